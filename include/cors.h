@@ -61,6 +61,20 @@ typedef struct cors_ntrip_source_info {
     UT_hash_handle ii;
 } cors_ntrip_source_info_t;
 
+typedef struct cors_ntrip_sbuf {
+    int ref,nb,type;                /* type: AGENT_SBUF_??? */
+    char buff[];
+} cors_ntrip_sbuf_t;
+
+#define AGENT_WQ_LEN     64         /* max pending messages per agent connection */
+#define AGENT_WQ_DROP    0          /* write queue policy: drop stale, keep newest */
+#define AGENT_WQ_COAL    1          /* write queue policy: coalesce to newest */
+#define AGENT_WQ_DISC    2          /* write queue policy: disconnect */
+#define AGENT_WQ_STALL   8192       /* stream write queue of stalled connection (bytes) */
+#define AGENT_SBUF_OBS   0          /* send buffer type: observation epoch */
+#define AGENT_SBUF_NAV   1          /* send buffer type: ephemeris messages */
+#define AGENT_SBUF_STA   2          /* send buffer type: station position (1005) */
+
 typedef struct cors_ntrip_conn {
     uv_tcp_t *conn;
     int state,nb,type,sta_chg;
@@ -69,7 +83,13 @@ typedef struct cors_ntrip_conn {
     char buff[MAXBUFLEN];
     double pos[3];
     gtime_t time;
-    struct cors_ntrip_agent *agent;
+    struct cors_ntrip_agent_loop *lp;
+    cors_ntrip_sbuf_t *wq[AGENT_WQ_LEN];
+    int wq_head,wq_n,wq_nb,del;
+    double gga_ref[3],gga_slack;    /* position and slack of last station query */
+    unsigned int gga_ver;           /* station index version of last query */
+    int gga_pend;
+    QUEUE gga_q;
     UT_hash_handle hh;
 } cors_ntrip_conn_t;
 
@@ -79,29 +99,63 @@ typedef struct cors_ntrip_conn_q {
     UT_hash_handle hh;
 } cors_ntrip_conn_q_t;
 
+#define NTRIP_SUBS_SHARD 64         /* number of subscriber registry shards */
+
+typedef struct cors_ntrip_subs_snap {
+    struct cors_ntrip_subs_snap *next;
+    int n;
+    char mntpnt[][32];              /* mountpoints with subscribers (sorted) */
+} cors_ntrip_subs_snap_t;
+
+typedef struct cors_ntrip_subs_shard {
+    cors_ntrip_conn_q_t *cq_tbl;    /* subscribers (writer only) */
+    cors_ntrip_subs_snap_t *snap;   /* published snapshot (any thread) */
+} cors_ntrip_subs_shard_t;
+
+typedef struct cors_ntrip_subs {
+    cors_ntrip_subs_shard_t shard[NTRIP_SUBS_SHARD];
+    unsigned int epoch;
+    int nreader[2];
+    cors_ntrip_subs_snap_t *retire[2];
+    uint64_t npub,nfree;
+} cors_ntrip_subs_t;
+
 typedef struct cors_ntrip_user {
     char user[64];
     char passwd[64];
     UT_hash_handle hh;
 } cors_ntrip_user_t;
 
-typedef struct cors_ntrip_agent {
-    int state;
+typedef struct cors_ntrip_agent_loop {
+    int ID,state;
     uv_thread_t thread;
     uv_async_t *close;
     uv_async_t *del_conn;
-    uv_async_t *add_conn;
     uv_async_t *send;
     uv_tcp_t *svr;
     uv_mutex_t del_lock;
     uv_mutex_t send_lock;
-    uv_mutex_t cq_lock;
-    struct cors_ntrip *ntrip;
-    cors_ntrip_conn_q_t *cq_tbl;
+    struct cors_ntrip_agent *agent;
+    cors_ntrip_subs_t subs;
     cors_ntrip_conn_t *conn_tbl;
-    cors_ntrip_user_t *user_tbl;
+    uv_timer_t *gga_timer;
     QUEUE del_queue;
     QUEUE send_queue;
+    QUEUE gga_queue;
+    uint64_t nconn,nwrite,nbyte;
+    uint64_t ndrop,nbdrop,nevict;
+    uint64_t ngga,nquery,nswitch;
+} cors_ntrip_agent_loop_t;
+
+typedef struct cors_ntrip_agent {
+    int state,nloop,port;
+    int wq_limit,wq_policy;
+    int gga_tick;                   /* gga reassignment tick (ms) (0:per message) */
+    double gga_hyst;                /* gga reassignment hysteresis (m) */
+    cors_ntrip_agent_loop_t *loops;
+    struct cors_ntrip *ntrip;
+    cors_ntrip_user_t *user_tbl;
+    uint64_t nnav;
 } cors_ntrip_agent_t;
 
 typedef struct cors_ntrip_caster {
@@ -119,6 +173,21 @@ typedef struct cors_ntrip_caster {
     UT_hash_handle hh;
 } cors_ntrip_caster_t;
 
+typedef struct cors_ntrip_stas_ent {
+    char name[64];
+    int ID;
+    double pos[3];
+    UT_hash_handle hh;
+} cors_ntrip_stas_ent_t;
+
+typedef struct cors_ntrip_stas {    /* immutable station index snapshot */
+    int ref,n;
+    unsigned int ver;
+    struct kdtree *tree;
+    cors_ntrip_stas_ent_t *tbl;
+    cors_ntrip_stas_ent_t sta[];
+} cors_ntrip_stas_t;
+
 typedef struct cors_ntrip {
     uv_timer_t *timer_stat;
     uv_async_t *close;
@@ -126,16 +195,29 @@ typedef struct cors_ntrip {
     cors_ntrip_source_info_t *info_tbl[2];
     cors_ntrip_caster_t *ctr_tbl;
     int state;
-    struct kdtree *src_kdtree;
+    uv_mutex_t info_lock;           /* changes of info_tbl and publish */
+    uv_mutex_t stas_lock;
+    unsigned int stas_ver;
+    cors_ntrip_stas_t *stas;
     struct cors* cors;
 } cors_ntrip_t;
 
+typedef struct cors_ring {
+    uint8_t *buff;
+    uint32_t size;
+    uint32_t head,tail;
+    uint64_t ndrop;
+} cors_ring_t;
+
 typedef struct cors_rtcm {
     rtcm_t rtcm;
+    cors_ring_t ring;
+    int queued;
+    QUEUE q;
     UT_hash_handle hh;
 } cors_rtcm_t;
 
-typedef struct cors_rtcm_decoder {
+typedef struct cors_rtcm_decoder_shard {
     uv_thread_t thread;
     uv_mutex_t tbl_lock,qlock;
     uv_timer_t *timer_stat;
@@ -143,22 +225,59 @@ typedef struct cors_rtcm_decoder {
     uv_async_t *close;
     cors_rtcm_t *data_tbl;
     QUEUE decode_queue;
-    int state;
+    int state,ID;
+    int nq,nq_max;
+    uint64_t nchunk,nbyte,nmsg,ndrop,tdecode;
+    struct cors_rtcm_decoder *decoder;
+} cors_rtcm_decoder_shard_t;
+
+typedef struct cors_rtcm_decoder {
+    uv_mutex_t nav_lock,sta_lock;   /* shared nav and station updates of shards */
+    uv_mutex_t moni_lock;           /* monitor tables updated by shards */
+    cors_rtcm_decoder_shard_t *shards;
+    int state,nshard;
     struct cors* cors;
 } cors_rtcm_decoder_t;
 
+typedef struct cors_obs_sub {
+    struct cors_baseline *bl;
+    struct cors_srtk *srtk;
+    UT_hash_handle hh;
+} cors_obs_sub_t;
+
+typedef struct cors_zdmod {
+    int ref,stat;
+    uv_mutex_t lock;
+    zdmod_t data;
+} cors_zdmod_t;
+
 typedef struct cors_obsd {
     obs_t obs;
     int srcid;
+    cors_zdmod_t *bmod;
+    cors_obs_sub_t *subs;
     UT_hash_handle hh;
 } cors_obsd_t;
 
 typedef struct cors_obs {
+    uv_mutex_t lock;
     cors_obsd_t *data;
 } cors_obs_t;
 
+#define NAVMSG_LEN       128
+
+typedef struct cors_navmsg {        /* encoded rtcm ephemeris message */
+    int nb;
+    char buff[NAVMSG_LEN];
+} cors_navmsg_t;
+
 typedef struct cors_nav {
     nav_t data;
+    uv_mutex_t lock;
+    cors_navmsg_t *msg;             /* messages of current ephemeris (NULL: no encoding) */
+    cors_ntrip_sbuf_t *rtcm;        /* all messages, rebuilt on new ephemeris */
+    uint64_t nenc,nupd;             /* number of encoded messages/rebuilds */
+    uint64_t nenc0,nupd0;           /* counts at start of last minute */
 } cors_nav_t;
 
 typedef struct cors_sta {
@@ -311,6 +430,18 @@ typedef struct cors_opt {
     char rtk_conf_file[MAXSTRPATH];
     char pnt_conf_file[MAXSTRPATH];
     char agent_user_file[MAXSTRPATH];
+    int decoder_threads;
+    int rtk_workers;
+    int vrs_workers;
+    int vrs_deadline;
+    double vrs_radius;
+    int vrs_idle;
+    int vrs_maxsta;
+    int agent_loops;
+    int agent_wq_limit;
+    int agent_wq_policy;
+    int agent_gga_tick;
+    double agent_gga_hyst;
 } cors_opt_t;
 
 typedef struct cors_ssat {
@@ -324,44 +455,93 @@ typedef struct cors_ssats {
     cors_ssat_t *data;
 } cors_ssats_t;
 
+typedef struct cors_blsat {
+    uint8_t sat;
+    uint8_t vsat[NFREQ],fix[NFREQ],slip[NFREQ],lflg[NFREQ],refsat[NFREQ];
+    double resc[NFREQ];
+    double dd[NFREQ];
+} cors_blsat_t;
+
+typedef struct cors_blsnap {
+    int ref,ns;
+    gtime_t time;
+    sol_t sol;
+    double rb[3],bl[3];
+    short idx[MAXSAT];
+    cors_blsat_t sat[MAXOBS];
+} cors_blsnap_t;
+
 typedef struct cors_blsol {
     int base_srcid,rover_srcid;
     char id[16];
-    rtk_t rtk;
+    cors_blsnap_t *snap,*spare;
+    uv_mutex_t lock;
     UT_hash_handle hh;
 } cors_blsol_t;
 
 typedef struct cors_blsols {
     cors_blsol_t *data;
+    uv_mutex_t lock;                /* lock of solution table */
 } cors_blsols_t;
 
 typedef struct cors_baseline {
-    int base_srcid,rover_srcid,on;
+    int base_srcid,rover_srcid,on,upd;
     char id[16];
     uint64_t wt;
     gtime_t time;
     rtk_t rtk;
     cors_blsol_t *sol;
+    uv_mutex_t lock;
+    uv_cond_t done;                 /* signaled when on drops to 0 */
+    int scheduled,nwait;
+    QUEUE tasks;
+    QUEUE q;
     UT_hash_handle hh;
 } cors_baseline_t;
 
+typedef struct cors_rtkpos_task {
+    struct cors_baseline *bl;
+    struct cors_srtk *srtk;
+    obs_t *robs,*bobs;
+    cors_zdmod_t *bmod;
+    QUEUE q;
+} cors_rtkpos_task_t;
+
+typedef struct cors_rtkpool_worker {
+    uv_thread_t thread;
+    uv_mutex_t lock;
+    QUEUE deque;
+    int ID;
+    uint64_t nrun,nsteal;
+    struct cors_rtkpool *pool;
+} cors_rtkpool_worker_t;
+
+typedef struct cors_rtkpool {
+    cors_rtkpool_worker_t *workers;
+    uv_mutex_t lock;
+    uv_cond_t cond;
+    int nworker,npend,state;
+    struct cors* cors;
+} cors_rtkpool_t;
+
 typedef struct cors_baselines {
     cors_baseline_t *data;
 } cors_baselines_t;
 
 typedef struct cors_srtk {
-    uv_thread_t thread[2];
+    uv_thread_t thread;
     int state,ID;
 
     uv_mutex_t addbl_lock;
     uv_mutex_t delbl_lock;
-    uv_mutex_t rtkpos_lock;
+    uv_mutex_t event_lock;
+    uv_cond_t event_cond;
+    int nevent;
 
     cors_baselines_t bls;
     struct cors* cors;
     struct cors_nrtk* nrtk;
     prcopt_t opt;
-    QUEUE rtkpos_queue;
     QUEUE addbl_queue,delbl_queue;
     UT_hash_handle hh;
 } cors_srtk_t;
@@ -379,6 +559,7 @@ typedef struct cors_dtrig_edge_q {
 typedef struct cors_dtrig_vertex {
     int srcid;
     double pos[3];
+    double xy[2];
     uint64_t wt;
     gtime_t time;
     cors_dtrig_vertex_q_t *vt_list;
@@ -392,6 +573,9 @@ typedef struct cors_dtrig_edge {
     char id[32];
     cors_dtrig_vertex_t *vt[2];
     cors_baseline_t *bl;
+    struct cors_dtrig *dtrig;
+    uint32_t mark;
+    int bad;
     UT_hash_handle hh;
 } cors_dtrig_edge_t;
 
@@ -402,6 +586,9 @@ typedef struct cors_dtrig {
     cors_dtrig_vertex_t *vt[3];
     cors_dtrig_edge_t *edge[3];
     cors_dtrig_edge_t *edge_f[3][2];
+    struct cors_vrs_model *vmod[3];
+    uint32_t mark;
+    int bad;
     UT_hash_handle hh;
 } cors_dtrig_t;
 typedef cors_dtrig_t cors_bsta_trig_t;
@@ -411,28 +598,31 @@ typedef struct cors_dtrig_net {
     cors_dtrig_vertex_t *vertexs;
     cors_dtrig_edge_t *edges;
     struct kdtree *vts_kdtree;
-    int state;
+    double r0[3],pos0[3];
+    uint32_t stamp;
+    int state,org,nkd_dead;
 } cors_dtrig_net_t;
 
 typedef struct cors_nrtk {
     uv_thread_t thread;
-    uv_mutex_t addsrc_lock,delsrc_lock;
+    uv_mutex_t addsrc_lock,delsrc_lock,updsrc_lock;
     uv_mutex_t addvsta_lock,delvsta_lock;
     uv_mutex_t addbl_lock,delbl_lock;
     uv_mutex_t updbl_lock;
 
     int state;
+    uint64_t tvrs;                  /* last on-demand vrs tick (ns) */
     cors_dtrig_net_t dtrig_net;
     cors_srtk_t *srtk;
     struct cors* cors;
     QUEUE addvsta_queue,delvsta_queue;
-    QUEUE addsrc_queue,delsrc_queue;
+    QUEUE addsrc_queue,delsrc_queue,updsrc_queue;
     QUEUE addbl_queue,delbl_queue;
     QUEUE updbl_queue;
 } cors_nrtk_t;
 
 typedef struct cors_vrs_sta {
-    int srcid,in_dtrig;
+    int srcid,in_dtrig,ondemand;
     char name[64];
     double pos[3];
     obs_t obs;
@@ -441,6 +631,10 @@ typedef struct cors_vrs_sta {
     rtcm_t rtcm;
     cors_master_sta_t *msta;
     cors_bsta_trig_t *trig;
+    uv_mutex_t lock;
+    int scheduled;
+    struct cors_vrs_task *task;
+    QUEUE q;
     UT_hash_handle hh;
 } cors_vrs_sta_t;
 
@@ -449,20 +643,67 @@ typedef struct cors_vrs_sta_q {
     UT_hash_handle hh;
 } cors_vrs_sta_q_t;
 
+typedef struct cors_vrs_coef {
+    int sat,stat[NFREQ];
+    double c[NFREQ][3];
+    double r,dts,trop;
+} cors_vrs_coef_t;
+
+typedef struct cors_vrs_model {
+    int ref,stat,n,nc;
+    uv_mutex_t lock;
+    gtime_t time;
+    double pos[3];
+    const cors_blsnap_t **snap;
+    int *dire;
+    cors_vrs_coef_t coef[MAXOBS];
+} cors_vrs_model_t;
+
 typedef struct cors_vrs_stas {
     cors_vrs_sta_t *data;
 } cors_vrs_stas_t;
 
+typedef struct cors_vrs_task {
+    obs_t mobs;
+    uint64_t tq;
+    cors_vrs_model_t *mod;
+    struct cors_vrs_sta *vsta;
+    struct cors_vrs *vrs;
+} cors_vrs_task_t;
+
+#define VRS_NLATENCY     10000
+
+typedef struct cors_vrspool {
+    uv_thread_t *threads;
+    uv_mutex_t lock;
+    uv_cond_t cond,done;            /* done: station finished for cancel */
+    QUEUE queue;
+    int nworker,state,nwait;
+    uint64_t deadline;
+    uint64_t ngen,nlate,nskip;
+    uint32_t latency[VRS_NLATENCY+1];
+} cors_vrspool_t;
+
+typedef struct cors_vrs_dsta {      /* on-demand vrs station */
+    char name[32];
+    double pos[3];
+    int nuser,stat;                 /* stat: 0:to create,1:created,2:evicted */
+    gtime_t tu;                     /* last time used */
+    struct cors_vrs_dsta *next;     /* pending create/delete list */
+    UT_hash_handle hh;
+} cors_vrs_dsta_t;
+
 typedef struct cors_vrs {
-    int state;
-    uv_thread_t thread;
-    uv_async_t *upd_vrs;
-    uv_async_t *close;
-    uv_mutex_t upd_vrs_lock;
+    int state,outrnx;
+    cors_vrspool_t pool;
     cors_vrs_stas_t stas;
+    uv_mutex_t dlock;
+    cors_vrs_dsta_t *dstas,*dadd,*ddel;
+    struct kdtree *dsta_kdtree;
+    int dseq,ndsta;                 /* ndsta: on-demand stations not yet freed */
+    gtime_t tevict;
     cors_nrtk_t *nrtk;
     struct cors* cors;
-    QUEUE upd_vrs_queue;
 } cors_vrs_t;
 
 typedef struct cors_cli {
@@ -487,6 +728,7 @@ typedef struct cors {
     cors_pnt_t pnt;
     cors_monitor_t monitor;
     cors_srtk_t srtk;
+    cors_rtkpool_t rtkpool;
     cors_nrtk_t nrtk;
     cors_vrs_t vrs;
     cors_ci_t ci;
@@ -517,13 +759,29 @@ EXPORT void cors_ntrip_close(cors_ntrip_t *ntrip);
 EXPORT void cors_ntrip_add_source(cors_ntrip_t *ntrip, cors_ntrip_source_info_t *info);
 EXPORT void cors_ntrip_del_source(cors_ntrip_t *ntrip, const char *name);
 EXPORT void cors_ntrip_source_updpos(cors_ntrip_t *ntrip, const double *pos, int srcid);
+EXPORT void cors_ntrip_stas_publish(cors_ntrip_t *ntrip);
+EXPORT cors_ntrip_stas_t *cors_ntrip_stas_get(cors_ntrip_t *ntrip);
+EXPORT void cors_ntrip_stas_unref(cors_ntrip_stas_t *stas);
+EXPORT const cors_ntrip_stas_ent_t *cors_ntrip_stas_nearest(const cors_ntrip_stas_t *stas, const double *pos);
+EXPORT const cors_ntrip_stas_ent_t *cors_ntrip_stas_find(const cors_ntrip_stas_t *stas, const char *name);
 
 EXPORT void cors_updnav(cors_nav_t *cors_nav, const nav_t *nav, int ephsat, int ephset);
 EXPORT void cors_updobs(cors_obs_t *cors_obs, const obsd_t *obsd, int n, int srcid);
+EXPORT void cors_subobs(cors_obs_t *cors_obs, int srcid, cors_baseline_t *bl, cors_srtk_t *srtk);
+EXPORT void cors_unsubobs(cors_obs_t *cors_obs, int srcid, const cors_baseline_t *bl);
+EXPORT cors_zdmod_t* cors_zdmod_ref(cors_obsd_t *obsd);
+EXPORT const zdmod_t* cors_zdmod_upd(cors_zdmod_t *mod, gtime_t teph, const obs_t *obs,
+                                     const nav_t *nav, const double *rr, const prcopt_t *opt);
+EXPORT void cors_zdmod_unref(cors_zdmod_t *mod);
 EXPORT int cors_start(cors_t* cors, const cors_opt_t *opt);
+EXPORT void cors_set_thread_rt_priority(void);
 EXPORT void cors_updssat(cors_ssats_t *ssats, ssat_t *ssat, int srcid, int upd_flag, gtime_t time);
 EXPORT void cors_updsta(cors_stas_t *stas, const sta_t *sta, int srcid);
 EXPORT void cors_updblsol(cors_blsols_t *blsols, cors_baseline_t *bl, const rtk_t *rtk, int base_srcid, int rover_srcid);
+EXPORT const cors_blsnap_t* cors_blsol_snap(cors_blsol_t *blsol);
+EXPORT const cors_blsnap_t* cors_blsnap_ref(const cors_blsnap_t *snap);
+EXPORT void cors_blsnap_unref(const cors_blsnap_t *snap);
+EXPORT const cors_blsat_t* cors_blsnap_sat(const cors_blsnap_t *snap, int sat);
 EXPORT void cors_freenav(cors_nav_t *nav);
 EXPORT void cors_freeobs(cors_obs_t *obs);
 EXPORT void cors_freessat(cors_ssats_t *ssat);
@@ -533,7 +791,10 @@ EXPORT void cors_freesta(cors_stas_t *stas);
 EXPORT void cors_initssat(cors_ssats_t *ssat);
 EXPORT void cors_initsta(cors_stas_t *stas);
 EXPORT int cors_initnav(cors_nav_t *nav);
+EXPORT int cors_initnavrtcm(cors_nav_t *nav);
+EXPORT cors_ntrip_sbuf_t* cors_navrtcm(cors_nav_t *nav);
 EXPORT void cors_initobs(cors_obs_t *obs);
+EXPORT void cors_initblsol(cors_blsols_t *blsols);
 EXPORT void cors_add_source(cors_t *cors, const char *name, const char *addr, int port, const char *user, const char *passwd,
                             const char *mntpnt, const double *pos);
 EXPORT void cors_del_source(cors_t *cors, const char *name);
@@ -542,6 +803,12 @@ EXPORT void cors_del_baseline(cors_t *cors, const char *base, const char *rover)
 EXPORT void cors_basenet_del_baseline(cors_t *cors, const char *base, const char *rover);
 EXPORT void cors_basenet_add_baseline(cors_t *cors, const char *base, const char *rover);
 
+EXPORT int cors_ring_init(cors_ring_t *ring, int size);
+EXPORT void cors_ring_free(cors_ring_t *ring);
+EXPORT int cors_ring_write(cors_ring_t *ring, const uint8_t *data, int n);
+EXPORT int cors_ring_peek(cors_ring_t *ring, uint8_t **p);
+EXPORT void cors_ring_commit(cors_ring_t *ring, int n);
+
 EXPORT int cors_rtcm_decoder_start(cors_rtcm_decoder_t *decoder, cors_t* cors);
 EXPORT void cors_rtcm_decoder_close(cors_rtcm_decoder_t *decoder);
 EXPORT int cors_rtcm_decode(cors_rtcm_decoder_t *decoder, const uint8_t *data, int n, int srcid);
@@ -570,15 +837,24 @@ EXPORT int cors_srtk_start(cors_srtk_t *srtk, cors_t *cors, cors_nrtk_t *nrtk, c
 EXPORT int cors_srtk_close(cors_srtk_t *srtk);
 EXPORT int cors_srtk_add_baseline(cors_srtk_t *srtk, int base_srcid, int rover_srcid);
 EXPORT int cors_srtk_del_baseline(cors_srtk_t *srtk, int base_srcid, int rover_srcid);
+EXPORT void cors_srtk_notify(cors_srtk_t *srtk, cors_baseline_t *bl);
+EXPORT void cors_srtk_rtkpos(cors_rtkpos_task_t *task);
+
+EXPORT int cors_rtkpool_start(cors_rtkpool_t *pool, cors_t *cors, int nworker);
+EXPORT void cors_rtkpool_close(cors_rtkpool_t *pool);
+EXPORT void cors_rtkpool_push(cors_rtkpool_t *pool, cors_rtkpos_task_t *task);
 
 EXPORT void cors_dtrignet_init(cors_dtrig_net_t *dtrig_net);
 EXPORT void cors_dtrignet_free(cors_dtrig_net_t *dtrig_net);
-EXPORT int cors_dtrignet_build(cors_dtrig_net_t *dtrig_net, cors_dtrig_edge_t **edge_add, cors_dtrig_edge_t **edge_del);
+EXPORT int cors_dtrignet_build(cors_dtrig_net_t *dtrig_net, cors_dtrig_edge_t **edge_add, cors_dtrig_edge_t **edge_del,
+                               cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del);
 EXPORT int cors_dtrignet_add_vertex(cors_dtrig_net_t *dtrig_net, const double *pos, int srcid, cors_dtrig_edge_t **edge_add,
-                                    cors_dtrig_edge_t **edge_del);
-EXPORT void cors_dtrignet_upd_vertex(cors_dtrig_net_t *dtrig_net, const double *pos, int srcid);
+                                    cors_dtrig_edge_t **edge_del, cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del);
+EXPORT int cors_dtrignet_upd_vertex(cors_dtrig_net_t *dtrig_net, const double *pos, int srcid, cors_dtrig_edge_t **edge_add,
+                                    cors_dtrig_edge_t **edge_del, cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del);
 EXPORT void cors_dtrignet_del_vertex(cors_dtrig_net_t *dtrig_net, int srcid, cors_dtrig_edge_t **edge_add,
-                                     cors_dtrig_edge_t **edge_del);
+                                     cors_dtrig_edge_t **edge_del, cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del);
+EXPORT cors_dtrig_t* cors_dtrignet_locate(cors_dtrig_net_t *dtrig_net, const double *pos, int *in);
 EXPORT void cors_dtrignet_upd_edge(cors_dtrig_net_t *dtrig_net, cors_baseline_t *bl, int base_srcid, int rover_srcid);
 EXPORT void cors_dtrignet_del_edge(cors_dtrig_net_t *dtrig_net, int srcid1, int srcid2);
 EXPORT void cors_dtrignet_add_edge(cors_dtrig_net_t *dtrig_net, int srcid1, int srcid2);
@@ -590,19 +866,46 @@ EXPORT void cors_nrtk_del_baseline(cors_nrtk_t *nrtk, int base_srcid, int rover_
 EXPORT void cors_nrtk_add_baseline(cors_nrtk_t *nrtk, int base_srcid, int rover_srcid);
 EXPORT void cors_nrtk_add_source(cors_nrtk_t *nrtk, int srcid, const double *pos);
 EXPORT void cors_nrtk_del_source(cors_nrtk_t *nrtk, int srcid);
+EXPORT void cors_nrtk_upd_source(cors_nrtk_t *nrtk, int srcid, const double *pos);
 EXPORT void cors_nrtk_add_vsta(cors_nrtk_t *nrtk, const char *name, const double *pos);
 EXPORT void cors_nrtk_del_vsta(cors_nrtk_t *nrtk, const char *name);
 
-EXPORT int cors_vrs_upd(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const cors_master_sta_t *msta, const obs_t *mobs, const rtk_t **rtk, int n);
+EXPORT cors_vrs_model_t* cors_vrs_model_new(gtime_t time, const double *pos, const cors_blsnap_t **snap, const int *dire, int n);
+EXPORT cors_vrs_model_t* cors_vrs_model_ref(cors_vrs_model_t *mod);
+EXPORT void cors_vrs_model_unref(cors_vrs_model_t *mod);
+EXPORT int cors_vrs_model_fit(cors_vrs_model_t *mod, const nav_t *nav, const obs_t *mobs);
+EXPORT int cors_vrs_model_obs(const cors_vrs_model_t *mod, const nav_t *nav, const double *vpos, int corr, const obs_t *mobs, obsd_t *vobs);
+EXPORT void cors_vrs_work(cors_vrs_task_t *task);
+EXPORT void cors_vrs_free_task(cors_vrs_task_t *task);
+EXPORT int cors_vrspool_start(cors_vrspool_t *pool, int nworker, int deadline);
+EXPORT void cors_vrspool_close(cors_vrspool_t *pool);
+EXPORT void cors_vrspool_push(cors_vrspool_t *pool, cors_vrs_task_t *task);
+EXPORT void cors_vrspool_cancel(cors_vrspool_t *pool, cors_vrs_sta_t *vsta);
+EXPORT double cors_vrspool_latency(cors_vrspool_t *pool, double p);
+EXPORT int cors_vrs_upd(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const cors_master_sta_t *msta, const obs_t *mobs, const cors_blsnap_t **snap, int n);
 EXPORT int cors_vrs_start(cors_vrs_t *vrs, cors_t *cors, cors_nrtk_t *nrtk, const char *vstas_file);
 EXPORT void cors_vrs_close(cors_vrs_t *vrs);
+EXPORT int cors_vrs_attach(cors_vrs_t *vrs, const double *pos, const char *cur, char *name);
+EXPORT void cors_vrs_detach(cors_vrs_t *vrs, const char *name);
+EXPORT int cors_vrs_evict(cors_vrs_t *vrs);
+EXPORT void cors_vrs_ondemand(cors_vrs_t *vrs);
 
-EXPORT int cors_ntrip_agent_start(cors_ntrip_agent_t *agent, cors_ntrip_t *ntrip, const char *users_file);
+EXPORT int cors_ntrip_agent_start(cors_ntrip_agent_t *agent, cors_ntrip_t *ntrip, const char *users_file,
+                                  int nloop);
 EXPORT void cors_ntrip_agent_close(cors_ntrip_agent_t *agent);
-EXPORT int cors_ntrip_agent_send(cors_ntrip_agent_t *agent, const char *mntpnt, const char *buff, int nb,
-                                 const nav_t *nav);
+EXPORT int cors_ntrip_agent_send(cors_ntrip_agent_t *agent, const char *mntpnt, const char *buff, int nb);
 EXPORT int cors_ntrip_agent_add_user(cors_ntrip_agent_t *agent, const char *user, const char *passwd);
 EXPORT int cors_ntrip_agent_del_user(cors_ntrip_agent_t *agent, const char *user);
+EXPORT cors_ntrip_sbuf_t* cors_ntrip_sbuf_new(const char *buff, int nb);
+EXPORT void cors_ntrip_sbuf_ref(cors_ntrip_sbuf_t *sbuf);
+EXPORT void cors_ntrip_sbuf_unref(cors_ntrip_sbuf_t *sbuf);
+
+EXPORT void cors_ntrip_subs_init(cors_ntrip_subs_t *subs);
+EXPORT void cors_ntrip_subs_free(cors_ntrip_subs_t *subs);
+EXPORT cors_ntrip_conn_q_t *cors_ntrip_subs_get(cors_ntrip_subs_t *subs, const char *mntpnt);
+EXPORT void cors_ntrip_subs_add(cors_ntrip_subs_t *subs, const char *mntpnt, cors_ntrip_conn_t *c);
+EXPORT cors_ntrip_conn_t *cors_ntrip_subs_del(cors_ntrip_subs_t *subs, const char *mntpnt, uv_tcp_t *conn);
+EXPORT int cors_ntrip_subs_has(cors_ntrip_subs_t *subs, const char *mntpnt);
 
 #ifdef __cplusplus
 }
@@ -19,6 +19,7 @@ extern "C" {
 EXPORT void log_trace_open(const char *file);
 EXPORT void log_trace_close(void);
 EXPORT void log_set_level(int level);
+EXPORT uint64_t log_trace_ndrop(void);
 EXPORT void log_trace(int level, const char *format, ...);
 EXPORT void log_traceobs(int level, const obsd_t *obs, int n);
 EXPORT void log_tracemat(int level, const double *A, int n, int m, int p, int q);
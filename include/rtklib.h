@@ -245,6 +245,7 @@ extern "C" {
 #define MAXLEAPS    64                  /* max number of leap seconds table */
 #define MAXGISLAYER 32                  /* max number of GIS data layers */
 #define MAXRCVCMD   4096                /* max length of receiver commands */
+#define MAXEPHIDX   4                   /* max number of indexed ephemerides per satellite */
 
 #define RNX2VER     2.10                /* RINEX ver.2 default output version */
 #define RNX3VER     3.00                /* RINEX ver.3 default output version */
@@ -744,6 +745,8 @@ typedef struct {        /* navigation data type */
     sbsion_t sbsion[MAXBAND+1]; /* SBAS ionosphere corrections */
     dgps_t dgps[MAXSAT]; /* DGPS corrections */
     ssr_t ssr[MAXSAT];  /* SSR corrections */
+    int ephidx;         /* ephemeris index enabled (0:scan eph/geph,1:eidx) */
+    int eidx[MAXSAT][MAXEPHIDX]; /* eph/geph index+1 by satellite (ascending,0:none) */
 } nav_t;
 
 typedef struct {        /* station parameter type */
@@ -1027,6 +1030,53 @@ typedef struct {        /* ambiguity control type */
     char flags[MAXSAT]; /* fix flags */
 } ambc_t;
 
+typedef struct {        /* kalman filter workspace type */
+    int nmax,mmax;      /* allocated number of active states/measurements */
+    int *ix,*ipiv;      /* index of active states, pivot of matrix inverse */
+    double *x,*xp;      /* active states before/after update */
+    double *P,*Pp;      /* active states covariance before/after update */
+    double *H;          /* design matrix of active states */
+    double *F,*Q,*K,*I,*work; /* filter temporaries */
+    double *buf;        /* scratch of epoch temporaries */
+    int nbuf,pbuf,hbuf; /* size/used/high-water mark of scratch (doubles) */
+    int novf;           /* size of scratch blocks beyond buf (doubles) */
+    void *ovf;          /* scratch blocks beyond buf */
+} filtws_t;
+
+typedef struct {        /* options of undifferenced model type */
+    int nf;             /* number of frequencies */
+    int navsys;         /* navigation system */
+    int sateph;         /* satellite ephemeris/clock (EPHOPT_???) */
+    int ionoopt;        /* ionosphere option (IONOOPT_???) */
+    int tropopt;        /* troposphere option (TROPOPT_???) */
+    int tidecorr;       /* earth tide correction */
+    int pcvopt;         /* phase center variation option (posopt[1]) */
+    int snrena;         /* SNR mask enable flag of base */
+    double elmin;       /* elevation mask angle (rad) */
+    double snrmask[NFREQ][9]; /* SNR mask (dBHz) (snrena!=0) */
+    double antdel[3];   /* base antenna delta (m) */
+    double off[NFREQ][3]; /* base antenna phase center offset (m) */
+    double pcv[NFREQ][19]; /* base antenna phase center variation (m) */
+    double odisp[6*11]; /* base ocean tide loading parameters */
+    uint8_t exsats[MAXSAT]; /* excluded satellites */
+} zdopt_t;
+
+typedef struct {        /* undifferenced model of station epoch type */
+    gtime_t time;       /* time of observation data (gpst) */
+    gtime_t teph;       /* time of satellite ephemeris selection (gpst) */
+    int n,nf;           /* number of observation data/frequencies */
+    double rr[3];       /* station position (ecef) (m) */
+    zdopt_t opt;        /* options of the model */
+    double rs[MAXOBS*6]; /* satellite positions and velocities (ecef) */
+    double dts[MAXOBS*2]; /* satellite clocks */
+    double var[MAXOBS]; /* satellite position and clock variances (m^2) */
+    int svh[MAXOBS];    /* satellite health flags */
+    double y[MAXOBS*NFREQ*2]; /* UD phase/code residuals (m) */
+    double e[MAXOBS*3]; /* line-of-sight vectors */
+    double azel[MAXOBS*2]; /* azimuth/elevation angles (rad) */
+    double freq[MAXOBS*NFREQ]; /* carrier frequencies (Hz) */
+} zdmod_t;
+
 typedef struct {        /* RTK control/result type */
     gtime_t time;       /* RTK time */
     sol_t  sol;         /* RTK solution */
@@ -1038,6 +1088,11 @@ typedef struct {        /* RTK control/result type */
     double *x, *P;      /* float states and their covariance */
     double *xa,*Pa;     /* fixed states and their covariance */
     double *xp,*Pp,*xl,*H,*R,*bias,*v;
+    filtws_t ws;        /* kalman filter workspace */
+    int nsmax;          /* number of satellite state slots (ionos/phase-bias) */
+    short *slots;       /* satellite of state slot (0:free) */
+    short sslot[MAXSAT]; /* state slot of satellite (-1:none) */
+    short sout[MAXSAT]; /* outage epochs of satellite with state slot */
     int nfix;           /* number of continuous fixes of ambiguity */
     ambc_t ambc[MAXSAT]; /* ambiguity control */
     ssat_t ssat[MAXSAT]; /* satellite status */
@@ -1090,6 +1145,15 @@ EXPORT int  lsq   (const double *A, const double *y, int n, int m, double *x,
                    double *Q);
 EXPORT int  filter(double *x, double *P, const double *H, const double *v,
                    const double *R, int n, int m, const int *ix_, int nx_);
+EXPORT int  filter_ws(double *x, double *P, const double *H, const double *v,
+                      const double *R, int n, int m, const int *ix_, int nx_,
+                      filtws_t *ws);
+EXPORT int  filtws_init(filtws_t *ws, int n, int m);
+EXPORT void filtws_free(filtws_t *ws);
+EXPORT double *filtws_mat  (filtws_t *ws, int n, int m);
+EXPORT int    *filtws_imat (filtws_t *ws, int n, int m);
+EXPORT void    filtws_reset(filtws_t *ws);
+EXPORT int     filtws_matinv(filtws_t *ws, double *A, int n);
 EXPORT int  smoother(const double *xf, const double *Qf, const double *xb,
                      const double *Qb, int n, double *xs, double *Qs);
 EXPORT void matfprint(const double *A, int n, int m, int p, int q, FILE *fp);
@@ -1225,6 +1289,8 @@ EXPORT double satdis(const double *rr, const obsd_t *obs, const nav_t *nav, int
 
 EXPORT void setseleph(int sys, int sel);
 EXPORT int  getseleph(int sys);
+EXPORT void setephcache(int ena);
+EXPORT int  getephcache(uint64_t *nhit, uint64_t *nmiss);
 EXPORT void readsp3(const char *file, nav_t *nav, int opt);
 EXPORT int  readsap(const char *file, gtime_t time, nav_t *nav);
 EXPORT int  readdcb(const char *file, nav_t *nav, const sta_t *sta);
@@ -1244,6 +1310,8 @@ EXPORT int decode_word (uint32_t word, uint8_t *data);
 /* integer ambiguity resolution ----------------------------------------------*/
 EXPORT int lambda(int n, int m, const double *a, const double *Q, double *F,
                   double *s);
+EXPORT int lambda_ws(int n, int m, const double *a, const double *Q, double *F,
+                     double *s, filtws_t *ws);
 EXPORT int lambda_reduction(int n, const double *Q, double *Z);
 EXPORT int lambda_search(int n, int m, const double *a, const double *Q,
                          double *F, double *s);
@@ -1270,10 +1338,17 @@ EXPORT int ppp_ar(rtk_t *gposd, const obsd_t *obs, int n, int *exc, const nav_t
                   const double *azel, double *x, double *P);
 EXPORT void pppos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav);
 EXPORT int rtkpos(rtk_t *rtk, const obs_t *robs, const obs_t *bobs, const nav_t *nav);
+EXPORT int rtkpos_zd(rtk_t *rtk, const obs_t *robs, const obs_t *bobs, const zdmod_t *bmod,
+                     const nav_t *nav);
+EXPORT int zdmodel(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav,
+                   const double *rr, const prcopt_t *opt, zdmod_t *mod);
+EXPORT int zdmodmatch(const zdmod_t *mod, gtime_t teph, gtime_t time, int n,
+                      const double *rr, const prcopt_t *opt);
 
 EXPORT int pppnx(const prcopt_t *opt);
 EXPORT void rtkfree(rtk_t *rtk);
 EXPORT void rtkinit(rtk_t *rtk, const prcopt_t *opt);
+EXPORT int rtkslots(rtk_t *rtk, int nslot);
 
 /* nmea message functions-----------------------------------------------------*/
 EXPORT int outnmea_gga(uint8_t *buff, const sol_t *sol);
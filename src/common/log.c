@@ -6,33 +6,259 @@
  * history : 2022/11/17 1.0  new
  *-----------------------------------------------------------------------------*/
 #include "log.h"
+#ifndef WIN32
+#include <sys/time.h>
+#endif
 
 #if OUTPUT_LOG
+
+#define LOG_RING_SIZE   65536       /* per-thread ring size (bytes, power of 2) */
+#define LOG_BATCH_SIZE  65536       /* writer batch size (bytes) */
+#define LOG_MSG_SIZE    4096        /* max message size (bytes) */
+#define LOG_IDLE_MS     10          /* writer sleep when rings are empty (ms) */
+
+#ifdef WIN32
+#define LOG_TLS         __declspec(thread)
+#else
+#define LOG_TLS         __thread
+#endif
+#define LOAD_ACQ(p)     __atomic_load_n(p,__ATOMIC_ACQUIRE)
+#define STORE_REL(p,v)  __atomic_store_n(p,v,__ATOMIC_RELEASE)
+
+typedef struct log_ring {           /* per-thread message ring */
+    char buff[LOG_RING_SIZE];       /* records: length (uint32) + message */
+    uint32_t head,tail;             /* producer/consumer positions */
+    uint64_t ndrop;                 /* number of dropped messages */
+    int dead;                       /* owner thread exited (1:freed by writer) */
+    struct log_ring *next;          /* next ring of writer list */
+} log_ring_t;
+
 static FILE *fp_trace=NULL;         /* file pointer of trace */
 static char file_trace[1024]={0};   /* trace file */
 static int level_trace=0;           /* level of trace */
-static lock_t lock_trace;           /* lock for trace */
+static lock_t lock_trace;           /* lock for ring registration */
+static log_ring_t *rings=NULL;      /* rings of logging threads */
+static int state_trace=0;           /* writer state (1:running) */
+static thread_t thread_trace;       /* writer thread */
+static uint64_t ndrop_trace=0;      /* number of dropped messages reported */
+static uint64_t ndrop_dead=0;       /* dropped messages of freed rings */
+#ifdef WIN32
+static DWORD key_trace;             /* key to mark ring dead on thread exit */
+#else
+static pthread_key_t key_trace;     /* key to mark ring dead on thread exit */
+#endif
+static LOG_TLS log_ring_t *ring_thread=NULL; /* ring of this thread */
+
+/* time string of log message (yyyy/mm/dd hh:mm:ss.sss) ------------------------
+ * formatted once per second and per thread, clock re-synced to timeget() every
+ * minute
+ *-----------------------------------------------------------------------------*/
+static int time_prefix(char *buff)
+{
+#ifdef WIN32
+    time2str(timeget(),buff,3);
+    return (int)strlen(buff);
+#else
+    static LOG_TLS gtime_t t0,tp;
+    static LOG_TLS double tv0=-1.0;
+    static LOG_TLS char str[32];
+    struct timeval tv;
+    gtime_t t;
+    double now;
+    int ms;
+
+    gettimeofday(&tv,NULL);
+    now=tv.tv_sec+tv.tv_usec*1E-6;
+    if (tv0<0.0||now-tv0>60.0||now<tv0) {
+        t0=timeget(); tv0=now; tp.time=0;
+    }
+    t=timeadd(t0,now-tv0);
+    if (t.time!=tp.time) {
+        tp=t; tp.sec=0.0;
+        time2str(tp,str,0);
+    }
+    if ((ms=(int)(t.sec*1000.0))>999) ms=999;
+    return sprintf(buff,"%s.%03d",str,ms);
+#endif
+}
+/* owner thread of ring exited, ring is freed by writer once drained --------*/
+#ifdef WIN32
+static void WINAPI ring_exit(void *arg)
+#else
+static void ring_exit(void *arg)
+#endif
+{
+    ring_thread=NULL;
+    if (arg) STORE_REL(&((log_ring_t *)arg)->dead,1);
+}
+/* ring of calling thread (registered to writer on first use) ----------------*/
+static log_ring_t *get_ring(void)
+{
+    log_ring_t *ring;
+
+    if (ring_thread) return ring_thread;
+    if (!(ring=calloc(1,sizeof(log_ring_t)))) return NULL;
 
+    lock(&lock_trace);
+    ring->next=rings;
+    STORE_REL(&rings,ring);
+    unlock(&lock_trace);
+#ifdef WIN32
+    FlsSetValue(key_trace,ring);
+#else
+    pthread_setspecific(key_trace,ring);
+#endif
+    return ring_thread=ring;
+}
+/* unlink and free drained ring of exited thread (writer) ---------------------*/
+static void free_ring(log_ring_t *ring)
+{
+    log_ring_t **p;
+
+    lock(&lock_trace);
+    for (p=&rings;*p&&*p!=ring;p=&(*p)->next) ;
+    if (*p) *p=ring->next;
+    __atomic_add_fetch(&ndrop_dead,__atomic_load_n(&ring->ndrop,__ATOMIC_RELAXED),__ATOMIC_RELAXED);
+    unlock(&lock_trace);
+    free(ring);
+}
+/* put message to ring of calling thread (dropped if ring is full) -----------*/
+static void put_msg(const char *msg, int n)
+{
+    log_ring_t *ring;
+    uint32_t head,off,m,len=(uint32_t)n;
+
+    if (n<=0||!(ring=get_ring())) return;
+
+    head=ring->head;
+    if (LOG_RING_SIZE-(head-LOAD_ACQ(&ring->tail))<len+sizeof(len)) {
+        __atomic_add_fetch(&ring->ndrop,1,__ATOMIC_RELAXED);
+        return;
+    }
+    for (m=0;m<sizeof(len);m++) ring->buff[(head+m)&(LOG_RING_SIZE-1)]=((char*)&len)[m];
+    head+=sizeof(len);
+    off=head&(LOG_RING_SIZE-1);
+    m=LOG_RING_SIZE-off<len?LOG_RING_SIZE-off:len;
+    memcpy(ring->buff+off,msg,m);
+    memcpy(ring->buff,msg+m,len-m);
+    STORE_REL(&ring->head,head+len);
+}
+/* drain rings to trace file in batch (writer) -------------------------------*/
+static int flush_rings(void)
+{
+    static char batch[LOG_BATCH_SIZE];
+    char msg[128],tbuf[64];
+    log_ring_t *ring,*next;
+    uint32_t head,tail,off,m,len;
+    uint64_t ndrop;
+    int nb=0,n=0,dead;
+
+    for (ring=LOAD_ACQ(&rings);ring;ring=next) {
+        next=ring->next;
+        dead=LOAD_ACQ(&ring->dead);
+        head=LOAD_ACQ(&ring->head);
+
+        for (tail=ring->tail;tail!=head;tail+=len,n++) {
+            for (m=0;m<sizeof(len);m++) ((char*)&len)[m]=ring->buff[(tail+m)&(LOG_RING_SIZE-1)];
+            tail+=sizeof(len);
+            if (nb+len>LOG_BATCH_SIZE) {
+                fwrite(batch,1,nb,fp_trace);
+                nb=0;
+            }
+            off=tail&(LOG_RING_SIZE-1);
+            m=LOG_RING_SIZE-off<len?LOG_RING_SIZE-off:len;
+            memcpy(batch+nb,ring->buff+off,m);
+            memcpy(batch+nb+m,ring->buff,len-m);
+            nb+=len;
+        }
+        STORE_REL(&ring->tail,tail);
+        if (dead) free_ring(ring);
+    }
+    ndrop=log_trace_ndrop();
+    if (ndrop>ndrop_trace) {
+        time_prefix(tbuf);
+        m=sprintf(msg,"%s [WARN]: log messages dropped: %llu\n",tbuf,(unsigned long long)(ndrop-ndrop_trace));
+        if (nb+m>LOG_BATCH_SIZE) {fwrite(batch,1,nb,fp_trace); nb=0;}
+        memcpy(batch+nb,msg,m); nb+=m;
+        ndrop_trace=ndrop;
+    }
+    if (nb>0) fwrite(batch,1,nb,fp_trace);
+    if (n>0) fflush(fp_trace);
+    return n;
+}
+#ifdef WIN32
+static DWORD WINAPI log_writer_thread(void *arg)
+#else
+static void *log_writer_thread(void *arg)
+#endif
+{
+    for (;;) {
+        if (flush_rings()) continue;
+        if (!LOAD_ACQ(&state_trace)) break;
+        sleepms(LOG_IDLE_MS);
+    }
+    flush_rings();
+    return 0;
+}
 /* close trace output----------------------------------------------------------*/
 extern void log_trace_close(void)
 {
+    log_ring_t *ring,*next;
+
+    if (state_trace) {
+        STORE_REL(&state_trace,0);
+#ifdef WIN32
+        WaitForSingleObject(thread_trace,INFINITE);
+        CloseHandle(thread_trace);
+#else
+        pthread_join(thread_trace,NULL);
+#endif
+    }
     if (fp_trace&&fp_trace!=stderr) fclose(fp_trace);
     fp_trace=NULL;
     file_trace[0]='\0';
+
+    /* rings of exited threads are freed by last flush of writer, rings are
+       kept for threads still alive and only emptied */
+    for (ring=LOAD_ACQ(&rings);ring;ring=next) {
+        next=ring->next;
+        if (LOAD_ACQ(&ring->dead)) free_ring(ring);
+        else STORE_REL(&ring->tail,LOAD_ACQ(&ring->head));
+    }
 }
 /* open trace output-----------------------------------------------------------
+ * messages are formatted by the calling thread into its own ring and written
+ * to the file by a writer thread in batch. a message is dropped (and counted)
+ * instead of blocking the caller if the ring is full.
  * args:  char* file    trace file path
  * return: none
  * ---------------------------------------------------------------------------*/
 extern void log_trace_open(const char *file)
 {
+    static int init=0;
     gtime_t time=timeget();
     char path[1024]={0};
 
+    if (state_trace) log_trace_close();
+    if (!init) {
+        initlock(&lock_trace);
+#ifdef WIN32
+        key_trace=FlsAlloc(ring_exit);
+#else
+        pthread_key_create(&key_trace,ring_exit);
+#endif
+        init=1;
+    }
     reppath(file,path,time,"","");
     if (!*path||!(fp_trace=fopen(path,"w"))) fp_trace=stderr;
     strcpy(file_trace,path);
-    initlock(&lock_trace);
+
+    state_trace=1;
+#ifdef WIN32
+    if (!(thread_trace=CreateThread(NULL,0,log_writer_thread,NULL,0,NULL))) state_trace=0;
+#else
+    if (pthread_create(&thread_trace,NULL,log_writer_thread,NULL)) state_trace=0;
+#endif
 }
 /* set trace level-------------------------------------------------------------
  * args:  int level  trace level:
@@ -43,45 +269,51 @@ extern void log_set_level(int level)
 {
     level_trace=level;
 }
+/* number of dropped log messages --------------------------------------------*/
+extern uint64_t log_trace_ndrop(void)
+{
+    log_ring_t *ring;
+    uint64_t ndrop;
+
+    lock(&lock_trace);
+    ndrop=__atomic_load_n(&ndrop_dead,__ATOMIC_RELAXED);
+    for (ring=rings;ring;ring=ring->next) {
+        ndrop+=__atomic_load_n(&ring->ndrop,__ATOMIC_RELAXED);
+    }
+    unlock(&lock_trace);
+    return ndrop;
+}
 extern void log_trace(int level, const char *format, ...)
 {
-    char buff[4096]={0};
+    char buff[LOG_MSG_SIZE];
     va_list ap;
-    gtime_t t_curr;
+    int n=0;
 
-    if (level>level_trace) {
+    if (level>level_trace||!state_trace) {
         return;
     }
-    lock(&lock_trace);
-
-    va_start(ap,format); vsprintf(buff,format,ap); va_end(ap);
-    t_curr=timeget();
-
-    char tbuf[64];
-    time2str(t_curr,tbuf,3);
+    if (level>=1&&level<=3) {
+        n=time_prefix(buff);
+        memcpy(buff+n,level==3?" [INFO]: ":(level==2?" [WARN]: ":" [ERRO]: "),10);
+        n+=9;
+    }
 
-    if      (level==3) fprintf(fp_trace,"%s %s: ",tbuf,"[INFO]");
-    else if (level==2) fprintf(fp_trace,"%s %s: ",tbuf,"[WARN]");
-    else if (level==1) fprintf(fp_trace,"%s %s: ",tbuf,"[ERRO]");
+    va_start(ap,format); n+=vsnprintf(buff+n,sizeof(buff)-n,format,ap); va_end(ap);
+    if (n>=(int)sizeof(buff)) n=sizeof(buff)-1;
 
-    if (fp_trace) {
-        fprintf(fp_trace,"%s",buff);
-        fflush(fp_trace);
-    }
-    unlock(&lock_trace);
+    put_msg(buff,n);
 }
 extern void log_traceobs(int level, const obsd_t *obs, int n)
 {
-    char buff[4096]={0};
-    char str[64],id[16],*p=buff;
-    int i;
+    char buff[256];
+    char str[64],id[16];
+    int i,nb;
 
-    if (level>level_trace) {
+    if (level>level_trace||!state_trace) {
         return;
     }
     log_trace(3,"observation: n=%d\n",n);
 
-    lock(&lock_trace);
     for (i=0;i<n;i++) {
         time2str(obs[i].time,str,3);
         satno2id(obs[i].sat,id);
@@ -89,36 +321,35 @@ extern void log_traceobs(int level, const obsd_t *obs, int n)
 
         sprintf(rcvbuf,"rcv%d",obs[i].rcv);
 
-        sprintf(p,"  (%2d) %s %-3s %8s %13.5f %13.5f %13.5f %13.5f %2d %2d %2d %2d %6.3f %6.3f\n",
-                i+1,str,id,rcvbuf,obs[i].L[0],obs[i].L[1],obs[i].P[0],
-                obs[i].P[1],obs[i].LLI[0],obs[i].LLI[1],obs[i].code[0],
-                obs[i].code[1],obs[i].SNR[0]*0.25,obs[i].SNR[1]*0.25);
-
-        if (level>level_trace) continue;
-
-        if (fp_trace) {
-            fprintf(fp_trace,"%s",p);
-            fflush(fp_trace);
-        }
+        nb=sprintf(buff,"  (%2d) %s %-3s %8s %13.5f %13.5f %13.5f %13.5f %2d %2d %2d %2d %6.3f %6.3f\n",
+                   i+1,str,id,rcvbuf,obs[i].L[0],obs[i].L[1],obs[i].P[0],
+                   obs[i].P[1],obs[i].LLI[0],obs[i].LLI[1],obs[i].code[0],
+                   obs[i].code[1],obs[i].SNR[0]*0.25,obs[i].SNR[1]*0.25);
+        put_msg(buff,nb);
     }
-    unlock(&lock_trace);
 }
 extern void log_tracemat(int level, const double *A, int n, int m, int p, int q)
 {
-    if (!fp_trace) return;
+    char buff[LOG_MSG_SIZE];
+    int i,j,nb;
 
-    if (level>level_trace) {
+    if (level>level_trace||!state_trace) {
         return;
     }
-    lock(&lock_trace);
-    matfprint(A,n,m,p,q,fp_trace); fflush(fp_trace);
-    unlock(&lock_trace);
+    for (i=0;i<n;i++) {
+        for (j=nb=0;j<m&&nb<(int)sizeof(buff)-64;j++) {
+            nb+=sprintf(buff+nb," %*.*f",p,q,A[i+j*n]);
+        }
+        buff[nb++]='\n';
+        put_msg(buff,nb);
+    }
 }
 #else
 extern void log_trace_open(const char *file) {}
 extern void log_trace_close(void) {}
 extern void log_set_level(int level) {}
+extern uint64_t log_trace_ndrop(void) {return 0;}
 extern void log_trace(int level, const char *format, ...) {}
 extern void log_traceobs(int level, const obsd_t *obs, int n) {}
 extern void log_tracemat(int level, const double *A, int n, int m, int p, int q) {}
-#endif
\ No newline at end of file
+#endif
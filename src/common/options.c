@@ -16,6 +16,8 @@ static double elmask_,elmaskar_,elmaskhold_;
 static char exsats_[1024];
 static char snrmask_[NFREQ][1024];
 
+#define WQPOPT  "0:drop,1:coalesce,2:disconnect"
+
 EXPORT opt_t cors_opts[]={
         {"ntrip-sources-file",     2,(void *)&cors_opt_.ntrip_sources_file,""},
         {"trace-file",             2,(void *)&cors_opt_.trace_file,        ""},
@@ -26,6 +28,18 @@ EXPORT opt_t cors_opts[]={
         {"pnt-conf-file",          2,(void *)&cors_opt_.pnt_conf_file,     ""},
         {"agent-user-file",        2,(void *)&cors_opt_.agent_user_file,   ""},
         {"monitor-port",           0,(void *)&cors_opt_.monitor_port,      ""},
+        {"rtcm-decoder-threads",   0,(void *)&cors_opt_.decoder_threads,   ""},
+        {"rtk-workers",            0,(void *)&cors_opt_.rtk_workers,       ""},
+        {"vrs-workers",            0,(void *)&cors_opt_.vrs_workers,       ""},
+        {"vrs-deadline",           0,(void *)&cors_opt_.vrs_deadline,      "ms"},
+        {"vrs-ondemand-radius",    1,(void *)&cors_opt_.vrs_radius,        "m"},
+        {"vrs-idle-timeout",       0,(void *)&cors_opt_.vrs_idle,          "s"},
+        {"vrs-max-stations",       0,(void *)&cors_opt_.vrs_maxsta,        ""},
+        {"agent-loops",            0,(void *)&cors_opt_.agent_loops,       ""},
+        {"agent-wq-limit",         0,(void *)&cors_opt_.agent_wq_limit,    "bytes"},
+        {"agent-wq-policy",        3,(void *)&cors_opt_.agent_wq_policy,   WQPOPT},
+        {"agent-gga-tick",         0,(void *)&cors_opt_.agent_gga_tick,    "ms"},
+        {"agent-gga-hysteresis",   1,(void *)&cors_opt_.agent_gga_hyst,    "m"},
         {"",0,NULL,""}
 };
 
@@ -323,6 +337,18 @@ static void reset_corsopts()
     cors_opt_.baselines_file[0]='\0';
     cors_opt_.bstas_info_file[0]='\0';
     cors_opt_.monitor_port=0;
+    cors_opt_.decoder_threads=1;
+    cors_opt_.rtk_workers=0;
+    cors_opt_.vrs_workers=0;
+    cors_opt_.vrs_deadline=1000;
+    cors_opt_.vrs_radius=0.0;
+    cors_opt_.vrs_idle=300;
+    cors_opt_.vrs_maxsta=1000;
+    cors_opt_.agent_loops=1;
+    cors_opt_.agent_wq_limit=65536;
+    cors_opt_.agent_wq_policy=AGENT_WQ_DROP;
+    cors_opt_.agent_gga_tick=1000;
+    cors_opt_.agent_gga_hyst=1000.0;
 }
 /* load options ----------------------------------------------------------------
 * load options from file
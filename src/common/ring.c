@@ -0,0 +1,73 @@
+/*------------------------------------------------------------------------------
+ * ring.c  : single-producer/single-consumer byte ring functions for CORS
+ *
+ * author  : sujinglan
+ * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
+ * history : 2022/11/17 1.0  new
+ *-----------------------------------------------------------------------------*/
+#include "cors.h"
+
+#define LOAD_ACQ(p)     __atomic_load_n(p,__ATOMIC_ACQUIRE)
+#define STORE_REL(p,v)  __atomic_store_n(p,v,__ATOMIC_RELEASE)
+
+/* initialize byte ring --------------------------------------------------------
+ * args   : cors_ring_t *ring  IO  byte ring
+ *          int         size   I   ring size (bytes, rounded up to power of 2)
+ * return : status (1:ok,0:error)
+ *-----------------------------------------------------------------------------*/
+extern int cors_ring_init(cors_ring_t *ring, int size)
+{
+    uint32_t n=1;
+
+    while (n<(uint32_t)size) n<<=1;
+    memset(ring,0,sizeof(*ring));
+    if (!(ring->buff=malloc(n))) return 0;
+    ring->size=n;
+    return 1;
+}
+/* free byte ring ------------------------------------------------------------*/
+extern void cors_ring_free(cors_ring_t *ring)
+{
+    free(ring->buff);
+    ring->buff=NULL;
+    ring->size=ring->head=ring->tail=0;
+}
+/* write bytes to ring (producer) ----------------------------------------------
+ * bytes exceeding the free space are dropped and counted in ring->ndrop
+ * return : number of bytes written
+ *-----------------------------------------------------------------------------*/
+extern int cors_ring_write(cors_ring_t *ring, const uint8_t *data, int n)
+{
+    uint32_t head=ring->head,tail=LOAD_ACQ(&ring->tail);
+    uint32_t off,m,space=ring->size-(head-tail);
+
+    if (n<=0) return 0;
+    if ((uint32_t)n>space) {
+        ring->ndrop+=n-space;
+        n=(int)space;
+    }
+    off=head&(ring->size-1);
+    m=ring->size-off<(uint32_t)n?ring->size-off:(uint32_t)n;
+    memcpy(ring->buff+off,data,m);
+    memcpy(ring->buff,data+m,n-m);
+    STORE_REL(&ring->head,head+n);
+    return n;
+}
+/* get contiguous readable region of ring (consumer) ---------------------------
+ * args   : cors_ring_t *ring  I   byte ring
+ *          uint8_t    **p     O   start of readable bytes in ring buffer
+ * return : number of contiguous readable bytes
+ *-----------------------------------------------------------------------------*/
+extern int cors_ring_peek(cors_ring_t *ring, uint8_t **p)
+{
+    uint32_t tail=ring->tail,head=LOAD_ACQ(&ring->head);
+    uint32_t off=tail&(ring->size-1),n=head-tail;
+
+    *p=ring->buff+off;
+    return (int)(ring->size-off<n?ring->size-off:n);
+}
+/* release n bytes read by consumer ------------------------------------------*/
+extern void cors_ring_commit(cors_ring_t *ring, int n)
+{
+    STORE_REL(&ring->tail,ring->tail+n);
+}
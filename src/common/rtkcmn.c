@@ -722,13 +722,32 @@ extern int getcodepri(int sys, uint8_t code, const char *opt)
 *          int    pos       I   bit position from start of data (bits)
 *          int    len       I   bit length (bits) (len<=32)
 * return : extracted unsigned/signed bits
+* notes  : the bytes covering the field (up to 5) are loaded into one 64-bit
+*          big-endian word which is shifted and masked. only bytes touched by
+*          the field are read, so the end of buff is never overrun.
 *-----------------------------------------------------------------------------*/
 extern uint32_t getbitu(const uint8_t *buff, int pos, int len)
 {
-    uint32_t bits=0;
-    int i;
-    for (i=pos;i<pos+len;i++) bits=(bits<<1)+((buff[i/8]>>(7-i%8))&1u);
-    return bits;
+    const uint8_t *p=buff+(pos>>3);
+    uint64_t word=0;
+    int off=pos&7,nb;
+
+    if (len<=0) return 0;
+    if (len>32) { /* only last 32 bits are kept */
+        pos+=len-32; len=32;
+        p=buff+(pos>>3); off=pos&7;
+    }
+    nb=(off+len+7)>>3;
+
+    switch (nb) {
+        case 5: word=(uint64_t)p[0]<<32|(uint64_t)p[1]<<24|(uint64_t)p[2]<<16|
+                     (uint64_t)p[3]<<8|p[4]; break;
+        case 4: word=(uint64_t)p[0]<<24|(uint64_t)p[1]<<16|(uint64_t)p[2]<<8|p[3]; break;
+        case 3: word=(uint64_t)p[0]<<16|(uint64_t)p[1]<<8|p[2]; break;
+        case 2: word=(uint64_t)p[0]<<8|p[1]; break;
+        default: word=p[0]; break;
+    }
+    return (uint32_t)((word>>(nb*8-off-len))&(0xFFFFFFFFu>>(32-len)));
 }
 extern int32_t getbits(const uint8_t *buff, int pos, int len)
 {
@@ -743,15 +762,31 @@ extern int32_t getbits(const uint8_t *buff, int pos, int len)
 *          int    len       I   bit length (bits) (len<=32)
 *          [u]int32_t data  I   unsigned/signed data
 * return : none
+* notes  : the bytes covering the field (up to 5) are merged as one 64-bit
+*          big-endian word and written back. bits outside the field are kept.
 *-----------------------------------------------------------------------------*/
 extern void setbitu(uint8_t *buff, int pos, int len, uint32_t data)
 {
-    uint32_t mask=1u<<(len-1);
-    int i;
+    uint8_t *p=buff+(pos>>3);
+    uint64_t word,mask;
+    int off=pos&7,nb,sft,i;
+
     if (len<=0||32<len) return;
-    for (i=pos;i<pos+len;i++,mask>>=1) {
-        if (data&mask) buff[i/8]|=1u<<(7-i%8); else buff[i/8]&=~(1u<<(7-i%8));
+    nb=(off+len+7)>>3;
+    sft=nb*8-off-len;
+    mask=(uint64_t)(0xFFFFFFFFu>>(32-len))<<sft;
+
+    switch (nb) {
+        case 5: word=(uint64_t)p[0]<<32|(uint64_t)p[1]<<24|(uint64_t)p[2]<<16|
+                     (uint64_t)p[3]<<8|p[4]; break;
+        case 4: word=(uint64_t)p[0]<<24|(uint64_t)p[1]<<16|(uint64_t)p[2]<<8|p[3]; break;
+        case 3: word=(uint64_t)p[0]<<16|(uint64_t)p[1]<<8|p[2]; break;
+        case 2: word=(uint64_t)p[0]<<8|p[1]; break;
+        default: word=p[0]; break;
     }
+    word=(word&~mask)|(((uint64_t)data<<sft)&mask);
+
+    for (i=nb-1;i>=0;i--,word>>=8) p[i]=(uint8_t)word;
 }
 extern void setbits(uint8_t *buff, int pos, int len, int32_t data)
 {
@@ -971,6 +1006,13 @@ extern void matcpy(double *A, const double *B, int n, int m)
 }
 /* matrix routines -----------------------------------------------------------*/
 
+#ifdef LAPACK /* with LAPACK/BLAS or MKL */
+#define MATINV_NWORK(n) (16)            /* columns of matinv work buffer */
+#else
+#define MATINV_NWORK(n) ((n)+1)
+#endif
+#define MATINV_NSTACK   16              /* max size of matrix inverted on stack */
+
 #ifdef LAPACK /* with LAPACK/BLAS or MKL */
 
 /* multiply matrix (wrapper of blas dgemm) -------------------------------------
@@ -991,6 +1033,15 @@ extern void matmul(const char *tr, int n, int k, int m, double alpha,
     dgemm_((char *)tr,(char *)tr+1,&n,&k,&m,&alpha,(double *)A,&lda,(double *)B,
            &ldb,&beta,C,&n);
 }
+/* inverse of matrix with work buffers (ipiv: n, work: n x MATINV_NWORK(n)) --*/
+static int matinv_(double *A, int n, int *ipiv, double *work)
+{
+    int info,lwork=n*16;
+
+    dgetrf_(&n,&n,A,&n,ipiv,&info);
+    if (!info) dgetri_(&n,A,&n,ipiv,work,&lwork,&info);
+    return info;
+}
 /* inverse of matrix -----------------------------------------------------------
 * inverse of matrix (A=A^-1)
 * args   : double *A        IO  matrix (n x n)
@@ -999,12 +1050,12 @@ extern void matmul(const char *tr, int n, int k, int m, double alpha,
 *-----------------------------------------------------------------------------*/
 extern int matinv(double *A, int n)
 {
-    double *work;
-    int info,lwork=n*16,*ipiv=imat(n,1);
+    double *work,work_[MATINV_NSTACK*(MATINV_NSTACK+1)];
+    int info,*ipiv,ipiv_[MATINV_NSTACK];
 
-    work=mat(lwork,1);
-    dgetrf_(&n,&n,A,&n,ipiv,&info);
-    if (!info) dgetri_(&n,A,&n,ipiv,work,&lwork,&info);
+    if (n<=MATINV_NSTACK) return matinv_(A,n,ipiv_,work_);
+    ipiv=imat(n,1); work=mat(n,MATINV_NWORK(n));
+    info=matinv_(A,n,ipiv,work);
     free(ipiv); free(work);
     return info;
 }
@@ -1066,15 +1117,15 @@ extern void matmul(const char *tr, int n, int k, int m, double alpha,
         }
 }
 /* LU decomposition ----------------------------------------------------------*/
-static int ludcmp(double *A, int n, int *indx, double *d)
+static int ludcmp(double *A, int n, int *indx, double *d, double *vv)
 {
-    double big,s,tmp,*vv=mat(n,1);
+    double big,s,tmp;
     int i,imax=0,j,k;
 
     *d=1.0;
     for (i=0;i<n;i++) {
         big=0.0; for (j=0;j<n;j++) if ((tmp=fabs(A[i+j*n]))>big) big=tmp;
-        if (big>0.0) vv[i]=1.0/big; else {free(vv); return -1;}
+        if (big>0.0) vv[i]=1.0/big; else return -1;
     }
     for (j=0;j<n;j++) {
         for (i=0;i<j;i++) {
@@ -1092,12 +1143,11 @@ static int ludcmp(double *A, int n, int *indx, double *d)
             *d=-(*d); vv[imax]=vv[j];
         }
         indx[j]=imax;
-        if (A[j+j*n]==0.0) {free(vv); return -1;}
+        if (A[j+j*n]==0.0) return -1;
         if (j!=n-1) {
             tmp=1.0/A[j+j*n]; for (i=j+1;i<n;i++) A[i+j*n]*=tmp;
         }
     }
-    free(vv);
     return 0;
 }
 /* LU back-substitution ------------------------------------------------------*/
@@ -1115,22 +1165,33 @@ static void lubksb(const double *A, int n, const int *indx, double *b)
         s=b[i]; for (j=i+1;j<n;j++) s-=A[i+j*n]*b[j]; b[i]=s/A[i+i*n];
     }
 }
-/* inverse of matrix ---------------------------------------------------------*/
-extern int matinv(double *A, int n)
+/* inverse of matrix with work buffers (indx: n, work: n x MATINV_NWORK(n)) --*/
+static int matinv_(double *A, int n, int *indx, double *work)
 {
-    double d,*B;
-    int i,j,*indx;
+    double d,*B=work,*vv=work+n*n;
+    int i,j;
 
-    indx=imat(n,1); B=mat(n,n); matcpy(B,A,n,n);
-    if (ludcmp(B,n,indx,&d)) {free(indx); free(B); return -1;}
+    matcpy(B,A,n,n);
+    if (ludcmp(B,n,indx,&d,vv)) return -1;
     for (j=0;j<n;j++) {
         for (i=0;i<n;i++) A[i+j*n]=0.0;
         A[j+j*n]=1.0;
         lubksb(B,n,indx,A+j*n);
     }
-    free(indx); free(B);
     return 0;
 }
+/* inverse of matrix ---------------------------------------------------------*/
+extern int matinv(double *A, int n)
+{
+    double *work,work_[MATINV_NSTACK*(MATINV_NSTACK+1)];
+    int info,*indx,indx_[MATINV_NSTACK];
+
+    if (n<=MATINV_NSTACK) return matinv_(A,n,indx_,work_);
+    indx=imat(n,1); work=mat(n,MATINV_NWORK(n));
+    info=matinv_(A,n,indx,work);
+    free(indx); free(work);
+    return info;
+}
 /* solve linear equation -----------------------------------------------------*/
 extern int solve(const char *tr, const double *A, const double *Y, int n,
                  int m, double *X)
@@ -1160,15 +1221,15 @@ extern int solve(const char *tr, const double *A, const double *Y, int n,
 extern int lsq(const double *A, const double *y, int n, int m, double *x,
                double *Q)
 {
-    double *Ay;
+    double *Ay,Ay_[MATINV_NSTACK];
     int info;
 
     if (m<n) return -1;
-    Ay=mat(n,1);
+    Ay=n<=MATINV_NSTACK?Ay_:mat(n,1);
     matmul("NN",n,1,m,1.0,A,y,0.0,Ay); /* Ay=A*y */
     matmul("NT",n,n,m,1.0,A,A,0.0,Q);  /* Q=A*A' */
     if (!(info=matinv(Q,n))) matmul("NN",n,1,n,1.0,Q,Ay,0.0,x); /* x=Q^-1*Ay */
-    free(Ay);
+    if (Ay!=Ay_) free(Ay);
     return info;
 }
 /* kalman filter ---------------------------------------------------------------
@@ -1190,50 +1251,211 @@ extern int lsq(const double *A, const double *y, int n, int m, double *x,
 *-----------------------------------------------------------------------------*/
 static int filter_(const double *x, const double *P, const double *H,
                    const double *v, const double *R, int n, int m,
-                   double *xp, double *Pp)
+                   double *xp, double *Pp, filtws_t *ws)
 {
-    double *F=mat(n,m),*Q=mat(m,m),*K=mat(n,m),*I=eye(n);
-    int info;
+    double *F=ws->F,*Q=ws->Q,*K=ws->K,*I=ws->I;
+    int i,info;
 
+    for (i=0;i<n*n;i++) I[i]=0.0;
+    for (i=0;i<n;i++) I[i+i*n]=1.0;
     matcpy(Q,R,m,m);
     matcpy(xp,x,n,1);
     matmul("NN",n,m,n,1.0,P,H,0.0,F);       /* Q=H'*P*H+R */
     matmul("TN",m,m,n,1.0,H,F,1.0,Q);
-    if (!(info=matinv(Q,m))) {
+    if (!(info=matinv_(Q,m,ws->ipiv,ws->work))) {
         matmul("NN",n,m,m,1.0,F,Q,0.0,K);   /* K=P*H*Q^-1 */
         matmul("NN",n,1,m,1.0,K,v,1.0,xp);  /* xp=x+K*v */
         matmul("NT",n,n,m,-1.0,K,H,1.0,I);  /* Pp=(I-K*H')*P */
         matmul("NN",n,n,n,1.0,I,P,0.0,Pp);
     }
-    free(F); free(Q); free(K); free(I);
     return info;
 }
-extern int filter(double *x, double *P, const double *H, const double *v,
-                  const double *R, int n, int m, const int *ix_, int nx_)
+typedef struct scratch_blk {        /* scratch block beyond workspace buffer */
+    struct scratch_blk *next;       /* next block */
+    double data[1];                 /* matrix data */
+} scratch_blk_t;
+
+/* free filter buffers of workspace ------------------------------------------*/
+static void free_filter_buf(filtws_t *ws)
+{
+    free(ws->ix); free(ws->ipiv);
+    free(ws->x ); free(ws->xp); free(ws->P); free(ws->Pp); free(ws->I);
+    free(ws->H ); free(ws->F ); free(ws->K); free(ws->Q ); free(ws->work);
+    ws->ix=ws->ipiv=NULL;
+    ws->x=ws->xp=ws->P=ws->Pp=ws->I=ws->H=ws->F=ws->K=ws->Q=ws->work=NULL;
+    ws->nmax=ws->mmax=0;
+}
+/* initialize kalman filter workspace ------------------------------------------
+* allocate (or enlarge) work buffers of filter_ws() for up to n active states
+* and m measurements
+* args   : filtws_t *ws     IO  filter workspace (zero cleared before first use)
+*          int    n,m       I   number of active states and measurements
+* return : status (0:ok,-1:memory allocation error)
+* notes  : buffers are kept if already large enough, so the workspace can be
+*          sized once and reused without heap allocation
+*-----------------------------------------------------------------------------*/
+extern int filtws_init(filtws_t *ws, int n, int m)
+{
+    filtws_t ws0={0};
+
+    if (n<=ws->nmax&&m<=ws->mmax) return 0;
+    if (n<ws->nmax) n=ws->nmax;
+    if (m<ws->mmax) m=ws->mmax;
+    if (n<1) n=1;
+    if (m<1) m=1;
+    free_filter_buf(ws);
+
+    /* scratch is kept, its blocks may be in use */
+    ws0.buf=ws->buf; ws0.nbuf=ws->nbuf; ws0.pbuf=ws->pbuf; ws0.hbuf=ws->hbuf;
+    ws0.novf=ws->novf; ws0.ovf=ws->ovf;
+    ws0.nmax=n; ws0.mmax=m;
+    if (!(ws0.ix  =(int *)malloc(sizeof(int)*n))||
+        !(ws0.ipiv=(int *)malloc(sizeof(int)*m))||
+        !(ws0.x =mat(n,1))||!(ws0.xp=mat(n,1))||
+        !(ws0.P =mat(n,n))||!(ws0.Pp=mat(n,n))||!(ws0.I=mat(n,n))||
+        !(ws0.H =mat(n,m))||!(ws0.F =mat(n,m))||!(ws0.K=mat(n,m))||
+        !(ws0.Q =mat(m,m))||!(ws0.work=mat(m,MATINV_NWORK(m)))) {
+        free_filter_buf(&ws0);
+        *ws=ws0;
+        return -1;
+    }
+    *ws=ws0;
+    return 0;
+}
+/* free kalman filter workspace ----------------------------------------------*/
+extern void filtws_free(filtws_t *ws)
+{
+    free_filter_buf(ws);
+    ws->hbuf=0;
+    filtws_reset(ws);
+    free(ws->buf);
+    memset(ws,0,sizeof(filtws_t));
+}
+/* scratch matrix of workspace -------------------------------------------------
+* allocate zero matrix from scratch of workspace (see mat())
+* args   : filtws_t *ws     IO  filter workspace
+*          int    n,m       I   number of rows and columns of matrix
+* return : matrix pointer (if n<=0 or m<=0, return NULL)
+* notes  : scratch is released by restoring ws->pbuf saved before allocation
+*          (blocks allocated beyond the buffer are kept until filtws_reset())
+*          and fully by filtws_reset(). no heap allocation if the scratch is
+*          large enough, otherwise filtws_reset() enlarges it to the high-water
+*          mark of usage
+*-----------------------------------------------------------------------------*/
+extern double *filtws_mat(filtws_t *ws, int n, int m)
+{
+    scratch_blk_t *blk;
+    double *p;
+
+    if (n<=0||m<=0) return NULL;
+
+    if (ws->pbuf+n*m<=ws->nbuf) {
+        p=ws->buf+ws->pbuf;
+        ws->pbuf+=n*m;
+    }
+    else {
+        if (!(blk=(scratch_blk_t *)malloc(sizeof(scratch_blk_t)+sizeof(double)*(n*m-1)))) {
+            fprintf(stderr,"matrix memory allocation error: n=%d,m=%d\n",n,m);
+            return NULL;
+        }
+        blk->next=(scratch_blk_t *)ws->ovf;
+        ws->ovf=blk;
+        ws->novf+=n*m;
+        p=blk->data;
+    }
+    if (ws->pbuf+ws->novf>ws->hbuf) ws->hbuf=ws->pbuf+ws->novf;
+    memset(p,0,sizeof(double)*n*m);
+    return p;
+}
+/* scratch integer matrix of workspace (see filtws_mat()) --------------------*/
+extern int *filtws_imat(filtws_t *ws, int n, int m)
+{
+    if (n<=0||m<=0) return NULL;
+    return (int *)filtws_mat(ws,(int)((sizeof(int)*n*m+sizeof(double)-1)/sizeof(double)),1);
+}
+/* release scratch of workspace ----------------------------------------------*/
+extern void filtws_reset(filtws_t *ws)
+{
+    scratch_blk_t *blk,*next;
+
+    for (blk=(scratch_blk_t *)ws->ovf;blk;blk=next) {
+        next=blk->next;
+        free(blk);
+    }
+    ws->ovf=NULL; ws->novf=ws->pbuf=0;
+
+    if (ws->hbuf>ws->nbuf) {
+        free(ws->buf);
+        ws->nbuf=(ws->buf=(double *)malloc(sizeof(double)*ws->hbuf))?ws->hbuf:0;
+    }
+}
+/* inverse of matrix with work buffers of workspace --------------------------*/
+extern int filtws_matinv(filtws_t *ws, double *A, int n)
+{
+    if (n<=MATINV_NSTACK) return matinv(A,n);
+    if (filtws_init(ws,ws->nmax,n)) return -1;
+    return matinv_(A,n,ws->ipiv,ws->work);
+}
+/* kalman filter with workspace ------------------------------------------------
+* kalman filter state update on the active states (see filter())
+* args   : double *x        IO  states vector (n x 1)
+*          double *P        IO  covariance matrix of states (n x n)
+*          double *H        I   transpose of design matrix (n x m)
+*          double *v        I   innovation (measurement - model) (m x 1)
+*          double *R        I   covariance matrix of measurement error (m x m)
+*          int    n,m       I   number of states and measurements
+*          int    *ix_      I   index of active states (NULL: x[i]!=0.0)
+*          int    nx_       I   number of active states
+*          filtws_t *ws     IO  filter workspace
+* return : status (0:ok,<0:error)
+* notes  : no heap allocation if the workspace is large enough for the active
+*          states and measurements, otherwise it is enlarged
+*-----------------------------------------------------------------------------*/
+extern int filter_ws(double *x, double *P, const double *H, const double *v,
+                     const double *R, int n, int m, const int *ix_, int nx_,
+                     filtws_t *ws)
 {
     double *x_,*xp_,*P_,*Pp_,*H_;
-    int i,j,k,info,*ix;
+    int i,j,k,*ix;
 
-    ix=imat(n,1);
     if (ix_&&nx_) {
-        memcpy(ix,ix_,sizeof(int)*nx_);
         k=nx_;
     }
+    else {
+        for (i=k=0;i<n;i++) if (x[i]!=0.0&&P[i+i*n]>0.0) k++;
+    }
+    if (filtws_init(ws,k,m)) return -1;
+
+    ix=ws->ix;
+    if (ix_&&nx_) {
+        memcpy(ix,ix_,sizeof(int)*nx_);
+    }
     else {
         for (i=k=0;i<n;i++) if (x[i]!=0.0&&P[i+i*n]>0.0) ix[k++]=i;
     }
-    x_=mat(k,1); xp_=mat(k,1); P_=mat(k,k); Pp_=mat(k,k); H_=mat(k,m);
+    x_=ws->x; xp_=ws->xp; P_=ws->P; Pp_=ws->Pp; H_=ws->H;
     for (i=0;i<k;i++) {
         x_[i]=x[ix[i]];
         for (j=0;j<k;j++) P_[i+j*k]=P[ix[i]+ix[j]*n];
         for (j=0;j<m;j++) H_[i+j*k]=H[ix[i]+j*n];
     }
-    info=filter_(x_,P_,H_,v,R,k,m,xp_,Pp_);
+    if ((i=filter_(x_,P_,H_,v,R,k,m,xp_,Pp_,ws))) return i;
+
     for (i=0;i<k;i++) {
         x[ix[i]]=xp_[i];
         for (j=0;j<k;j++) P[ix[i]+ix[j]*n]=Pp_[i+j*k];
     }
-    free(ix); free(x_); free(xp_); free(P_); free(Pp_); free(H_);
+    return 0;
+}
+/* kalman filter (temporary workspace) ---------------------------------------*/
+extern int filter(double *x, double *P, const double *H, const double *v,
+                  const double *R, int n, int m, const int *ix_, int nx_)
+{
+    filtws_t ws={0};
+    int info;
+
+    info=filter_ws(x,P,H,v,R,n,m,ix_,nx_,&ws);
+    filtws_free(&ws);
     return info;
 }
 /* smoother --------------------------------------------------------------------
@@ -16,23 +16,41 @@ static void close_cb(uv_async_t* handle)
 
 static void on_timer_stat_cb(uv_timer_t* handle)
 {
-    NULL;
+    cors_t *cors=handle->data;
+    cors_nav_t *nav=&cors->nav;
+
+    if (!cors->state) return;
+
+    log_trace(2,"nav rtcm: encoded=%llu rebuilt=%llu /min, total encoded=%llu sent=%llu\n",
+              (unsigned long long)(nav->nenc-nav->nenc0),(unsigned long long)(nav->nupd-nav->nupd0),
+              (unsigned long long)nav->nenc,(unsigned long long)cors->agent.nnav);
+    nav->nenc0=nav->nenc;
+    nav->nupd0=nav->nupd;
 }
 
 static void start_cors(cors_t *cors)
 {
     cors_initssat(&cors->ssats);
     cors_initobs(&cors->obs);
+    cors_initblsol(&cors->blsols);
     cors_initnav(&cors->nav);
+    cors_initnavrtcm(&cors->nav);
     cors_initsta(&cors->stas);
 
     strcpy(cors->monitor.bstas_info_file,cors->opt.bstas_info_file);
     cors->monitor.port=cors->opt.monitor_port;
 
     cors_ntrip_start(&cors->ntrip,cors,cors->opt.ntrip_sources_file);
-    cors_ntrip_agent_start(&cors->agent,&cors->ntrip,cors->opt.agent_user_file);
+    cors->agent.wq_limit=cors->opt.agent_wq_limit;
+    cors->agent.wq_policy=cors->opt.agent_wq_policy;
+    cors->agent.gga_tick=cors->opt.agent_gga_tick;
+    cors->agent.gga_hyst=cors->opt.agent_gga_hyst;
+    cors_ntrip_agent_start(&cors->agent,&cors->ntrip,cors->opt.agent_user_file,cors->opt.agent_loops);
     cors_rtcm_decoder_start(&cors->rtcm_decoder,cors);
     cors_pnt_start(&cors->pnt,cors);
+    if (!cors_rtkpool_start(&cors->rtkpool,cors,cors->opt.rtk_workers)) {
+        log_trace(1,"rtk worker pool start error, baselines run inline\n");
+    }
     cors_srtk_start(&cors->srtk,cors,NULL,cors->opt.baselines_file);
     cors_nrtk_start(&cors->nrtk,cors);
     cors_vrs_start(&cors->vrs,cors,&cors->nrtk,cors->opt.vstas_file);
@@ -50,8 +68,9 @@ static void cors_thread(void *cors_arg)
     uv_async_init(loop,cors->close,close_cb);
 
     cors->timer_stat=calloc(1,sizeof(uv_timer_t));
+    cors->timer_stat->data=cors;
     uv_timer_init(loop,cors->timer_stat);
-    uv_timer_start(cors->timer_stat,on_timer_stat_cb,0,10000);
+    uv_timer_start(cors->timer_stat,on_timer_stat_cb,60000,60000);
 
     start_cors(cors);
 
@@ -80,6 +99,21 @@ extern int cors_start(cors_t* cors, const cors_opt_t *opt)
     return 1;
 }
 
+/* set real-time priority of calling thread ------------------------------------
+ * only the calling thread is changed. the process scheduling policy is set
+ * once by cors_start().
+ *-----------------------------------------------------------------------------*/
+extern void cors_set_thread_rt_priority(void)
+{
+#if WIN32
+    SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    struct sched_param param;
+    param.sched_priority=sched_get_priority_max(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
+#endif
+}
+
 static void free_cors(cors_t *cors)
 {
     cors_freenav(&cors->nav);
@@ -98,6 +132,7 @@ extern void cors_close(cors_t *cors)
     cors_srtk_close(&cors->srtk);
     cors_nrtk_close(&cors->nrtk);
     cors_vrs_close(&cors->vrs);
+    cors_rtkpool_close(&cors->rtkpool);
     cors_ntrip_agent_close(&cors->agent);
 
     cors->state=0;
@@ -106,6 +141,100 @@ extern void cors_close(cors_t *cors)
     free_cors(cors);
 }
 
+/* index current and previous ephemerides of satellite ----------------------*/
+static void upd_ephidx(nav_t *nav, int sat)
+{
+    int i,k,n=0,prn,*idx=nav->eidx[sat-1];
+
+    if (satsys(sat,&prn)!=SYS_GLO) {
+        for (k=0;k<4;k++) {
+            i=sat-1+MAXSAT*k;
+            if (nav->eph[i].sat==sat) idx[n++]=i+1;
+        }
+    }
+    else {
+        for (k=0;k<2;k++) {
+            i=prn-1+MAXPRNGLO*k;
+            if (nav->geph[i].sat==sat) idx[n++]=i+1;
+        }
+    }
+    for (;n<MAXEPHIDX;n++) idx[n]=0;
+}
+
+static int navmsg_type(int sys)
+{
+    switch (sys) {
+        case SYS_GPS: return 1019;
+        case SYS_GLO: return 1020;
+        case SYS_GAL: return 1046;
+        case SYS_CMP: return 1042;
+        case SYS_QZS: return 1044;
+    }
+    return 0;
+}
+
+/* encode message of new ephemeris and rebuild shared messages ---------------*/
+static void upd_navrtcm(cors_nav_t *cors_nav, int sat, int ephset)
+{
+    cors_ntrip_sbuf_t *sbuf,*old;
+    cors_navmsg_t *msg;
+    char buff[1200],*blob;
+    int i,nb,prn,sys,type;
+
+    if (!cors_nav->msg) return;
+    sys=satsys(sat,&prn);
+    if (!(type=navmsg_type(sys))) return;
+
+    if (sys==SYS_GLO) {
+        msg=cors_nav->msg+MAXSAT*2+prn-1;
+        nb=rtcm_encode_geph(type,cors_nav->data.geph+prn-1,buff);
+    }
+    else {
+        msg=cors_nav->msg+sat-1+MAXSAT*ephset;
+        nb=rtcm_encode_eph(type,cors_nav->data.eph+sat-1+MAXSAT*ephset,buff);
+    }
+    if (nb<=0||nb>NAVMSG_LEN) return;
+
+    uv_mutex_lock(&cors_nav->lock);
+    memcpy(msg->buff,buff,nb);
+    msg->nb=nb;
+    cors_nav->nenc++;
+
+    for (i=nb=0;i<MAXSAT*2+NSATGLO;i++) nb+=cors_nav->msg[i].nb;
+    if (!(blob=malloc(nb))) {
+        uv_mutex_unlock(&cors_nav->lock);
+        return;
+    }
+    for (i=nb=0;i<MAXSAT*2+NSATGLO;i++) {
+        memcpy(blob+nb,cors_nav->msg[i].buff,cors_nav->msg[i].nb);
+        nb+=cors_nav->msg[i].nb;
+    }
+    old=cors_nav->rtcm;
+    if ((sbuf=cors_ntrip_sbuf_new(blob,nb))) {
+        sbuf->type=AGENT_SBUF_NAV;
+        cors_nav->rtcm=sbuf;
+        cors_nav->nupd++;
+    }
+    else old=NULL;
+    uv_mutex_unlock(&cors_nav->lock);
+
+    if (old) cors_ntrip_sbuf_unref(old);
+    free(blob);
+}
+
+/* shared encoded messages of current ephemeris (NULL: none) -----------------*/
+extern cors_ntrip_sbuf_t* cors_navrtcm(cors_nav_t *nav)
+{
+    cors_ntrip_sbuf_t *sbuf;
+
+    if (!nav->msg) return NULL;
+
+    uv_mutex_lock(&nav->lock);
+    if ((sbuf=nav->rtcm)) cors_ntrip_sbuf_ref(sbuf);
+    uv_mutex_unlock(&nav->lock);
+    return sbuf;
+}
+
 extern void cors_updnav(cors_nav_t *cors_nav, const nav_t *nav, int ephsat, int ephset)
 {
     geph_t *geph1,*geph2,*geph3;
@@ -125,6 +254,7 @@ extern void cors_updnav(cors_nav_t *cors_nav, const nav_t *nav, int ephsat, int
              timediff(eph1->toc,eph2->toc)!=0.0)) {
             *eph3=*eph2;
             *eph2=*eph1;
+            upd_navrtcm(cors_nav,ephsat,ephset);
         }
     }
     else {
@@ -136,8 +266,10 @@ extern void cors_updnav(cors_nav_t *cors_nav, const nav_t *nav, int ephsat, int
             (geph1->iode!=geph3->iode&&geph1->iode!=geph2->iode)) {
             *geph3=*geph2;
             *geph2=*geph1;
+            upd_navrtcm(cors_nav,ephsat,0);
         }
     }
+    upd_ephidx(&cors_nav->data,ephsat);
 }
 
 static cors_obsd_t* new_cors_obsd(cors_obsd_t **tbl, int srcid)
@@ -154,12 +286,104 @@ extern void cors_updobs(cors_obs_t *cors_obs, const obsd_t *obsd, int n, int src
     if (n<=0) return;
 
     cors_obsd_t *s;
+    cors_obs_sub_t *sub,*tmp;
+
+    uv_mutex_lock(&cors_obs->lock);
     HASH_FIND_INT(cors_obs->data,&srcid,s);
     if (!s&&!(s=new_cors_obsd(&cors_obs->data,srcid))) {
+        uv_mutex_unlock(&cors_obs->lock);
         return;
     }
     memcpy(s->obs.data,obsd,sizeof(obsd_t)*n);
     s->obs.n=n;
+
+    /* model of former epoch is released by the last baseline using it */
+    if (s->bmod) {
+        cors_zdmod_unref(s->bmod);
+        s->bmod=NULL;
+    }
+
+    /* wake up only baselines using this source */
+    HASH_ITER(hh,s->subs,sub,tmp) cors_srtk_notify(sub->srtk,sub->bl);
+    uv_mutex_unlock(&cors_obs->lock);
+}
+
+/* base station model of current epoch (called with cors_obs locked) ---------*/
+extern cors_zdmod_t* cors_zdmod_ref(cors_obsd_t *obsd)
+{
+    cors_zdmod_t *mod=obsd->bmod;
+
+    if (!mod) {
+        if (!(mod=calloc(1,sizeof(cors_zdmod_t)))) return NULL;
+        mod->ref=1;
+        uv_mutex_init(&mod->lock);
+        obsd->bmod=mod;
+    }
+    __atomic_add_fetch(&mod->ref,1,__ATOMIC_SEQ_CST);
+    return mod;
+}
+
+/* compute model once per epoch, shared read-only by baselines of the base.
+ * the model is computed with the options/position of the first caller, other
+ * callers get NULL and compute their own unless it matches theirs ----------*/
+extern const zdmod_t* cors_zdmod_upd(cors_zdmod_t *mod, gtime_t teph, const obs_t *obs,
+                                     const nav_t *nav, const double *rr, const prcopt_t *opt)
+{
+    const zdmod_t *data=NULL;
+
+    uv_mutex_lock(&mod->lock);
+    if (!mod->stat) {
+        mod->stat=zdmodel(teph,obs->data,obs->n,nav,rr,opt,&mod->data)?1:-1;
+    }
+    if (mod->stat>0&&obs->n>0&&
+        zdmodmatch(&mod->data,teph,obs->data[0].time,obs->n,rr,opt)) {
+        data=&mod->data;
+    }
+    uv_mutex_unlock(&mod->lock);
+    return data;
+}
+
+extern void cors_zdmod_unref(cors_zdmod_t *mod)
+{
+    if (__atomic_sub_fetch(&mod->ref,1,__ATOMIC_SEQ_CST)) return;
+    uv_mutex_destroy(&mod->lock);
+    free(mod);
+}
+
+extern void cors_subobs(cors_obs_t *cors_obs, int srcid, cors_baseline_t *bl, cors_srtk_t *srtk)
+{
+    cors_obsd_t *s;
+    cors_obs_sub_t *sub;
+
+    uv_mutex_lock(&cors_obs->lock);
+    HASH_FIND_INT(cors_obs->data,&srcid,s);
+    if (!s&&!(s=new_cors_obsd(&cors_obs->data,srcid))) {
+        uv_mutex_unlock(&cors_obs->lock);
+        return;
+    }
+    HASH_FIND_PTR(s->subs,&bl,sub);
+    if (!sub) {
+        sub=calloc(1,sizeof(*sub));
+        sub->bl=bl;
+        sub->srtk=srtk;
+        HASH_ADD_PTR(s->subs,bl,sub);
+    }
+    uv_mutex_unlock(&cors_obs->lock);
+}
+
+extern void cors_unsubobs(cors_obs_t *cors_obs, int srcid, const cors_baseline_t *bl)
+{
+    cors_obsd_t *s;
+    cors_obs_sub_t *sub=NULL;
+
+    uv_mutex_lock(&cors_obs->lock);
+    HASH_FIND_INT(cors_obs->data,&srcid,s);
+    if (s) HASH_FIND_PTR(s->subs,&bl,sub);
+    if (sub) {
+        HASH_DEL(s->subs,sub);
+        free(sub);
+    }
+    uv_mutex_unlock(&cors_obs->lock);
 }
 
 static cors_ssat_t* new_cors_ssat(cors_ssat_t **tbl, int srcid)
@@ -209,13 +433,25 @@ extern void cors_updsta(cors_stas_t *stas, const sta_t *sta, int srcid)
 extern void cors_freenav(cors_nav_t *nav)
 {
     freenav(&nav->data,0xFF);
+
+    if (!nav->msg) return;
+    if (nav->rtcm) cors_ntrip_sbuf_unref(nav->rtcm);
+    uv_mutex_destroy(&nav->lock);
+    free(nav->msg);
+    nav->msg=NULL;
+    nav->rtcm=NULL;
 }
 
 extern void cors_freeobs(cors_obs_t *obs)
 {
     cors_obsd_t *o,*t;
+    cors_obs_sub_t *s,*st;
     HASH_ITER(hh,obs->data,o,t) {
         HASH_DEL(obs->data,o);
+        HASH_ITER(hh,o->subs,s,st) {
+            HASH_DEL(o->subs,s); free(s);
+        }
+        if (o->bmod) cors_zdmod_unref(o->bmod);
         freeobs(&o->obs);
     }
 }
@@ -252,14 +488,35 @@ extern int cors_initnav(cors_nav_t *nav)
     nav->data.n =MAXSAT *2;
     nav->data.ng=NSATGLO*2;
     nav->data.ns=NSATSBS*2;
+    nav->data.ephidx=1;
+    return 1;
+}
+
+/* keep encoded rtcm messages of navigation data for agent connections -------*/
+extern int cors_initnavrtcm(cors_nav_t *nav)
+{
+    if (!(nav->msg=calloc(MAXSAT*2+NSATGLO,sizeof(cors_navmsg_t)))) {
+        log_trace(1,"cors_initnavrtcm: malloc error\n");
+        return 0;
+    }
+    uv_mutex_init(&nav->lock);
+    nav->rtcm=NULL;
+    nav->nenc=nav->nupd=0;
     return 1;
 }
 
 extern void cors_initobs(cors_obs_t *obs)
 {
+    uv_mutex_init(&obs->lock);
     obs->data=NULL;
 }
 
+extern void cors_initblsol(cors_blsols_t *blsols)
+{
+    uv_mutex_init(&blsols->lock);
+    blsols->data=NULL;
+}
+
 extern void cors_initssat(cors_ssats_t *ssats)
 {
     ssats->data=NULL;
@@ -354,26 +611,110 @@ static cors_blsol_t* new_cors_blsol(cors_blsol_t **tbl, cors_baseline_t *bl, int
     sprintf(id,"%d->%d",base_srcid,rover_srcid);
 
     cors_blsol_t *blsol=calloc(1,sizeof((*blsol)));
+    if (!blsol) return NULL;
     blsol->base_srcid=base_srcid;
     blsol->rover_srcid=rover_srcid;
-    bl->sol=blsol;
+    uv_mutex_init(&blsol->lock);
     strcpy(blsol->id,id);
     HASH_ADD_STR(*tbl,id,blsol);
     return blsol;
 }
 
+/* fill snapshot with the fields used by nrtk and vrs ------------------------*/
+static void set_blsnap(cors_blsnap_t *snap, const rtk_t *rtk)
+{
+    const ssat_t *ssat;
+    cors_blsat_t *s;
+    int i,f;
+
+    snap->ref=1;
+    snap->time=rtk->time;
+    snap->sol=rtk->sol;
+    matcpy(snap->rb,rtk->rb,1,3);
+    matcpy(snap->bl,rtk->bl,1,3);
+    memset(snap->idx,0,sizeof(snap->idx));
+
+    for (snap->ns=i=0;i<MAXSAT&&snap->ns<MAXOBS;i++) {
+        ssat=rtk->ssat+i;
+        for (f=0;f<NFREQ;f++) if (ssat->vsat[f]||ssat->fix[f]) break;
+        if (f>=NFREQ) continue;
+
+        s=snap->sat+snap->ns;
+        s->sat=i+1;
+        memcpy(s->vsat,ssat->vsat,sizeof(s->vsat));
+        memcpy(s->fix,ssat->fix,sizeof(s->fix));
+        memcpy(s->slip,ssat->slip,sizeof(s->slip));
+        memcpy(s->lflg,ssat->lflg,sizeof(s->lflg));
+        memcpy(s->refsat,ssat->refsat,sizeof(s->refsat));
+        memcpy(s->resc,ssat->resc,sizeof(s->resc));
+        memcpy(s->dd,ssat->dd,sizeof(s->dd));
+        snap->idx[i]=++snap->ns;
+    }
+}
+
+/* publish new baseline solution by pointer swap ---------------------------------
+ * the solution table is shared by rtk workers and looked up under its lock
+ * only on the first epoch of baseline, later epochs use bl->sol of baseline
+ * which is processed by one worker at a time.
+ *-----------------------------------------------------------------------------*/
 extern void cors_updblsol(cors_blsols_t *blsols, cors_baseline_t *bl, const rtk_t *rtk, int base_srcid, int rover_srcid)
 {
     cors_blsol_t *blsol;
+    cors_blsnap_t *snap,*old;
     char id[16];
 
-    sprintf(id,"%d->%d",base_srcid,rover_srcid);
-    HASH_FIND_STR(blsols->data,id,blsol);
-
-    if (!blsol&&!(blsol=new_cors_blsol(&blsols->data,bl,base_srcid,rover_srcid))) {
-        return;
+    if (!(blsol=bl->sol)) {
+        sprintf(id,"%d->%d",base_srcid,rover_srcid);
+        uv_mutex_lock(&blsols->lock);
+        HASH_FIND_STR(blsols->data,id,blsol);
+        if (!blsol) blsol=new_cors_blsol(&blsols->data,bl,base_srcid,rover_srcid);
+        uv_mutex_unlock(&blsols->lock);
+        if (!blsol) return;
+        __atomic_store_n(&bl->sol,blsol,__ATOMIC_RELEASE);
     }
-    blsol->rtk=*rtk;
+    /* the writer owns the spare buffer, readers only see published ones */
+    if (!(snap=blsol->spare)&&!(snap=malloc(sizeof(cors_blsnap_t)))) return;
+    blsol->spare=NULL;
+    set_blsnap(snap,rtk);
+
+    uv_mutex_lock(&blsol->lock);
+    old=blsol->snap;
+    blsol->snap=snap;
+    uv_mutex_unlock(&blsol->lock);
+
+    /* keep previous buffer for next epoch if no reader holds it */
+    if (old&&!__atomic_sub_fetch(&old->ref,1,__ATOMIC_SEQ_CST)) blsol->spare=old;
+}
+
+/* latest baseline solution snapshot (release by cors_blsnap_unref) ---------*/
+extern const cors_blsnap_t* cors_blsol_snap(cors_blsol_t *blsol)
+{
+    cors_blsnap_t *snap;
+
+    uv_mutex_lock(&blsol->lock);
+    if ((snap=blsol->snap)) __atomic_add_fetch(&snap->ref,1,__ATOMIC_SEQ_CST);
+    uv_mutex_unlock(&blsol->lock);
+    return snap;
+}
+
+extern const cors_blsnap_t* cors_blsnap_ref(const cors_blsnap_t *snap)
+{
+    if (snap) __atomic_add_fetch(&((cors_blsnap_t*)snap)->ref,1,__ATOMIC_SEQ_CST);
+    return snap;
+}
+
+extern void cors_blsnap_unref(const cors_blsnap_t *snap)
+{
+    if (!snap) return;
+    if (__atomic_sub_fetch(&((cors_blsnap_t*)snap)->ref,1,__ATOMIC_SEQ_CST)) return;
+    free((cors_blsnap_t*)snap);
+}
+
+/* satellite status in snapshot (sat=1-MAXSAT, NULL: not active) -------------*/
+extern const cors_blsat_t* cors_blsnap_sat(const cors_blsnap_t *snap, int sat)
+{
+    if (!snap||sat<=0||sat>MAXSAT||!snap->idx[sat-1]) return NULL;
+    return snap->sat+snap->idx[sat-1]-1;
 }
 
 extern void cors_freeblsol(cors_blsols_t *blsols)
@@ -381,7 +722,11 @@ extern void cors_freeblsol(cors_blsols_t *blsols)
     cors_blsol_t *blsol,*tmp;
     HASH_ITER(hh,blsols->data,blsol,tmp) {
         HASH_DEL(blsols->data,blsol);
+        if (blsol->snap) cors_blsnap_unref(blsol->snap);
+        free(blsol->spare);
+        uv_mutex_destroy(&blsol->lock);
         free(blsol);
     }
+    uv_mutex_destroy(&blsols->lock);
 }
 
@@ -7,13 +7,110 @@
  *-----------------------------------------------------------------------------*/
 #include "cors.h"
 
+#define SQR(x)          ((x)*(x))
+#define MAX_WALK        (1<<20)     /* max steps of point location walk */
+#define MAX_LINK        32          /* max link vertices for local deletion */
+#define MAX_LINK_TRIG   (MAX_LINK*2)
+
+/* robust predicates of triangle (lib/triangulator) */
+extern double ccwerrboundA,iccerrboundA;
+extern void exactinit();
+extern double counterclockwiseadapt(double *pa, double *pb, double *pc, double detsum);
+extern double incircleadapt(double *pa, double *pb, double *pc, double *pd, double permanent);
+
+typedef struct {
+    void **p;
+    int n,nmax;
+} ptr_list_t;
+
 extern void cors_dtrignet_init(cors_dtrig_net_t *dtrig_net)
 {
+    exactinit();
     dtrig_net->vts_kdtree=kd_create(3);
     dtrig_net->dtrigs=NULL;
     dtrig_net->edges=NULL;
     dtrig_net->vertexs=NULL;
     dtrig_net->state=0;
+    dtrig_net->org=0;
+    dtrig_net->stamp=0;
+    dtrig_net->nkd_dead=0;
+}
+
+/* orientation of c against a->b (>0:left,<0:right,0:collinear) --------------*/
+static double orient2d(const double *a, const double *b, const double *c)
+{
+    double detleft,detright,det,detsum;
+
+    detleft =(a[0]-c[0])*(b[1]-c[1]);
+    detright=(a[1]-c[1])*(b[0]-c[0]);
+    det=detleft-detright;
+
+    if (detleft>0.0) {
+        if (detright<=0.0) return det;
+        detsum=detleft+detright;
+    }
+    else if (detleft<0.0) {
+        if (detright>=0.0) return det;
+        detsum=-detleft-detright;
+    }
+    else return det;
+
+    if (fabs(det)>=ccwerrboundA*detsum) return det;
+    return counterclockwiseadapt((double*)a,(double*)b,(double*)c,detsum);
+}
+
+/* d against circumcircle of ccw a,b,c (>0:inside,<0:outside,0:cocircular) ---*/
+static double incircle(const double *a, const double *b, const double *c, const double *d)
+{
+    double adx,bdx,cdx,ady,bdy,cdy,alift,blift,clift,det,permanent;
+    double bdxcdy,cdxbdy,cdxady,adxcdy,adxbdy,bdxady;
+
+    adx=a[0]-d[0]; bdx=b[0]-d[0]; cdx=c[0]-d[0];
+    ady=a[1]-d[1]; bdy=b[1]-d[1]; cdy=c[1]-d[1];
+
+    bdxcdy=bdx*cdy; cdxbdy=cdx*bdy; alift=adx*adx+ady*ady;
+    cdxady=cdx*ady; adxcdy=adx*cdy; blift=bdx*bdx+bdy*bdy;
+    adxbdy=adx*bdy; bdxady=bdx*ady; clift=cdx*cdx+cdy*cdy;
+
+    det=alift*(bdxcdy-cdxbdy)+blift*(cdxady-adxcdy)+clift*(adxbdy-bdxady);
+    permanent=(fabs(bdxcdy)+fabs(cdxbdy))*alift+(fabs(cdxady)+fabs(adxcdy))*blift+
+              (fabs(adxbdy)+fabs(bdxady))*clift;
+
+    if (fabs(det)>iccerrboundA*permanent) return det;
+    return incircleadapt((double*)a,(double*)b,(double*)c,(double*)d,permanent);
+}
+
+static void ptr_list_add(ptr_list_t *list, void *p)
+{
+    void **pp;
+    if (list->n>=list->nmax) {
+        list->nmax=list->nmax<=0?64:list->nmax*2;
+        if (!(pp=realloc(list->p,sizeof(void*)*list->nmax))) return;
+        list->p=pp;
+    }
+    list->p[list->n++]=p;
+}
+
+/* local plane coordinates of position (net origin fixed at first vertex) ----*/
+static void pos2xy(const cors_dtrig_net_t *dtrig_net, const double *pos, double *xy)
+{
+    double dr[3],de[3];
+    int i;
+
+    for (i=0;i<3;i++) dr[i]=pos[i]-dtrig_net->r0[i];
+    ecef2enu(dtrig_net->pos0,dr,de);
+    xy[0]=de[0];
+    xy[1]=de[1];
+}
+
+static void set_vertex_xy(cors_dtrig_net_t *dtrig_net, cors_dtrig_vertex_t *vt)
+{
+    if (!dtrig_net->org) {
+        matcpy(dtrig_net->r0,vt->pos,1,3);
+        ecef2pos(dtrig_net->r0,dtrig_net->pos0);
+        dtrig_net->org=1;
+    }
+    pos2xy(dtrig_net,vt->pos,vt->xy);
 }
 
 static void vertex_kdtree_insert(struct kdtree *vts_tree, cors_dtrig_vertex_t *vt)
@@ -21,12 +118,19 @@ static void vertex_kdtree_insert(struct kdtree *vts_tree, cors_dtrig_vertex_t *v
     kd_insert(vts_tree,vt->pos,vt);
 }
 
+static void free_dtrig(cors_dtrig_t *dtrig)
+{
+    int i;
+    for (i=0;i<3;i++) cors_vrs_model_unref(dtrig->vmod[i]);
+    free(dtrig);
+}
+
 extern void cors_dtrignet_free(cors_dtrig_net_t *dtrig_net)
 {
     cors_dtrig_t *s,*t;
     HASH_ITER(hh,dtrig_net->dtrigs,s,t) {
         HASH_DEL(dtrig_net->dtrigs,s);
-        free(s);
+        free_dtrig(s);
     }
     cors_dtrig_vertex_q_t *vv,*pp;
     cors_vrs_sta_q_t *vs,*vq;
@@ -112,8 +216,18 @@ static void upd_edge(cors_dtrig_edge_t **edges, cors_dtrig_vertex_t **vts, cors_
     upd_vertex(v2,v1);
 }
 
+static void add_dtrig_copy(cors_dtrig_t **dtrigs, const cors_dtrig_t *dtrig)
+{
+    cors_dtrig_t *d;
+    if (!dtrigs) return;
+    d=calloc(1,sizeof(*d));
+    *d=*dtrig;
+    memset(d->vmod,0,sizeof(d->vmod));
+    HASH_ADD_STR(*dtrigs,id,d);
+}
+
 static void upd_dtrig(cors_dtrig_t **dtrigs, cors_dtrig_vertex_t *v1, cors_dtrig_vertex_t *v2, cors_dtrig_vertex_t *v3,
-                      cors_dtrig_t **dtrigs_cur)
+                      cors_dtrig_t **dtrigs_cur, cors_dtrig_t **dtrig_add)
 {
     char id1[32],id2[32],id3[32];
     int i;
@@ -137,6 +251,7 @@ static void upd_dtrig(cors_dtrig_t **dtrigs, cors_dtrig_vertex_t *v1, cors_dtrig
     dtrig->vt[0]=v1; dtrig->vt[1]=v2; dtrig->vt[2]=v3;
     strcpy(dtrig->id,id1);
     HASH_ADD_STR(*dtrigs,id,dtrig);
+    add_dtrig_copy(dtrig_add,dtrig);
 }
 
 static void del_vertex_q(cors_dtrig_vertex_q_t **vq, cors_dtrig_vertex_t *vt)
@@ -190,7 +305,7 @@ static void del_edges(cors_dtrig_vertex_t *vts, cors_dtrig_edge_t **edge_cur, co
     }
 }
 
-static void del_dtrigs(cors_dtrig_t **dtrigs, cors_dtrig_t **dtrigs_cur)
+static void del_dtrigs(cors_dtrig_t **dtrigs, cors_dtrig_t **dtrigs_cur, cors_dtrig_t **dtrig_del)
 {
     char id1[32],id2[32],id3[32];
     cors_dtrig_t *dg1,*dg2,*dg3;
@@ -205,15 +320,17 @@ static void del_dtrigs(cors_dtrig_t **dtrigs, cors_dtrig_t **dtrigs_cur)
         HASH_FIND_STR(*dtrigs_cur,id2,dg2);
         HASH_FIND_STR(*dtrigs_cur,id3,dg3);
         if (dg1||dg2||dg3) continue;
-        HASH_DEL(*dtrigs,d); free(d);
+        HASH_DEL(*dtrigs,d);
+        add_dtrig_copy(dtrig_del,d);
+        free_dtrig(d);
     }
 }
 
-extern int cors_dtrignet_build(cors_dtrig_net_t *dtrignet, cors_dtrig_edge_t **edge_add, cors_dtrig_edge_t **edge_del)
+extern int cors_dtrignet_build(cors_dtrig_net_t *dtrignet, cors_dtrig_edge_t **edge_add, cors_dtrig_edge_t **edge_del,
+                               cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del)
 {
     struct triangulateio in,out;
     int i,j=0,k=0,cnt=HASH_COUNT(dtrignet->vertexs),p[3],l=0;
-    double de[3],r0[3]={0},pos0[3],dr[3];
     char parameters[]="zQB",id1[32],id2[32],id3[32];
     cors_dtrig_vertex_t *v,*t,**vs,*vtss[2];
     cors_dtrig_vertex_t *vts=dtrignet->vertexs;
@@ -234,18 +351,8 @@ extern int cors_dtrignet_build(cors_dtrig_net_t *dtrignet, cors_dtrig_edge_t **e
     vs=calloc(cnt,sizeof(cors_dtrig_vertex_t*));
 
     HASH_ITER(hh,dtrignet->vertexs,v,t) {
-        r0[0]+=v->pos[0];
-        r0[1]+=v->pos[1];
-        r0[2]+=v->pos[2];
-    }
-    for (i=0;i<3;i++) r0[i]/=cnt;
-    ecef2pos(r0,pos0);
-
-    HASH_ITER(hh,dtrignet->vertexs,v,t) {
-        for (i=0;i<3;i++) dr[i]=v->pos[i]-r0[i];
-        ecef2enu(pos0,dr,de);
-        in.pointlist[k++]=de[0];
-        in.pointlist[k++]=de[1];
+        in.pointlist[k++]=v->xy[0];
+        in.pointlist[k++]=v->xy[1];
         vs[j++]=v;
     }
     in.pointattributelist     =NULL;
@@ -274,10 +381,10 @@ extern int cors_dtrignet_build(cors_dtrig_net_t *dtrignet, cors_dtrig_edge_t **e
         upd_edge(&dtrignet->edges,&vts,vs[p[0]],vs[p[1]],&edge_cur,edge_add);
         upd_edge(&dtrignet->edges,&vts,vs[p[1]],vs[p[2]],&edge_cur,edge_add);
         upd_edge(&dtrignet->edges,&vts,vs[p[2]],vs[p[0]],&edge_cur,edge_add);
-        upd_dtrig(&dtrignet->dtrigs,vs[p[0]],vs[p[1]],vs[p[2]],&dtrig_cur);
+        upd_dtrig(&dtrignet->dtrigs,vs[p[0]],vs[p[1]],vs[p[2]],&dtrig_cur,dtrig_add);
     }
     del_edges(vts,&edge_cur,&dtrignet->edges,edge_del);
-    del_dtrigs(&dtrignet->dtrigs,&dtrig_cur);
+    del_dtrigs(&dtrignet->dtrigs,&dtrig_cur,dtrig_del);
     HASH_ITER(hh,edge_cur,e,et) {
         HASH_DEL(edge_cur,e); free(e);
     }
@@ -291,43 +398,408 @@ extern int cors_dtrignet_build(cors_dtrig_net_t *dtrignet, cors_dtrig_edge_t **e
     return out.numberoftriangles;
 }
 
-static void upd_dtrig_edge(cors_dtrig_net_t *dtrig_net)
+static void set_dtrig_edge(cors_dtrig_net_t *dtrig_net, cors_dtrig_t *d)
 {
-    cors_dtrig_edge_t *e1,*e2,*e3;
-    cors_dtrig_t *d,*t;
     static int j[3][2]={{1,2},{0,2},{0,1}};
-    char id1[32],id2[32],id3[32];
+    cors_dtrig_edge_t *e1,*e2;
+    char id1[32],id2[32];
     int i;
 
-    HASH_ITER(hh,dtrig_net->dtrigs,d,t) {
-        sprintf(id1,"%d->%d",d->vt[0]->srcid,d->vt[1]->srcid);
-        sprintf(id2,"%d->%d",d->vt[1]->srcid,d->vt[2]->srcid);
-        sprintf(id3,"%d->%d",d->vt[2]->srcid,d->vt[0]->srcid);
-
+    for (i=0;i<3;i++) {
+        sprintf(id1,"%d->%d",d->vt[i]->srcid,d->vt[(i+1)%3]->srcid);
+        HASH_FIND_STR(dtrig_net->edges,id1,e1);
+        d->edge[i]=e1;
+    }
+    for (i=0;i<3;i++) {
+        sprintf(id1,"%d->%d",d->vt[i]->srcid,d->vt[j[i][0]]->srcid);
+        sprintf(id2,"%d->%d",d->vt[i]->srcid,d->vt[j[i][1]]->srcid);
         HASH_FIND_STR(dtrig_net->edges,id1,e1);
         HASH_FIND_STR(dtrig_net->edges,id2,e2);
-        HASH_FIND_STR(dtrig_net->edges,id3,e3);
-        d->edge[0]=e1;
-        d->edge[1]=e2;
-        d->edge[2]=e3;
+        d->edge_f[i][0]=e1;
+        d->edge_f[i][1]=e2;
     }
+}
+
+static void upd_dtrig_edge(cors_dtrig_net_t *dtrig_net)
+{
+    cors_dtrig_t *d,*t;
+
+    HASH_ITER(hh,dtrig_net->dtrigs,d,t) set_dtrig_edge(dtrig_net,d);
+}
+
+static cors_dtrig_edge_t* find_edge(cors_dtrig_net_t *dtrig_net, const cors_dtrig_vertex_t *v1, const cors_dtrig_vertex_t *v2)
+{
+    cors_dtrig_edge_t *e;
+    char id[32];
+    sprintf(id,"%d->%d",v1->srcid,v2->srcid);
+    HASH_FIND_STR(dtrig_net->edges,id,e);
+    return e;
+}
+
+/* link each directed edge to the ccw triangle on its left -------------------*/
+static void link_dtrig_edges(cors_dtrig_net_t *dtrig_net)
+{
+    cors_dtrig_edge_t *e,*et;
+    cors_dtrig_t *d,*t;
+    int i;
+
+    HASH_ITER(hh,dtrig_net->edges,e,et) e->dtrig=NULL;
     HASH_ITER(hh,dtrig_net->dtrigs,d,t) {
         for (i=0;i<3;i++) {
-            sprintf(id1,"%d->%d",d->vt[i]->srcid,d->vt[j[i][0]]->srcid);
-            sprintf(id2,"%d->%d",d->vt[i]->srcid,d->vt[j[i][1]]->srcid);
-            HASH_FIND_STR(dtrig_net->edges,id1,e1);
-            HASH_FIND_STR(dtrig_net->edges,id2,e2);
-            d->edge_f[i][0]=e1;
-            d->edge_f[i][1]=e2;
+            if ((e=find_edge(dtrig_net,d->vt[i],d->vt[(i+1)%3]))) e->dtrig=d;
         }
     }
 }
 
-extern int cors_dtrignet_add_vertex(cors_dtrig_net_t *dtrig_net, const double *pos, int srcid, cors_dtrig_edge_t **edge_add,
-                                    cors_dtrig_edge_t **edge_del)
+/* full rebuild by triangle (fallback of incremental update) -----------------*/
+static void rebuild_dtrignet(cors_dtrig_net_t *dtrig_net, cors_dtrig_edge_t **edge_add, cors_dtrig_edge_t **edge_del,
+                             cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del)
+{
+    cors_dtrignet_build(dtrig_net,edge_add,edge_del,dtrig_add,dtrig_del);
+    link_dtrig_edges(dtrig_net);
+    upd_dtrig_edge(dtrig_net);
+}
+
+/* add triangle v1->v2->v3 (ccw) with its edges ------------------------------*/
+static void add_new_dtrig(cors_dtrig_net_t *dtrig_net, cors_dtrig_vertex_t *v1, cors_dtrig_vertex_t *v2, cors_dtrig_vertex_t *v3,
+                          cors_dtrig_edge_t **edge_add, cors_dtrig_t **dtrig_add)
+{
+    cors_dtrig_vertex_t *vt[3]={v1,v2,v3};
+    cors_dtrig_edge_t *e;
+    cors_dtrig_t *d;
+    int i;
+
+    for (i=0;i<3;i++) {
+        upd_edge(&dtrig_net->edges,&dtrig_net->vertexs,vt[i],vt[(i+1)%3],NULL,edge_add);
+    }
+    d=calloc(1,sizeof(*d));
+    for (i=0;i<3;i++) d->vt[i]=vt[i];
+    sprintf(d->id,"%d->%d->%d",v1->srcid,v2->srcid,v3->srcid);
+    HASH_ADD_STR(dtrig_net->dtrigs,id,d);
+
+    for (i=0;i<3;i++) {
+        if ((e=find_edge(dtrig_net,vt[i],vt[(i+1)%3]))) e->dtrig=d;
+    }
+    set_dtrig_edge(dtrig_net,d);
+    add_dtrig_copy(dtrig_add,d);
+}
+
+static void del_old_dtrig(cors_dtrig_net_t *dtrig_net, cors_dtrig_t *d, cors_dtrig_t **dtrig_del)
+{
+    cors_dtrig_edge_t *e;
+    int i;
+
+    for (i=0;i<3;i++) {
+        e=find_edge(dtrig_net,d->vt[i],d->vt[(i+1)%3]);
+        if (e&&e->dtrig==d) e->dtrig=NULL;
+    }
+    HASH_DEL(dtrig_net->dtrigs,d);
+    add_dtrig_copy(dtrig_del,d);
+    free(d);
+}
+
+/* delete edges v1->v2 and v2->v1 --------------------------------------------*/
+static void del_edge_pair(cors_dtrig_net_t *dtrig_net, cors_dtrig_vertex_t *v1, cors_dtrig_vertex_t *v2,
+                          cors_dtrig_edge_t **edge_del)
+{
+    cors_dtrig_edge_t *e,*et;
+    int i;
+
+    for (i=0;i<2;i++) {
+        if (!(et=i?find_edge(dtrig_net,v2,v1):find_edge(dtrig_net,v1,v2))) continue;
+        if (edge_del) {
+            e=calloc(1,sizeof(*e));
+            *e=*et;
+            HASH_ADD_STR(*edge_del,id,e);
+        }
+        del_edge_prc(dtrig_net->vertexs,&dtrig_net->edges,et,et->vt[0],et->vt[1]);
+    }
+}
+
+/* hull edge b->x leaving b / hull edge w->a entering a ----------------------*/
+static cors_dtrig_edge_t* next_hull_edge(cors_dtrig_net_t *dtrig_net, cors_dtrig_vertex_t *b)
+{
+    cors_dtrig_edge_q_t *q,*t;
+    cors_dtrig_edge_t *r;
+
+    HASH_ITER(hh,b->edge_list,q,t) {
+        if (!q->edge->dtrig) continue;
+        r=find_edge(dtrig_net,q->edge->vt[1],b);
+        if (!r||!r->dtrig) return q->edge;
+    }
+    return NULL;
+}
+
+static cors_dtrig_edge_t* prev_hull_edge(cors_dtrig_net_t *dtrig_net, cors_dtrig_vertex_t *a)
+{
+    cors_dtrig_edge_q_t *q,*t;
+    cors_dtrig_edge_t *r;
+
+    HASH_ITER(hh,a->edge_list,q,t) {
+        if (q->edge->dtrig) continue;
+        r=find_edge(dtrig_net,q->edge->vt[1],a);
+        if (r&&r->dtrig) return r;
+    }
+    return NULL;
+}
+
+/* start triangle of point location from nearest live vertex -----------------*/
+static cors_dtrig_t* start_dtrig(cors_dtrig_net_t *dtrig_net, const double *pos)
+{
+    cors_dtrig_vertex_t *vt=NULL,*v;
+    cors_dtrig_edge_q_t *q,*t;
+    struct kdres *res;
+
+    if ((res=kd_nearest(dtrig_net->vts_kdtree,pos))) {
+        if (kd_res_size(res)>0) vt=kd_res_item_data(res);
+        kd_res_free(res);
+    }
+    if (vt) {
+        HASH_FIND_INT(dtrig_net->vertexs,&vt->srcid,v);
+        if (v==vt) {
+            HASH_ITER(hh,vt->edge_list,q,t) if (q->edge->dtrig) return q->edge->dtrig;
+        }
+    }
+    return dtrig_net->dtrigs;
+}
+
+/* locate triangle containing p by visibility walk ------------------------------
+ * return : triangle containing p (closed), or NULL with hull edge having p on
+ *          its right side (outside of network) or NULL if walk failed
+ *-----------------------------------------------------------------------------*/
+static cors_dtrig_t* locate_dtrig(cors_dtrig_net_t *dtrig_net, const double *pos, const double *p,
+                                  cors_dtrig_edge_t **hull)
+{
+    cors_dtrig_t *d=start_dtrig(dtrig_net,pos);
+    cors_dtrig_edge_t *r;
+    int i,k;
+
+    *hull=NULL;
+    for (i=0;d&&i<MAX_WALK;i++) {
+        for (k=0;k<3;k++) {
+            if (orient2d(d->vt[k]->xy,d->vt[(k+1)%3]->xy,p)>=0.0) continue;
+            r=find_edge(dtrig_net,d->vt[(k+1)%3],d->vt[k]);
+            if (r&&r->dtrig) {d=r->dtrig; break;}
+            *hull=find_edge(dtrig_net,d->vt[k],d->vt[(k+1)%3]);
+            return NULL;
+        }
+        if (k>=3) return d;
+    }
+    return NULL;
+}
+
+/* squared distance of p to segment a-b -------------------------------------*/
+static double seg_dist2(const double *a, const double *b, const double *p)
+{
+    double ab[2]={b[0]-a[0],b[1]-a[1]},ap[2]={p[0]-a[0],p[1]-a[1]},t,l=ab[0]*ab[0]+ab[1]*ab[1];
+
+    t=l>0.0?(ap[0]*ab[0]+ap[1]*ab[1])/l:0.0;
+    if (t<0.0) t=0.0; else if (t>1.0) t=1.0;
+    return SQR(ap[0]-t*ab[0])+SQR(ap[1]-t*ab[1]);
+}
+
+/* nearest triangle of point outside network: follow hull to nearest edge ----*/
+static cors_dtrig_t* nearest_hull_dtrig(cors_dtrig_net_t *dtrig_net, cors_dtrig_edge_t *e, const double *p)
+{
+    cors_dtrig_edge_t *r;
+    double d=seg_dist2(e->vt[0]->xy,e->vt[1]->xy,p),dn;
+    int i,dir;
+
+    for (dir=0;dir<2;dir++) {
+        for (i=0;i<MAX_WALK;i++) {
+            r=dir?prev_hull_edge(dtrig_net,e->vt[0]):next_hull_edge(dtrig_net,e->vt[1]);
+            if (!r||(dn=seg_dist2(r->vt[0]->xy,r->vt[1]->xy,p))>=d) break;
+            e=r; d=dn;
+        }
+    }
+    return e->dtrig;
+}
+
+static int visit_dtrig(cors_dtrig_net_t *dtrig_net, cors_dtrig_t *d, const double *p, ptr_list_t *bad)
+{
+    if (d->mark==dtrig_net->stamp) return d->bad;
+    d->mark=dtrig_net->stamp;
+    d->bad=incircle(d->vt[0]->xy,d->vt[1]->xy,d->vt[2]->xy,p)>0.0;
+    if (d->bad) ptr_list_add(bad,d);
+    return d->bad;
+}
+
+/* ghost triangle right of hull edge a->b is in conflict if p sees a->b ------*/
+static int visit_ghost(cors_dtrig_net_t *dtrig_net, cors_dtrig_edge_t *e, const double *p, ptr_list_t *bad)
+{
+    const double *a=e->vt[0]->xy,*b=e->vt[1]->xy;
+    double o;
+
+    if (e->mark==dtrig_net->stamp) return e->bad;
+    e->mark=dtrig_net->stamp;
+    o=orient2d(a,b,p);
+    e->bad=o<0.0||(o==0.0&&(p[0]-a[0])*(b[0]-a[0])+(p[1]-a[1])*(b[1]-a[1])>0.0&&
+                            (p[0]-b[0])*(a[0]-b[0])+(p[1]-b[1])*(a[1]-b[1])>0.0);
+    if (e->bad) ptr_list_add(bad,e);
+    return e->bad;
+}
+
+/* insert vertex by Bowyer-Watson on the cavity of conflicting triangles --------
+ * return : status (1:ok,0:not inserted, full rebuild needed)
+ *-----------------------------------------------------------------------------*/
+static int insert_vertex(cors_dtrig_net_t *dtrig_net, cors_dtrig_vertex_t *vt, cors_dtrig_edge_t **edge_add,
+                         cors_dtrig_edge_t **edge_del, cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del)
+{
+    ptr_list_t badd={0},badg={0},bnd={0},cand={0};
+    cors_dtrig_vertex_t *a,*b;
+    cors_dtrig_edge_t *e,*r;
+    cors_dtrig_t *d;
+    const double *p=vt->xy;
+    int i,j,k,stat=0;
+
+    d=locate_dtrig(dtrig_net,vt->pos,p,&e);
+    if (!d&&!e) return 0;
+    if (d) {
+        for (k=0;k<3;k++) {
+            if (d->vt[k]->xy[0]==p[0]&&d->vt[k]->xy[1]==p[1]) return 1; /* duplicated */
+        }
+    }
+    dtrig_net->stamp++;
+    if (d?!visit_dtrig(dtrig_net,d,p,&badd):!visit_ghost(dtrig_net,e,p,&badg)) goto exit;
+
+    /* cavity search over triangles and ghost triangles */
+    for (i=j=0;i<badd.n||j<badg.n;) {
+        if (i<badd.n) {
+            d=badd.p[i++];
+            for (k=0;k<3;k++) {
+                a=d->vt[k]; b=d->vt[(k+1)%3];
+                r=find_edge(dtrig_net,b,a);
+                if (r&&r->dtrig) {
+                    if (visit_dtrig(dtrig_net,r->dtrig,p,&badd)) continue;
+                }
+                else if (!(e=find_edge(dtrig_net,a,b))||visit_ghost(dtrig_net,e,p,&badg)) continue;
+                ptr_list_add(&bnd,a); ptr_list_add(&bnd,b);
+            }
+        }
+        else {
+            e=badg.p[j++];
+            a=e->vt[0]; b=e->vt[1];
+            if (!visit_dtrig(dtrig_net,e->dtrig,p,&badd)) {
+                ptr_list_add(&bnd,b); ptr_list_add(&bnd,a);
+            }
+            if ((r=prev_hull_edge(dtrig_net,a))) visit_ghost(dtrig_net,r,p,&badg);
+            if ((r=next_hull_edge(dtrig_net,b))) visit_ghost(dtrig_net,r,p,&badg);
+        }
+    }
+    /* retriangulate cavity */
+    for (i=0;i<badd.n;i++) {
+        d=badd.p[i];
+        for (k=0;k<3;k++) {
+            ptr_list_add(&cand,d->vt[k]); ptr_list_add(&cand,d->vt[(k+1)%3]);
+        }
+        del_old_dtrig(dtrig_net,d,dtrig_del);
+    }
+    for (i=0;i<bnd.n;i+=2) {
+        add_new_dtrig(dtrig_net,bnd.p[i],bnd.p[i+1],vt,edge_add,dtrig_add);
+    }
+    for (i=0;i<cand.n;i+=2) {
+        e=find_edge(dtrig_net,cand.p[i],cand.p[i+1]);
+        r=find_edge(dtrig_net,cand.p[i+1],cand.p[i]);
+        if ((e&&e->dtrig)||(r&&r->dtrig)) continue;
+        del_edge_pair(dtrig_net,cand.p[i],cand.p[i+1],edge_del);
+    }
+    stat=1;
+exit:
+    free(badd.p); free(badg.p); free(bnd.p); free(cand.p);
+    return stat;
+}
+
+static int is_in_dtrig(cors_dtrig_t *d, const double *p)
+{
+    int k;
+    for (k=0;k<3;k++) {
+        if (orient2d(d->vt[k]->xy,d->vt[(k+1)%3]->xy,p)<0.0) return 0;
+    }
+    return 1;
+}
+
+/* remove vertex and retriangulate its star by the Delaunay triangles of link --
+ * return : status (1:ok,0:not removed, full rebuild needed)
+ *-----------------------------------------------------------------------------*/
+static int remove_vertex(cors_dtrig_net_t *dtrig_net, cors_dtrig_vertex_t *vt, cors_dtrig_edge_t **edge_add,
+                         cors_dtrig_edge_t **edge_del, cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del)
+{
+    cors_dtrig_t *star[MAX_LINK],*d;
+    cors_dtrig_vertex_t *link[MAX_LINK],*tri[MAX_LINK_TRIG][3],*u[3],*s;
+    cors_dtrig_vertex_q_t *vq,*vqt;
+    cors_dtrig_edge_q_t *q,*t;
+    cors_dtrig_edge_t *r;
+    double c[2],o,ic;
+    int i,j,k,l,m,nstar=0,nlink=0,ntri=0,hull=0;
+
+    HASH_ITER(hh,vt->edge_list,q,t) {
+        if ((d=q->edge->dtrig)) {
+            if (nstar>=MAX_LINK) return 0;
+            star[nstar++]=d;
+        }
+        else if ((r=find_edge(dtrig_net,q->edge->vt[1],vt))&&r->dtrig) hull=1;
+    }
+    for (i=0;i<nstar;i++) for (k=0;k<3;k++) {
+        if ((s=star[i]->vt[k])==vt) continue;
+        for (j=0;j<nlink;j++) if (link[j]==s) break;
+        if (j<nlink) continue;
+        if (nlink>=MAX_LINK) return 0;
+        link[nlink++]=s;
+    }
+    /* Delaunay triangles of link vertices inside the star */
+    for (i=0;i<nlink;i++) for (j=i+1;j<nlink;j++) for (k=j+1;k<nlink;k++) {
+        if ((o=orient2d(link[i]->xy,link[j]->xy,link[k]->xy))==0.0) continue;
+        u[0]=link[i];
+        u[1]=o>0.0?link[j]:link[k];
+        u[2]=o>0.0?link[k]:link[j];
+        c[0]=(u[0]->xy[0]+u[1]->xy[0]+u[2]->xy[0])/3.0;
+        c[1]=(u[0]->xy[1]+u[1]->xy[1]+u[2]->xy[1])/3.0;
+        for (l=0;l<nstar;l++) if (is_in_dtrig(star[l],c)) break;
+        if (l>=nstar) continue;
+
+        for (l=0;l<nlink;l++) {
+            if (link[l]==u[0]||link[l]==u[1]||link[l]==u[2]) continue;
+            if ((ic=incircle(u[0]->xy,u[1]->xy,u[2]->xy,link[l]->xy))>0.0) break;
+            if (ic==0.0) return 0; /* cocircular: ambiguous */
+        }
+        if (l<nlink) continue;
+        if (ntri>=MAX_LINK_TRIG) return 0;
+        for (m=0;m<3;m++) tri[ntri][m]=u[m];
+        ntri++;
+    }
+    if (!hull&&ntri!=nlink-2) return 0;
+
+    for (i=0;i<nstar;i++) del_old_dtrig(dtrig_net,star[i],dtrig_del);
+    HASH_ITER(hh,vt->vt_list,vq,vqt) del_edge_pair(dtrig_net,vt,vq->vt,edge_del);
+    for (i=0;i<ntri;i++) add_new_dtrig(dtrig_net,tri[i][0],tri[i][1],tri[i][2],edge_add,dtrig_add);
+    return 1;
+}
+
+static void init_outputs(cors_dtrig_edge_t **edge_add, cors_dtrig_edge_t **edge_del, cors_dtrig_t **dtrig_add,
+                         cors_dtrig_t **dtrig_del)
 {
     if (edge_del) *edge_del=NULL;
     if (edge_add) *edge_add=NULL;
+    if (dtrig_add) *dtrig_add=NULL;
+    if (dtrig_del) *dtrig_del=NULL;
+}
+
+/* add vertex to network ---------------------------------------------------------
+ * add vertex and update triangles of its cavity only (full rebuild until the
+ * network has the first triangle)
+ * args   : cors_dtrig_net_t  *dtrig_net  IO  network
+ *          double            *pos        I   vertex position (ecef) (m)
+ *          int               srcid       I   vertex source id
+ *          cors_dtrig_edge_t **edge_add  O   added edges   (NULL: no output)
+ *          cors_dtrig_edge_t **edge_del  O   deleted edges (NULL: no output)
+ *          cors_dtrig_t      **dtrig_add O   added triangles   (NULL: no output)
+ *          cors_dtrig_t      **dtrig_del O   deleted triangles (NULL: no output)
+ * return : status (1:ok,0:error)
+ *-----------------------------------------------------------------------------*/
+extern int cors_dtrignet_add_vertex(cors_dtrig_net_t *dtrig_net, const double *pos, int srcid, cors_dtrig_edge_t **edge_add,
+                                    cors_dtrig_edge_t **edge_del, cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del)
+{
+    init_outputs(edge_add,edge_del,dtrig_add,dtrig_del);
 
     if (norm(pos,3)<=0) return 0;
 
@@ -337,37 +809,196 @@ extern int cors_dtrignet_add_vertex(cors_dtrig_net_t *dtrig_net, const double *p
     s=calloc(1,sizeof(*s));
     s->srcid=srcid;
     matcpy(s->pos,pos,1,3);
+    set_vertex_xy(dtrig_net,s);
 
     HASH_ADD_INT(dtrig_net->vertexs,srcid,s);
-    cors_dtrignet_build(dtrig_net,edge_add,edge_del);
+    if (!dtrig_net->dtrigs||!insert_vertex(dtrig_net,s,edge_add,edge_del,dtrig_add,dtrig_del)) {
+        rebuild_dtrignet(dtrig_net,edge_add,edge_del,dtrig_add,dtrig_del);
+    }
     vertex_kdtree_insert(dtrig_net->vts_kdtree,s);
-    upd_dtrig_edge(dtrig_net);
     return 1;
 }
 
-extern void cors_dtrignet_upd_vertex(cors_dtrig_net_t *dtrig_net, const double *pos, int srcid)
+/* count dead kd-tree node, rebuild kd-tree when half of it is dead ---------*/
+static void vertex_kdtree_dead(cors_dtrig_net_t *dtrig_net)
+{
+    cors_dtrig_vertex_t *s,*t;
+
+    if (++dtrig_net->nkd_dead>HASH_COUNT(dtrig_net->vertexs)/2) {
+        kd_clear(dtrig_net->vts_kdtree);
+        HASH_ITER(hh,dtrig_net->vertexs,s,t) {
+            vertex_kdtree_insert(dtrig_net->vts_kdtree,s);
+        }
+        dtrig_net->nkd_dead=0;
+    }
+}
+
+/* drop edges and triangles deleted and added again by one update ------------*/
+static void cancel_outputs(cors_dtrig_edge_t **edge_add, cors_dtrig_edge_t **edge_del, cors_dtrig_t **dtrig_add,
+                           cors_dtrig_t **dtrig_del)
+{
+    cors_dtrig_edge_t *e,*et,*ea;
+    cors_dtrig_t *d,*dt,*da;
+
+    if (edge_add&&edge_del) HASH_ITER(hh,*edge_del,e,et) {
+        HASH_FIND_STR(*edge_add,e->id,ea);
+        if (!ea) continue;
+        HASH_DEL(*edge_add,ea); free(ea);
+        HASH_DEL(*edge_del,e); free(e);
+    }
+    if (dtrig_add&&dtrig_del) HASH_ITER(hh,*dtrig_del,d,dt) {
+        HASH_FIND_STR(*dtrig_add,d->id,da);
+        if (!da) continue;
+        HASH_DEL(*dtrig_add,da); free(da);
+        HASH_DEL(*dtrig_del,d); free(d);
+    }
+}
+
+/* save baselines of edges of vertex -----------------------------------------*/
+static int save_edge_bls(cors_dtrig_net_t *dtrig_net, cors_dtrig_vertex_t *vt, cors_dtrig_edge_t **ebl)
+{
+    cors_dtrig_vertex_q_t *vq,*vqt;
+    cors_dtrig_edge_t *e;
+    int i,n=0;
+
+    if (!(*ebl=calloc(2*HASH_COUNT(vt->vt_list)+1,sizeof(cors_dtrig_edge_t)))) return 0;
+    HASH_ITER(hh,vt->vt_list,vq,vqt) {
+        for (i=0;i<2;i++) {
+            e=i?find_edge(dtrig_net,vq->vt,vt):find_edge(dtrig_net,vt,vq->vt);
+            if (!e||!e->bl) continue;
+            strcpy((*ebl)[n].id,e->id);
+            (*ebl)[n].bad=e->bad;
+            (*ebl)[n++].bl=e->bl;
+        }
+    }
+    return n;
+}
+
+/* link saved baselines to edges deleted and created again -------------------*/
+static void restore_edge_bls(cors_dtrig_net_t *dtrig_net, cors_dtrig_edge_t *ebl, int n)
+{
+    cors_dtrig_edge_t *e;
+    int i;
+
+    for (i=0;i<n;i++) {
+        HASH_FIND_STR(dtrig_net->edges,ebl[i].id,e);
+        if (!e||e->bl) continue;
+        e->bl=ebl[i].bl;
+        e->bad=ebl[i].bad;
+    }
+}
+
+/* update vertex position --------------------------------------------------------
+ * a vertex whose projected position moved is removed from its star and
+ * inserted again at the new position (full rebuild if a local update is not
+ * possible). edges and triangles kept by the move are not reported and edges
+ * kept keep their baselines.
+ * args   : cors_dtrig_net_t  *dtrig_net  IO  network
+ *          double            *pos        I   new vertex position (ecef) (m)
+ *          int               srcid       I   vertex source id
+ *          cors_dtrig_edge_t **edge_add  O   added edges   (NULL: no output)
+ *          cors_dtrig_edge_t **edge_del  O   deleted edges (NULL: no output)
+ *          cors_dtrig_t      **dtrig_add O   added triangles   (NULL: no output)
+ *          cors_dtrig_t      **dtrig_del O   deleted triangles (NULL: no output)
+ * return : status (1:network updated,0:unchanged)
+ *-----------------------------------------------------------------------------*/
+extern int cors_dtrignet_upd_vertex(cors_dtrig_net_t *dtrig_net, const double *pos, int srcid,
+                                    cors_dtrig_edge_t **edge_add, cors_dtrig_edge_t **edge_del,
+                                    cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del)
 {
     cors_dtrig_vertex_t *s;
+    cors_dtrig_edge_t *ebl;
+    double xy[2];
+    int stat,nbl;
+
+    init_outputs(edge_add,edge_del,dtrig_add,dtrig_del);
+
+    if (!pos||norm(pos,3)<=0.0) return 0;
     HASH_FIND_INT(dtrig_net->vertexs,&srcid,s);
-    if (!s) return;
-    if (pos) matcpy(s->pos,pos,1,3);
+    if (!s) return 0;
+
+    pos2xy(dtrig_net,pos,xy);
+    if (xy[0]==s->xy[0]&&xy[1]==s->xy[1]) {
+        matcpy(s->pos,pos,1,3);
+        return 0;
+    }
+    nbl=save_edge_bls(dtrig_net,s,&ebl);
+
+    stat=dtrig_net->dtrigs&&HASH_COUNT(dtrig_net->vertexs)>4&&
+         remove_vertex(dtrig_net,s,edge_add,edge_del,dtrig_add,dtrig_del);
+
+    matcpy(s->pos,pos,1,3);
+    s->xy[0]=xy[0];
+    s->xy[1]=xy[1];
+
+    if (!stat||!insert_vertex(dtrig_net,s,edge_add,edge_del,dtrig_add,dtrig_del)) {
+        rebuild_dtrignet(dtrig_net,edge_add,edge_del,dtrig_add,dtrig_del);
+    }
+    cancel_outputs(edge_add,edge_del,dtrig_add,dtrig_del);
+    restore_edge_bls(dtrig_net,ebl,nbl);
+    free(ebl);
+
+    /* former kd-tree node of vertex is dead */
+    vertex_kdtree_insert(dtrig_net->vts_kdtree,s);
+    vertex_kdtree_dead(dtrig_net);
+    return 1;
 }
 
+/* delete vertex from network ------------------------------------------------
+ * deleted vertex is kept in kd-tree until half of the tree is dead
+ *-----------------------------------------------------------------------------*/
 extern void cors_dtrignet_del_vertex(cors_dtrig_net_t *dtrig_net, int srcid, cors_dtrig_edge_t **edge_add,
-                                     cors_dtrig_edge_t **edge_del)
+                                     cors_dtrig_edge_t **edge_del, cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del)
 {
-    cors_dtrig_vertex_t *s,*t;
+    cors_dtrig_vertex_t *s;
+    int stat;
+
+    init_outputs(edge_add,edge_del,dtrig_add,dtrig_del);
 
     HASH_FIND_INT(dtrig_net->vertexs,&srcid,s);
     if (!s) return;
+
+    stat=dtrig_net->dtrigs&&HASH_COUNT(dtrig_net->vertexs)>4&&
+         remove_vertex(dtrig_net,s,edge_add,edge_del,dtrig_add,dtrig_del);
     HASH_DEL(dtrig_net->vertexs,s);
-    cors_dtrignet_build(dtrig_net,edge_add,edge_del);
+    if (!stat) rebuild_dtrignet(dtrig_net,edge_add,edge_del,dtrig_add,dtrig_del);
+
+    vertex_kdtree_dead(dtrig_net);
+}
+
+/* locate triangle of position ----------------------------------------------------
+ * walk from the triangle of nearest vertex, so lookup cost does not depend on
+ * network size. triangle nearest to position is returned if it is outside.
+ * args   : cors_dtrig_net_t *dtrig_net  I   network
+ *          double           *pos        I   position (ecef) (m)
+ *          int              *in         O   1:in triangle,0:nearest triangle
+ * return : triangle (NULL: no triangle)
+ *-----------------------------------------------------------------------------*/
+extern cors_dtrig_t* cors_dtrignet_locate(cors_dtrig_net_t *dtrig_net, const double *pos, int *in)
+{
+    cors_dtrig_edge_t *e;
+    cors_dtrig_t *d,*t,*m=NULL;
+    double p[2],c[2],dist,md=-1.0;
 
-    kd_clear(dtrig_net->vts_kdtree);
-    HASH_ITER(hh,dtrig_net->vertexs,s,t) {
-        vertex_kdtree_insert(dtrig_net->vts_kdtree,s);
+    *in=0;
+    if (!dtrig_net->dtrigs||!dtrig_net->org) return NULL;
+    pos2xy(dtrig_net,pos,p);
+
+    if ((d=locate_dtrig(dtrig_net,pos,p,&e))) {
+        *in=1;
+        return d;
     }
-    upd_dtrig_edge(dtrig_net);
+    if (e) return nearest_hull_dtrig(dtrig_net,e,p);
+
+    /* walk failed: nearest by centroid */
+    HASH_ITER(hh,dtrig_net->dtrigs,d,t) {
+        c[0]=(d->vt[0]->xy[0]+d->vt[1]->xy[0]+d->vt[2]->xy[0])/3.0;
+        c[1]=(d->vt[0]->xy[1]+d->vt[1]->xy[1]+d->vt[2]->xy[1])/3.0;
+        dist=SQR(p[0]-c[0])+SQR(p[1]-c[1]);
+        if (md<0.0||dist<md) {md=dist; m=d;}
+    }
+    if (m&&is_in_dtrig(m,p)) *in=1;
+    return m;
 }
 
 extern void cors_dtrignet_del_edge(cors_dtrig_net_t *dtrignet, int srcid1, int srcid2)
@@ -188,11 +188,16 @@ static int cors_getobs(const char *name, obsd_t *obs)
     HASH_FIND_STR(cors.ntrip.info_tbl[0],name,s);
     if (!s) return 0;
 
+    uv_mutex_lock(&cors.obs.lock);
     HASH_FIND_INT(cors.obs.data,&s->ID,o);
 
-    if (!o) return -1;
+    if (!o) {
+        uv_mutex_unlock(&cors.obs.lock);
+        return -1;
+    }
     nobs=o->obs.n;
     memcpy(obs,o->obs.data,sizeof(obsd_t)*nobs);
+    uv_mutex_unlock(&cors.obs.lock);
     return nobs;
 }
 
@@ -700,25 +705,27 @@ static void cmd_showdtrigs(char **args, int narg, vt_t *vt)
     }
 }
 
-static void cmd_showbls(char **args, int narg, vt_t *vt)
+static void show_blsol(vt_t *vt, cors_baseline_t *b)
 {
     const char *solstr[]={"------","FIX","FLOAT","SBAS","DGPS","SINGLE","PPP",""};
+    const cors_blsnap_t *snap;
     char tbuf[16];
+
+    if (!b->sol||!(snap=cors_blsol_snap(b->sol))) return;
+    time2str(b->time,tbuf,3);
+    vt_printf(vt,"%s: %3d->%3d stat=%6s\n",tbuf,b->base_srcid,b->rover_srcid,solstr[snap->sol.stat]);
+    cors_blsnap_unref(snap);
+}
+
+static void cmd_showbls(char **args, int narg, vt_t *vt)
+{
     cors_baseline_t *b,*t;
     cors_srtk_t *s,*st;
 
     HASH_ITER(hh,cors.nrtk.srtk,s,st) {
-        HASH_ITER(hh,s->bls.data,b,t) {
-            if (!b->sol) continue;
-            time2str(b->time,tbuf,3);
-            vt_printf(vt,"%s: %3d->%3d stat=%6s\n",tbuf,b->base_srcid,b->rover_srcid,solstr[b->sol->rtk.sol.stat]);
-        }
-    }
-    HASH_ITER(hh,cors.srtk.bls.data,b,t) {
-        if (!b->sol) continue;
-        time2str(b->time,tbuf,3);
-        vt_printf(vt,"%s: %3d->%3d stat=%6s\n",tbuf,b->base_srcid,b->rover_srcid,solstr[b->sol->rtk.sol.stat]);
+        HASH_ITER(hh,s->bls.data,b,t) show_blsol(vt,b);
     }
+    HASH_ITER(hh,cors.srtk.bls.data,b,t) show_blsol(vt,b);
 }
 
 static void cmd_showsubnet(char **args, int narg, vt_t *vt)
@@ -147,7 +147,7 @@ static int fixsol(rtk_t *rtk, const double *v, const double *H, int nv)
     for (i=0;i<nv;i++) R[i+i*nv]=0.0001;
 
     /* update states with constraints */
-    if (!(info=filter(rtk->x,rtk->P,H,v,R,rtk->nx,nv,NULL,0))) {
+    if (!(info=filter_ws(rtk->x,rtk->P,H,v,R,rtk->nx,nv,NULL,0,&rtk->ws))) {
 
         /* set solution */
         for (i=0;i<rtk->na;i++) {
@@ -62,6 +62,36 @@
 #define MAX_ITER_KEPLER 30        /* max number of iteration of Kelpler */
 #define MAX_ITER        30
 
+#define NEPHCACHE 4               /* orbit/clock cache entries per satellite */
+#define NEPHNODE  4               /* interpolation nodes per cache window */
+#define HEPHNODE  (1.0/(NEPHNODE-1)) /* interval of interpolation nodes (s) */
+
+typedef struct {                  /* orbit/clock polynomial of 1 s window */
+    uint32_t seq;                 /* sequence number (odd:updating) */
+    time_t t0;                    /* window start (gpst) */
+    int iode;                     /* ephemeris iode */
+    gtime_t toe;                  /* ephemeris toe */
+    double key[2];                /* ephemeris clock/orbit parameters */
+    double var;                   /* position and clock variance (m^2) */
+    double d[NEPHNODE][4];        /* divided differences of {x,y,z,dts} */
+} ephcache_t;
+
+#define NGLOSTEP  32              /* max cached integration steps of glonass */
+
+typedef struct {                  /* glonass integration states of ephemeris */
+    uint32_t seq;                 /* sequence number (odd:updating) */
+    gtime_t toe;                  /* ephemeris toe */
+    double x0[9];                 /* ephemeris position/velocity/acceleration */
+    int n;                        /* number of cached steps */
+    double x[NGLOSTEP][6];        /* states after 1..n steps of TSTEP from toe */
+} glocache_t;
+
+/* orbit/clock polynomial cache ----------------------------------------------*/
+static ephcache_t eph_cache[MAXSAT][NEPHCACHE];
+static glocache_t glo_cache[NSATGLO>0?NSATGLO:1][2]; /* by prn and direction */
+static int eph_cache_ena=1;
+static uint64_t eph_cache_nhit=0,eph_cache_nmiss=0;
+
 /* ephemeris selections ------------------------------------------------------*/
 static int eph_sel[]={ /* GPS,GLO,GAL,QZS,BDS,IRN,SBS */
     0,0,0,0,0,0,0
@@ -272,6 +302,52 @@ static void glorbit(double t, double *x, const double *acc)
     deq(w,k4,acc);
     for (i=0;i<6;i++) x[i]+=(k1[i]+2.0*k2[i]+2.0*k3[i]+k4[i])*t/6.0;
 }
+/* cached glonass state after k integration steps -----------------------------
+* return number of steps of the state in x (0:no cached state)
+*-----------------------------------------------------------------------------*/
+static int glostate(const glocache_t *c, gtime_t toe, const double *x0, int k,
+                    double *x)
+{
+    double xs[6];
+    uint32_t seq;
+    int n;
+    
+    if (k<=0||((seq=__atomic_load_n(&c->seq,__ATOMIC_ACQUIRE))&1)) return 0;
+    if (timediff(c->toe,toe)!=0.0||memcmp(c->x0,x0,sizeof(c->x0))) return 0;
+    if ((n=c->n<k?c->n:k)>0) memcpy(xs,c->x[n-1],sizeof(xs));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&c->seq,__ATOMIC_RELAXED)!=seq||n<=0) return 0;
+    memcpy(x,xs,sizeof(xs));
+    return n;
+}
+/* append glonass states of steps n+1..k ---------------------------------------
+* states are appended only to the cached ones they continue (a new toe starts
+* from step 0). a writer losing the race skips the update.
+*-----------------------------------------------------------------------------*/
+static void gloappend(glocache_t *c, gtime_t toe, const double *x0, int n, int k,
+                      const double (*xs)[6])
+{
+    uint32_t seq=__atomic_load_n(&c->seq,__ATOMIC_RELAXED);
+    
+    if (k>NGLOSTEP) k=NGLOSTEP;
+    if (k<=n||(seq&1)||!__atomic_compare_exchange_n(&c->seq,&seq,seq+1,0,
+                                                   __ATOMIC_ACQUIRE,__ATOMIC_RELAXED)) {
+        return;
+    }
+    if (timediff(c->toe,toe)!=0.0||memcmp(c->x0,x0,sizeof(c->x0))) {
+        if (!n) {
+            c->toe=toe;
+            memcpy(c->x0,x0,sizeof(c->x0));
+            c->n=0;
+        }
+        else n=-1;
+    }
+    if (n>=0&&c->n==n) {
+        memcpy(c->x[n],xs[n],sizeof(double)*6*(k-n));
+        c->n=k;
+    }
+    __atomic_store_n(&c->seq,seq+2,__ATOMIC_RELEASE);
+}
 /* glonass ephemeris to satellite clock bias -----------------------------------
 * compute satellite clock bias with glonass ephemeris
 * args   : gtime_t time     I   time by satellite clock (gpst)
@@ -302,12 +378,16 @@ extern double geph2clk(gtime_t time, const geph_t *geph)
 *          double *var      O   satellite position and clock variance (m^2)
 * return : none
 * notes  : see ref [2]
+*          the states after full steps of TSTEP from toe are cached per
+*          satellite, toe and direction (see setephcache()). a later time
+*          continues from the cached state with identical results.
 *-----------------------------------------------------------------------------*/
 extern void geph2pos(gtime_t time, const geph_t *geph, double *rs, double *dts,
                      double *var)
 {
-    double t,tt,x[6];
-    int i;
+    glocache_t *c=NULL;
+    double t,tt,x[6],x0[9],xs[NGLOSTEP][6];
+    int i,j,k,n=0,prn;
     
     log_trace(4,"geph2pos: time=%s sat=%2d\n",time_str(time,3),geph->sat);
     
@@ -316,13 +396,27 @@ extern void geph2pos(gtime_t time, const geph_t *geph, double *rs, double *dts,
     *dts=-geph->taun+geph->gamn*t;
     
     for (i=0;i<3;i++) {
-        x[i  ]=geph->pos[i];
-        x[i+3]=geph->vel[i];
+        x[i]=x0[i]=geph->pos[i];
+        x[i+3]=x0[i+3]=geph->vel[i];
+        x0[i+6]=geph->acc[i];
+    }
+    /* number of full steps and last step */
+    tt=t<0.0?-TSTEP:TSTEP;
+    for (k=0;fabs(t)>=TSTEP;k++) t-=tt;
+    
+    if (eph_cache_ena&&satsys(geph->sat,&prn)==SYS_GLO&&prn>=MINPRNGLO&&
+        prn<=MAXPRNGLO) {
+        c=glo_cache[prn-MINPRNGLO]+(tt<0.0);
+        n=glostate(c,geph->toe,x0,k,x);
     }
-    for (tt=t<0.0?-TSTEP:TSTEP;fabs(t)>1E-9;t-=tt) {
-        if (fabs(t)<TSTEP) tt=t;
+    for (j=n;j<k;j++) {
         glorbit(tt,x,geph->acc);
+        if (c&&j<NGLOSTEP) memcpy(xs[j],x,sizeof(x));
     }
+    if (c&&k>n&&n<NGLOSTEP) gloappend(c,geph->toe,x0,n,k,xs);
+    
+    if (fabs(t)>1E-9) glorbit(t,x,geph->acc);
+    
     for (i=0;i<3;i++) rs[i]=x[i];
     
     *var=SQR(ERREPH_GLO);
@@ -375,11 +469,15 @@ extern void seph2pos(gtime_t time, const seph_t *seph, double *rs, double *dts,
     
     *var=var_uraeph(SYS_SBS,seph->sva);
 }
-/* select ephememeris --------------------------------------------------------*/
+/* select ephememeris ---------------------------------------------------------
+* with nav->ephidx, only the ephemerides indexed for the satellite are checked.
+* indexed ones beyond nav->n (previous sets) are selected by iode only.
+*-----------------------------------------------------------------------------*/
 static eph_t *seleph(gtime_t time, int sat, int iode, const nav_t *nav)
 {
+    const int *idx=nav->ephidx&&sat>0&&sat<=MAXSAT?nav->eidx[sat-1]:NULL;
     double t,tmax,tmin;
-    int i,j=-1,sys,sel;
+    int i,j=-1,k,sys,sel;
     
     log_trace(4,"seleph  : time=%s sat=%2d iode=%d\n",time_str(time,3),sat,iode);
     
@@ -394,7 +492,9 @@ static eph_t *seleph(gtime_t time, int sat, int iode, const nav_t *nav)
     }
     tmin=tmax+1.0;
     
-    for (i=0;i<nav->n;i++) {
+    for (k=0;k<(idx?MAXEPHIDX:nav->n);k++) {
+        if (!idx) i=k;
+        else if ((i=idx[k]-1)<0||(iode<0&&i>=nav->n)) break;
         if (nav->eph[i].sat!=sat) continue;
         if (iode>=0&&nav->eph[i].iode!=iode) continue;
         if (sys==SYS_GAL) {
@@ -417,12 +517,15 @@ static eph_t *seleph(gtime_t time, int sat, int iode, const nav_t *nav)
 /* select glonass ephememeris ------------------------------------------------*/
 static geph_t *selgeph(gtime_t time, int sat, int iode, const nav_t *nav)
 {
+    const int *idx=nav->ephidx&&sat>0&&sat<=MAXSAT?nav->eidx[sat-1]:NULL;
     double t,tmax=MAXDTOE_GLO,tmin=tmax+1.0;
-    int i,j=-1;
+    int i,j=-1,k;
     
     log_trace(4,"selgeph : time=%s sat=%2d iode=%2d\n",time_str(time,3),sat,iode);
     
-    for (i=0;i<nav->ng;i++) {
+    for (k=0;k<(idx?MAXEPHIDX:nav->ng);k++) {
+        if (!idx) i=k;
+        else if ((i=idx[k]-1)<0||(iode<0&&i>=nav->ng)) break;
         if (nav->geph[i].sat!=sat) continue;
         if (iode>=0&&nav->geph[i].iode!=iode) continue;
         if ((t=fabs(timediff(nav->geph[i].toe,time)))>tmax) continue;
@@ -484,6 +587,79 @@ static int ephclk(gtime_t time, gtime_t teph, int sat, const nav_t *nav,
     
     return 1;
 }
+/* cached orbit/clock of broadcast ephemeris -----------------------------------
+* position and clock within a 1 s window of gpst are interpolated by a cubic
+* through NEPHNODE evaluations of the ephemeris. the cubic is shared by all
+* stations, baselines and vrs computing the satellite in the window. entries
+* are keyed by window and ephemeris and written under a sequence lock; a
+* writer losing the race only skips caching its own fit.
+*-----------------------------------------------------------------------------*/
+static void cachepos(gtime_t time, int sat, const eph_t *eph, const geph_t *geph,
+                     double *rs, double *dts, double *var)
+{
+    ephcache_t *c=eph_cache[sat-1],e,*w=NULL;
+    gtime_t t0={0};
+    double dt,tt=1E-3,f[2][4],key[2];
+    uint32_t seq;
+    int i,j,k,iode;
+
+    t0.time=time.time;
+    dt=timediff(time,t0);
+    iode=eph?eph->iode:geph->iode;
+    key[0]=eph?eph->f0:geph->taun;
+    key[1]=eph?eph->A:geph->pos[0];
+
+    for (i=0;i<NEPHCACHE;i++) {
+        if ((seq=__atomic_load_n(&c[i].seq,__ATOMIC_ACQUIRE))&1) continue;
+        e=c[i];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&c[i].seq,__ATOMIC_RELAXED)!=seq) continue;
+        if (e.t0!=t0.time||e.iode!=iode||e.key[0]!=key[0]||e.key[1]!=key[1]||
+            timediff(e.toe,eph?eph->toe:geph->toe)!=0.0) continue;
+        break;
+    }
+    if (i<NEPHCACHE) {
+        if (eph_cache_ena>1) __atomic_add_fetch(&eph_cache_nhit,1,__ATOMIC_RELAXED);
+    }
+    else {
+        if (eph_cache_ena>1) __atomic_add_fetch(&eph_cache_nmiss,1,__ATOMIC_RELAXED);
+        e.t0=t0.time; e.iode=iode; e.toe=eph?eph->toe:geph->toe;
+        e.key[0]=key[0]; e.key[1]=key[1];
+
+        /* newton divided differences through nodes */
+        for (k=0;k<NEPHNODE;k++) {
+            if (eph) eph2pos(timeadd(t0,k*HEPHNODE),eph,e.d[k],e.d[k]+3,&e.var);
+            else    geph2pos(timeadd(t0,k*HEPHNODE),geph,e.d[k],e.d[k]+3,&e.var);
+        }
+        for (j=1;j<NEPHNODE;j++) for (k=NEPHNODE-1;k>=j;k--) {
+            for (i=0;i<4;i++) e.d[k][i]=(e.d[k][i]-e.d[k-1][i])/(j*HEPHNODE);
+        }
+        /* replace empty or oldest entry */
+        for (i=0;i<NEPHCACHE;i++) {
+            if (!w||c[i].t0<w->t0) w=c+i;
+        }
+        seq=__atomic_load_n(&w->seq,__ATOMIC_RELAXED);
+        if (!(seq&1)&&__atomic_compare_exchange_n(&w->seq,&seq,seq+1,0,
+                                                  __ATOMIC_ACQUIRE,__ATOMIC_RELAXED)) {
+            w->t0=e.t0; w->iode=e.iode; w->toe=e.toe; w->var=e.var;
+            memcpy(w->key,e.key,sizeof(e.key));
+            memcpy(w->d,e.d,sizeof(e.d));
+            __atomic_store_n(&w->seq,seq+2,__ATOMIC_RELEASE);
+        }
+    }
+    for (j=0;j<2;j++) for (i=0;i<4;i++) {
+        f[j][i]=e.d[NEPHNODE-1][i];
+        for (k=NEPHNODE-2;k>=0;k--) f[j][i]=e.d[k][i]+(dt+j*tt-k*HEPHNODE)*f[j][i];
+    }
+    /* satellite velocity and clock drift by differential approx */
+    for (i=0;i<3;i++) {
+        rs[i]=f[0][i];
+        rs[i+3]=(f[1][i]-f[0][i])/tt;
+    }
+    dts[0]=f[0][3];
+    dts[1]=(f[1][3]-f[0][3])/tt;
+    *var=e.var;
+}
 /* satellite position and clock by broadcast ephemeris -----------------------*/
 static int ephpos(gtime_t time, gtime_t teph, int sat, const nav_t *nav,
                   int iode, double *rs, double *dts, double *var, int *svh)
@@ -502,17 +678,25 @@ static int ephpos(gtime_t time, gtime_t teph, int sat, const nav_t *nav,
     
     if (sys==SYS_GPS||sys==SYS_GAL||sys==SYS_QZS||sys==SYS_CMP||sys==SYS_IRN) {
         if (!(eph=seleph(teph,sat,iode,nav))) return 0;
+        *svh=eph->svh;
+        if (eph_cache_ena) {
+            cachepos(time,sat,eph,NULL,rs,dts,var);
+            return 1;
+        }
         eph2pos(time,eph,rs,dts,var);
         time=timeadd(time,tt);
         eph2pos(time,eph,rst,dtst,var);
-        *svh=eph->svh;
     }
     else if (sys==SYS_GLO) {
         if (!(geph=selgeph(teph,sat,iode,nav))) return 0;
+        *svh=geph->svh;
+        if (eph_cache_ena) {
+            cachepos(time,sat,NULL,geph,rs,dts,var);
+            return 1;
+        }
         geph2pos(time,geph,rs,dts,var);
         time=timeadd(time,tt);
         geph2pos(time,geph,rst,dtst,var);
-        *svh=geph->svh;
     }
     else if (sys==SYS_SBS) {
         if (!(seph=selseph(teph,sat,nav))) return 0;
@@ -801,6 +985,30 @@ extern int getseleph(int sys)
     }
     return 0;
 }
+/* set orbit/clock cache -------------------------------------------------------
+* enable or disable the orbit/clock polynomial cache of broadcast ephemeris and
+* the integration state cache of glonass ephemeris
+* args   : int    ena       I   cache enabled (0:off,1:on,2:on with statistics)
+*                               (default: on)
+* return : none
+* notes  : hit/miss statistics are counted by all threads on shared counters,
+*          so they are only counted for ena=2
+*-----------------------------------------------------------------------------*/
+extern void setephcache(int ena)
+{
+    eph_cache_ena=ena;
+}
+/* get orbit/clock cache statistics --------------------------------------------
+* args   : uint64_t *nhit   O   number of cache hits   (NULL: no output)
+*          uint64_t *nmiss  O   number of cache misses (NULL: no output)
+* return : cache enabled (0:off,1:on,2:on with statistics)
+*-----------------------------------------------------------------------------*/
+extern int getephcache(uint64_t *nhit, uint64_t *nmiss)
+{
+    if (nhit ) *nhit =__atomic_load_n(&eph_cache_nhit ,__ATOMIC_RELAXED);
+    if (nmiss) *nmiss=__atomic_load_n(&eph_cache_nmiss,__ATOMIC_RELAXED);
+    return eph_cache_ena;
+}
 /* compute distance between satellite and receiver-----------------------------*/
 extern double satdis(const double *rr, const obsd_t *obs, const nav_t *nav, int ephopt, double *dts_, double *e)
 {
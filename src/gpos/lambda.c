@@ -20,11 +20,11 @@
 #define ROUND(x)    (floor((x)+0.5))
 #define SWAP(x,y)   do {double tmp_; tmp_=x; x=y; y=tmp_;} while (0)
 
-/* LD factorization (Q=L'*diag(D)*L) -----------------------------------------*/
-static int LD(int n, const double *Q, double *L, double *D)
+/* LD factorization (Q=L'*diag(D)*L) (A: work n x n) -------------------------*/
+static int LD(int n, const double *Q, double *L, double *D, double *A)
 {
     int i,j,k,info=0;
-    double a,*A=mat(n,n);
+    double a;
     
     memcpy(A,Q,sizeof(double)*n*n);
     for (i=n-1;i>=0;i--) {
@@ -38,7 +38,6 @@ static int LD(int n, const double *Q, double *L, double *D)
         }
         for (j=0;j<=i;j++) L[i+j*n]/=L[i+i*n];
     }
-    free(A);
     if (info) fprintf(stderr,"%s: LD factorization error\n",__FILE__);
     return info;
 }
@@ -87,13 +86,13 @@ static void reduction(int n, double *L, double *D, double *Z)
         else j--;
     }
 }
-/* modified lambda (mlambda) search (ref. [2]) -------------------------------*/
+/* modified lambda (mlambda) search (ref. [2]) (work: zero n x (n+4)) --------*/
 static int search(int n, int m, const double *L, const double *D,
-                  const double *zs, double *zn, double *s)
+                  const double *zs, double *zn, double *s, double *work)
 {
     int i,j,k,c,nn=0,imax=0;
     double newdist,maxdist=1E99,y;
-    double *S=zeros(n,n),*dist=mat(n,1),*zb=mat(n,1),*z=mat(n,1),*step=mat(n,1);
+    double *S=work,*dist=work+n*n,*zb=dist+n,*z=zb+n,*step=z+n;
     
     k=n-1; dist[k]=0.0;
     zb[k]=zs[k];
@@ -140,8 +139,6 @@ static int search(int n, int m, const double *L, const double *D,
             for (k=0;k<n;k++) SWAP(zn[k+i*n],zn[k+j*n]);
         }
     }
-    free(S); free(dist); free(zb); free(z); free(step);
-    
     if (c>=LOOPMAX) {
         fprintf(stderr,"%s : search loop count overflow\n",__FILE__);
         return -1;
@@ -163,25 +160,52 @@ static int search(int n, int m, const double *L, const double *D,
 extern int lambda(int n, int m, const double *a, const double *Q, double *F,
                   double *s)
 {
+    filtws_t ws={0};
     int info;
-    double *L,*D,*Z,*z,*E;
-    
+
+    info=lambda_ws(n,m,a,Q,F,s,&ws);
+    filtws_free(&ws);
+    return info;
+}
+/* lambda/mlambda integer least-square estimation with workspace ---------------
+* integer least-square estimation (see lambda()) with temporaries taken from
+* the scratch of workspace
+* args   : int    n      I  number of float parameters
+*          int    m      I  number of fixed solutions
+*          double *a     I  float parameters (n x 1)
+*          double *Q     I  covariance matrix of float parameters (n x n)
+*          double *F     O  fixed solutions (n x m)
+*          double *s     O  sum of squared residulas of fixed solutions (1 x m)
+*          filtws_t *ws  IO workspace
+* return : status (0:ok,other:error)
+*-----------------------------------------------------------------------------*/
+extern int lambda_ws(int n, int m, const double *a, const double *Q, double *F,
+                     double *s, filtws_t *ws)
+{
+    int i,info,pbuf=ws->pbuf;
+    double *L,*D,*Z,*z,*E,*W;
+
     if (n<=0||m<=0) return -1;
-    L=zeros(n,n); D=mat(n,1); Z=eye(n); z=mat(n,1); E=mat(n,m);
+    L=filtws_mat(ws,n,n); D=filtws_mat(ws,n,1); Z=filtws_mat(ws,n,n);
+    z=filtws_mat(ws,n,1); E=filtws_mat(ws,n,m); W=filtws_mat(ws,n,n+4);
+    for (i=0;i<n;i++) Z[i+i*n]=1.0;
 
     /* LD factorization */
-    if (!(info=LD(n,Q,L,D))) {
+    if (!(info=LD(n,Q,L,D,W))) {
 
         /* lambda reduction */
         reduction(n,L,D,Z);
         matmul("TN",n,1,n,1.0,Z,a,0.0,z); /* z=Z'*a */
 
         /* mlambda search */
-        if (!(info=search(n,m,L,D,z,E,s))) {
-            info=solve("T",Z,E,n,m,F); /* F=Z'\E */
+        memset(W,0,sizeof(double)*n*n);
+        if (!(info=search(n,m,L,D,z,E,s,W))) {
+
+            /* F=Z'\E=(Z^-1)'*E */
+            if (!(info=filtws_matinv(ws,Z,n))) matmul("TN",n,m,n,1.0,Z,E,0.0,F);
         }
     }
-    free(L); free(D); free(Z); free(z); free(E);
+    ws->pbuf=pbuf;
     return info;
 }
 /* lambda reduction ------------------------------------------------------------
@@ -193,25 +217,25 @@ extern int lambda(int n, int m, const double *a, const double *Q, double *F,
 *-----------------------------------------------------------------------------*/
 extern int lambda_reduction(int n, const double *Q, double *Z)
 {
-    double *L,*D;
+    double *L,*D,*A;
     int i,j,info;
     
     if (n<=0) return -1;
     
-    L=zeros(n,n); D=mat(n,1);
+    L=zeros(n,n); D=mat(n,1); A=mat(n,n);
     
     for (i=0;i<n;i++) for (j=0;j<n;j++) {
         Z[i+j*n]=i==j?1.0:0.0;
     }
     /* LD factorization */
-    if ((info=LD(n,Q,L,D))) {
-        free(L); free(D);
+    if ((info=LD(n,Q,L,D,A))) {
+        free(L); free(D); free(A);
         return info;
     }
     /* lambda reduction */
     reduction(n,L,D,Z);
      
-    free(L); free(D);
+    free(L); free(D); free(A);
     return 0;
 }
 /* mlambda search --------------------------------------------------------------
@@ -227,22 +251,23 @@ extern int lambda_reduction(int n, const double *Q, double *Z)
 extern int lambda_search(int n, int m, const double *a, const double *Q,
                          double *F, double *s)
 {
-    double *L,*D;
+    double *L,*D,*W;
     int info;
     
     if (n<=0||m<=0) return -1;
     
-    L=zeros(n,n); D=mat(n,1);
+    L=zeros(n,n); D=mat(n,1); W=zeros(n,n+4);
     
     /* LD factorization */
-    if ((info=LD(n,Q,L,D))) {
-        free(L); free(D);
+    if ((info=LD(n,Q,L,D,W))) {
+        free(L); free(D); free(W);
         return info;
     }
     /* mlambda search */
-    info=search(n,m,L,D,a,F,s);
+    memset(W,0,sizeof(double)*n*n);
+    info=search(n,m,L,D,a,F,s,W);
     
-    free(L); free(D);
+    free(L); free(D); free(W);
     return info;
 }
 
@@ -1015,7 +1015,7 @@ extern void pppos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
             break;
         }
         /* measurement update of ekf states */
-        if ((info=filter(xp,Pp,H,v,R,rtk->nx,nv,NULL,0))) {
+        if ((info=filter_ws(xp,Pp,H,v,R,rtk->nx,nv,NULL,0,&rtk->ws))) {
             log_trace(2,"%s ppp (%d) filter error info=%d\n",str,i+1,info);
             break;
         }
@@ -27,19 +27,27 @@
 #define THRES_MW_JUMP          0.3
 #define ADJ_AR_RATIO           1
 
-/* number of parameters (pos,ionos,tropos,hw-bias,phase-bias,real,estimated) */
+/* number of parameters (pos,tropos,ionos,phase-bias,real,estimated) */
 #define NF(opt)     ((opt)->nf)
 #define NP(opt)     (3)
-#define NI(opt)     ((opt)->ionoopt!=IONOOPT_EST?0:MAXSAT)
 #define NT(opt)     ((opt)->tropopt<TROPOPT_EST?0:((opt)->tropopt<TROPOPT_ESTG?2:6))
-#define NB(opt)     ((opt)->mode<=PMODE_DGPS?0:MAXSAT*NF(opt))
-#define NR(opt)     (NP(opt)+NI(opt)+NT(opt))
-#define NX(opt)     (NR(opt)+NB(opt))
-
-/* state variable index */
-#define II(s,opt)   (NP(opt)+(s)-1)                 /* ionos (s:satellite no) */
-#define IT(r,opt)   (NP(opt)+NI(opt)+NT(opt)/2*(r)) /* tropos (r:0=rov,1:ref) */
-#define IB(s,f,opt) (NR(opt)+MAXSAT*(f)+(s)-1)      /* phase bias (s:satno,f:freq) */
+#define NIS(opt)    ((opt)->ionoopt!=IONOOPT_EST?0:1)     /* ionos per slot */
+#define NBS(opt)    ((opt)->mode<=PMODE_DGPS?0:NF(opt))   /* phase-bias per slot */
+#define NI(rtk)     (NIS(&(rtk)->opt)*(rtk)->nsmax)
+#define NB(rtk)     (NBS(&(rtk)->opt)*(rtk)->nsmax)
+#define NR(rtk)     (NP(&(rtk)->opt)+NT(&(rtk)->opt)+NI(rtk))
+#define NX(rtk)     (NR(rtk)+NB(rtk))
+#define NV(opt)     (MAXOBS*NF(opt)*2)                    /* max number of DD */
+#define NVS(opt,ns) ((ns)>0?MIN(ns,MAXOBS)*NF(opt)*2:NV(opt)) /* max number of DD for ns slots */
+
+#define NSLOT       16        /* initial number of satellite state slots */
+#define NSLOT_INC   8         /* increment of satellite state slots */
+#define MAXIX       (3+6+MAXOBS*2*(1+NFREQ)) /* max number of active states */
+
+/* state variable index (ionos and phase-bias in slot of tracked satellite) */
+#define IT(r,opt)   (NP(opt)+NT(opt)/2*(r))               /* tropos (r:0=rov,1:ref) */
+#define II(s,rtk)   (NP(&(rtk)->opt)+NT(&(rtk)->opt)+(rtk)->sslot[(s)-1]) /* ionos (s:satellite no) */
+#define IB(s,f,rtk) (NR(rtk)+(rtk)->sslot[(s)-1]*NBS(&(rtk)->opt)+(f)) /* phase bias (s:satno,f:freq) */
 
 #define DD_BSAT(val) ((val>>16)&0xFF)
 #define DD_RSAT(val) ((val>> 8)&0xFF)
@@ -155,6 +163,99 @@ static int selsat(const rtk_t *rtk, const obsd_t *obs, const double *azel, int n
     }
     return k;
 }
+/* allocate states of rtk control for satellite slots ------------------------
+* states, residual buffers and filter workspace are sized for nsmax slots, as
+* all common satellites of an epoch have a slot (at most min(nsmax,MAXOBS)
+* satellites with active states and nf*2 DD each)
+*-----------------------------------------------------------------------------*/
+static int rtkalloc(rtk_t *rtk, int nsmax)
+{
+    double *x,*P,*xa,*Pa,*xp,*Pp,*xl,*bias,*H,*v,*R;
+    short *slots;
+    int i,j,k,l,nx,na,nw,nv=NVS(&rtk->opt,nsmax),nx0=rtk->nx,nr0=NR(rtk),nsmax0=rtk->nsmax;
+
+    rtk->nsmax=MIN(nsmax,MAXOBS); nw=NX(rtk);
+    rtk->nsmax=nsmax; nx=NX(rtk); na=NR(rtk); rtk->nsmax=nsmax0;
+
+    x=zeros(nx,1); P=zeros(nx,nx); xa=zeros(na,1); Pa=zeros(na,na);
+    xp=zeros(nx,1); Pp=zeros(nx,nx); xl=zeros(nx,1); bias=zeros(nx,1);
+    H=zeros(nv,nx); v=zeros(nv,1); R=zeros(nv,nv);
+    slots=(short *)calloc(nsmax>0?nsmax:1,sizeof(short));
+
+    if (!x||!P||!xa||!Pa||!xp||!Pp||!xl||!bias||!H||!v||!R||!slots||filtws_init(&rtk->ws,nw,nv)) {
+        free(x); free(P); free(xa); free(Pa); free(xp); free(Pp); free(xl);
+        free(bias); free(H); free(v); free(R); free(slots);
+        return 0;
+    }
+    /* copy states to new state vector (phase-biases shifted by new slots) */
+    for (i=0;i<nx0;i++) {
+        k=i<nr0?i:i-nr0+na;
+        x[k]=rtk->x[i];
+        for (j=0;j<nx0;j++) {
+            l=j<nr0?j:j-nr0+na;
+            P[k+l*nx]=rtk->P[i+j*nx0];
+        }
+    }
+    for (i=0;i<nsmax0;i++) slots[i]=rtk->slots[i];
+
+    free(rtk->x ); free(rtk->P ); free(rtk->xa); free(rtk->Pa);
+    free(rtk->xp); free(rtk->Pp); free(rtk->xl); free(rtk->bias);
+    free(rtk->H ); free(rtk->v ); free(rtk->R ); free(rtk->slots);
+    rtk->x =x;  rtk->P =P;  rtk->xa=xa; rtk->Pa=Pa;
+    rtk->xp=xp; rtk->Pp=Pp; rtk->xl=xl; rtk->bias=bias;
+    rtk->H =H;  rtk->v =v;  rtk->R =R;  rtk->slots=slots;
+    rtk->nsmax=nsmax; rtk->nx=nx; rtk->na=na;
+    return 1;
+}
+/* release state slot of satellite -------------------------------------------*/
+static void freeslot(rtk_t *rtk, int k)
+{
+    int i,j,f,sat=rtk->slots[k];
+
+    for (f=-1;f<NBS(&rtk->opt);f++) {
+        if (f<0&&!NIS(&rtk->opt)) continue;
+        i=f<0?II(sat,rtk):IB(sat,f,rtk);
+        rtk->x[i]=0.0;
+        for (j=0;j<rtk->nx;j++) rtk->P[i+j*rtk->nx]=rtk->P[j+i*rtk->nx]=0.0;
+    }
+    rtk->sslot[sat-1]=-1;
+    rtk->sout [sat-1]=0;
+    rtk->slots[k]=0;
+}
+/* update state slots of satellites --------------------------------------------
+* ionospheric and phase-bias states only exist for tracked satellites. a slot
+* is assigned to a satellite when it is tracked and kept (stable index) until
+* it has not been tracked for more than maxout epochs, then it is released
+* and reused. the state vector is enlarged only if all slots are in use.
+*-----------------------------------------------------------------------------*/
+static int udslot(rtk_t *rtk, const int *sat, int ns)
+{
+    uint8_t track[MAXSAT]={0};
+    int i,k,s;
+
+    if (!NIS(&rtk->opt)&&!NBS(&rtk->opt)) return 1;
+
+    for (i=0;i<ns;i++) track[sat[i]-1]=1;
+
+    /* release slots of satellites lost for more than maxout epochs */
+    for (k=0;k<rtk->nsmax;k++) {
+        if (!(s=rtk->slots[k])||track[s-1]) continue;
+        if (++rtk->sout[s-1]>rtk->opt.maxout) freeslot(rtk,k);
+    }
+    /* assign free slots to new satellites */
+    for (i=0,k=0;i<ns;i++) {
+        rtk->sout[sat[i]-1]=0;
+        if (rtk->sslot[sat[i]-1]>=0) continue;
+
+        for (;k<rtk->nsmax&&rtk->slots[k];k++) ;
+        if (k>=rtk->nsmax&&!rtkalloc(rtk,rtk->nsmax+NSLOT_INC)) return 0;
+
+        rtk->slots[k]=(short)sat[i];
+        rtk->sslot[sat[i]-1]=(short)k;
+        log_trace(4,"udslot: sat=%3d slot=%d nx=%d\n",sat[i],k,rtk->nx);
+    }
+    return 1;
+}
 /* temporal update of position/velocity/acceleration -------------------------*/
 static void udpos(int reset, rtk_t *rtk, double tt)
 {
@@ -185,15 +286,16 @@ static void udpos(int reset, rtk_t *rtk, double tt)
 static void udion(int reset, rtk_t *rtk, double tt, double bl, const int *sat, int ns)
 {
     double el,fact;
-    int i,j;
+    int i,j,k;
 
-    for (i=1;i<=MAXSAT;i++) {
-        j=II(i,&rtk->opt);
+    for (k=0;k<rtk->nsmax;k++) {
+        if (!(i=rtk->slots[k])) continue;
+        j=II(i,rtk);
         if (rtk->x[j]!=0.0&&rtk->ssat[i-1].outc[0]>GAP_RESION&&rtk->ssat[i-1].outc[1]>GAP_RESION)
             rtk->x[j]=0.0;
     }
     for (i=0;i<ns;i++) {
-        j=II(sat[i],&rtk->opt);
+        j=II(sat[i],rtk);
         if (rtk->x[j]==0.0||reset) {
             initx(rtk,1E-6,SQR(rtk->opt.std[1]*bl/1E4),j);
         }
@@ -310,7 +412,7 @@ static void udbias(int reset_flag, rtk_t *rtk, double tt, const obsd_t *obs, con
                    const int *iu, const int *ir, int ns, const nav_t *nav)
 {
     double cp,pr,*bias,freqi,cp1,cp2,pr1,pr2,freq1,freq2,C1,C2;
-    int i,j,k,slip,reset,nf=NF(&rtk->opt),f;
+    int i,j,k,slip,reset,nf=NF(&rtk->opt),f,pbuf;
 
     for (i=0;i<ns;i++) {
 
@@ -344,7 +446,7 @@ static void udbias(int reset_flag, rtk_t *rtk, double tt, const obsd_t *obs, con
             reset|=reset_flag;
             reset|=(rtk->opt.modear==ARMODE_INST);
 
-            if (reset&&rtk->x[IB(sat[i],k,&rtk->opt)]!=0.0) initx(rtk,0.0,0.0,IB(sat[i],k,&rtk->opt));
+            if (reset&&rtk->x[IB(sat[i],k,rtk)]!=0.0) initx(rtk,0.0,0.0,IB(sat[i],k,rtk));
             if (reset) {
                 rtk->ssat[sat[i]-1].lock[k]=-rtk->opt.minlock;
                 rtk->ssat[sat[i]-1].fix[k]=0;
@@ -352,7 +454,7 @@ static void udbias(int reset_flag, rtk_t *rtk, double tt, const obsd_t *obs, con
         }
         /* reset phase-bias if detecting cycle slip */
         for (i=0;i<ns;i++) {
-            j=IB(sat[i],k,&rtk->opt);
+            j=IB(sat[i],k,rtk);
             rtk->P[j+j*rtk->nx]+=rtk->opt.prn[0]*rtk->opt.prn[0]*fabs(tt);
             slip=rtk->ssat[sat[i]-1].slip[k];
             if (rtk->opt.ionoopt==IONOOPT_IFLC) slip|=rtk->ssat[sat[i]-1].slip[0];
@@ -362,7 +464,8 @@ static void udbias(int reset_flag, rtk_t *rtk, double tt, const obsd_t *obs, con
             rtk->ssat[sat[i]-1].lock[k]=-rtk->opt.minlock;
             rtk->ssat[sat[i]-1].fix[k]=0;
         }
-        bias=zeros(ns,1);
+        pbuf=rtk->ws.pbuf;
+        bias=filtws_mat(&rtk->ws,ns,1);
 
         /* estimate approximate phase-bias by phase - code */
         for (i=j=0;i<ns;i++) {
@@ -392,10 +495,10 @@ static void udbias(int reset_flag, rtk_t *rtk, double tt, const obsd_t *obs, con
         /* set initial states of phase-bias */
         for (i=0;i<ns;i++) {
             f=(rtk->opt.ionoopt==IONOOPT_IFLC?k-1:k);
-            if (!bias[i]||rtk->x[IB(sat[i],f,&rtk->opt)]!=0.0) continue;
-            initx(rtk,bias[i],SQR(rtk->opt.std[0]),IB(sat[i],f,&rtk->opt));
+            if (!bias[i]||rtk->x[IB(sat[i],f,rtk)]!=0.0) continue;
+            initx(rtk,bias[i],SQR(rtk->opt.std[0]),IB(sat[i],f,rtk));
         }
-        free(bias);
+        rtk->ws.pbuf=pbuf;
     }
 }
 /* temporal update of states --------------------------------------------------*/
@@ -567,15 +670,31 @@ static int test_sys(int sys, int m)
     }
     return 0;
 }
+/* compare residuals ---------------------------------------------------------*/
+static int cmpres(const void *p1, const void *p2)
+{
+    double *q1=(double *)p1,*q2=(double *)p2;
+    return ((*q1-*q2)<0)?-1:1;
+}
+/* median of vector sorted in place (n>=3) -----------------------------------*/
+static double median_sort(double *w, int n)
+{
+    qsort(w,n,sizeof(double),cmpres);
+    return n%2==0?(w[n/2-1]+w[n/2])/2.0:w[n/2];
+}
 /* detect measurement outlier on MAD------------------------------------------*/
 static int detoutl_MAD(const double *v, int nv, int *outl_ind, double thres)
 {
     int i,outl_n=0;
-    double m,med;
+    double m,med,w[NFREQ*MAXOBS];
 
     if (nv<3) return 0;
 
-    med=median(v,nv); m=mad(v,nv);
+    /* median and MAD (median of absolute deviations) of residuals */
+    matcpy(w,v,1,nv);
+    med=median_sort(w,nv);
+    for (i=0;i<nv;i++) w[i]=fabs(v[i]-med);
+    m=median_sort(w,nv);
     for (i=0;i<nv;i++) {
         if (fabs((v[i]-med)/(1.4826*m))<thres) continue;
         outl_ind[outl_n++]=i;
@@ -607,18 +726,21 @@ static void detect_outl(rtk_t *rtk, const double *v, const int *vflg, int nv,
     }
 }
 /* generate valid states index------------------------------------------------*/
-static int valix(const prcopt_t *opt, const int *vflg, int nv, int *ix)
+static int valix(const rtk_t *rtk, const int *vflg, int nv, int *ix)
 {
     int i,nx=0,rsat=0,rfrq=0;
 
-    for (i=0;i<NR(opt);i++) ix[nx++]=i;
+    for (i=0;i<NP(&rtk->opt)+NT(&rtk->opt);i++) ix[nx++]=i;
+    for (i=0;i<rtk->nsmax&&NIS(&rtk->opt);i++) {
+        if (rtk->slots[i]&&!rtk->sout[rtk->slots[i]-1]) ix[nx++]=II(rtk->slots[i],rtk);
+    }
     for (i=0;i<nv;i++) {
         if (DD_TYPE(vflg[i])!=0) continue;
-        ix[nx++]=IB(DD_RSAT(vflg[i]),DD_FREQ(vflg[i]),opt);
+        ix[nx++]=IB(DD_RSAT(vflg[i]),DD_FREQ(vflg[i]),rtk);
         if (DD_BSAT(vflg[i])==rsat&&DD_FREQ(vflg[i])==rfrq) continue;
         rsat=DD_BSAT(vflg[i]);
         rfrq=DD_FREQ(vflg[i]);
-        ix[nx++]=IB(DD_BSAT(vflg[i]),DD_FREQ(vflg[i]),opt);
+        ix[nx++]=IB(DD_BSAT(vflg[i]),DD_FREQ(vflg[i]),rtk);
     }
     return nx;
 }
@@ -629,7 +751,7 @@ static int ddres(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, double dt, con
                  int ns, double *v, double *H, double *R, int *vflg, int *ix, int *nx)
 {
     prcopt_t *opt=&rtk->opt;
-    double bl,dr[3],posu[3],posr[3],didxi=0.0,didxj=0.0,*im,df;
+    double bl,dr[3],posu[3],posr[3],didxi=0.0,didxj=0.0,im[MAXOBS]={0},df;
     double tropr[MAXOBS]={0},tropu[MAXOBS]={0},dtdxr[MAXOBS*3]={0},dtdxu[MAXOBS*3]={0};
     double Ri[MAXOBS*NFREQ*2]={0},Rj[MAXOBS*NFREQ*2]={0},frq,*Hi=NULL;
     int i,j,k,m,f,nv=0,nb[NFREQ*4*2+2]={0},b=0,sysi,sysj,nf=NF(opt),bi,bj;
@@ -673,7 +795,7 @@ static int ddres(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, double dt, con
             if (!rtk->ssat[sat[j]-1].vs) continue;
 
             if (f<nf) {
-                rtk->ssat[sat[j]-1].dd[f]=x[IB(sat[i],f,opt)]-x[IB(sat[j],f,opt)];
+                rtk->ssat[sat[j]-1].dd[f]=x[IB(sat[i],f,rtk)]-x[IB(sat[j],f,rtk)];
             }
             rtk->ssat[sat[i]-1].refsat[f%nf]=sat[i];
             rtk->ssat[sat[j]-1].refsat[f%nf]=sat[i];
@@ -695,10 +817,10 @@ static int ddres(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, double dt, con
             if (opt->ionoopt==IONOOPT_EST) {
                 didxi=(f<nf?-1.0:1.0)*im[i]*SQR(FREQ1/frq);
                 didxj=(f<nf?-1.0:1.0)*im[j]*SQR(FREQ1/frq);
-                v[nv]-=didxi*x[II(sat[i],opt)]-didxj*x[II(sat[j],opt)];
+                v[nv]-=didxi*x[II(sat[i],rtk)]-didxj*x[II(sat[j],rtk)];
                 if (H) {
-                    Hi[II(sat[i],opt)]= didxi;
-                    Hi[II(sat[j],opt)]=-didxj;
+                    Hi[II(sat[i],rtk)]= didxi;
+                    Hi[II(sat[j],rtk)]=-didxj;
                 }
             }
             /* DD tropospheric delay term */
@@ -713,17 +835,17 @@ static int ddres(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, double dt, con
             /* DD phase-bias term */
             if (f<nf) {
                 if (opt->ionoopt!=IONOOPT_IFLC) {
-                    v[nv]-=CLIGHT/freq[f%nf+iu[i]*nf]*x[IB(sat[i],f,opt)]-CLIGHT/freq[f%nf+iu[j]*nf]*x[IB(sat[j],f,opt)];
+                    v[nv]-=CLIGHT/freq[f%nf+iu[i]*nf]*x[IB(sat[i],f,rtk)]-CLIGHT/freq[f%nf+iu[j]*nf]*x[IB(sat[j],f,rtk)];
                     if (H) {
-                        Hi[IB(sat[i],f,opt)]= CLIGHT/freq[f%nf+iu[i]*nf];
-                        Hi[IB(sat[j],f,opt)]=-CLIGHT/freq[f%nf+iu[j]*nf];
+                        Hi[IB(sat[i],f,rtk)]= CLIGHT/freq[f%nf+iu[i]*nf];
+                        Hi[IB(sat[j],f,rtk)]=-CLIGHT/freq[f%nf+iu[j]*nf];
                     }
                 }
                 else {
-                    v[nv]-=x[IB(sat[i],f,opt)]-x[IB(sat[j],f,opt)];
+                    v[nv]-=x[IB(sat[i],f,rtk)]-x[IB(sat[j],f,rtk)];
                     if (H) {
-                        Hi[IB(sat[i],f,opt)]= 1.0;
-                        Hi[IB(sat[j],f,opt)]=-1.0;
+                        Hi[IB(sat[i],f,rtk)]= 1.0;
+                        Hi[IB(sat[j],f,rtk)]=-1.0;
                     }
                 }
             }
@@ -756,7 +878,7 @@ static int ddres(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, double dt, con
 
             log_trace(3,"sat=%3d-%3d %4s-%4s %s%d v=%13.3f R=%8.6f %8.6f el=%5.1lf SNR=%5.1lf DD-AMB: %10.3lf fix=%d\n",sat[i],
                       sat[j],bsat,rsat,f<nf?"L":"P",f%nf+1,v[nv],Ri[nv],Rj[nv],rtk->ssat[sat[j]-1].azel[1]*R2D,rtk->ssat[sat[j]-1].snr[f%nf]*SNR_UNIT,
-                      f<nf?x[IB(sat[i],f,opt)]-x[IB(sat[j],f,opt)]:0.0,rtk->ssat[sat[j]-1].fix[f%nf]);
+                      f<nf?x[IB(sat[i],f,rtk)]-x[IB(sat[j],f,rtk)]:0.0,rtk->ssat[sat[j]-1].fix[f%nf]);
 
             vflg[nv++]=(sat[i]<<16)|(sat[j]<<8)|((f<nf?0:1)<<4)|(f%nf);
             nb[b]++;
@@ -769,7 +891,7 @@ static int ddres(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, double dt, con
     detect_outl(rtk,v,vflg,nv,Ri,Rj);
 
     /* generate valid states index */
-    if (ix) *nx=valix(opt,vflg,nv,ix);
+    if (ix) *nx=valix(rtk,vflg,nv,ix);
 
     /* DD measurement error covariance */
     if (R) ddcov(nb,b,Ri,Rj,nv,R);
@@ -801,8 +923,8 @@ static int ddidx(rtk_t *rtk, const int *vflg, int nv, int *ix, int *ind)
 
     for (i=0;i<nv;i++) {
         if (!is_fixamb(rtk,vflg[i],elmask)) continue;
-        ix[nb*2+0]=IB(DD_BSAT(vflg[i]),DD_FREQ(vflg[i]),&rtk->opt);
-        ix[nb*2+1]=IB(DD_RSAT(vflg[i]),DD_FREQ(vflg[i]),&rtk->opt);
+        ix[nb*2+0]=IB(DD_BSAT(vflg[i]),DD_FREQ(vflg[i]),rtk);
+        ix[nb*2+1]=IB(DD_RSAT(vflg[i]),DD_FREQ(vflg[i]),rtk);
         ind[nb++]=i;
         rtk->ssat[DD_RSAT(vflg[i])-1].fix[DD_FREQ(vflg[i])]=1;
         rtk->ssat[DD_BSAT(vflg[i])-1].fix[DD_FREQ(vflg[i])]=1;
@@ -820,7 +942,7 @@ static int restamb(rtk_t *rtk, const int *vflg, const double *bias, const int *i
         b=DD_BSAT(vflg[ind[i]]);
         r=DD_RSAT(vflg[ind[i]]);
         f=DD_FREQ(vflg[ind[i]]);
-        xa[IB(r,f,&rtk->opt)]=xa[IB(b,f,&rtk->opt)]-bias[i];
+        xa[IB(r,f,rtk)]=xa[IB(b,f,rtk)]-bias[i];
         rtk->ssat[r-1].fix[f]=2;
         rtk->ssat[b-1].fix[f]=2;
     }
@@ -831,42 +953,41 @@ static void holdamb(rtk_t *rtk, const double *xa, const int *vflg, const int *in
 {
     prcopt_t *opt=&rtk->opt;
     double *v,*H,*R,*var,b1,b2;
-    int i,n,nv,info,b,r,f;
+    int i,n,nv,info,b,r,f,pbuf=rtk->ws.pbuf;
 
-    v=mat(nb,1); H=zeros(nb,rtk->nx); var=mat(nb,1);
+    v=filtws_mat(&rtk->ws,nb,1); H=filtws_mat(&rtk->ws,nb,rtk->nx); var=filtws_mat(&rtk->ws,nb,1);
 
     for (i=nv=0;i<nb;i++) {
         b=DD_BSAT(vflg[ind[i]]);
         r=DD_RSAT(vflg[ind[i]]);
         f=DD_FREQ(vflg[ind[i]]);
-        v[nv]=(xa[IB(b,f,&rtk->opt)]-xa[IB(r,f,&rtk->opt)])-(rtk->x[IB(b,f,&rtk->opt)]-rtk->x[IB(r,f,&rtk->opt)]);
+        v[nv]=(xa[IB(b,f,rtk)]-xa[IB(r,f,rtk)])-(rtk->x[IB(b,f,rtk)]-rtk->x[IB(r,f,rtk)]);
 
-        H[IB(b,f,&rtk->opt)+nv*rtk->nx]= 1.0;
-        H[IB(r,f,&rtk->opt)+nv*rtk->nx]=-1.0;
+        H[IB(b,f,rtk)+nv*rtk->nx]= 1.0;
+        H[IB(r,f,rtk)+nv*rtk->nx]=-1.0;
         var[nv]=rtk->ssat[r-1].lflg[f]?3.0*VAR_HOLDAMB:VAR_HOLDAMB;
         rtk->ssat[r-1].fix[f]=3;
         rtk->ssat[b-1].fix[f]=3;
         nv++;
     }
     if (nv>0) {
-        R=zeros(nv,nv);
+        R=filtws_mat(&rtk->ws,nv,nv);
         for (i=0;i<nv;i++) R[i+i*nv]=var[i];
 
         /* update states with constraints */
-        if ((info=filter(rtk->x,rtk->P,H,v,R,rtk->nx,nv,ix,nx))) {
+        if ((info=filter_ws(rtk->x,rtk->P,H,v,R,rtk->nx,nv,ix,nx,&rtk->ws))) {
             log_trace(1,"filter error (info=%d)\n",info);
         }
-        free(R);
     }
-    free(v); free(H); free(var);
+    rtk->ws.pbuf=pbuf;
 }
 /* extract double-difference ambiguity Qb/y/Qab-------------------------------*/
 static void resamb_Qy(rtk_t *rtk, const int *ix, int nb, double *y, double *Qb, double *Qab)
 {
-    int i,j,nx=rtk->nx,na=rtk->na;
+    int i,j,nx=rtk->nx,na=rtk->na,pbuf=rtk->ws.pbuf;
     double *DP;
 
-    DP=mat(nb,nx-na);
+    DP=filtws_mat(&rtk->ws,nb,nx-na);
 
     for (i=0;y&&i<nb;i++) y[i]=rtk->x[ix[i*2]]-rtk->x[ix[i*2+1]];
 
@@ -879,14 +1000,14 @@ static void resamb_Qy(rtk_t *rtk, const int *ix, int nb, double *y, double *Qb,
     for (j=0;Qab&&j<nb;j++) for (i=0;i<na;i++) {
         Qab[i+j*na]=rtk->P[i+ix[j*2]*nx]-rtk->P[i+ix[j*2+1]*nx];
     }
-    free(DP);
+    rtk->ws.pbuf=pbuf;
 }
 /* fixamb on LAMBDA-----------------------------------------------------------*/
 static double fixamb(rtk_t *rtk, const int *vflg, const int *ind, const int *ix, int nb,
                      double *bias, double *y, double *Qb, double *Qab, double thresar)
 {
-    int i,j,info,nx=rtk->nx,na=rtk->na;
-    double *b=mat(nb,2),s[2],ratio=0.0;
+    int i,j,info,nx=rtk->nx,na=rtk->na,pbuf=rtk->ws.pbuf;
+    double *b=filtws_mat(&rtk->ws,nb,2),s[2],ratio=0.0;
 
     resamb_Qy(rtk,ix,nb,y,Qb,Qab);
 
@@ -894,9 +1015,9 @@ static double fixamb(rtk_t *rtk, const int *vflg, const int *ind, const int *ix,
     log_trace(3,"Qb=\n"); log_tracemat(3,Qb,nb,nb,12,5);
 
     /* LAMBDA/MLAMBDA ILS (integer least-square) estimation */
-    if ((info=lambda(nb,2,y,Qb,b,s))) {
+    if ((info=lambda_ws(nb,2,y,Qb,b,s,&rtk->ws))) {
         log_trace(1,"lambda error (info=%d)\n",info);
-        free(b);
+        rtk->ws.pbuf=pbuf;
         return 0.0;
     }
     ratio=s[0]>0?(float)(s[1]/s[0]):0.0f;
@@ -916,7 +1037,7 @@ static double fixamb(rtk_t *rtk, const int *vflg, const int *ind, const int *ix,
         log_trace(2,"ambiguity validation failed (nb=%d ratio=%.2f s=%.2f/%.2f)\n",
                   nb,s[1]/s[0],s[0],s[1]);
     }
-    free(b); return ratio;
+    rtk->ws.pbuf=pbuf; return ratio;
 }
 /* inherit double-differenced ambiguity---------------------------------------*/
 static int inherit_amb(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, const int *ir, const int *iu,
@@ -931,8 +1052,8 @@ static int inherit_amb(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, const in
         if (rtk->ssat[DD_RSAT(vflg[i])-1].fix[DD_FREQ(vflg[i])]!=3) continue;
         if (DD_TYPE(vflg[i])) continue;
 
-        ix[nb*2+0]=IB(DD_BSAT(vflg[i]),DD_FREQ(vflg[i]),&rtk->opt);
-        ix[nb*2+1]=IB(DD_RSAT(vflg[i]),DD_FREQ(vflg[i]),&rtk->opt);
+        ix[nb*2+0]=IB(DD_BSAT(vflg[i]),DD_FREQ(vflg[i]),rtk);
+        ix[nb*2+1]=IB(DD_RSAT(vflg[i]),DD_FREQ(vflg[i]),rtk);
         bias[nb]=ROUND(rtk->x[ix[nb*2]]-rtk->x[ix[nb*2+1]]);
         amb_ind[nb++]=i;
     }
@@ -942,12 +1063,13 @@ static int inherit_amb(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, const in
         if (rtk->ssat[DD_RSAT(vflg[i])-1].fix[DD_FREQ(vflg[i])]==3) continue;
         if (!is_fixamb(rtk,vflg[i],rtk->opt.elmin)) continue;
 
-        ixb[m*2+0]=IB(DD_BSAT(vflg[i]),DD_FREQ(vflg[i]),&rtk->opt);
-        ixb[m*2+1]=IB(DD_RSAT(vflg[i]),DD_FREQ(vflg[i]),&rtk->opt);
+        ixb[m*2+0]=IB(DD_BSAT(vflg[i]),DD_FREQ(vflg[i]),rtk);
+        ixb[m*2+1]=IB(DD_RSAT(vflg[i]),DD_FREQ(vflg[i]),rtk);
         ind[m++]=i;
     }
     if (m) {
-        double *b=mat(1,m),*y=mat(m,1),*Qb=mat(m,m);
+        int pbuf=rtk->ws.pbuf;
+        double *b=filtws_mat(&rtk->ws,1,m),*y=filtws_mat(&rtk->ws,m,1),*Qb=filtws_mat(&rtk->ws,m,m);
         double ratio,thresar=rtk->opt.thresar[0];
 #if ADJ_AR_RATIO
         thresar=adj_arratio(&rtk->opt,m);
@@ -960,7 +1082,7 @@ static int inherit_amb(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, const in
             }
         }
         rtk->sol.ratio=MAX(rtk->sol.ratio,ratio);
-        free(b); free(y); free(Qb);
+        rtk->ws.pbuf=pbuf;
     }
     return nb;
 }
@@ -968,7 +1090,7 @@ static int inherit_amb(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, const in
 static int float2fix(int hold, rtk_t *rtk, const int *vflg, int nb, int *amb_ind, int *ix, double *bias, double *xa,
                      double *y, double *Qb, double *Qab)
 {
-    int i,j,na=rtk->na,nx=rtk->nx;
+    int i,j,na=rtk->na,nx=rtk->nx,pbuf;
     double *db,*QQ;
 
     for (i=0;i<na;i++) {
@@ -982,10 +1104,11 @@ static int float2fix(int hold, rtk_t *rtk, const int *vflg, int nb, int *amb_ind
     if (rtk->opt.mode==PMODE_FIXED) return nb;
     for (i=0;i<nb;i++) y[i]-=bias[i];
 
-    QQ=mat(na,nb); db=mat(nb,1);
+    pbuf=rtk->ws.pbuf;
+    QQ=filtws_mat(&rtk->ws,na,nb); db=filtws_mat(&rtk->ws,nb,1);
 
-    if (matinv(Qb,nb)) {
-        free(db); free(QQ);
+    if (filtws_matinv(&rtk->ws,Qb,nb)) {
+        rtk->ws.pbuf=pbuf;
         return 0;
     }
     matmul("NN",nb,1,nb, 1.0,Qb ,y,0.0,db);
@@ -994,7 +1117,7 @@ static int float2fix(int hold, rtk_t *rtk, const int *vflg, int nb, int *amb_ind
     /* covariance of fixed solution (Qa=Qa-Qab*Qb^-1*Qab') */
     matmul("NN",na,nb,nb, 1.0,Qab,Qb ,0.0,QQ);
     matmul("NT",na,na,nb,-1.0,QQ ,Qab,1.0,rtk->Pa);
-    free(db); free(QQ);
+    rtk->ws.pbuf=pbuf;
     return nb;
 }
 /* resolve integer ambiguity by LAMBDA ---------------------------------------*/
@@ -1002,32 +1125,32 @@ static int resamb_LAMBDA(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, const
                          const int *vflg, int nv, int *amb_ind, double *bias, double *xa)
 {
     prcopt_t *opt=&rtk->opt;
-    int i,j,nb,info,nx=rtk->nx,na=rtk->na,*ix;
+    int i,j,nb,info,nx=rtk->nx,na=rtk->na,*ix,pbuf=rtk->ws.pbuf;
     double *DP,*y,*b,*Qb,*Qab,s[2],ratio,thresar=rtk->opt.thresar[0];
 
     if (rtk->opt.mode<=PMODE_DGPS||rtk->opt.modear==ARMODE_OFF||rtk->opt.ionoopt==IONOOPT_IFLC||
         thresar<1.0) {
         return 0;
     }
-    ix=imat(nx,2);
+    ix=filtws_imat(&rtk->ws,nx,2);
 
 #if INHERIT_AMB
     if ((nb=inherit_amb(rtk,nav,obs,ir,iu,vflg,nv,amb_ind,bias,xa,ix))) {
 #if CONST_FIX_INHERIT_AMB
-        y=mat(nb,1); Qb=mat(nb,nb); Qab=mat(na,nb);
+        y=filtws_mat(&rtk->ws,nb,1); Qb=filtws_mat(&rtk->ws,nb,nb); Qab=filtws_mat(&rtk->ws,na,nb);
 
         resamb_Qy(rtk,ix,nb,y,Qb,Qab);
         nb=float2fix(0,rtk,vflg,nb,amb_ind,bias,xa,y,Qb,Qab);
         rtk->nb=nb;
 
-        free(y); free(Qb); free(Qab); free(ix);
+        rtk->ws.pbuf=pbuf;
         log_trace(3,"inherit double-differenced ambiguity: nb=%d\n",nb);
         return nb;
 #else
         nb=float2fix(1,rtk,vflg,nb,amb_ind,ix,bias,xa,y,Qb,Qab);
         rtk->nb=nb;
 
-        free(ix);
+        rtk->ws.pbuf=pbuf;
         log_trace(3,"inherit double-differenced ambiguity: nb=%d\n",nb);
         return nb;
 #endif
@@ -1038,14 +1161,14 @@ static int resamb_LAMBDA(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, const
     /* index of SD to DD transformation matrix D */
     if ((nb=ddidx(rtk,vflg,nv,ix,amb_ind))<=0) {
         log_trace(2,"no valid double-difference\n");
-        free(ix);
+        rtk->ws.pbuf=pbuf;
         return 0;
     }
 #if ADJ_AR_RATIO
     thresar=adj_arratio(&rtk->opt,nb);
 #endif
-    y=mat(nx,1); b=mat(nx,2); Qb=mat(nx,nx);
-    Qab=mat(na,nx);
+    y=filtws_mat(&rtk->ws,nb,1); Qb=filtws_mat(&rtk->ws,nb,nb);
+    Qab=filtws_mat(&rtk->ws,na,nb);
 
     if ((ratio=fixamb(rtk,vflg,amb_ind,ix,nb,bias,y,Qb,Qab,thresar))>thresar) {
         nb=float2fix(0,rtk,vflg,nb,amb_ind,ix,bias,xa,y,Qb,Qab);
@@ -1054,8 +1177,7 @@ static int resamb_LAMBDA(rtk_t *rtk, const nav_t *nav, const obsd_t *obs, const
     else nb=0;
 
     rtk->nb=nb;
-    free(ix); free(y);
-    free(b); free(Qb); free(Qab);
+    rtk->ws.pbuf=pbuf;
     return nb; /* number of ambiguities */
 }
 /* validation of solution ----------------------------------------------------*/
@@ -1088,7 +1210,7 @@ static int valpos(rtk_t *rtk, const double *v, const double *R, const int *vflg,
 }
 /* update satellite position/velocity/clcok-----------------------------------*/
 static void udsatpos(gtime_t time, rtk_t *rtk, const obsd_t *obs, int nu, int nr, const nav_t *nav,
-                     double *rs, double *dts, double *var, int *svh)
+                     const zdmod_t *bmod, double *rs, double *dts, double *var, int *svh)
 {
     int i;
     for (i=0;i<nu;i++) {
@@ -1097,6 +1219,13 @@ static void udsatpos(gtime_t time, rtk_t *rtk, const obsd_t *obs, int nu, int nr
         var[i]=rtk->ssat[obs[i].sat-1].var;
         svh[i]=rtk->ssat[obs[i].sat-1].svh;
     }
+    if (bmod) {
+        matcpy(rs+6*nu,bmod->rs,6,nr);
+        matcpy(dts+2*nu,bmod->dts,2,nr);
+        matcpy(var+nu,bmod->var,1,nr);
+        memcpy(svh+nu,bmod->svh,sizeof(int)*nr);
+        return;
+    }
     satposs(time,obs+nu,nr,nav,rtk->opt.sateph,rs+6*nu,dts+2*nu,var+nu,svh+nu);
 }
 /* update rtk solution ------------------------------------------------------*/
@@ -1154,18 +1283,22 @@ static void udssat(rtk_t *rtk, const obsd_t *obs, int nu)
     }
 }
 /* relative positioning ------------------------------------------------------*/
-static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr, const nav_t *nav)
+static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr, const nav_t *nav,
+                  const zdmod_t *bmod)
 {
     prcopt_t *opt=&rtk->opt;
     double rs[MAXOBS*2*6]={0},dts[MAXOBS*2*2]={0},var[MAXOBS*2]={0},y[MAXOBS*4*NFREQ]={0};
     double e[MAXOBS*2*3]={0},azel[MAXOBS*2*2]={0},freq[MAXOBS*2*NFREQ]={0};
     double *v,*H,*R,*xp,*Pp,*xa,*bias,dt;
     int i,j,f,nb,r,b,n=nu+nr,ns,nv,sat[MAXOBS*2],iu[MAXOBS*2],ir[MAXOBS*2],amb_ind[MAXOBS*NF(opt)],niter;
-    int info,vflg[MAXOBS*NFREQ*2*2+1],svh[MAXOBS*2],reset=0,nf=NF(opt),ix[NX(opt)],nx;
+    int info,vflg[MAXOBS*NFREQ*2*2+1],svh[MAXOBS*2],reset=0,nf=NF(opt),ix[MAXIX],nx;
     int stat=rtk->opt.mode<=PMODE_DGPS?SOLQ_DGPS:SOLQ_FLOAT;
 
     log_trace(3,"relpos: nx=%d nu=%d nr=%d\n",rtk->nx,nu,nr);
 
+    /* release scratch of previous epoch */
+    filtws_reset(&rtk->ws);
+
     for (i=0;i<nu+nr;i++) {
         for (j=0;j<NFREQ;j++) rtk->ssat[obs[i].sat-1].vsat[j]=0;
         for (j=0;j<NFREQ;j++) rtk->ssat[obs[i].sat-1].lflg[j]=0;
@@ -1184,10 +1317,16 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr, const nav_t *na
         return 1;
     }
     /* satellite positions/clocks */
-    udsatpos(obs[0].time,rtk,obs,nu,nr,nav,rs,dts,var,svh);
+    udsatpos(obs[0].time,rtk,obs,nu,nr,nav,bmod,rs,dts,var,svh);
 
     /* UD (undifferenced) residuals for base station */
-    if (!zdres(1,obs+nu,nr,rs+nu*6,dts+nu*2,var+nu,svh+nu,nav,rtk->rb,opt,1,y+nu*nf*2,e+nu*3,azel+nu*2,freq+nu*nf)) {
+    if (bmod) {
+        matcpy(y+nu*nf*2,bmod->y,nf*2,nr);
+        matcpy(e+nu*3,bmod->e,3,nr);
+        matcpy(azel+nu*2,bmod->azel,2,nr);
+        matcpy(freq+nu*nf,bmod->freq,nf,nr);
+    }
+    else if (!zdres(1,obs+nu,nr,rs+nu*6,dts+nu*2,var+nu,svh+nu,nav,rtk->rb,opt,1,y+nu*nf*2,e+nu*3,azel+nu*2,freq+nu*nf)) {
         log_trace(1,"initial base station position error\n");
         return 0;
     }
@@ -1196,6 +1335,11 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr, const nav_t *na
         log_trace(2,"no common satellite\n");
         return 0;
     }
+    /* update state slots of satellites */
+    if (!udslot(rtk,sat,ns)) {
+        log_trace(1,"state slot allocation error\n");
+        return 0;
+    }
     xp=rtk->xp; Pp=rtk->Pp; xa=rtk->xl;
     v=rtk->v; H=rtk->H; R=rtk->R; bias=rtk->bias;
 
@@ -1219,7 +1363,7 @@ __reset_rtk:
         }
         /* Kalman filter measurement update */
         matcpy(Pp,rtk->P,rtk->nx,rtk->nx);
-        if ((info=filter(xp,Pp,H,v,R,rtk->nx,nv,ix,nx))) {
+        if ((info=filter_ws(xp,Pp,H,v,R,rtk->nx,nv,ix,nx,&rtk->ws))) {
             log_trace(1,"filter error (info=%d)\n",info);
             stat=SOLQ_NONE;
             break;
@@ -1283,25 +1427,51 @@ extern void rtkinit(rtk_t *rtk, const prcopt_t *opt)
 
     rtk->sol=sol0;
     for (i=0;i<6;i++) rtk->rb[i]=0.0;
-    rtk->nx=opt->mode<=PMODE_FIXED?NX(opt):pppnx(opt);
-    rtk->na=opt->mode<=PMODE_FIXED?NR(opt):pppnx(opt);
+    rtk->opt=*opt;
     rtk->tt=0.0;
-    rtk->x =zeros(rtk->nx,1);
-    rtk->P =zeros(rtk->nx,rtk->nx);
-    rtk->xa=zeros(rtk->na,1);
-    rtk->Pa=zeros(rtk->na,rtk->na);
-    rtk->xp=zeros(rtk->nx,1);
-    rtk->Pp=zeros(rtk->nx,rtk->nx);
-    rtk->xl=zeros(rtk->nx,1);
-    rtk->bias=zeros(rtk->nx,1);
-    rtk->v=zeros(MAXOBS*NFREQ*4,1);
-    rtk->H=zeros(MAXOBS*NFREQ*4,rtk->nx);
-    rtk->R=zeros(MAXOBS*NFREQ*4,MAXOBS*NFREQ*2);
+    rtk->x=rtk->P=rtk->xa=rtk->Pa=rtk->xp=rtk->Pp=rtk->xl=rtk->bias=rtk->H=NULL;
+    rtk->v=rtk->R=NULL;
+    rtk->slots=NULL;
+    rtk->nsmax=0;
+    memset(&rtk->ws,0,sizeof(filtws_t));
+    for (i=0;i<MAXSAT;i++) {
+        rtk->sslot[i]=-1; rtk->sout[i]=0;
+    }
+    if (opt->mode<=PMODE_FIXED) { /* compact states for tracked satellites */
+        rtk->nx=rtk->na=0;
+        rtkalloc(rtk,NIS(opt)||NBS(opt)?NSLOT:0);
+    }
+    else {
+        rtk->nx=rtk->na=pppnx(opt);
+        rtk->x =zeros(rtk->nx,1);
+        rtk->P =zeros(rtk->nx,rtk->nx);
+        rtk->xa=zeros(rtk->na,1);
+        rtk->Pa=zeros(rtk->na,rtk->na);
+        rtk->xp=zeros(rtk->nx,1);
+        rtk->Pp=zeros(rtk->nx,rtk->nx);
+        rtk->xl=zeros(rtk->nx,1);
+        rtk->bias=zeros(rtk->nx,1);
+        rtk->H=zeros(NV(opt),rtk->nx);
+        rtk->v=zeros(NV(opt),1);
+        rtk->R=zeros(NV(opt),NV(opt));
+    }
     rtk->nfix=0;
     for (i=0;i<MAXSAT;i++) {
         rtk->ambc[i]=ambc0; rtk->ssat[i]=ssat0;
     }
-    rtk->opt=*opt;
+}
+/* reserve satellite state slots ------------------------------------------------
+* enlarge states of rtk control for nslot satellite slots in advance
+* args   : rtk_t    *rtk    IO  rtk control/result struct
+*          int      nslot   I   number of satellite state slots
+* return : status (1:ok,0:error or no slots in processing mode)
+* notes  : nslot=MAXSAT gives one state slot for every satellite
+*-----------------------------------------------------------------------------*/
+extern int rtkslots(rtk_t *rtk, int nslot)
+{
+    if (rtk->opt.mode>PMODE_FIXED||(!NIS(&rtk->opt)&&!NBS(&rtk->opt))) return 0;
+    if (nslot>MAXSAT) nslot=MAXSAT;
+    return nslot<=rtk->nsmax||rtkalloc(rtk,nslot);
 }
 /* free rtk control ------------------------------------------------------------
 * free memory for rtk control struct
@@ -1315,12 +1485,16 @@ extern void rtkfree(rtk_t *rtk)
     free(rtk->P ); rtk->P =NULL;
     free(rtk->xa); rtk->xa=NULL;
     free(rtk->Pa); rtk->Pa=NULL;
+    free(rtk->xp); rtk->xp=NULL;
     free(rtk->xl); rtk->xl=NULL;
     free(rtk->Pp); rtk->Pp=NULL;
     free(rtk->v ); rtk->v =NULL;
     free(rtk->H ); rtk->H =NULL;
     free(rtk->R ); rtk->R =NULL;
     free(rtk->bias); rtk->bias=NULL;
+    free(rtk->slots); rtk->slots=NULL;
+    rtk->nsmax=0;
+    filtws_free(&rtk->ws);
 }
 /* update RTK time-------------------------------------------------------------*/
 static void udrtktime(rtk_t *rtk, gtime_t tr, gtime_t tb)
@@ -1328,6 +1502,91 @@ static void udrtktime(rtk_t *rtk, gtime_t tr, gtime_t tb)
     if (timediff(tr,tb)>0.0) rtk->time=tr;
     else rtk->time=tb;
 }
+/* options of undifferenced model -------------------------------------------*/
+static void zdmodopt(const prcopt_t *opt, zdopt_t *zopt)
+{
+    int i;
+
+    memset(zopt,0,sizeof(zdopt_t));
+    zopt->nf=NF(opt);
+    zopt->navsys=opt->navsys;
+    zopt->sateph=opt->sateph;
+    zopt->ionoopt=opt->ionoopt;
+    zopt->tropopt=opt->tropopt;
+    zopt->tidecorr=opt->tidecorr;
+    zopt->pcvopt=opt->posopt[1];
+    zopt->snrena=opt->snrmask.ena[1];
+    zopt->elmin=opt->elmin;
+    if (zopt->snrena) {
+        memcpy(zopt->snrmask,opt->snrmask.mask,sizeof(zopt->snrmask));
+    }
+    for (i=0;i<3;i++) zopt->antdel[i]=opt->antdel[1][i];
+    memcpy(zopt->off,opt->pcvr[1].off,sizeof(zopt->off));
+    memcpy(zopt->pcv,opt->pcvr[1].var,sizeof(zopt->pcv));
+    if (zopt->tidecorr) {
+        memcpy(zopt->odisp,opt->odisp[1],sizeof(zopt->odisp));
+    }
+    memcpy(zopt->exsats,opt->exsats,sizeof(zopt->exsats));
+}
+/* undifferenced model of station epoch -----------------------------------------
+ * compute satellite positions/clocks and UD residuals of station observation
+ * data as base station of relative positioning. the model of an epoch can be
+ * shared by all baselines with the station as base (see rtkpos_zd()).
+ * args   : gtime_t teph     I   time of ephemeris selection (rover epoch time)
+ *          obsd_t *obs      I   station observation data
+ *          int    n         I   number of observation data
+ *          nav_t  *nav      I   navigation messages
+ *          double *rr       I   station position (ecef) (m)
+ *          prcopt_t *opt    I   processing options
+ *          zdmod_t *mod     O   undifferenced model
+ * return : status (0:error,1:ok)
+ * notes  : the options the residuals depend on are saved in the model and
+ *          checked by zdmodmatch()
+ *-----------------------------------------------------------------------------*/
+extern int zdmodel(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav,
+                   const double *rr, const prcopt_t *opt, zdmod_t *mod)
+{
+    if (n<=0||n>MAXOBS) return 0;
+
+    memset(mod,0,sizeof(zdmod_t));
+    mod->time=obs[0].time;
+    mod->teph=teph;
+    mod->n=n;
+    mod->nf=NF(opt);
+    matcpy(mod->rr,rr,3,1);
+    zdmodopt(opt,&mod->opt);
+
+    satposs(teph,obs,n,nav,opt->sateph,mod->rs,mod->dts,mod->var,mod->svh);
+
+    if (!zdres(1,obs,n,mod->rs,mod->dts,mod->var,mod->svh,nav,rr,opt,1,mod->y,mod->e,
+               mod->azel,mod->freq)) {
+        mod->n=0;
+        return 0;
+    }
+    return 1;
+}
+/* test undifferenced model ----------------------------------------------------
+ * test if the model is the one zdmodel() would compute for the arguments
+ * args   : zdmod_t *mod     I   undifferenced model
+ *          gtime_t teph     I   time of ephemeris selection (rover epoch time)
+ *          gtime_t time     I   time of station observation data
+ *          int    n         I   number of station observation data
+ *          double *rr       I   station position (ecef) (m)
+ *          prcopt_t *opt    I   processing options
+ * return : status (0:not match,1:match)
+ *-----------------------------------------------------------------------------*/
+extern int zdmodmatch(const zdmod_t *mod, gtime_t teph, gtime_t time, int n,
+                      const double *rr, const prcopt_t *opt)
+{
+    zdopt_t zopt;
+
+    if (mod->n!=n||mod->nf!=NF(opt)||timediff(mod->time,time)!=0.0||
+        timediff(mod->teph,teph)!=0.0) return 0;
+    if (mod->rr[0]!=rr[0]||mod->rr[1]!=rr[1]||mod->rr[2]!=rr[2]) return 0;
+
+    zdmodopt(opt,&zopt);
+    return !memcmp(&mod->opt,&zopt,sizeof(zdopt_t));
+}
 /* precise positioning ---------------------------------------------------------
  * input observation data and navigation message, compute rover position by
  * RTK positioning
@@ -1340,6 +1599,20 @@ static void udrtktime(rtk_t *rtk, gtime_t tr, gtime_t tb)
  *          be properly set for relative mode except for moving-baseline
  *-----------------------------------------------------------------------------*/
 extern int rtkpos(rtk_t *rtk, const obs_t *robs, const obs_t *bobs, const nav_t *nav)
+{
+    return rtkpos_zd(rtk,robs,bobs,NULL,nav);
+}
+/* precise positioning with base station model ---------------------------------
+ * same as rtkpos() but base station satellite positions and UD residuals are
+ * taken from the model by zdmodel()
+ * args   : zdmod_t *bmod    I   base station model of bobs (NULL: compute)
+ *          (others same as rtkpos())
+ * return : status (0:no solution,1:valid solution)
+ * notes  : bmod is ignored unless zdmodmatch() holds for it with the rover
+ *          epoch time, bobs, rtk->rb and rtk->opt
+ *-----------------------------------------------------------------------------*/
+extern int rtkpos_zd(rtk_t *rtk, const obs_t *robs, const obs_t *bobs, const zdmod_t *bmod,
+                     const nav_t *nav)
 {
     obsd_t obs[2*MAXOBS]={0};
     gtime_t time=rtk->sol.time,tr={0},tb={0};
@@ -1371,8 +1644,12 @@ extern int rtkpos(rtk_t *rtk, const obs_t *robs, const obs_t *bobs, const nav_t
         udrtktime(rtk,tr,tb);
         return 1;
     }
+    /* base station model */
+    if (bmod&&(nu<=0||!zdmodmatch(bmod,obs[0].time,tb,nr,rtk->rb,&rtk->opt))) {
+        bmod=NULL;
+    }
     /* relative positioning */
-    stat=relpos(rtk,obs,nu,nr,nav);
+    stat=relpos(rtk,obs,nu,nr,nav,bmod);
 
     /* update RTK solution time */
     udrtktime(rtk,tr,tb);
@@ -9,6 +9,7 @@
 
 #define MONITOR_CMD_SOURCE     "MONITOR-SOURCE"
 #define MONITOR_CMD_BSTA_DISTR "MONITOR-BSTADISTR"
+#define MONITOR_CMD_AGENT      "MONITOR-AGENT"
 
 extern void monitor_src_updconn(uv_stream_t *str, char *buff);
 extern void monitor_src_init(uv_loop_t *loop, cors_monitor_t *monitor, cors_monitor_src_qs_t *qs);
@@ -19,6 +20,8 @@ extern void monitor_bsta_distr(uv_stream_t *str, char *buff);
 extern void monitor_bsta_distr_moni(uv_async_t *handle);
 extern void monitor_bsta_distr_init(uv_loop_t *loop, cors_monitor_bsta_distr_t *m_bsta_distr);
 
+extern void monitor_agent(uv_stream_t *str, char *buff);
+
 extern void monitor_init_bstas_info(cors_monitor_bstas_info_t *bstas);
 extern void monitor_free_bstas_info(cors_monitor_bstas_info_t *bstas);
 extern int monitor_read_bstas_info(const char *file, cors_monitor_bstas_info_t *bstas);
@@ -60,6 +63,9 @@ static void on_read_cb(uv_stream_t *str, ssize_t nr, const uv_buf_t *buf)
     else if ((p=strrstr(buf->base,MONITOR_CMD_BSTA_DISTR))) {
         monitor_bsta_distr(str,p);
     }
+    else if ((p=strrstr(buf->base,MONITOR_CMD_AGENT))) {
+        monitor_agent(str,p);
+    }
     free(buf->base);
 }
 
@@ -0,0 +1,47 @@
+/*------------------------------------------------------------------------------
+ * monitor_agent.c: monitor NTRIP agent functions for CORS
+ *
+ * author  : sujinglan
+ * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
+ * history : 2022/11/17 1.0  new
+ *-----------------------------------------------------------------------------*/
+#include "cors.h"
+
+extern int monitor_agent_str(const cors_ntrip_agent_t *agent, char *buff);
+
+static void on_rsp_cb(uv_write_t* req, int status)
+{
+    char *buff=req->data;
+    free(req);
+    free(buff);
+}
+
+/* agent counters per loop (write queue drops, gga reassignments) ------------*/
+extern void monitor_agent(uv_stream_t *str, char *buff)
+{
+    cors_monitord_t *md=str->data;
+    cors_ntrip_agent_t *agent=&md->monitor->cors->agent;
+    uv_write_t *wreq;
+    uv_buf_t buf;
+    char *data;
+    int ret,len;
+
+    if (!(data=malloc((agent->nloop+1)*1024))) return;
+
+    if ((len=monitor_agent_str(agent,data))<=0||
+        uv_is_closing((uv_handle_t*)md->conn)||
+        !uv_is_writable((uv_stream_t*)md->conn)) {
+        free(data);
+        return;
+    }
+    wreq=malloc(sizeof(uv_write_t));
+    buf=uv_buf_init(data,len);
+    wreq->data=data;
+
+    if ((ret=uv_write(wreq,(uv_stream_t *)md->conn,&buf,1,on_rsp_cb))!=0) {
+        log_trace(1,"failed to send monitor data: %s\n",
+                uv_strerror(ret));
+        free(wreq);
+        free(data);
+    }
+}
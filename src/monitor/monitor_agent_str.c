@@ -0,0 +1,38 @@
+/*------------------------------------------------------------------------------
+ * monitor_agent_str.c: monitor NTRIP agent functions for CORS
+ *
+ * author  : sujinglan
+ * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
+ * history : 2022/11/17 1.0  new
+ *-----------------------------------------------------------------------------*/
+#include "cors.h"
+
+extern int monitor_agent_str(const cors_ntrip_agent_t *agent, char *buff)
+{
+    const cors_ntrip_agent_loop_t *lp;
+    char tmp[1024];
+    int i;
+
+    buff[0]='\0';
+
+    if (!agent->state||agent->nloop<=0) return 0;
+
+    sprintf(tmp,"{[limit:%d],[policy:%d],[tick:%d],[hyst:%.1f],",agent->wq_limit,agent->wq_policy,
+            agent->gga_tick,agent->gga_hyst);
+    strcat(buff,tmp);
+
+    for (i=0;i<agent->nloop;i++) {
+        lp=agent->loops+i;
+        sprintf(tmp,"{[loop:%d],[conn:%llu],[write:%llu],[byte:%llu],[drop:%llu],[dropbyte:%llu],[evict:%llu],"
+                "[gga:%llu],[query:%llu],[switch:%llu]},",
+                lp->ID,(unsigned long long)lp->nconn,(unsigned long long)lp->nwrite,
+                (unsigned long long)lp->nbyte,(unsigned long long)lp->ndrop,
+                (unsigned long long)lp->nbdrop,(unsigned long long)lp->nevict,
+                (unsigned long long)lp->ngga,(unsigned long long)lp->nquery,
+                (unsigned long long)lp->nswitch);
+        strcat(buff,tmp);
+    }
+    buff[strlen(buff)-1]='}';
+    strcat(buff,"\n");
+    return strlen(buff);
+}
@@ -12,6 +12,7 @@
 #define NRTK_STRICT_TRIG_SYNC     1
 #define NRTK_WAIT_SYNC            1
 #define NTRK_MAX_BLS    64
+#define NRTK_VRS_TICK   100000000 /* on-demand vrs tick (ns) */
 
 extern int  vrs_add_vsta(cors_vrs_t *vrs, const char *name, const double *pos);
 extern int  vrs_del_vsta(cors_vrs_t *vrs, const char *name);
@@ -28,6 +29,12 @@ typedef struct nrtk_del_source {
     QUEUE q;
 } nrtk_del_source_t;
 
+typedef struct nrtk_upd_source {
+    int srcid;
+    double pos[3];
+    QUEUE q;
+} nrtk_upd_source_t;
+
 typedef struct nrtk_add_vsta {
     double pos[3];
     char name[32];
@@ -58,18 +65,6 @@ typedef struct nrtk_upd_bl {
     QUEUE q;
 } nrtk_upd_bl_t;
 
-static void set_thread_rt_priority()
-{
-#if WIN32
-    SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_TIME_CRITICAL);
-#else
-    struct sched_param param;
-    param.sched_priority=sched_get_priority_max(SCHED_FIFO);
-    sched_setscheduler(getpid(),SCHED_RR,&param);
-    pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
-#endif
-}
-
 static void nrtk_del_baseline(cors_nrtk_t *nrtk, int base_srcid, int rover_srcid)
 {
     cors_srtk_t *s,*t;
@@ -135,7 +130,7 @@ static int nrtk_init_dtrignet(cors_nrtk_t *nrtk)
     cors_dtrignet_init(&nrtk->dtrig_net);
 
     HASH_ITER(ii,info_tbl,info,t) {
-        cors_dtrignet_add_vertex(dtg,info->pos,info->ID,NULL,NULL);
+        cors_dtrignet_add_vertex(dtg,info->pos,info->ID,NULL,NULL,NULL,NULL);
     }
     cors_srtk_t *srtk;
     HASH_ITER(hh,dtg->edges,e,et) {
@@ -154,7 +149,7 @@ static void nrtk_add_source(cors_nrtk_t *nrtk, nrtk_add_source_t *data)
     cors_dtrig_edge_t *edge_add,*edge_del;
     cors_vrs_t *vrs=&nrtk->cors->vrs;
 
-    cors_dtrignet_add_vertex(dtg,data->pos,data->srcid,&edge_add,&edge_del);
+    cors_dtrignet_add_vertex(dtg,data->pos,data->srcid,&edge_add,&edge_del,NULL,NULL);
     nrtk_upd_bls(nrtk,&edge_add,&edge_del);
     vrs_upd_vsta(vrs);
     free(data);
@@ -166,12 +161,25 @@ static void nrtk_del_source(cors_nrtk_t *nrtk, nrtk_del_source_t *data)
     cors_dtrig_edge_t *edge_add,*edge_del;
     cors_vrs_t *vrs=&nrtk->cors->vrs;
 
-    cors_dtrignet_del_vertex(dtg,data->srcid,&edge_add,&edge_del);
+    cors_dtrignet_del_vertex(dtg,data->srcid,&edge_add,&edge_del,NULL,NULL);
     nrtk_upd_bls(nrtk,&edge_add,&edge_del);
     vrs_upd_vsta(vrs);
     free(data);
 }
 
+static void nrtk_upd_source(cors_nrtk_t *nrtk, nrtk_upd_source_t *data)
+{
+    cors_dtrig_net_t *dtg=&nrtk->dtrig_net;
+    cors_dtrig_edge_t *edge_add,*edge_del;
+    cors_vrs_t *vrs=&nrtk->cors->vrs;
+
+    if (cors_dtrignet_upd_vertex(dtg,data->pos,data->srcid,&edge_add,&edge_del,NULL,NULL)) {
+        nrtk_upd_bls(nrtk,&edge_add,&edge_del);
+        vrs_upd_vsta(vrs);
+    }
+    free(data);
+}
+
 static void nrtk_add_vsta(cors_nrtk_t *nrtk, nrtk_add_vsta_t *data)
 {
     cors_vrs_t *vrs=&nrtk->cors->vrs;
@@ -219,6 +227,7 @@ static void nrtk_init(cors_nrtk_t *nrtk)
 
     QUEUE_INIT(&nrtk->delsrc_queue);
     QUEUE_INIT(&nrtk->addsrc_queue);
+    QUEUE_INIT(&nrtk->updsrc_queue);
     QUEUE_INIT(&nrtk->addvsta_queue);
     QUEUE_INIT(&nrtk->delvsta_queue);
     QUEUE_INIT(&nrtk->addbl_queue);
@@ -227,6 +236,7 @@ static void nrtk_init(cors_nrtk_t *nrtk)
 
     uv_mutex_init(&nrtk->delsrc_lock);
     uv_mutex_init(&nrtk->addsrc_lock);
+    uv_mutex_init(&nrtk->updsrc_lock);
     uv_mutex_init(&nrtk->addvsta_lock);
     uv_mutex_init(&nrtk->delvsta_lock);
     uv_mutex_init(&nrtk->addbl_lock);
@@ -260,6 +270,19 @@ static void do_del_source_work(cors_nrtk_t *nrtk)
     }
 }
 
+static void do_upd_source_work(cors_nrtk_t *nrtk)
+{
+    while (!QUEUE_EMPTY(&nrtk->updsrc_queue)) {
+        uv_mutex_lock(&nrtk->updsrc_lock);
+
+        QUEUE *q=QUEUE_HEAD(&nrtk->updsrc_queue);
+        nrtk_upd_source_t *data=QUEUE_DATA(q,nrtk_upd_source_t,q);
+        QUEUE_REMOVE(q);
+        uv_mutex_unlock(&nrtk->updsrc_lock);
+        nrtk_upd_source(nrtk,data);
+    }
+}
+
 static void do_add_vsta_work(cors_nrtk_t *nrtk)
 {
     while (!QUEUE_EMPTY(&nrtk->addvsta_queue)) {
@@ -286,6 +309,18 @@ static void do_del_vsta_work(cors_nrtk_t *nrtk)
     }
 }
 
+/* on-demand vrs stations, skipped without subscribers, else once per tick --*/
+static void do_vrs_ondemand_work(cors_nrtk_t *nrtk)
+{
+    cors_vrs_t *vrs=&nrtk->cors->vrs;
+    uint64_t t;
+
+    if (!__atomic_load_n(&vrs->ndsta,__ATOMIC_RELAXED)) return;
+    if ((t=uv_hrtime())-nrtk->tvrs<NRTK_VRS_TICK) return;
+    nrtk->tvrs=t;
+    cors_vrs_ondemand(vrs);
+}
+
 static void do_add_bl_work(cors_nrtk_t *nrtk)
 {
     while (!QUEUE_EMPTY(&nrtk->addbl_queue)) {
@@ -325,7 +360,7 @@ static void do_upd_bl_work(cors_nrtk_t *nrtk)
     }
 }
 
-static int subnet_time_sync(cors_nrtk_t *nrtk, cors_master_sta_t *vt, rtk_t **rtk, obs_t **mobs)
+static int subnet_time_sync(cors_nrtk_t *nrtk, cors_master_sta_t *vt, const cors_blsnap_t **snap, obs_t **mobs)
 {
     gtime_t time_cur={0};
     cors_dtrig_edge_q_t *eq,*tt;
@@ -339,11 +374,10 @@ static int subnet_time_sync(cors_nrtk_t *nrtk, cors_master_sta_t *vt, rtk_t **rt
     }
     time_cur=d->obs.data[0].time;
     *mobs=&d->obs;
-    for (i=0;i<HASH_COUNT(vt->edge_list);i++) rtk[i]=NULL;
 
     HASH_ITER(hh,vt->edge_list,eq,tt) {
         if (!eq->edge->bl||!(blsol=eq->edge->bl->sol)) {j++; continue;}
-        rtk[j++]=&blsol->rtk;
+        snap[j++]=cors_blsol_snap(blsol);
     }
 #if NRTK_STRICT_TIME_SYNC
     static double age=1E-2;
@@ -351,7 +385,7 @@ static int subnet_time_sync(cors_nrtk_t *nrtk, cors_master_sta_t *vt, rtk_t **rt
     static double age=15.0;
 #endif
     for (i=0;i<HASH_COUNT(vt->edge_list);i++) {
-        if (rtk[i]&&fabs(timediff(time_cur,rtk[i]->time))<age) {
+        if (snap[i]&&fabs(timediff(time_cur,snap[i]->time))<age) {
             sync++;
         }
     }
@@ -369,16 +403,16 @@ static int subnet_time_sync(cors_nrtk_t *nrtk, cors_master_sta_t *vt, rtk_t **rt
     return 0;
 }
 
-static int upd_dtrig_time(cors_dtrig_t *dtrig, rtk_t **rtk)
+static int upd_dtrig_time(cors_dtrig_t *dtrig, const cors_blsnap_t **snap)
 {
     int i;
     for (i=0;i<3;i++) {
-        if (rtk[i]&&timediff(rtk[i]->time,dtrig->time)>1E-2) dtrig->time=rtk[i]->time;
+        if (snap[i]&&timediff(snap[i]->time,dtrig->time)>1E-2) dtrig->time=snap[i]->time;
     }
     return dtrig->time.time>0;
 }
 
-static int dtrig_time_sync(cors_nrtk_t *nrtk, cors_dtrig_t *dtrig, rtk_t **rtk)
+static int dtrig_time_sync(cors_nrtk_t *nrtk, cors_dtrig_t *dtrig, const cors_blsnap_t **snap)
 {
 #if NRTK_STRICT_TRIG_SYNC
     static double age=1E-2;
@@ -389,22 +423,21 @@ static int dtrig_time_sync(cors_nrtk_t *nrtk, cors_dtrig_t *dtrig, rtk_t **rtk)
     cors_blsol_t *blsol;
     int i,sync=0;
 
-    for (i=0;i<3;i++) rtk[i]=NULL;
     for (i=0;i<3;i++) {
         if (!dtrig->edge[i]||!dtrig->edge[i]->bl||!(blsol=dtrig->edge[i]->bl->sol)) continue;
-        rtk[i]=&blsol->rtk;
-        if (!time_cur.time||timediff(rtk[i]->time,time_cur)>1E-2) {
-            time_cur=rtk[i]->time;
+        if (!(snap[i]=cors_blsol_snap(blsol))) continue;
+        if (!time_cur.time||timediff(snap[i]->time,time_cur)>1E-2) {
+            time_cur=snap[i]->time;
         }
     }
     if (fabs(timediff(time_cur,dtrig->time))<1E-2) {
         return 0;
     }
     if (!dtrig->time.time) {
-        if (!upd_dtrig_time(dtrig,rtk)) return -1;
+        if (!upd_dtrig_time(dtrig,snap)) return -1;
     }
     for (i=0;i<3;i++) {
-        if (rtk[i]&&fabs(timediff(time_cur,rtk[i]->time))<age) {
+        if (snap[i]&&fabs(timediff(time_cur,snap[i]->time))<age) {
             sync++;
         }
     }
@@ -422,52 +455,53 @@ static int dtrig_time_sync(cors_nrtk_t *nrtk, cors_dtrig_t *dtrig, rtk_t **rtk)
     return 0;
 }
 
-static void upd_dtrig_stat(cors_dtrig_t *dtrig, rtk_t **rtk)
+static void upd_dtrig_stat(cors_dtrig_t *dtrig, const cors_blsnap_t **snap)
 {
-    upd_dtrig_time(dtrig,rtk);
+    upd_dtrig_time(dtrig,snap);
     dtrig->wt=0;
 }
 
-static void upd_vrs(cors_vrs_t *vrs, cors_master_sta_t *msta, const obs_t *mobs, const rtk_t **rtk, int n)
+static void upd_vrs(cors_vrs_t *vrs, cors_master_sta_t *msta, const obs_t *mobs, const cors_blsnap_t **snap, int n)
 {
     cors_vrs_sta_q_t *vs,*vq;
     HASH_ITER(hh,msta->vsta_list,vs,vq) {
-        cors_vrs_upd(vrs,vs->vsta,msta,mobs,rtk,n);
+        cors_vrs_upd(vrs,vs->vsta,msta,mobs,snap,n);
     }
 }
 
-static void upd_subnet_stat(cors_dtrig_vertex_t *vt, rtk_t **rtk, const obs_t *mobs)
+static void upd_subnet_stat(cors_dtrig_vertex_t *vt, const cors_blsnap_t **snap, const obs_t *mobs)
 {
     vt->time=mobs->data[0].time;
     vt->wt=0;
 }
 
-static void upd_amb_closure(cors_dtrig_t *dtrig, rtk_t **rtk, int sat, int f)
+static void upd_amb_closure(cors_dtrig_t *dtrig, const cors_blsnap_t **snap, int sat, int f)
 {
-    if (!rtk[0]||!rtk[0]->ssat[sat].fix[f]) return;
-    if (!rtk[1]||!rtk[1]->ssat[sat].fix[f]) return;
-    if (!rtk[2]||!rtk[2]->ssat[sat].fix[f]) return;
+    const cors_blsat_t *s[3];
+    int i;
 
-    if (rtk[0]->ssat[sat].refsat[f]!=rtk[1]->ssat[sat].refsat[f]) return;
-    if (rtk[0]->ssat[sat].refsat[f]!=rtk[2]->ssat[sat].refsat[f]) return;
-    if (rtk[0]->ssat[sat].refsat[f]==sat+1) return;
+    for (i=0;i<3;i++) {
+        if (!(s[i]=cors_blsnap_sat(snap[i],sat+1))||!s[i]->fix[f]) return;
+    }
+    if (s[0]->refsat[f]!=s[1]->refsat[f]) return;
+    if (s[0]->refsat[f]!=s[2]->refsat[f]) return;
+    if (s[0]->refsat[f]==sat+1) return;
 
     char tbuf[32];
     double dd[3],dire;
-    int i;
 
     for (i=0;i<3;i++) {
         if (strcmp(dtrig->edge[i]->id,dtrig->edge[i]->bl->id)) dire=-1.0;
         else dire=1.0;
-        dd[i]=dire*rtk[i]->ssat[sat].dd[f];
+        dd[i]=dire*s[i]->dd[f];
     }
     time2str(dtrig->time,tbuf,3);
     log_trace(3,"%12s: sat=%4d f=%d stat=[%d %d %d] time=%s amb=[%8.2lf %8.2lf %8.2lf] closure=%6.2lf\n",dtrig->id,
-            sat+1,f,rtk[0]->sol.stat,rtk[1]->sol.stat,rtk[2]->sol.stat,tbuf,
+            sat+1,f,snap[0]->sol.stat,snap[1]->sol.stat,snap[2]->sol.stat,tbuf,
             dd[0],dd[1],dd[2],dd[0]+dd[1]+dd[2]);
 }
 
-static void chk_dtrig_amb_closure(cors_dtrig_t *dtrig, rtk_t **rtk)
+static void chk_dtrig_amb_closure(cors_dtrig_t *dtrig, const cors_blsnap_t **snap)
 {
     char tbuf[32];
     int i,f;
@@ -476,11 +510,11 @@ static void chk_dtrig_amb_closure(cors_dtrig_t *dtrig, rtk_t **rtk)
     log_trace(1,"%12s trig time=%s\n",dtrig->id,tbuf);
 
     for (i=0;i<MAXSAT;i++) {
-        for (f=0;f<NFREQ;f++) upd_amb_closure(dtrig,rtk,i,f);
+        for (f=0;f<NFREQ;f++) upd_amb_closure(dtrig,snap,i,f);
     }
 }
 
-static void out_subnet_stat(cors_dtrig_vertex_t *vts, cors_dtrig_vertex_t *vt, rtk_t **rtk)
+static void out_subnet_stat(cors_dtrig_vertex_t *vts, cors_dtrig_vertex_t *vt, const cors_blsnap_t **snap)
 {
     cors_dtrig_edge_q_t *e,*q;
     cors_dtrig_vertex_t *eq;
@@ -490,20 +524,26 @@ static void out_subnet_stat(cors_dtrig_vertex_t *vts, cors_dtrig_vertex_t *vt, r
 
     HASH_ITER(hh,vt->edge_list,e,q) {
         HASH_FIND_INT(vts,&e->edge->bl->rover_srcid,eq);
-        if (!rtk[j]) {
+        if (!snap[j]) {
             j++; continue;
         }
         for (i=0;i<3;i++) {
-            dd[i]=rtk[j]->sol.rr[i]?rtk[j]->sol.rr[i]-eq->pos[i]:0.0;
-            dr[i]=rtk[j]->rb[i]?rtk[j]->rb[i]-rtk[j]->sol.rr[i]:0.0;
+            dd[i]=snap[j]->sol.rr[i]?snap[j]->sol.rr[i]-eq->pos[i]:0.0;
+            dr[i]=snap[j]->rb[i]?snap[j]->rb[i]-snap[j]->sol.rr[i]:0.0;
         }
-        time2str(rtk[j]->time,tbuf,3);
+        time2str(snap[j]->time,tbuf,3);
         log_trace(1,"    %4d->%4d(%8.3lf) stat=%d time=%s [%6.3lf %6.3lf %6.3lf]\n",e->edge->vt[0]->srcid,e->edge->vt[1]->srcid,
-                norm(dr,3)/1000.0,rtk[j]->sol.stat,tbuf,dd[0],dd[1],dd[2]);
+                norm(dr,3)/1000.0,snap[j]->sol.stat,tbuf,dd[0],dd[1],dd[2]);
         j++;
     }
 }
 
+static void unref_blsnaps(const cors_blsnap_t **snap, int n)
+{
+    int i;
+    for (i=0;i<n;i++) cors_blsnap_unref(snap[i]);
+}
+
 static void do_subnet_work(cors_nrtk_t *nrtk)
 {
     cors_dtrig_vertex_t *vt,*tt;
@@ -511,18 +551,26 @@ static void do_subnet_work(cors_nrtk_t *nrtk)
     cors_dtrig_vertex_t *vts=nrtk->dtrig_net.vertexs;
     cors_vrs_t *vrs=&nrtk->cors->vrs;
     obs_t *mobs;
-    rtk_t *rtk[64];
+    const cors_blsnap_t *snap[64];
+    int n;
 
     HASH_ITER(hh,vts,vt,tt) {
-        if (subnet_time_sync(nrtk,vt,rtk,&mobs)<=0) continue;
-        upd_subnet_stat(vt,rtk,mobs);
-        upd_vrs(vrs,vt,mobs,rtk,HASH_COUNT(vt->edge_list));
-        out_subnet_stat(vts,vt,rtk);
+        n=HASH_COUNT(vt->edge_list);
+        memset(snap,0,sizeof(snap[0])*n);
+        if (subnet_time_sync(nrtk,vt,snap,&mobs)>0) {
+            upd_subnet_stat(vt,snap,mobs);
+            upd_vrs(vrs,vt,mobs,snap,n);
+            out_subnet_stat(vts,vt,snap);
+        }
+        unref_blsnaps(snap,n);
     }
     HASH_ITER(hh,nrtk->dtrig_net.dtrigs,dg,dt) {
-        if (dtrig_time_sync(nrtk,dg,rtk)<=0) continue;
-        chk_dtrig_amb_closure(dg,rtk);
-        upd_dtrig_stat(dg,rtk);
+        memset(snap,0,sizeof(snap[0])*3);
+        if (dtrig_time_sync(nrtk,dg,snap)>0) {
+            chk_dtrig_amb_closure(dg,snap);
+            upd_dtrig_stat(dg,snap);
+        }
+        unref_blsnaps(snap,3);
     }
 }
 
@@ -536,17 +584,19 @@ static void free_nrtk(cors_nrtk_t *nrtk)
 static void nrtk_thread(void *nrtk_arg)
 {
     cors_nrtk_t *nrtk=(cors_nrtk_t*)nrtk_arg;
-    set_thread_rt_priority();
+    cors_set_thread_rt_priority();
 
     while (nrtk->state) {
         do_subnet_work    (nrtk);
         do_add_source_work(nrtk);
         do_del_source_work(nrtk);
+        do_upd_source_work(nrtk);
         do_add_bl_work    (nrtk);
         do_del_bl_work    (nrtk);
         do_upd_bl_work    (nrtk);
         do_add_vsta_work  (nrtk);
         do_del_vsta_work  (nrtk);
+        do_vrs_ondemand_work(nrtk);
     }
     free_nrtk(nrtk);
 }
@@ -594,6 +644,19 @@ extern void cors_nrtk_del_source(cors_nrtk_t *nrtk, int srcid)
     uv_mutex_unlock(&nrtk->delsrc_lock);
 }
 
+extern void cors_nrtk_upd_source(cors_nrtk_t *nrtk, int srcid, const double *pos)
+{
+    if (nrtk->state<=0) return;
+    if (norm(pos,3)<=0) return;
+
+    uv_mutex_lock(&nrtk->updsrc_lock);
+    nrtk_upd_source_t *data=calloc(1,sizeof(*data));
+    data->srcid=srcid;
+    matcpy(data->pos,pos,1,3);
+    QUEUE_INSERT_TAIL(&nrtk->updsrc_queue,&data->q);
+    uv_mutex_unlock(&nrtk->updsrc_lock);
+}
+
 extern void cors_nrtk_del_baseline(cors_nrtk_t *nrtk, int base_srcid, int rover_srcid)
 {
     if (base_srcid<=0||rover_srcid<=0) return;
@@ -0,0 +1,222 @@
+/*------------------------------------------------------------------------------
+ * rtkpool.c : shared rtkpos worker pool for CORS
+ *
+ * author  : sujinglan
+ * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
+ * history : 2022/11/17 1.0  new
+ *-----------------------------------------------------------------------------*/
+#include "cors.h"
+
+#define MAX_RTK_WORKERS   64
+
+/* release baseline after epoch ------------------------------------------------
+ * last access to baseline. on is dropped under bl->lock and a waiter in
+ * free_baseline() is woken while the lock is held, so the baseline is not
+ * freed before the lock is released.
+ *-----------------------------------------------------------------------------*/
+static void leave_baseline(cors_baseline_t *bl)
+{
+    uv_mutex_lock(&bl->lock);
+    if (!__atomic_sub_fetch(&bl->on,1,__ATOMIC_SEQ_CST)&&bl->nwait) {
+        uv_cond_broadcast(&bl->done);
+    }
+    uv_mutex_unlock(&bl->lock);
+}
+
+/* push scheduled baseline to worker deque -----------------------------------*/
+static void push_worker(cors_rtkpool_t *pool, cors_rtkpool_worker_t *w, cors_baseline_t *bl)
+{
+    /* counted before visible in deque, so each pop follows its increment */
+    uv_mutex_lock(&w->lock);
+    __atomic_add_fetch(&pool->npend,1,__ATOMIC_SEQ_CST);
+    QUEUE_INSERT_TAIL(&w->deque,&bl->q);
+    uv_mutex_unlock(&w->lock);
+
+    uv_mutex_lock(&pool->lock);
+    uv_cond_signal(&pool->cond);
+    uv_mutex_unlock(&pool->lock);
+}
+
+/* take baseline from own deque (head) or from other worker (tail) -----------*/
+static cors_baseline_t* pop_worker(cors_rtkpool_worker_t *w, int steal)
+{
+    cors_baseline_t *bl=NULL;
+    QUEUE *q;
+
+    uv_mutex_lock(&w->lock);
+    if (!QUEUE_EMPTY(&w->deque)) {
+        q=steal?QUEUE_PREV(&w->deque):QUEUE_HEAD(&w->deque);
+        QUEUE_REMOVE(q);
+        bl=QUEUE_DATA(q,cors_baseline_t,q);
+    }
+    uv_mutex_unlock(&w->lock);
+    return bl;
+}
+
+static cors_baseline_t* steal_worker(cors_rtkpool_t *pool, cors_rtkpool_worker_t *w)
+{
+    cors_baseline_t *bl;
+    int i;
+
+    for (i=1;i<pool->nworker;i++) {
+        if ((bl=pop_worker(pool->workers+(w->ID+i)%pool->nworker,1))) return bl;
+    }
+    return NULL;
+}
+
+/* run one epoch of baseline and reschedule if more epochs are pending -------*/
+static void run_baseline(cors_rtkpool_t *pool, cors_rtkpool_worker_t *w, cors_baseline_t *bl)
+{
+    cors_rtkpos_task_t *task;
+    QUEUE *q;
+    int more;
+
+    uv_mutex_lock(&bl->lock);
+    q=QUEUE_HEAD(&bl->tasks);
+    QUEUE_REMOVE(q);
+    uv_mutex_unlock(&bl->lock);
+
+    task=QUEUE_DATA(q,cors_rtkpos_task_t,q);
+    cors_srtk_rtkpos(task);
+    w->nrun++;
+
+    uv_mutex_lock(&bl->lock);
+    if (!(more=!QUEUE_EMPTY(&bl->tasks))) bl->scheduled=0;
+    uv_mutex_unlock(&bl->lock);
+
+    if (more) push_worker(pool,w,bl);
+
+    leave_baseline(bl);
+}
+
+static void rtkpool_worker_thread(void *arg)
+{
+    cors_rtkpool_worker_t *w=(cors_rtkpool_worker_t*)arg;
+    cors_rtkpool_t *pool=w->pool;
+    cors_baseline_t *bl;
+
+    cors_set_thread_rt_priority();
+
+    for (;;) {
+        if (!(bl=pop_worker(w,0))&&(bl=steal_worker(pool,w))) w->nsteal++;
+        if (bl) {
+            __atomic_sub_fetch(&pool->npend,1,__ATOMIC_SEQ_CST);
+            run_baseline(pool,w,bl);
+            continue;
+        }
+        uv_mutex_lock(&pool->lock);
+        while (pool->state&&__atomic_load_n(&pool->npend,__ATOMIC_SEQ_CST)<=0) {
+            uv_cond_wait(&pool->cond,&pool->lock);
+        }
+        if (!pool->state&&__atomic_load_n(&pool->npend,__ATOMIC_SEQ_CST)<=0) {
+            uv_mutex_unlock(&pool->lock);
+            break;
+        }
+        uv_mutex_unlock(&pool->lock);
+    }
+}
+
+/* start rtkpos worker pool ----------------------------------------------------
+ * args   : cors_rtkpool_t *pool  IO  worker pool
+ *          cors_t         *cors  I   cors
+ *          int            nworker I  number of workers (0:number of cpus)
+ * return : status (1:ok,0:error)
+ *-----------------------------------------------------------------------------*/
+extern int cors_rtkpool_start(cors_rtkpool_t *pool, cors_t *cors, int nworker)
+{
+    cors_rtkpool_worker_t *w;
+    uv_cpu_info_t *cpus;
+    int i,ncpu;
+
+    if (nworker<=0) {
+        nworker=1;
+        if (!uv_cpu_info(&cpus,&ncpu)) {
+            nworker=ncpu;
+            uv_free_cpu_info(cpus,ncpu);
+        }
+    }
+    if (nworker>MAX_RTK_WORKERS) nworker=MAX_RTK_WORKERS;
+
+    pool->cors=cors;
+    pool->npend=0;
+    if (!(pool->workers=calloc(nworker,sizeof(cors_rtkpool_worker_t)))) {
+        return 0;
+    }
+    uv_mutex_init(&pool->lock);
+    uv_cond_init(&pool->cond);
+    pool->nworker=nworker;
+    pool->state=1;
+
+    for (i=0;i<nworker;i++) {
+        w=pool->workers+i;
+        w->ID=i;
+        w->pool=pool;
+        QUEUE_INIT(&w->deque);
+        uv_mutex_init(&w->lock);
+    }
+    for (i=0;i<nworker;i++) {
+        if (uv_thread_create(&pool->workers[i].thread,rtkpool_worker_thread,pool->workers+i)) {
+            log_trace(1,"rtk worker thread create error: worker=%d\n",i);
+            break;
+        }
+    }
+    if (i<nworker) {
+        cors_rtkpool_close(pool);
+        return 0;
+    }
+    log_trace(1,"rtk worker pool create ok: workers=%d\n",nworker);
+    return 1;
+}
+
+/* close rtkpos worker pool (pending epochs are processed before exit) -------*/
+extern void cors_rtkpool_close(cors_rtkpool_t *pool)
+{
+    int i;
+
+    if (!pool->workers) return;
+
+    uv_mutex_lock(&pool->lock);
+    pool->state=0;
+    uv_cond_broadcast(&pool->cond);
+    uv_mutex_unlock(&pool->lock);
+
+    for (i=0;i<pool->nworker;i++) {
+        if (pool->workers[i].thread) uv_thread_join(&pool->workers[i].thread);
+        log_trace(3,"rtk worker %2d: run=%llu steal=%llu\n",i,
+                  (unsigned long long)pool->workers[i].nrun,
+                  (unsigned long long)pool->workers[i].nsteal);
+    }
+    for (i=0;i<pool->nworker;i++) uv_mutex_destroy(&pool->workers[i].lock);
+    free(pool->workers);
+    pool->workers=NULL;
+    pool->nworker=0;
+}
+
+/* push baseline epoch task to pool --------------------------------------------
+ * epochs of one baseline are queued on the baseline and the baseline itself is
+ * scheduled on a worker deque at most once, so no two epochs of the same
+ * baseline run concurrently. without workers (pool not started) the epoch is
+ * run inline by the caller.
+ *-----------------------------------------------------------------------------*/
+extern void cors_rtkpool_push(cors_rtkpool_t *pool, cors_rtkpos_task_t *task)
+{
+    cors_baseline_t *bl=task->bl;
+    int sched=0;
+
+    __atomic_add_fetch(&bl->on,1,__ATOMIC_SEQ_CST);
+
+    if (pool->nworker<=0) {
+        cors_srtk_rtkpos(task);
+        leave_baseline(bl);
+        return;
+    }
+
+    uv_mutex_lock(&bl->lock);
+    QUEUE_INSERT_TAIL(&bl->tasks,&task->q);
+    if (!bl->scheduled) bl->scheduled=sched=1;
+    uv_mutex_unlock(&bl->lock);
+
+    if (sched) {
+        push_worker(pool,pool->workers+(unsigned int)(bl->base_srcid*31+bl->rover_srcid)%pool->nworker,bl);
+    }
+}
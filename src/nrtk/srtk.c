@@ -25,33 +25,15 @@ typedef struct del_baseline {
     QUEUE q;
 } del_baseline_t;
 
-typedef struct rtkpos_task {
-    cors_baseline_t *bl;
-    cors_srtk_t *srtk;
-    obs_t *robs,*bobs;
-    QUEUE q;
-} rtkpos_task_t;
-
-static void set_thread_rt_priority()
-{
-#if WIN32
-    SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_TIME_CRITICAL);
-#else
-    struct sched_param param;
-    param.sched_priority=sched_get_priority_max(SCHED_FIFO);
-    sched_setscheduler(getpid(),SCHED_RR,&param);
-    pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
-#endif
-}
-
-static rtkpos_task_t* new_rtkpos_task(cors_srtk_t *srtk, cors_baseline_t *bl,obs_t *robs, obs_t *bobs)
+static cors_rtkpos_task_t* new_rtkpos_task(cors_srtk_t *srtk, cors_baseline_t *bl,obs_t *robs, obs_t *bobs,
+                                           cors_zdmod_t *bmod)
 {
-    rtkpos_task_t *task=calloc(1,sizeof(*task));
+    cors_rtkpos_task_t *task=calloc(1,sizeof(*task));
     task->srtk=srtk;
     task->bl=bl;
-    task->bl->on++;
     task->robs=robs;
     task->bobs=bobs;
+    task->bmod=bmod;
     return task;
 }
 
@@ -68,10 +50,12 @@ static void upd_obs(const cors_obsd_t *obs, obs_t **obs_o)
     (*obs_o)->n=obsd->n;
 }
 
-static void upd_rbobs(const cors_obsd_t *obsr, const cors_obsd_t *obsb, obs_t **robs, obs_t **bobs)
+static void upd_rbobs(const cors_obsd_t *obsr, cors_obsd_t *obsb, obs_t **robs, obs_t **bobs,
+                      cors_zdmod_t **bmod)
 {
     upd_obs(obsr,robs);
     upd_obs(obsb,bobs);
+    *bmod=cors_zdmod_ref(obsb);
 }
 
 static gtime_t upd_bl_time(const obs_t *robs, const obs_t *bobs)
@@ -85,13 +69,14 @@ static gtime_t upd_bl_time(const obs_t *robs, const obs_t *bobs)
     else return tb;
 }
 
-static int bl_time_sync(cors_baseline_t *bl, cors_obs_t *obs, obs_t **robs, obs_t **bobs)
+static int bl_time_sync_prc(cors_baseline_t *bl, cors_obs_t *obs, obs_t **robs, obs_t **bobs,
+                            cors_zdmod_t **bmod)
 {
     cors_obsd_t *obsd[2];
     HASH_FIND_INT(obs->data,&bl->rover_srcid,obsd[0]);
     HASH_FIND_INT(obs->data,&bl->base_srcid,obsd[1]);
 
-    if (!obsd[0]&&!obsd[1]) return 0;
+    if (!obsd[0]||!obsd[1]||!obsd[0]->obs.n||!obsd[1]->obs.n) return 0;
 
     gtime_t time_cur={0};
     int i,sync=0;
@@ -112,7 +97,7 @@ static int bl_time_sync(cors_baseline_t *bl, cors_obs_t *obs, obs_t **robs, obs_
     }
 #if SRTK_STRICT_BSTA_SYNC
     if (sync==2) {
-        upd_rbobs(obsd[0],obsd[1],robs,bobs);
+        upd_rbobs(obsd[0],obsd[1],robs,bobs,bmod);
         return 1;
     }
 #else
@@ -120,12 +105,12 @@ static int bl_time_sync(cors_baseline_t *bl, cors_obs_t *obs, obs_t **robs, obs_
     static double mt=200.0;
     static double st=0.1;
     if (sync&&++bl->wt>st*1E9/mt) {
-        upd_rbobs(obsd[0],obsd[1],robs,bobs);
+        upd_rbobs(obsd[0],obsd[1],robs,bobs,bmod);
         return 1;
     }
 #else
     if (sync) {
-        upd_rbobs(obsd[0],obsd[1],robs,bobs);
+        upd_rbobs(obsd[0],obsd[1],robs,bobs,bmod);
         return 1;
     }
 #endif
@@ -133,13 +118,22 @@ static int bl_time_sync(cors_baseline_t *bl, cors_obs_t *obs, obs_t **robs, obs_
     return 0;
 }
 
-static void add_rtkpos_work(cors_srtk_t *srtk, cors_baseline_t *bl, obs_t *robs, obs_t *bobs)
+static int bl_time_sync(cors_baseline_t *bl, cors_obs_t *obs, obs_t **robs, obs_t **bobs,
+                        cors_zdmod_t **bmod)
 {
-    uv_mutex_lock(&srtk->rtkpos_lock);
-    rtkpos_task_t *task=new_rtkpos_task(srtk,bl,robs,bobs);
+    int stat;
+
+    uv_mutex_lock(&obs->lock);
+    stat=bl_time_sync_prc(bl,obs,robs,bobs,bmod);
+    uv_mutex_unlock(&obs->lock);
+    return stat;
+}
 
-    QUEUE_INSERT_TAIL(&srtk->rtkpos_queue,&task->q);
-    uv_mutex_unlock(&srtk->rtkpos_lock);
+static void add_rtkpos_work(cors_srtk_t *srtk, cors_baseline_t *bl, obs_t *robs, obs_t *bobs,
+                            cors_zdmod_t *bmod)
+{
+    cors_rtkpos_task_t *task=new_rtkpos_task(srtk,bl,robs,bobs,bmod);
+    cors_rtkpool_push(&srtk->cors->rtkpool,task);
 }
 
 static void upd_stapos_prc(cors_baseline_t *bl, const sta_t *sta, int type)
@@ -161,7 +155,7 @@ static void upd_stapos_prc(cors_baseline_t *bl, const sta_t *sta, int type)
     }
 }
 
-static void upd_rtk_stapos(rtkpos_task_t *data)
+static void upd_rtk_stapos(cors_rtkpos_task_t *data)
 {
     cors_t *cors=data->srtk->cors;
     cors_stas_t *stas=&cors->stas;
@@ -173,55 +167,40 @@ static void upd_rtk_stapos(rtkpos_task_t *data)
     if (sta) upd_stapos_prc(data->bl,&sta->sta,1);
 }
 
-static void do_rtkpos_work(rtkpos_task_t *data)
+/* process baseline epoch task (called by rtk worker pool) -------------------*/
+extern void cors_srtk_rtkpos(cors_rtkpos_task_t *data)
 {
     cors_baseline_t *bl=data->bl;
     cors_t *cors=data->srtk->cors;
     rtk_t *rtk=&bl->rtk;
+    const zdmod_t *bmod=NULL;
 
     char tbuf_r[32]={0};
     double dr[3];
     int i;
 
     upd_rtk_stapos(data);
-    rtkpos(rtk,data->robs,data->bobs,&cors->nav.data);
-    bl->on--;
+
+    /* base station model shared by baselines of the base */
+    if (data->bmod&&data->robs&&data->robs->n>0) {
+        bmod=cors_zdmod_upd(data->bmod,data->robs->data[0].time,data->bobs,&cors->nav.data,
+                            rtk->rb,&rtk->opt);
+    }
+    rtkpos_zd(rtk,data->robs,data->bobs,bmod,&cors->nav.data);
 
     for (i=0;i<3;i++) dr[i]=bl->rtk.rb[i]-bl->rtk.sol.rr[i];
     time2str(bl->rtk.time,tbuf_r,2);
 
     log_trace(1,"%4d->%4d(%8.3lf) delay=%2d age=%5.1lf stat=%d nb=%2d %s\n",bl->base_srcid,bl->rover_srcid,norm(dr,3)/1000.0,
-            bl->on,bl->rtk.sol.age,bl->rtk.sol.stat,rtk->nb,tbuf_r);
+            bl->on-1,bl->rtk.sol.age,bl->rtk.sol.stat,rtk->nb,tbuf_r);
 
     cors_updssat(&cors->ssats,rtk->ssat,bl->rover_srcid,2,rtk->sol.time);
     cors_updblsol(&cors->blsols,bl,rtk,bl->base_srcid,bl->rover_srcid);
 
     freeobs(data->robs);
-    freeobs(data->bobs); free(data);
-}
-
-static void rtk_process(cors_srtk_t *srtk)
-{
-    while (!QUEUE_EMPTY(&srtk->rtkpos_queue)) {
-        uv_mutex_lock(&srtk->rtkpos_lock);
-
-        QUEUE *q=QUEUE_HEAD(&srtk->rtkpos_queue);
-        rtkpos_task_t *data=QUEUE_DATA(q,rtkpos_task_t,q);
-        QUEUE_REMOVE(q);
-        uv_mutex_unlock(&srtk->rtkpos_lock);
-        do_rtkpos_work(data);
-    }
-}
-
-static void rtk_work_thread(void *srtk_arg)
-{
-    cors_srtk_t *srtk=(cors_srtk_t*)srtk_arg;
-    set_thread_rt_priority();
-
-    while (srtk->state) {
-        if (srtk->state<=1) continue;
-        rtk_process(srtk);
-    }
+    freeobs(data->bobs);
+    if (data->bmod) cors_zdmod_unref(data->bmod);
+    free(data);
 }
 
 static void do_add_baseline(add_baseline_t *data);
@@ -238,17 +217,38 @@ static void add_baseline_work(cors_srtk_t *srtk)
     }
 }
 
+/* wait for running epochs of baseline (see rtkpool.c) and free it ---------*/
+static void free_baseline(cors_baseline_t *bl)
+{
+    uv_mutex_lock(&bl->lock);
+    bl->nwait++;
+    while (__atomic_load_n(&bl->on,__ATOMIC_SEQ_CST)) uv_cond_wait(&bl->done,&bl->lock);
+    bl->nwait--;
+    uv_mutex_unlock(&bl->lock);
+
+    uv_cond_destroy(&bl->done);
+    uv_mutex_destroy(&bl->lock);
+    rtkfree(&bl->rtk);
+    free(bl);
+}
+
 static void do_del_baseline(del_baseline_t *del)
 {
-    cors_baseline_t *bl=del->bl;
-    while (bl->on) uv_sleep(5);
+    free_baseline(del->bl);
+    free(del);
+}
 
-    rtkfree(&bl->rtk);
-    free(bl); free(del);
+static void unsub_baseline(cors_srtk_t *srtk, cors_baseline_t *bl)
+{
+    cors_obs_t *obs=&srtk->cors->obs;
+
+    cors_unsubobs(obs,bl->base_srcid,bl);
+    cors_unsubobs(obs,bl->rover_srcid,bl);
 }
 
 static void del_baseline_prc(cors_srtk_t *srtk, del_baseline_t *del)
 {
+    unsub_baseline(srtk,del->bl);
     HASH_DEL(srtk->bls.data,del->bl);
     do_del_baseline(del);
 }
@@ -258,7 +258,7 @@ static void del_baseline_work(cors_srtk_t *srtk)
     while (!QUEUE_EMPTY(&srtk->delbl_queue)) {
 
         uv_mutex_lock(&srtk->delbl_lock);
-        QUEUE *q=QUEUE_HEAD(&srtk->delbl_queue[0]);
+        QUEUE *q=QUEUE_HEAD(&srtk->delbl_queue);
         del_baseline_t *del=QUEUE_DATA(q,del_baseline_t,q);
         QUEUE_REMOVE(q);
         uv_mutex_unlock(&srtk->delbl_lock);
@@ -276,12 +276,14 @@ static void baseline_rtk_work(cors_srtk_t *srtk)
 {
     cors_baseline_t *bl,*bltmp;
     obs_t *robs,*bobs;
+    cors_zdmod_t *bmod;
     cors_t *cors=srtk->cors;
 
     HASH_ITER(hh,srtk->bls.data,bl,bltmp) {
-        if (!bl_time_sync(bl,&cors->obs,&robs,&bobs)) continue;
+        if (!__atomic_exchange_n(&bl->upd,0,__ATOMIC_ACQ_REL)) continue;
+        if (!bl_time_sync(bl,&cors->obs,&robs,&bobs,&bmod)) continue;
         upd_bl_stat(bl,robs,bobs);
-        add_rtkpos_work(srtk,bl,robs,bobs);
+        add_rtkpos_work(srtk,bl,robs,bobs,bmod);
     }
 }
 
@@ -290,10 +292,16 @@ static void rtk_thread(void *srtk_arg)
     cors_srtk_t *srtk=(cors_srtk_t*)srtk_arg;
     srtk->state++;
 
-    set_thread_rt_priority();
+    cors_set_thread_rt_priority();
 
     while (srtk->state) {
-        if (srtk->state<=1) continue;
+        uv_mutex_lock(&srtk->event_lock);
+        while (srtk->state&&!srtk->nevent) {
+            uv_cond_wait(&srtk->event_cond,&srtk->event_lock);
+        }
+        srtk->nevent=0;
+        uv_mutex_unlock(&srtk->event_lock);
+
         baseline_rtk_work(srtk);
         add_baseline_work(srtk);
         del_baseline_work(srtk);
@@ -306,6 +314,9 @@ static cors_baseline_t *new_baseline(cors_srtk_t *srtk, const char *id, int base
     strcpy(bl->id,id);
     bl->rover_srcid=rover_srcid;
     bl->base_srcid=base_srcid;
+    uv_mutex_init(&bl->lock);
+    uv_cond_init(&bl->done);
+    QUEUE_INIT(&bl->tasks);
     if (bl->rover_srcid<0) srtk->opt.mode=PMODE_KINEMA;
     rtkinit(&bl->rtk,&srtk->opt);
     return bl;
@@ -341,6 +352,8 @@ static void do_add_baseline(add_baseline_t *data)
     if (!bl) {
         bl=new_baseline(srtk,id,data->base_srcid,data->rover_srcid);
         HASH_ADD_STR(srtk->bls.data,id,bl);
+        cors_subobs(&cors->obs,bl->base_srcid,bl,srtk);
+        cors_subobs(&cors->obs,bl->rover_srcid,bl,srtk);
     }
     upd_nrtk_baseline(srtk,bl,data->base_srcid,
             data->rover_srcid);
@@ -390,12 +403,12 @@ static void srtk_init(cors_srtk_t *srtk, cors_nrtk_t *nrtk, cors_t *cors)
 {
     uv_mutex_init(&srtk->addbl_lock);
     uv_mutex_init(&srtk->delbl_lock);
-    uv_mutex_init(&srtk->rtkpos_lock);
+    uv_mutex_init(&srtk->event_lock);
+    uv_cond_init(&srtk->event_cond);
 
     srtk->cors=cors;
     srtk->nrtk=nrtk;
 
-    QUEUE_INIT(&srtk->rtkpos_queue);
     QUEUE_INIT(&srtk->addbl_queue);
     QUEUE_INIT(&srtk->delbl_queue);
     QUEUE_INIT(&srtk->delbl_queue);
@@ -419,10 +432,7 @@ extern int cors_srtk_start(cors_srtk_t *srtk, cors_t *cors, cors_nrtk_t *nrtk, c
     read_opts(srtk);
     read_bls_file(srtk,bls_file);
 
-    if (uv_thread_create(&srtk->thread[0],rtk_thread,srtk)) {
-        return 0;
-    }
-    if (uv_thread_create(&srtk->thread[1],rtk_work_thread,srtk)) {
+    if (uv_thread_create(&srtk->thread,rtk_thread,srtk)) {
         return 0;
     }
     log_trace(1,"srtk thread create ok\n");
@@ -431,16 +441,35 @@ extern int cors_srtk_start(cors_srtk_t *srtk, cors_t *cors, cors_nrtk_t *nrtk, c
 
 extern int cors_srtk_close(cors_srtk_t *srtk)
 {
+    uv_mutex_lock(&srtk->event_lock);
     srtk->state=0;
+    uv_cond_broadcast(&srtk->event_cond);
+    uv_mutex_unlock(&srtk->event_lock);
 
-    uv_thread_join(&srtk->thread[1]);
-    uv_thread_join(&srtk->thread[0]);
+    uv_thread_join(&srtk->thread);
 
     cors_baseline_t *bl,*bltmp;
     HASH_ITER(hh,srtk->bls.data,bl,bltmp) {
+        unsub_baseline(srtk,bl);
         HASH_DEL(srtk->bls.data,bl);
-        rtkfree(&bl->rtk); free(bl);
+        free_baseline(bl);
     }
+    return 1;
+}
+
+static void srtk_wakeup(cors_srtk_t *srtk)
+{
+    uv_mutex_lock(&srtk->event_lock);
+    srtk->nevent++;
+    uv_cond_signal(&srtk->event_cond);
+    uv_mutex_unlock(&srtk->event_lock);
+}
+
+/* notify baseline of new observation epoch (called by cors_updobs) ----------*/
+extern void cors_srtk_notify(cors_srtk_t *srtk, cors_baseline_t *bl)
+{
+    __atomic_store_n(&bl->upd,1,__ATOMIC_RELEASE);
+    srtk_wakeup(srtk);
 }
 
 extern int cors_srtk_add_baseline(cors_srtk_t *srtk, int base_srcid, int rover_srcid)
@@ -451,6 +480,7 @@ extern int cors_srtk_add_baseline(cors_srtk_t *srtk, int base_srcid, int rover_s
     add_baseline_t *data=new_add_baseline(srtk,base_srcid,rover_srcid);
     QUEUE_INSERT_TAIL(&srtk->addbl_queue,&data->q);
     uv_mutex_unlock(&srtk->addbl_lock);
+    srtk_wakeup(srtk);
     return 1;
 }
 
@@ -479,6 +509,7 @@ extern int cors_srtk_del_baseline(cors_srtk_t *srtk, int base_srcid, int rover_s
     uv_mutex_lock(&srtk->delbl_lock);
     QUEUE_INSERT_TAIL(&srtk->delbl_queue,&data->q);
     uv_mutex_unlock(&srtk->delbl_lock);
+    srtk_wakeup(srtk);
     return 1;
 }
 
@@ -9,18 +9,6 @@
 
 #define MAX_SRCS  1024
 
-static void set_thread_rt_priority()
-{
-#if WIN32
-    SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_TIME_CRITICAL);
-#else
-    struct sched_param param;
-    param.sched_priority=sched_get_priority_max(SCHED_FIFO);
-    sched_setscheduler(getpid(),SCHED_RR,&param);
-    pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
-#endif
-}
-
 static int generate_source_id()
 {
     static int mID=0;
@@ -68,7 +56,6 @@ static int read_sources_file(cors_ntrip_t *ntrip, const char *file)
 
         HASH_ADD(hh,ntrip->info_tbl[0],name,strlen(info_name->name),info_name);
         HASH_ADD(ii,ntrip->info_tbl[1],ID,sizeof(int),info_id);
-        kd_insert(ntrip->src_kdtree,info_name->pos,info_name);
     }
     fclose(fp);
     return HASH_COUNT(ntrip->info_tbl[0]);
@@ -112,7 +99,10 @@ static void free_ntrip(cors_ntrip_t *ntrip)
         free(i);
     }
     HASH_ITER(ii,ntrip->info_tbl[1],i,itmp) HASH_DELETE(ii,ntrip->info_tbl[1],i);
-    kd_free(ntrip->src_kdtree);
+    if (ntrip->stas) cors_ntrip_stas_unref(ntrip->stas);
+    ntrip->stas=NULL;
+    uv_mutex_destroy(&ntrip->stas_lock);
+    uv_mutex_destroy(&ntrip->info_lock);
 }
 
 static void on_timer_stat_cb(uv_timer_t* handle)
@@ -142,7 +132,7 @@ static void ntrip_thread(void *ntrip_arg)
     uv_async_init(loop,ntrip->close,close_cb);
 
     start_ntrip(ntrip);
-    set_thread_rt_priority();
+    cors_set_thread_rt_priority();
 
     uv_run(loop,UV_RUN_DEFAULT);
     close_uv_loop(loop);
@@ -151,9 +141,11 @@ static void ntrip_thread(void *ntrip_arg)
 
 extern int cors_ntrip_start(cors_ntrip_t *ntrip, cors_t *cors, const char *sources_file)
 {
-    ntrip->src_kdtree=kd_create(3);
+    uv_mutex_init(&ntrip->info_lock);
+    uv_mutex_init(&ntrip->stas_lock);
     ntrip->cors=cors;
     read_sources_file(ntrip,sources_file);
+    cors_ntrip_stas_publish(ntrip);
 
     if (uv_thread_create(&ntrip->thread,ntrip_thread,ntrip)) {
         log_trace(1,"ntrip thread create error\n");
@@ -217,8 +209,24 @@ extern void cors_ntrip_del_source(cors_ntrip_t *ntrip, const char *name)
 
 extern void cors_ntrip_source_updpos(cors_ntrip_t *ntrip, const double *pos, int srcid)
 {
-    cors_ntrip_source_info_t *s;
+    cors_ntrip_source_info_t *s,*t;
+    double dr[3];
+    int i;
+
+    uv_mutex_lock(&ntrip->info_lock);
     HASH_FIND(ii,ntrip->info_tbl[1],&srcid,sizeof(int),s);
-    if (!s) return;
+    if (!s) {
+        uv_mutex_unlock(&ntrip->info_lock);
+        return;
+    }
+    for (i=0;i<3;i++) dr[i]=pos[i]-s->pos[i];
     matcpy(s->pos,pos,1,3);
+
+    /* sources read from file have separate entries by name */
+    HASH_FIND_STR(ntrip->info_tbl[0],s->name,t);
+    if (t&&t!=s) matcpy(t->pos,pos,1,3);
+    uv_mutex_unlock(&ntrip->info_lock);
+
+    /* station index for rovers only on real moves, not repeated 1005 */
+    if (norm(dr,3)>1.0) cors_ntrip_stas_publish(ntrip);
 }
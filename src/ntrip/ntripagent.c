@@ -5,29 +5,40 @@
  * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
  * history : 2022/11/17 1.0  new
  *-----------------------------------------------------------------------------*/
+#include <signal.h>
 #include "cors.h"
 
 #define NTRIP_AGENT_MNTPNT  "RTCM32"
 #define NTRIP_RSP_UNAUTH    "HTTP/1.0 401 Unauthorized\r\n"
 #define NTRIP_RSP_OK_CLI    "ICY 200 OK\r\n"
 #define NTRIP_AGENT_PORT     8002
+#define MAX_AGENT_LOOPS      64
+
+#if !WIN32&&defined(SO_REUSEPORT)
+#define AGENT_REUSEPORT     /* accept sharded over loops by kernel */
+#endif
 
 typedef struct agent_del_ntripconn {
-    cors_ntrip_agent_t *agent;
+    cors_ntrip_agent_loop_t *lp;
     cors_ntrip_conn_t *conn;
     QUEUE q;
 } agent_del_ntripconn_t;
 
+typedef struct agent_write {
+    uv_write_t req;
+    int n;
+    cors_ntrip_sbuf_t *sbuf[];
+} agent_write_t;
+
 typedef struct agent_send_data {
-    int nb;
     char mntpnt[32];
-    char *buff;
-    const nav_t *nav;
-    cors_ntrip_agent_t *agent;
+    cors_ntrip_sbuf_t *sbuf;
+    cors_ntrip_sbuf_t *nav;
+    cors_ntrip_agent_loop_t *lp;
     QUEUE q;
 } agent_send_data_t;
 
-extern void ntripagnet_del_conn(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn);
+extern void ntripagnet_del_conn(cors_ntrip_agent_loop_t *lp, cors_ntrip_conn_t *conn);
 
 static void close_cb(uv_async_t* handle)
 {
@@ -39,7 +50,7 @@ static void close_cb(uv_async_t* handle)
 static void alloc_buffer(uv_handle_t *handle, size_t suggested_size, uv_buf_t *buf)
 {
     buf->base=malloc(suggested_size);
-    buf->len=suggested_size;
+    buf->len=suggested_size-1; /* keep room for terminator */
 }
 
 static int test_mntpnt(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn, const char *mntpnt)
@@ -53,40 +64,187 @@ static int test_mntpnt(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn, const
     return 2;
 }
 
+/* new shared send buffer (reference count 1) --------------------------------*/
+extern cors_ntrip_sbuf_t* cors_ntrip_sbuf_new(const char *buff, int nb)
+{
+    cors_ntrip_sbuf_t *sbuf;
+
+    if (!(sbuf=malloc(sizeof(cors_ntrip_sbuf_t)+nb))) return NULL;
+    sbuf->ref=1;
+    sbuf->nb=nb;
+    sbuf->type=AGENT_SBUF_OBS;
+    memcpy(sbuf->buff,buff,nb);
+    return sbuf;
+}
+
+extern void cors_ntrip_sbuf_ref(cors_ntrip_sbuf_t *sbuf)
+{
+    __atomic_add_fetch(&sbuf->ref,1,__ATOMIC_SEQ_CST);
+}
+
+extern void cors_ntrip_sbuf_unref(cors_ntrip_sbuf_t *sbuf)
+{
+    if (__atomic_sub_fetch(&sbuf->ref,1,__ATOMIC_SEQ_CST)==0) free(sbuf);
+}
+
+static void agent_flush(cors_ntrip_conn_t *conn);
+
 static void on_rsp_cb(uv_write_t* req, int status)
 {
-    char *p=req->data;
-    free(req); free(p);
+    agent_write_t *w=(agent_write_t*)req;
+    cors_ntrip_conn_t *conn=req->handle->data;
+    int i;
+
+    for (i=0;i<w->n;i++) cors_ntrip_sbuf_unref(w->sbuf[i]);
+    free(w);
+
+    /* stream drained, write pending messages at once */
+    if (status<0||!conn||!conn->wq_n) return;
+    if (uv_stream_get_write_queue_size(req->handle)<=AGENT_WQ_STALL) agent_flush(conn);
 }
 
-static void agent_send_data(cors_ntrip_conn_t *conn, const char *buff, int nb)
+/* write shared buffers to connection (no copy, buffers held until written) -*/
+static void agent_write(cors_ntrip_conn_t *conn, cors_ntrip_sbuf_t **sbuf, int n)
 {
-    uv_buf_t buf;
-    uv_write_t *wreq=malloc(sizeof(uv_write_t));
-    int ret;
+    agent_write_t *w;
+    uv_buf_t buf[AGENT_WQ_LEN];
+    int i,ret;
 
-    buf.base=calloc(nb,sizeof(char));
-    buf.len=nb;
+    if (!(w=malloc(sizeof(agent_write_t)+n*sizeof(cors_ntrip_sbuf_t*)))) {
+        for (i=0;i<n;i++) cors_ntrip_sbuf_unref(sbuf[i]);
+        return;
+    }
+    w->n=n;
+    for (i=0;i<n;i++) {
+        w->sbuf[i]=sbuf[i];
+        buf[i]=uv_buf_init(sbuf[i]->buff,sbuf[i]->nb);
+    }
+    if ((ret=uv_write(&w->req,(uv_stream_t *)conn->conn,buf,n,on_rsp_cb))!=0) {
+        log_trace(1,"agent failed to send data: %s\n",
+                  uv_strerror(ret));
+        for (i=0;i<n;i++) cors_ntrip_sbuf_unref(sbuf[i]);
+        free(w);
+        return;
+    }
+    for (i=0;i<n;i++) conn->lp->nbyte+=sbuf[i]->nb;
+    conn->lp->nwrite++;
+}
 
-    memcpy(buf.base,buff,nb);
-    wreq->data=buf.base;
+static void agent_flush(cors_ntrip_conn_t *conn)
+{
+    cors_ntrip_sbuf_t *sbuf[AGENT_WQ_LEN];
+    int i,n=conn->wq_n;
 
     if (!uv_is_writable((uv_stream_t*)conn->conn)||
         uv_is_closing((uv_handle_t*)conn->conn)) {
-        free(wreq);
-        free(buf.base);
         return;
     }
-    if ((ret=uv_write(wreq,(uv_stream_t *)conn->conn,&buf,1,on_rsp_cb))!=0) {
-        log_trace(1,"agent failed to send data: %s\n",
-                  uv_strerror(ret));
-        free(wreq);
-        free(buf.base);
+    for (i=0;i<n;i++) sbuf[i]=conn->wq[(conn->wq_head+i)%AGENT_WQ_LEN];
+    conn->wq_head=conn->wq_n=conn->wq_nb=0;
+    agent_write(conn,sbuf,n);
+}
+
+/* free pending messages of connection, return pending bytes -----------------*/
+static int agent_wq_free(cors_ntrip_conn_t *conn)
+{
+    int nb=conn->wq_nb;
+
+    while (conn->wq_n>0) {
+        cors_ntrip_sbuf_unref(conn->wq[conn->wq_head]);
+        conn->wq_head=(conn->wq_head+1)%AGENT_WQ_LEN;
+        conn->wq_n--;
+    }
+    conn->wq_head=conn->wq_nb=0;
+    return nb;
+}
+
+/* count dropped message, station position or ephemeris is sent again -------*/
+static void agent_wq_lost(cors_ntrip_conn_t *conn, const cors_ntrip_sbuf_t *sbuf)
+{
+    conn->lp->ndrop++;
+    conn->lp->nbdrop+=sbuf->nb;
+
+    if (sbuf->type==AGENT_SBUF_STA) conn->sta_chg=1;
+    else if (sbuf->type==AGENT_SBUF_NAV) memset(&conn->time,0,sizeof(gtime_t));
+}
+
+static void agent_wq_drop(cors_ntrip_conn_t *conn)
+{
+    cors_ntrip_sbuf_t *sbuf=conn->wq[conn->wq_head];
+
+    conn->wq_head=(conn->wq_head+1)%AGENT_WQ_LEN;
+    conn->wq_n--;
+    conn->wq_nb-=sbuf->nb;
+    agent_wq_lost(conn,sbuf);
+    cors_ntrip_sbuf_unref(sbuf);
+}
+
+/* queue message while stream is backed up, apply slow consumer policy -------*/
+static void agent_wq_push(cors_ntrip_conn_t *conn, cors_ntrip_sbuf_t *sbuf)
+{
+    cors_ntrip_agent_loop_t *lp=conn->lp;
+    int limit=lp->agent->wq_limit,full;
+
+    full=conn->wq_n>=AGENT_WQ_LEN||conn->wq_nb+sbuf->nb>limit;
+
+    if (lp->agent->wq_policy==AGENT_WQ_DISC&&full) {
+        lp->ndrop+=conn->wq_n+1;
+        lp->nbdrop+=agent_wq_free(conn)+sbuf->nb;
+        lp->nevict++;
+        log_trace(2,"agent slow consumer disconnected: mntpnt=%s\n",conn->mntpnt);
+        ntripagnet_del_conn(lp,conn);
+        return;
+    }
+    /* coalesce: a newer message replaces all pending ones */
+    if (lp->agent->wq_policy==AGENT_WQ_COAL) {
+        while (conn->wq_n>0) agent_wq_drop(conn);
+    }
+    while (conn->wq_n>0&&(conn->wq_n>=AGENT_WQ_LEN||conn->wq_nb+sbuf->nb>limit)) {
+        agent_wq_drop(conn);
+    }
+    if (sbuf->nb>limit) {
+        agent_wq_lost(conn,sbuf);
+        return;
+    }
+    cors_ntrip_sbuf_ref(sbuf);
+    conn->wq[(conn->wq_head+conn->wq_n)%AGENT_WQ_LEN]=sbuf;
+    conn->wq_n++;
+    conn->wq_nb+=sbuf->nb;
+}
+
+/* send shared buffer to connection -------------------------------------------
+ * subscriber entries are copies, write state is kept on the connection of the
+ * stream. a message is written at once until the stream write queue exceeds
+ * the stall threshold, then it is queued by the slow consumer policy
+ * (wq_limit<=0: always written). dropped station position or ephemeris
+ * messages are sent again with a later epoch.
+ *-----------------------------------------------------------------------------*/
+static void agent_send_sbuf(cors_ntrip_conn_t *conn, cors_ntrip_sbuf_t *sbuf)
+{
+    uv_stream_t *str=(uv_stream_t*)conn->conn;
+
+    if (!uv_is_writable(str)||uv_is_closing((uv_handle_t*)str)||
+        !(conn=str->data)||conn->del) {
+        return;
+    }
+    if (conn->lp->agent->wq_limit>0&&(conn->wq_n||uv_stream_get_write_queue_size(str)>AGENT_WQ_STALL)) {
+        agent_wq_push(conn,sbuf);
         return;
     }
+    cors_ntrip_sbuf_ref(sbuf);
+    agent_write(conn,&sbuf,1);
 }
 
-static void send_rsqc(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *cn, const char *rsp)
+static void agent_send_data(cors_ntrip_conn_t *conn, const char *buff, int nb)
+{
+    cors_ntrip_sbuf_t *sbuf;
+
+    if (!(sbuf=cors_ntrip_sbuf_new(buff,nb))) return;
+    agent_send_sbuf(conn,sbuf);
+    cors_ntrip_sbuf_unref(sbuf);
+}
+
+static void send_rsqc(cors_ntrip_agent_loop_t *lp, cors_ntrip_conn_t *cn, const char *rsp)
 {
     if (strlen(rsp)<=0) return;
     agent_send_data(cn,rsp,strlen(rsp));
@@ -100,24 +258,7 @@ static int test_auth(cors_ntrip_agent_t *agent, const char *user, const char *us
     return 1;
 }
 
-static int test_vstachg(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn, char *new_mntpnt)
-{
-    struct kdres *res;
-    struct kdtree *vts_kdtree=agent->ntrip->src_kdtree;
-    cors_ntrip_source_info_t *info;
-
-    if (conn->type!=2||norm(conn->pos,3)<=0.0) return 0;
-    if (!vts_kdtree) return 0;
-    if (!(res=kd_nearest(vts_kdtree,conn->pos))) return 0;
-    info=kd_res_item_data(res);
-
-    if (strcmp(new_mntpnt,info->name)) {
-        strcpy(new_mntpnt,info->name);
-        return 1;
-    }
-    return 0;
-}
-
+/* decode rover position of GGA message (return 2: new position) ------------*/
 static int test_gga_msg(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn, const char *buff)
 {
     char ggastr[256];
@@ -132,83 +273,165 @@ static int test_gga_msg(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn, cons
     sol.time=timeget();
     if (!decode_nmea(p,&sol)) return 1;
     matcpy(conn->pos,sol.rr,1,3);
-    return 1;
-}
-
-static cors_ntrip_conn_q_t *new_conn_q(cors_ntrip_agent_t *agent, const char *mntpnt)
-{
-    cors_ntrip_conn_q_t *q=calloc(1,sizeof(cors_ntrip_conn_q_t));
-    strcpy(q->mntpnt,mntpnt);
-    HASH_ADD_STR(agent->cq_tbl,mntpnt,q);
-    return q;
+    return 2;
 }
 
-static void agent_upd_conn(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn, uv_stream_t *str,
+static void agent_upd_conn(cors_ntrip_agent_loop_t *lp, cors_ntrip_conn_t *conn, uv_stream_t *str,
                            const char *new_mntpnt)
 {
-    cors_ntrip_conn_q_t *q,*q_c;
-    cors_ntrip_conn_t *c;
+    cors_ntrip_conn_q_t *q_c;
+    cors_ntrip_conn_t *c=NULL;
 
     if (!strcmp(new_mntpnt,"")) return;
 
-    uv_mutex_lock(&agent->cq_lock);
-    HASH_FIND_STR(agent->cq_tbl,new_mntpnt,q_c);
-    if (!q_c) q_c=new_conn_q(agent,new_mntpnt);
-
-    HASH_FIND_PTR(q_c->cs,&str,c);
-    if (c) {
-        uv_mutex_unlock(&agent->cq_lock);
-        return;
+    if ((q_c=cors_ntrip_subs_get(&lp->subs,new_mntpnt))) {
+        HASH_FIND_PTR(q_c->cs,&str,c);
+        if (c) return;
     }
     if (strcmp(new_mntpnt,conn->mntpnt)) {
-        HASH_FIND_STR(agent->cq_tbl,conn->mntpnt,q);
-        HASH_FIND_PTR(q->cs,&str,c);
-        HASH_DEL(q->cs,c);
+        c=cors_ntrip_subs_del(&lp->subs,conn->mntpnt,(uv_tcp_t*)str);
     }
-    else {
+    if (!c) {
         c=calloc(1,sizeof(*c));
         *c=*conn;
         c->conn=(uv_tcp_t*)str;
     }
     strcpy(conn->mntpnt,new_mntpnt);
     strcpy(c->mntpnt,new_mntpnt);
-    HASH_ADD_PTR(q_c->cs,conn,c);
     c->sta_chg=1;
-    uv_mutex_unlock(&agent->cq_lock);
+    cors_ntrip_subs_add(&lp->subs,new_mntpnt,c);
 }
 
-static int agent_test_msgc(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn, uv_stream_t *str,
+static double sta_dist(const cors_ntrip_stas_ent_t *s, const double *pos)
+{
+    double dr[3];
+    int i;
+
+    for (i=0;i<3;i++) dr[i]=pos[i]-s->pos[i];
+    return norm(dr,3);
+}
+
+/* reassign rover to nearest station with hysteresis --------------------------
+ * a rover switches only if the nearest station is closer than its current one
+ * by more than hysteresis. after a query the rover can't get there before it
+ * moved by slack=(hyst-(d_cur-d_near))/2, so within slack of the query position
+ * and with the same station index no kd query is made.
+ *-----------------------------------------------------------------------------*/
+static void agent_gga_upd(cors_ntrip_agent_loop_t *lp, cors_ntrip_conn_t *conn, const cors_ntrip_stas_t *stas)
+{
+    const cors_ntrip_stas_ent_t *s,*cur;
+    cors_ntrip_agent_t *agent=lp->agent;
+    cors_t *cors=agent->ntrip->cors;
+    char new_mntpnt[32]="";
+    double dr[3],dc,dn;
+    int i;
+
+    if (conn->type!=2||norm(conn->pos,3)<=0.0) return;
+
+    /* on-demand vrs shared by rovers within radius */
+    if (cors&&cors->vrs.state&&cors->opt.vrs_radius>0.0) {
+        if (cors_vrs_attach(&cors->vrs,conn->pos,conn->mntpnt,new_mntpnt)>0) {
+            lp->nswitch++;
+            agent_upd_conn(lp,conn,(uv_stream_t*)conn->conn,new_mntpnt);
+        }
+        return;
+    }
+    if (!stas) return;
+
+    if (conn->gga_ver==stas->ver) {
+        for (i=0;i<3;i++) dr[i]=conn->pos[i]-conn->gga_ref[i];
+        if (norm(dr,3)<=conn->gga_slack) return;
+    }
+    lp->nquery++;
+    if (!(s=cors_ntrip_stas_nearest(stas,conn->pos))) return;
+
+    matcpy(conn->gga_ref,conn->pos,1,3);
+    conn->gga_ver=stas->ver;
+    conn->gga_slack=agent->gga_hyst*0.5;
+
+    if ((cur=cors_ntrip_stas_find(stas,conn->mntpnt))) {
+        if (cur==s) return;
+        dc=sta_dist(cur,conn->pos);
+        dn=sta_dist(s,conn->pos);
+        if (dc-dn<=agent->gga_hyst) {
+            conn->gga_slack=(agent->gga_hyst-(dc-dn))*0.5;
+            return;
+        }
+    }
+    lp->nswitch++;
+    agent_upd_conn(lp,conn,(uv_stream_t*)conn->conn,s->name);
+}
+
+/* rover positions of tick, one station index reference for the batch -------*/
+static void on_gga_timer_cb(uv_timer_t *handle)
+{
+    cors_ntrip_agent_loop_t *lp=handle->data;
+    cors_ntrip_stas_t *stas;
+    cors_ntrip_conn_t *conn;
+    QUEUE *q;
+
+    if (QUEUE_EMPTY(&lp->gga_queue)) return;
+
+    stas=cors_ntrip_stas_get(lp->agent->ntrip);
+    while (!QUEUE_EMPTY(&lp->gga_queue)) {
+        q=QUEUE_HEAD(&lp->gga_queue);
+        conn=QUEUE_DATA(q,cors_ntrip_conn_t,gga_q);
+        QUEUE_REMOVE(q);
+        conn->gga_pend=0;
+        if (!conn->del) agent_gga_upd(lp,conn,stas);
+    }
+    if (stas) cors_ntrip_stas_unref(stas);
+}
+
+/* new rover position, reassigned on next tick (gga_tick<=0: at once) ---------*/
+static void agent_gga_pos(cors_ntrip_agent_loop_t *lp, cors_ntrip_conn_t *conn)
+{
+    cors_ntrip_stas_t *stas;
+
+    lp->ngga++;
+    if (lp->agent->gga_tick<=0) {
+        stas=cors_ntrip_stas_get(lp->agent->ntrip);
+        agent_gga_upd(lp,conn,stas);
+        if (stas) cors_ntrip_stas_unref(stas);
+        return;
+    }
+    if (conn->gga_pend) return;
+    conn->gga_pend=1;
+    QUEUE_INSERT_TAIL(&lp->gga_queue,&conn->gga_q);
+}
+
+static int agent_test_msgc(cors_ntrip_agent_loop_t *lp, cors_ntrip_conn_t *conn, uv_stream_t *str,
                            char *buff, int nb)
 {
+    cors_ntrip_agent_t *agent=lp->agent;
     char url[256]="",mntpnt[256]="",proto[256]="",*p,*q;
-    char tmp[256]={0},user[513]={0},user_pwd[256]={0},new_mntpnt[32]={0};
+    char tmp[256]={0},user[513]={0},user_pwd[256]={0};
     int len=0;
 
     if (conn->state) {
-        test_gga_msg(agent,conn,buff); test_vstachg(agent,conn,new_mntpnt);
-        agent_upd_conn(agent,conn,str,new_mntpnt);
+        if (test_gga_msg(agent,conn,buff)>1) agent_gga_pos(lp,conn);
         return 1;
     }
     if (!(p=strstr(buff,"GET"))||!(q=strstr(p,"\r\n"))||
         !(q=strstr(q,"User-Agent:"))||!strstr(q,"\r\n")) {
-        ntripagnet_del_conn(agent,conn);
+        ntripagnet_del_conn(lp,conn);
         return 0;
     }
     if (sscanf(p,"GET %255s %255s",url,proto)<2||strcmp(proto,"HTTP/1.0")) {
-        ntripagnet_del_conn(agent,conn);
+        ntripagnet_del_conn(lp,conn);
         return 0;
     }
     if ((p=strchr(url,'/'))) strcpy(mntpnt,p+1);
 
     if (!*mntpnt||!(conn->type=test_mntpnt(agent,conn,mntpnt))) {
 
-        send_rsqc(agent,conn,"");
-        ntripagnet_del_conn(agent,conn);
+        send_rsqc(lp,conn,"");
+        ntripagnet_del_conn(lp,conn);
         return 0;
     }
     if (!(p=strstr(buff,"Authorization: Basic "))||!(q=strstr(p,"\r\n"))) {
-        send_rsqc(agent,conn,NTRIP_RSP_UNAUTH);
-        ntripagnet_del_conn(agent,conn);
+        send_rsqc(lp,conn,NTRIP_RSP_UNAUTH);
+        ntripagnet_del_conn(lp,conn);
         return 0;
     }
     p+=strlen("Authorization: Basic ");
@@ -220,13 +443,13 @@ static int agent_test_msgc(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn, u
         if (++p&&*p) strcpy(user_pwd,p);
     }
     if (!test_auth(agent,user,user_pwd)) {
-        send_rsqc(agent,conn,NTRIP_RSP_UNAUTH);
-        ntripagnet_del_conn(agent,conn);
+        send_rsqc(lp,conn,NTRIP_RSP_UNAUTH);
+        ntripagnet_del_conn(lp,conn);
         return 0;
     }
     conn->state=1;
-    send_rsqc(agent,conn,NTRIP_RSP_OK_CLI);
-    agent_upd_conn(agent,conn,str,mntpnt);
+    send_rsqc(lp,conn,NTRIP_RSP_OK_CLI);
+    agent_upd_conn(lp,conn,str,mntpnt);
     return 1;
 }
 
@@ -235,111 +458,115 @@ static void on_read_cb(uv_stream_t *str, ssize_t nr, const uv_buf_t *buf)
     cors_ntrip_conn_t *conn=str->data;
 
     if (nr<0) {
-        ntripagnet_del_conn(conn->agent,conn);
+        ntripagnet_del_conn(conn->lp,conn);
         free(buf->base);
         return;
     }
-    agent_test_msgc(conn->agent,conn,str,buf->base,nr);
+    if (nr>0) {
+        buf->base[nr]='\0';
+        agent_test_msgc(conn->lp,conn,str,buf->base,nr);
+    }
     free(buf->base);
 }
 
-static void agent_add_ntripconn(cors_ntrip_agent_t *agent)
-{
-    uv_async_send(agent->add_conn);
-}
-
+/* accept connection on loop of listening socket ------------------------------*/
 static void on_new_ntripconn(uv_stream_t *svr, int status)
 {
+    cors_ntrip_agent_loop_t *lp=svr->data;
+    cors_ntrip_conn_t *conn;
+
     if (status<0) {
         log_trace(1,"new connection error %s\n",uv_strerror(status));
         return;
     }
-    agent_add_ntripconn(svr->data);
-}
-
-static void on_add_ntripconn_cb(uv_async_t *handle)
-{
-    cors_ntrip_conn_t *conn=calloc(1,sizeof(*conn));
-    cors_ntrip_agent_t *agent=handle->data;
-
-    conn->agent=agent;
+    conn=calloc(1,sizeof(*conn));
+    conn->lp=lp;
     conn->conn=calloc(1,sizeof(uv_tcp_t));
-    uv_tcp_init(handle->loop,conn->conn);
+    uv_tcp_init(svr->loop,conn->conn);
 
-    if (uv_accept((uv_stream_t*)agent->svr,(uv_stream_t*)conn->conn)!=0) {
-        free(conn->conn);
+    if (uv_accept(svr,(uv_stream_t*)conn->conn)!=0) {
+        uv_close((uv_handle_t*)conn->conn,on_close_cb);
         free(conn); return;
     }
     conn->conn->data=conn;
     uv_read_start((uv_stream_t*)conn->conn,alloc_buffer,on_read_cb);
-    HASH_ADD_PTR(agent->conn_tbl,conn,conn);
+    HASH_ADD_PTR(lp->conn_tbl,conn,conn);
+    lp->nconn++;
 }
 
 static void do_del_ntripconn(agent_del_ntripconn_t *data)
 {
-    cors_ntrip_agent_t *agent=data->agent;
-    cors_ntrip_conn_t *c,*t;
-    cors_ntrip_conn_q_t *cq;
-
-    HASH_FIND_PTR(agent->conn_tbl,&data->conn->conn,c);
-    if (!c) return;
+    cors_ntrip_agent_loop_t *lp=data->lp;
+    cors_ntrip_agent_t *agent=lp->agent;
+    cors_ntrip_conn_t *c;
 
-    uv_mutex_lock(&agent->cq_lock);
-    HASH_FIND_STR(agent->cq_tbl,data->conn->mntpnt,cq);
-    if (cq) {
-        HASH_FIND_PTR(cq->cs,&c->conn,t);
-        if (t) HASH_DEL(cq->cs,t); free(t);
+    HASH_FIND_PTR(lp->conn_tbl,&data->conn->conn,c);
+    if (!c) {
+        free(data);
+        return;
+    }
+    if (c->type==2&&agent->ntrip->cors) {
+        cors_vrs_detach(&agent->ntrip->cors->vrs,c->mntpnt);
     }
+
+    free(cors_ntrip_subs_del(&lp->subs,c->mntpnt,c->conn));
+    if (c->gga_pend) QUEUE_REMOVE(&c->gga_q);
+
+    agent_wq_free(c);
+    c->conn->data=NULL;
     uv_close((uv_handle_t*)c->conn,on_close_cb);
-    HASH_DEL(agent->conn_tbl,c);
-    uv_mutex_unlock(&agent->cq_lock);
+    HASH_DEL(lp->conn_tbl,c);
     free(c); free(data);
 }
 
 static void on_del_ntripconn_cb(uv_async_t *handle)
 {
-    cors_ntrip_agent_t *agent=handle->data;
+    cors_ntrip_agent_loop_t *lp=handle->data;
 
-    while (!QUEUE_EMPTY(&agent->del_queue)) {
-        uv_mutex_lock(&agent->del_lock);
-        QUEUE *q=QUEUE_HEAD(&agent->del_queue);
+    while (!QUEUE_EMPTY(&lp->del_queue)) {
+        uv_mutex_lock(&lp->del_lock);
+        QUEUE *q=QUEUE_HEAD(&lp->del_queue);
         agent_del_ntripconn_t *data=QUEUE_DATA(q,agent_del_ntripconn_t,q);
         QUEUE_REMOVE(q);
-        uv_mutex_unlock(&agent->del_lock);
+        uv_mutex_unlock(&lp->del_lock);
         do_del_ntripconn(data);
     }
 }
 
-extern void ntripagnet_del_conn(cors_ntrip_agent_t *agent, cors_ntrip_conn_t *conn)
+extern void ntripagnet_del_conn(cors_ntrip_agent_loop_t *lp, cors_ntrip_conn_t *conn)
 {
-    uv_mutex_lock(&agent->del_lock);
+    if (conn->del) return;
+    conn->del=1;
+
+    uv_mutex_lock(&lp->del_lock);
     agent_del_ntripconn_t *data=calloc(1,sizeof(*data));
-    data->agent=agent;
+    data->lp=lp;
     data->conn=conn;
-    QUEUE_INSERT_TAIL(&agent->del_queue,&data->q);
-    uv_mutex_unlock(&agent->del_lock);
+    QUEUE_INSERT_TAIL(&lp->del_queue,&data->q);
+    uv_mutex_unlock(&lp->del_lock);
 
-    uv_async_send(agent->del_conn);
+    uv_async_send(lp->del_conn);
 }
 
+/* send shared ephemeris messages, encoded once per new ephemeris by cors ----*/
 static void agent_send_nav_data(cors_ntrip_conn_t *conn, agent_send_data_t *data)
 {
-    int nb,type[5]={1019,1020,1046,1042,1044};
-    char buff[MAXSAT*256];
+    cors_ntrip_agent_t *agent=data->lp->agent;
 
     if (timediff(timeget(),conn->time)<600.0) return;
-    conn->time=timeget();
 
-    if ((nb=rtcm_encode_nav(type,data->nav,buff))) {
-        agent_send_data(conn,buff,nb);
-    }
+    if (!data->nav&&!(data->nav=cors_navrtcm(&agent->ntrip->cors->nav))) return;
+    conn->time=timeget();
+    agent_send_sbuf(conn,data->nav);
+    __atomic_add_fetch(&agent->nnav,1,__ATOMIC_SEQ_CST);
 }
 
 static void agent_send_sta_data(cors_ntrip_conn_t *conn, agent_send_data_t *data)
 {
-    cors_ntrip_agent_t *agent=data->agent;
+    cors_ntrip_agent_t *agent=data->lp->agent;
     cors_ntrip_source_info_t *info_tbl=agent->ntrip->info_tbl[0];
     cors_ntrip_source_info_t *s;
+    cors_ntrip_sbuf_t *sbuf;
     sta_t sta={0};
     int nb;
     char buff[1024];
@@ -352,100 +579,129 @@ static void agent_send_sta_data(cors_ntrip_conn_t *conn, agent_send_data_t *data
     matcpy(sta.pos,s->pos,1,3);
     conn->sta_chg=0;
 
-    if ((nb=rtcm_encode_sta(1005,&sta,buff))) {
-        agent_send_data(conn,buff,nb);
+    if ((nb=rtcm_encode_sta(1005,&sta,buff))&&(sbuf=cors_ntrip_sbuf_new(buff,nb))) {
+        sbuf->type=AGENT_SBUF_STA;
+        agent_send_sbuf(conn,sbuf);
+        cors_ntrip_sbuf_unref(sbuf);
     }
 }
 
 static void agent_send_obs_data(cors_ntrip_conn_t *conn, agent_send_data_t *data)
 {
-    agent_send_data(conn,data->buff,data->nb);
+    agent_send_sbuf(conn,data->sbuf);
 }
 
 static void do_agent_send_data_work(agent_send_data_t *data)
 {
     cors_ntrip_conn_q_t *q;
-    cors_ntrip_agent_t *agent=data->agent;
+    cors_ntrip_agent_loop_t *lp=data->lp;
     cors_ntrip_conn_t *c,*t;
 
-    HASH_FIND_STR(agent->cq_tbl,data->mntpnt,q);
-    if (!q) return;
-
-    uv_mutex_lock(&agent->cq_lock);
-
-    HASH_ITER(hh,q->cs,c,t) {
+    /* subscribers are changed on this loop only, no lock while iterating */
+    if ((q=cors_ntrip_subs_get(&lp->subs,data->mntpnt))) HASH_ITER(hh,q->cs,c,t) {
         agent_send_nav_data(c,data);
         agent_send_sta_data(c,data);
         agent_send_obs_data(c,data);
     }
-    uv_mutex_unlock(&agent->cq_lock);
 
-    free(data->buff);
+    if (data->nav) cors_ntrip_sbuf_unref(data->nav);
+    cors_ntrip_sbuf_unref(data->sbuf);
     free(data);
 }
 
 static void on_agent_send_cb(uv_async_t *handle)
 {
-    cors_ntrip_agent_t *agent=handle->data;
+    cors_ntrip_agent_loop_t *lp=handle->data;
 
-    while (!QUEUE_EMPTY(&agent->send_queue)) {
-        uv_mutex_lock(&agent->send_lock);
+    while (!QUEUE_EMPTY(&lp->send_queue)) {
+        uv_mutex_lock(&lp->send_lock);
 
-        QUEUE *q=QUEUE_HEAD(&agent->send_queue);
+        QUEUE *q=QUEUE_HEAD(&lp->send_queue);
         agent_send_data_t *data=QUEUE_DATA(q,agent_send_data_t,q);
         QUEUE_REMOVE(q);
-        uv_mutex_unlock(&agent->send_lock);
+        uv_mutex_unlock(&lp->send_lock);
         do_agent_send_data_work(data);
     }
 }
 
-static void agent_init(uv_loop_t *loop, cors_ntrip_agent_t *agent)
+static void agent_loop_init(uv_loop_t *loop, cors_ntrip_agent_loop_t *lp)
 {
-    QUEUE_INIT(&agent->send_queue);
-    QUEUE_INIT(&agent->del_queue);
+    lp->del_conn=calloc(1,sizeof(uv_async_t));
+    lp->del_conn->data=lp;
+    uv_async_init(loop,lp->del_conn,on_del_ntripconn_cb);
 
-    agent->add_conn=calloc(1,sizeof(uv_async_t));
-    agent->del_conn=calloc(1,sizeof(uv_async_t));
-    agent->add_conn->data=agent;
-    agent->del_conn->data=agent;
-    uv_async_init(loop,agent->add_conn,on_add_ntripconn_cb);
-    uv_async_init(loop,agent->del_conn,on_del_ntripconn_cb);
+    lp->close=calloc(1,sizeof(uv_async_t));
+    lp->close->data=lp;
+    uv_async_init(loop,lp->close,close_cb);
 
-    agent->close=calloc(1,sizeof(uv_async_t));
-    agent->close->data=agent;
-    uv_async_init(loop,agent->close,close_cb);
+    lp->send=calloc(1,sizeof(uv_async_t));
+    lp->send->data=lp;
+    uv_async_init(loop,lp->send,on_agent_send_cb);
 
-    agent->send=calloc(1,sizeof(uv_async_t));
-    agent->send->data=agent;
-    uv_async_init(loop,agent->send,on_agent_send_cb);
+    lp->gga_timer=calloc(1,sizeof(uv_timer_t));
+    lp->gga_timer->data=lp;
+    uv_timer_init(loop,lp->gga_timer);
+    if (lp->agent->gga_tick>0) {
+        uv_timer_start(lp->gga_timer,on_gga_timer_cb,lp->agent->gga_tick,lp->agent->gga_tick);
+    }
+}
 
-    uv_mutex_init(&agent->cq_lock);
-    uv_mutex_init(&agent->send_lock);
-    uv_mutex_init(&agent->del_lock);
-    agent->state=1;
+/* listening socket of loop, all loops bind same port with SO_REUSEPORT -----*/
+static int agent_listen(uv_loop_t *loop, cors_ntrip_agent_loop_t *lp)
+{
+    struct sockaddr_in addr;
+    int ret;
+#ifdef AGENT_REUSEPORT
+    int fd,on=1;
+#endif
+    lp->svr=calloc(1,sizeof(uv_tcp_t));
+    lp->svr->data=lp;
+    uv_tcp_init(loop,lp->svr);
+    uv_ip4_addr("127.0.0.1",lp->agent->port,&addr);
+
+#ifdef AGENT_REUSEPORT
+    if ((fd=socket(AF_INET,SOCK_STREAM,0))<0) {
+        log_trace(1,"agent loop %d socket error\n",lp->ID);
+        return 0;
+    }
+    setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+    if (setsockopt(fd,SOL_SOCKET,SO_REUSEPORT,&on,sizeof(on))<0||
+        bind(fd,(const struct sockaddr*)&addr,sizeof(addr))<0) {
+        log_trace(1,"agent loop %d bind error: port=%d\n",lp->ID,lp->agent->port);
+        close(fd);
+        return 0;
+    }
+    if ((ret=uv_tcp_open(lp->svr,fd))) {
+        log_trace(1,"agent loop %d error %s\n",lp->ID,uv_strerror(ret));
+        close(fd);
+        return 0;
+    }
+#else
+    uv_tcp_bind(lp->svr,(const struct sockaddr*)&addr,0);
+#endif
+    if ((ret=uv_listen((uv_stream_t*)lp->svr,SOMAXCONN,on_new_ntripconn))) {
+        log_trace(1,"agent error %s\n",uv_strerror(ret));
+        return 0;
+    }
+    return 1;
 }
 
-static void ntrip_agent_thread(void *ntrip_agent_arg)
+static void ntrip_agent_loop_thread(void *arg)
 {
-    cors_ntrip_agent_t *agent=ntrip_agent_arg;
+    cors_ntrip_agent_loop_t *lp=arg;
     uv_loop_t *loop=uv_loop_new();
 
-    agent->svr=calloc(1,sizeof(uv_tcp_t));
-    agent->svr->data=agent;
-    uv_tcp_init(loop,agent->svr);
-    struct sockaddr_in addr;
-
-    uv_ip4_addr("127.0.0.1",NTRIP_AGENT_PORT,&addr);
-    uv_tcp_bind(agent->svr,(const struct sockaddr*)&addr,0);
+    agent_loop_init(loop,lp);
 
-    int ret=uv_listen((uv_stream_t*)agent->svr,SOMAXCONN,on_new_ntripconn);
-    if (ret) {
-        log_trace(1,"agent error %s\n",uv_strerror(ret));
+    if (!agent_listen(loop,lp)) {
+        lp->state=-1;
+        close_uv_loop(loop);
         free(loop); return;
     }
-    agent_init(loop,agent);
+    __atomic_store_n(&lp->state,1,__ATOMIC_SEQ_CST);
 
     uv_run(loop,UV_RUN_DEFAULT);
+    lp->state=0;
     close_uv_loop(loop);
     free(loop);
 }
@@ -477,36 +733,122 @@ static void read_users_file(cors_ntrip_agent_t *agent, const char *users_file)
     fclose(fp);
 }
 
-extern int cors_ntrip_agent_start(cors_ntrip_agent_t *agent, cors_ntrip_t *ntrip, const char *users_file)
+static void free_agent_loop(cors_ntrip_agent_loop_t *lp)
 {
+    cors_ntrip_conn_t *cq,*ct;
+    QUEUE *qd;
+
+    HASH_ITER(hh,lp->conn_tbl,cq,ct) {
+        HASH_DEL(lp->conn_tbl,cq);
+        agent_wq_free(cq);
+        free(cq);
+    }
+    cors_ntrip_subs_free(&lp->subs);
+    while (!QUEUE_EMPTY(&lp->send_queue)) {
+        qd=QUEUE_HEAD(&lp->send_queue);
+        agent_send_data_t *data=QUEUE_DATA(qd,agent_send_data_t,q);
+        QUEUE_REMOVE(qd);
+        if (data->nav) cors_ntrip_sbuf_unref(data->nav);
+        cors_ntrip_sbuf_unref(data->sbuf);
+        free(data);
+    }
+    while (!QUEUE_EMPTY(&lp->del_queue)) {
+        qd=QUEUE_HEAD(&lp->del_queue);
+        QUEUE_REMOVE(qd);
+        free(QUEUE_DATA(qd,agent_del_ntripconn_t,q));
+    }
+    uv_mutex_destroy(&lp->send_lock);
+    uv_mutex_destroy(&lp->del_lock);
+}
+
+/* start ntrip agent -----------------------------------------------------------
+ * each loop runs its own thread, listening socket, connection table and
+ * mountpoint subscriber table. with SO_REUSEPORT the kernel spreads accepts
+ * over loops, so a connection is read and written by one loop only.
+ * args   : cors_ntrip_agent_t *agent  IO  ntrip agent (port 0: default)
+ *          cors_ntrip_t  *ntrip       I   ntrip sources
+ *          char          *users_file  I   agent users file
+ *          int            nloop       I   number of event loops (<=0: 1)
+ * return : status (1:ok,0:error)
+ *-----------------------------------------------------------------------------*/
+extern int cors_ntrip_agent_start(cors_ntrip_agent_t *agent, cors_ntrip_t *ntrip, const char *users_file,
+                                  int nloop)
+{
+    cors_ntrip_agent_loop_t *lp;
+    int i,state;
+
+#if !WIN32
+    signal(SIGPIPE,SIG_IGN); /* rovers may go away while written */
+#endif
+    if (nloop<=0) nloop=1;
+    if (nloop>MAX_AGENT_LOOPS) nloop=MAX_AGENT_LOOPS;
+#ifndef AGENT_REUSEPORT
+    nloop=1;
+#endif
+    if (!agent->port) agent->port=NTRIP_AGENT_PORT;
+    if (!(agent->loops=calloc(nloop,sizeof(cors_ntrip_agent_loop_t)))) {
+        return 0;
+    }
     agent->ntrip=ntrip;
     read_users_file(agent,users_file);
 
-    if (uv_thread_create(&agent->thread,ntrip_agent_thread,agent)) {
-        log_trace(1,"ntrip agent thread create error\n");
+    for (i=0;i<nloop;i++) {
+        lp=agent->loops+i;
+        lp->ID=i;
+        lp->agent=agent;
+        QUEUE_INIT(&lp->send_queue);
+        QUEUE_INIT(&lp->del_queue);
+        QUEUE_INIT(&lp->gga_queue);
+        cors_ntrip_subs_init(&lp->subs);
+        uv_mutex_init(&lp->send_lock);
+        uv_mutex_init(&lp->del_lock);
+
+        if (uv_thread_create(&lp->thread,ntrip_agent_loop_thread,lp)) {
+            log_trace(1,"ntrip agent thread create error: loop=%d\n",i);
+            break;
+        }
+        agent->nloop++;
+        /* wait for listening socket, loop may then receive data */
+        while (!(state=__atomic_load_n(&lp->state,__ATOMIC_SEQ_CST))) uv_sleep(1);
+        if (state<0) break;
+    }
+    agent->state=1;
+
+    if (i<nloop) {
+        cors_ntrip_agent_close(agent);
         return 0;
     }
-    log_trace(1,"ntrip agent thread create ok\n");
+    log_trace(1,"ntrip agent thread create ok: loops=%d port=%d\n",nloop,agent->port);
     return 1;
 }
 
 extern void cors_ntrip_agent_close(cors_ntrip_agent_t *agent)
 {
+    cors_ntrip_agent_loop_t *lp;
+    int i;
+
+    if (!agent->loops) return;
     agent->state=0;
-    uv_async_send(agent->close);
-    uv_thread_join(&agent->thread);
 
-    cors_ntrip_conn_t *cq,*ct;
-    HASH_ITER(hh,agent->conn_tbl,cq,ct) {
-        HASH_DEL(agent->conn_tbl,cq);
-        free(cq);
-    }
-    cors_ntrip_conn_q_t *q,*t;
-    HASH_ITER(hh,agent->cq_tbl,q,t) {
-        HASH_ITER(hh,q->cs,cq,ct) {
-            HASH_DEL(q->cs,cq); free(cq);
+    for (i=0;i<agent->nloop;i++) {
+        lp=agent->loops+i;
+        if (lp->state>0) {
+            lp->state=0;
+            uv_async_send(lp->close);
         }
     }
+    for (i=0;i<agent->nloop;i++) {
+        lp=agent->loops+i;
+        uv_thread_join(&lp->thread);
+        log_trace(3,"ntrip agent loop %d: conn=%llu write=%llu byte=%llu\n",i,
+                  (unsigned long long)lp->nconn,(unsigned long long)lp->nwrite,
+                  (unsigned long long)lp->nbyte);
+        free_agent_loop(lp);
+    }
+    free(agent->loops);
+    agent->loops=NULL;
+    agent->nloop=0;
+
     cors_ntrip_user_t *u,*s;
     HASH_ITER(hh,agent->user_tbl,u,s) {
         HASH_DEL(agent->user_tbl,u); free(u);
@@ -541,35 +883,44 @@ extern int cors_ntrip_agent_del_user(cors_ntrip_agent_t *agent, const char *user
     return 1;
 }
 
-static agent_send_data_t *new_agent_data(cors_ntrip_agent_t *agent, const char *mntpnt, const char *buff, int nb,
-                                         const nav_t *nav)
+static agent_send_data_t *new_agent_data(cors_ntrip_agent_loop_t *lp, const char *mntpnt,
+                                         cors_ntrip_sbuf_t *sbuf)
 {
     agent_send_data_t *data=calloc(1,sizeof(*data));
-    data->agent=agent;
-    data->nb=nb;
-    data->nav=nav;
+    if (!data) return NULL;
+    data->lp=lp;
     strcpy(data->mntpnt,mntpnt);
-    data->buff=calloc(nb,sizeof(char)*nb);
-    memcpy(data->buff,buff,nb);
+    data->sbuf=sbuf;
+    cors_ntrip_sbuf_ref(sbuf);
     return data;
 }
 
-extern int cors_ntrip_agent_send(cors_ntrip_agent_t *agent, const char *mntpnt, const char *buff, int nb,
-                                 const nav_t *nav)
+/* send data to subscribers of mountpoint on every loop (one shared copy) ----*/
+extern int cors_ntrip_agent_send(cors_ntrip_agent_t *agent, const char *mntpnt, const char *buff, int nb)
 {
+    cors_ntrip_agent_loop_t *lp;
+    cors_ntrip_sbuf_t *sbuf=NULL;
+    agent_send_data_t *data;
+    int i,n=0;
+
     if (!agent->state) return 0;
 
-    cors_ntrip_conn_q_t *q;
-    HASH_FIND_STR(agent->cq_tbl,mntpnt,q);
-    if (!q) return 0;
+    for (i=0;i<agent->nloop;i++) {
+        lp=agent->loops+i;
+        if (lp->state<=0) continue;
 
-    uv_mutex_lock(&agent->send_lock);
-    agent_send_data_t *data=new_agent_data(agent,mntpnt,buff,nb,nav);
-    QUEUE_INSERT_TAIL(&agent->send_queue,&data->q);
-    uv_mutex_unlock(&agent->send_lock);
+        if (!cors_ntrip_subs_has(&lp->subs,mntpnt)) continue;
 
-    uv_async_send(agent->send);
-    return 1;
-}
+        if (!sbuf&&!(sbuf=cors_ntrip_sbuf_new(buff,nb))) return 0;
+        if (!(data=new_agent_data(lp,mntpnt,sbuf))) continue;
 
+        uv_mutex_lock(&lp->send_lock);
+        QUEUE_INSERT_TAIL(&lp->send_queue,&data->q);
+        uv_mutex_unlock(&lp->send_lock);
 
+        uv_async_send(lp->send);
+        n++;
+    }
+    if (sbuf) cors_ntrip_sbuf_unref(sbuf);
+    return n>0;
+}
@@ -16,7 +16,7 @@ static int on_read_cb(void* userdata, const uint8_t *data, int n)
     log_trace(1,"[%2d] receive RTCM data: %d bytes\n",src->ID,n);
 
     cors_rtcm_decode(&cors->rtcm_decoder,data,n,src->ID);
-    cors_ntrip_agent_send(&cors->agent,src->name,data,n,&cors->nav.data);
+    cors_ntrip_agent_send(&cors->agent,src->name,data,n);
     return n;
 }
 
@@ -51,6 +51,7 @@ static void ntrip_caster_thread(void *caster_arg)
     cors_ntrip_t *ntrip=ctr->ntrip;
     cors_ntrip_source_info_t *info,*tmp,*itmp;
     cors_t *cors=ntrip->cors;
+    int nadd=0;
 
     uv_loop_t *loop=uv_loop_new();
     ctr->loop=loop;
@@ -92,8 +93,10 @@ static void ntrip_caster_thread(void *caster_arg)
         s->ctr=ctr;
         HASH_ADD_STR(ctr->src_tbl,name,s);
 
+        uv_mutex_lock(&ntrip->info_lock);
         HASH_FIND(hh,ntrip->info_tbl[0],s->name,strlen(s->name),itmp);
         if (itmp) {
+            uv_mutex_unlock(&ntrip->info_lock);
             HASH_DEL(argv->info_tbl,info);
             free(info);
             continue;
@@ -102,11 +105,13 @@ static void ntrip_caster_thread(void *caster_arg)
         *itmp=*info;
         HASH_ADD(hh,ntrip->info_tbl[0],name,strlen(itmp->name),itmp);
         HASH_ADD(ii,ntrip->info_tbl[1],ID,sizeof(int),itmp);
-        kd_insert(ntrip->src_kdtree,info->pos,itmp);
+        uv_mutex_unlock(&ntrip->info_lock);
+        nadd++;
 
         HASH_DEL(argv->info_tbl,info);
         free(info);
     }
+    if (nadd) cors_ntrip_stas_publish(ntrip);
     uv_run(loop,UV_RUN_DEFAULT);
     close_uv_loop(loop);
 
@@ -178,9 +183,11 @@ static void do_add_source(ntrip_add_source_t *data)
     s->ctr=ctr;
     HASH_ADD_STR(ctr->src_tbl,name,s);
 
+    uv_mutex_lock(&ntrip->info_lock);
     HASH_ADD(hh,ntrip->info_tbl[0],name,strlen(info->name),info);
     HASH_ADD(ii,ntrip->info_tbl[1],ID,sizeof(int),info);
-    kd_insert(ntrip->src_kdtree,info->pos,info);
+    uv_mutex_unlock(&ntrip->info_lock);
+    cors_ntrip_stas_publish(ntrip);
     free(data);
 }
 
@@ -209,21 +216,23 @@ static void do_del_source(ntrip_del_source_t *data)
     }
     cors_ntripcli_close(&s->cli);
     HASH_DEL(ctr->src_tbl,s);
-    free(s); free(data);
+    free(s);
 
-    cors_ntrip_source_info_t *info,*i,*t;
+    cors_ntrip_source_info_t *info;
     cors_ntrip_t *ntrip=ctr->ntrip;
 
+    uv_mutex_lock(&ntrip->info_lock);
     HASH_FIND(hh,ntrip->info_tbl[0],data->name,strlen(data->name),info);
     if (info) {
         HASH_DELETE(hh,ntrip->info_tbl[0],info);
         HASH_DELETE(ii,ntrip->info_tbl[1],info);
         free(info);
     }
-    kd_clear(ntrip->src_kdtree);
-    HASH_ITER(hh,ntrip->info_tbl[0],i,t) {
-        kd_insert(ntrip->src_kdtree,i->pos,i);
-    }
+    uv_mutex_unlock(&ntrip->info_lock);
+    free(data);
+
+    /* new station index, rovers keep querying the former one until done */
+    cors_ntrip_stas_publish(ntrip);
 }
 
 static void on_del_source_cb(uv_async_t *handle)
@@ -0,0 +1,96 @@
+/*------------------------------------------------------------------------------
+ * ntripstas.c: NTRIP source station index snapshot for CORS
+ *
+ * the station index (kd-tree over source positions and name table) is built
+ * as an immutable snapshot whenever sources are added, deleted or moved, and
+ * replaced under a short lock. readers take a reference once per batch and
+ * query it without lock while casters rebuild the next one. a snapshot is
+ * built and installed under the info lock which also guards every change of
+ * source table, so it never reads freed sources and versions follow builds.
+ *
+ * author  : sujinglan
+ * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
+ * history : 2022/11/17 1.0  new
+ *-----------------------------------------------------------------------------*/
+#include "cors.h"
+
+static void free_stas(cors_ntrip_stas_t *stas)
+{
+    HASH_CLEAR(hh,stas->tbl);
+    kd_free(stas->tree);
+    free(stas);
+}
+
+/* publish new snapshot of source stations with position ---------------------*/
+extern void cors_ntrip_stas_publish(cors_ntrip_t *ntrip)
+{
+    cors_ntrip_source_info_t *info,*t;
+    cors_ntrip_stas_t *stas,*old;
+    cors_ntrip_stas_ent_t *s;
+    int n;
+
+    uv_mutex_lock(&ntrip->info_lock);
+    n=HASH_COUNT(ntrip->info_tbl[0]);
+    if (!(stas=calloc(1,sizeof(cors_ntrip_stas_t)+n*sizeof(cors_ntrip_stas_ent_t)))) {
+        uv_mutex_unlock(&ntrip->info_lock);
+        return;
+    }
+    if (!(stas->tree=kd_create(3))) {
+        uv_mutex_unlock(&ntrip->info_lock);
+        free(stas); return;
+    }
+    stas->ref=1;
+    HASH_ITER(hh,ntrip->info_tbl[0],info,t) {
+        if (norm(info->pos,3)<=0.0) continue;
+        s=stas->sta+stas->n++;
+        strcpy(s->name,info->name);
+        s->ID=info->ID;
+        matcpy(s->pos,info->pos,1,3);
+        kd_insert(stas->tree,s->pos,s);
+        HASH_ADD_STR(stas->tbl,name,s);
+    }
+    uv_mutex_lock(&ntrip->stas_lock);
+    stas->ver=++ntrip->stas_ver;
+    old=ntrip->stas;
+    ntrip->stas=stas;
+    uv_mutex_unlock(&ntrip->stas_lock);
+    uv_mutex_unlock(&ntrip->info_lock);
+
+    if (old) cors_ntrip_stas_unref(old);
+}
+
+/* reference current snapshot (NULL: none) -----------------------------------*/
+extern cors_ntrip_stas_t *cors_ntrip_stas_get(cors_ntrip_t *ntrip)
+{
+    cors_ntrip_stas_t *stas;
+
+    uv_mutex_lock(&ntrip->stas_lock);
+    if ((stas=ntrip->stas)) __atomic_add_fetch(&stas->ref,1,__ATOMIC_SEQ_CST);
+    uv_mutex_unlock(&ntrip->stas_lock);
+    return stas;
+}
+
+extern void cors_ntrip_stas_unref(cors_ntrip_stas_t *stas)
+{
+    if (__atomic_sub_fetch(&stas->ref,1,__ATOMIC_SEQ_CST)==0) free_stas(stas);
+}
+
+/* nearest station of snapshot -----------------------------------------------*/
+extern const cors_ntrip_stas_ent_t *cors_ntrip_stas_nearest(const cors_ntrip_stas_t *stas, const double *pos)
+{
+    const cors_ntrip_stas_ent_t *s;
+    struct kdres *res;
+
+    if (!stas->n||!(res=kd_nearest(stas->tree,pos))) return NULL;
+    s=kd_res_item_data(res);
+    kd_res_free(res);
+    return s;
+}
+
+extern const cors_ntrip_stas_ent_t *cors_ntrip_stas_find(const cors_ntrip_stas_t *stas, const char *name)
+{
+    cors_ntrip_stas_ent_t *s;
+
+    HASH_FIND_STR(stas->tbl,name,s);
+    return s;
+}
@@ -0,0 +1,172 @@
+/*------------------------------------------------------------------------------
+ * ntripsubs.c: NTRIP agent mountpoint subscriber registry for CORS
+ *
+ * subscribers are kept in per-mountpoint queues hashed over shards and are
+ * changed and iterated by the agent loop only. for other threads each shard
+ * publishes an immutable snapshot of its mountpoints with subscribers, read
+ * without lock. a replaced snapshot is freed after two epoch advances when no
+ * reader of the older epochs is left (epoch based reclamation), so readers
+ * never wait for connects, disconnects or mountpoint switches.
+ *
+ * author  : sujinglan
+ * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
+ * history : 2022/11/17 1.0  new
+ *-----------------------------------------------------------------------------*/
+#include "cors.h"
+
+static int shard_of(const char *mntpnt)
+{
+    uint32_t h=2166136261u;
+
+    while (*mntpnt) h=(h^(uint8_t)*mntpnt++)*16777619u;
+    return h%NTRIP_SUBS_SHARD;
+}
+
+static int cmp_mntpnt(const void *p1, const void *p2)
+{
+    return strcmp((const char*)p1,(const char*)p2);
+}
+
+/* free snapshots retired two epochs ago if their readers are gone ----------*/
+static void reclaim(cors_ntrip_subs_t *subs)
+{
+    cors_ntrip_subs_snap_t *s,*t;
+    unsigned int e=subs->epoch;
+
+    if (__atomic_load_n(&subs->nreader[(e+1)&1],__ATOMIC_SEQ_CST)) return;
+
+    for (s=subs->retire[(e+1)&1];s;s=t) {
+        t=s->next;
+        free(s);
+        subs->nfree++;
+    }
+    subs->retire[(e+1)&1]=NULL;
+    __atomic_store_n(&subs->epoch,e+1,__ATOMIC_SEQ_CST);
+}
+
+/* publish mountpoints of shard after one got first or lost last subscriber -*/
+static void publish(cors_ntrip_subs_t *subs, int k)
+{
+    cors_ntrip_subs_shard_t *shard=subs->shard+k;
+    cors_ntrip_subs_snap_t *snap,*old;
+    cors_ntrip_conn_q_t *q,*t;
+    int n=HASH_COUNT(shard->cq_tbl);
+
+    if (!(snap=malloc(sizeof(cors_ntrip_subs_snap_t)+n*32))) return;
+    snap->next=NULL;
+    snap->n=0;
+    HASH_ITER(hh,shard->cq_tbl,q,t) {
+        strcpy(snap->mntpnt[snap->n++],q->mntpnt);
+    }
+    qsort(snap->mntpnt,snap->n,32,cmp_mntpnt);
+
+    old=__atomic_exchange_n(&shard->snap,snap,__ATOMIC_SEQ_CST);
+    subs->npub++;
+    if (old) {
+        old->next=subs->retire[subs->epoch&1];
+        subs->retire[subs->epoch&1]=old;
+    }
+    reclaim(subs);
+}
+
+extern void cors_ntrip_subs_init(cors_ntrip_subs_t *subs)
+{
+    memset(subs,0,sizeof(*subs));
+}
+
+/* free registry with subscriber entries (no reader left) -------------------*/
+extern void cors_ntrip_subs_free(cors_ntrip_subs_t *subs)
+{
+    cors_ntrip_subs_snap_t *s,*t;
+    cors_ntrip_conn_q_t *q,*qt;
+    cors_ntrip_conn_t *c,*ct;
+    int i;
+
+    for (i=0;i<NTRIP_SUBS_SHARD;i++) {
+        HASH_ITER(hh,subs->shard[i].cq_tbl,q,qt) {
+            HASH_ITER(hh,q->cs,c,ct) {
+                HASH_DEL(q->cs,c); free(c);
+            }
+            HASH_DEL(subs->shard[i].cq_tbl,q); free(q);
+        }
+        free(subs->shard[i].snap);
+        subs->shard[i].snap=NULL;
+    }
+    for (i=0;i<2;i++) {
+        for (s=subs->retire[i];s;s=t) {
+            t=s->next; free(s);
+        }
+        subs->retire[i]=NULL;
+    }
+}
+
+/* subscribers of mountpoint (agent loop only) -------------------------------*/
+extern cors_ntrip_conn_q_t *cors_ntrip_subs_get(cors_ntrip_subs_t *subs, const char *mntpnt)
+{
+    cors_ntrip_conn_q_t *q;
+
+    HASH_FIND_STR(subs->shard[shard_of(mntpnt)].cq_tbl,mntpnt,q);
+    return q;
+}
+
+/* add subscriber entry to mountpoint, registry owns entry (agent loop only) -*/
+extern void cors_ntrip_subs_add(cors_ntrip_subs_t *subs, const char *mntpnt, cors_ntrip_conn_t *c)
+{
+    cors_ntrip_subs_shard_t *shard;
+    cors_ntrip_conn_q_t *q;
+    int k=shard_of(mntpnt);
+
+    shard=subs->shard+k;
+    HASH_FIND_STR(shard->cq_tbl,mntpnt,q);
+    if (!q) {
+        if (!(q=calloc(1,sizeof(cors_ntrip_conn_q_t)))) return;
+        strcpy(q->mntpnt,mntpnt);
+        HASH_ADD_STR(shard->cq_tbl,mntpnt,q);
+    }
+    HASH_ADD_PTR(q->cs,conn,c);
+    if (HASH_COUNT(q->cs)==1) publish(subs,k);
+}
+
+/* remove subscriber entry of stream from mountpoint (agent loop only) -------
+ * return : removed entry (NULL: not subscribed), to be freed by caller
+ *-----------------------------------------------------------------------------*/
+extern cors_ntrip_conn_t *cors_ntrip_subs_del(cors_ntrip_subs_t *subs, const char *mntpnt, uv_tcp_t *conn)
+{
+    cors_ntrip_subs_shard_t *shard;
+    cors_ntrip_conn_q_t *q;
+    cors_ntrip_conn_t *c;
+    int k=shard_of(mntpnt);
+
+    shard=subs->shard+k;
+    HASH_FIND_STR(shard->cq_tbl,mntpnt,q);
+    if (!q) return NULL;
+
+    HASH_FIND_PTR(q->cs,&conn,c);
+    if (!c) return NULL;
+    HASH_DEL(q->cs,c);
+
+    if (!q->cs) {
+        HASH_DEL(shard->cq_tbl,q);
+        free(q);
+        publish(subs,k);
+    }
+    return c;
+}
+
+/* test mountpoint has subscribers (any thread, lock-free) ------------------*/
+extern int cors_ntrip_subs_has(cors_ntrip_subs_t *subs, const char *mntpnt)
+{
+    cors_ntrip_subs_snap_t *snap;
+    unsigned int e;
+    int ret=0;
+
+    e=__atomic_load_n(&subs->epoch,__ATOMIC_SEQ_CST)&1;
+    __atomic_add_fetch(&subs->nreader[e],1,__ATOMIC_SEQ_CST);
+
+    snap=__atomic_load_n(&subs->shard[shard_of(mntpnt)].snap,__ATOMIC_SEQ_CST);
+    if (snap&&snap->n>0) {
+        ret=bsearch(mntpnt,snap->mntpnt,snap->n,32,cmp_mntpnt)!=NULL;
+    }
+    __atomic_sub_fetch(&subs->nreader[e],1,__ATOMIC_SEQ_CST);
+    return ret;
+}
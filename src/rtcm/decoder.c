@@ -8,30 +8,8 @@
 #include "cors.h"
 
 #define REFINE_RTCM_DECODER    1
-
-typedef struct decode_rtcm_data {
-    uint8_t *buff;
-    int nb;
-    cors_rtcm_decoder_t *decoder;
-    cors_rtcm_t *rtcm;
-} decode_rtcm_data_t;
-
-typedef struct decode_rtcm_task {
-    decode_rtcm_data_t data;
-    QUEUE q;
-} decode_rtcm_task_t;
-
-static void set_thread_rt_priority()
-{
-#if WIN32
-    SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_TIME_CRITICAL);
-#else
-    struct sched_param param;
-    param.sched_priority=sched_get_priority_max(SCHED_FIFO);
-    sched_setscheduler(getpid(),SCHED_RR,&param);
-    pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
-#endif
-}
+#define MAX_RTCM_DECODER       64
+#define RTCM_RING_SIZE         32768
 
 static void close_cb(uv_async_t* handle)
 {
@@ -40,11 +18,12 @@ static void close_cb(uv_async_t* handle)
     }
 }
 
-static void free_rtcm_decoder(cors_rtcm_decoder_t *decoder)
+static void free_rtcm_shard(cors_rtcm_decoder_shard_t *shard)
 {
     cors_rtcm_t *s,*tmp;
-    HASH_ITER(hh,decoder->data_tbl,s,tmp) {
-        HASH_DEL(decoder->data_tbl,s);
+    HASH_ITER(hh,shard->data_tbl,s,tmp) {
+        HASH_DEL(shard->data_tbl,s);
+        cors_ring_free(&s->ring);
         free_rtcm(&s->rtcm);
         free(s);
     }
@@ -52,18 +31,41 @@ static void free_rtcm_decoder(cors_rtcm_decoder_t *decoder)
 
 extern void cors_rtcm_decoder_close(cors_rtcm_decoder_t *decoder)
 {
-    if (!decoder->close) return;
+    int i;
+
+    if (!decoder->shards) return;
+    decoder->state=0;
 
-    uv_async_send(decoder->close);
-    uv_thread_join(&decoder->thread);
-    free_rtcm_decoder(decoder);
+    for (i=0;i<decoder->nshard;i++) {
+        if (!decoder->shards[i].close) continue;
+        uv_async_send(decoder->shards[i].close);
+        uv_thread_join(&decoder->shards[i].thread);
+        free_rtcm_shard(&decoder->shards[i]);
+    }
+    free(decoder->shards);
+    decoder->shards=NULL;
+    decoder->nshard=0;
 }
 
 static void on_timer_stat_cb(uv_timer_t* handle)
 {
-    NULL;
+    cors_rtcm_decoder_shard_t *shard=handle->data;
+
+    if (shard->nchunk<=0) return;
+
+    log_trace(3,"rtcm decoder shard %2d: srcs=%4d queue=%4d max=%4d chunks=%8llu bytes=%10llu msgs=%8llu "
+              "drop=%8llu decode=%9.3lf ms (%7.2lf us/chunk)\n",shard->ID,HASH_COUNT(shard->data_tbl),shard->nq,
+              shard->nq_max,(unsigned long long)shard->nchunk,(unsigned long long)shard->nbyte,
+              (unsigned long long)shard->nmsg,(unsigned long long)shard->ndrop,shard->tdecode*1E-6,
+              shard->tdecode*1E-3/shard->nchunk);
+    shard->nq_max=shard->nq;
 }
 
+/* update shared cors tables by decoded message ---------------------------------
+ * each table has its own lock, so shards only wait for others updating the
+ * same table. observations are locked by cors_updobs and point positioning
+ * takes a copy of shard-local observations to the pnt thread.
+ *-----------------------------------------------------------------------------*/
 static void upd_rtcm_data(cors_rtcm_decoder_t *decoder, rtcm_t *rtcm, int ret)
 {
     cors_t *cors=decoder->cors;
@@ -78,91 +80,116 @@ static void upd_rtcm_data(cors_rtcm_decoder_t *decoder, rtcm_t *rtcm, int ret)
         cors_pnt_pos(pnt,obs->data,obs->n,rtcm->srcid);
     }
     else if (ret==2) {
+        uv_mutex_lock(&decoder->nav_lock);
         cors_updnav(&cors->nav,nav,rtcm->ephsat,rtcm->ephset);
+        uv_mutex_unlock(&decoder->nav_lock);
 #if CORS_MONITOR
+        uv_mutex_lock(&decoder->moni_lock);
         cors_monitor_nav(&cors->monitor.moni_nav,nav,rtcm->ephsat,rtcm->ephset,rtcm->srcid);
+        uv_mutex_unlock(&decoder->moni_lock);
 #endif
     }
     else if (ret==5) {
+        uv_mutex_lock(&decoder->sta_lock);
         cors_updsta(stas,&rtcm->sta,rtcm->srcid);
+        uv_mutex_unlock(&decoder->sta_lock);
         cors_ntrip_source_updpos(ntrip,rtcm->sta.pos,rtcm->srcid);
-        cors_dtrignet_upd_vertex(&cors->nrtk.dtrig_net,rtcm->sta.pos,rtcm->srcid);
+        cors_nrtk_upd_source(&cors->nrtk,rtcm->srcid,rtcm->sta.pos);
     }
 }
 
-static void do_rtcm_decode_work(decode_rtcm_task_t *task)
+static void upd_rtcm_shared(cors_rtcm_decoder_shard_t *shard, rtcm_t *rtcm, int ret)
 {
-    cors_rtcm_t *s=task->data.rtcm;
-    cors_t *cors=task->data.decoder->cors;
-    cors_monitor_rtcm_t *moni_rtcm=&cors->monitor.moni_rtcm;
-    int i,ret=0,rlen=task->data.nb;
+    cors_rtcm_decoder_t *decoder=shard->decoder;
+    cors_monitor_rtcm_t *moni_rtcm=&decoder->cors->monitor.moni_rtcm;
 
-#if REFINE_RTCM_DECODER
-    for (i=0;i<task->data.nb;i++) {
-        if ((ret=input_rtcm3x(&s->rtcm,task->data.buff+(task->data.nb-rlen),rlen,&rlen))) {
-            upd_rtcm_data(task->data.decoder,&s->rtcm,ret);
+    upd_rtcm_data(decoder,rtcm,ret);
 #if CORS_MONITOR
-            cors_monitor_rtcm(moni_rtcm,&s->rtcm,s->rtcm.srcid);
+    uv_mutex_lock(&decoder->moni_lock);
+    cors_monitor_rtcm(moni_rtcm,rtcm,rtcm->srcid);
+    uv_mutex_unlock(&decoder->moni_lock);
 #endif
+    shard->nmsg++;
+}
+
+static void decode_rtcm_buff(cors_rtcm_decoder_shard_t *shard, cors_rtcm_t *s, uint8_t *buff, int nb)
+{
+    int i,ret=0,rlen=nb;
+
+#if REFINE_RTCM_DECODER
+    for (i=0;i<nb;i++) {
+        if ((ret=input_rtcm3x(&s->rtcm,buff+(nb-rlen),rlen,&rlen))) {
+            upd_rtcm_shared(shard,&s->rtcm,ret);
         }
         if (rlen<=0) break;
     }
 #else
-    for (i=0;i<task->data.nb;i++) {
-        ret=input_rtcm3(&s->rtcm,task->data.buff[i]);
+    for (i=0;i<nb;i++) {
+        ret=input_rtcm3(&s->rtcm,buff[i]);
         if (ret) {
-            upd_rtcm_data(task->data.decoder,&s->rtcm,ret);
+            upd_rtcm_shared(shard,&s->rtcm,ret);
         }
-#if CORS_MONITOR
-        cors_monitor_rtcm(moni_rtcm,&s->rtcm,s->rtcm.srcid);
-#endif
     }
 #endif
-    free(task->data.buff);
-    free(task);
+}
+
+static void do_rtcm_decode_work(cors_rtcm_decoder_shard_t *shard, cors_rtcm_t *s)
+{
+    uint8_t *p;
+    uint64_t tp=uv_hrtime();
+    int n;
+
+    /* frame directly on ring contents */
+    while ((n=cors_ring_peek(&s->ring,&p))>0) {
+        decode_rtcm_buff(shard,s,p,n);
+        cors_ring_commit(&s->ring,n);
+        shard->nbyte+=n;
+        shard->nchunk++;
+    }
+    shard->tdecode+=uv_hrtime()-tp;
 }
 
 static void rtcm_decode_cb(uv_async_t* handle)
 {
-    cors_rtcm_decoder_t *decoder=handle->data;
-    QUEUE *queue=&decoder->decode_queue;
+    cors_rtcm_decoder_shard_t *shard=handle->data;
+    QUEUE *queue=&shard->decode_queue;
 
     while (!QUEUE_EMPTY(queue)) {
-        uv_mutex_lock(&decoder->qlock);
+        uv_mutex_lock(&shard->qlock);
 
         QUEUE *q=QUEUE_HEAD(queue);
-        decode_rtcm_task_t *task=QUEUE_DATA(q,decode_rtcm_task_t,q);
+        cors_rtcm_t *s=QUEUE_DATA(q,cors_rtcm_t,q);
         QUEUE_REMOVE(q);
-        uv_mutex_unlock(&decoder->qlock);
-        do_rtcm_decode_work(task);
+        shard->nq--;
+        uv_mutex_unlock(&shard->qlock);
+
+        /* clear before draining so that new data re-queues the source */
+        __atomic_store_n(&s->queued,0,__ATOMIC_SEQ_CST);
+        do_rtcm_decode_work(shard,s);
     }
 }
 
 static void rtcm_decoder_thread(void *arg)
 {
-    cors_rtcm_decoder_t *decoder=(cors_rtcm_decoder_t*)arg;
+    cors_rtcm_decoder_shard_t *shard=(cors_rtcm_decoder_shard_t*)arg;
 
     uv_loop_t *loop=uv_loop_new();
-    decoder->state=0;
-
-    set_thread_rt_priority();
+    shard->state=0;
 
-    decoder->timer_stat=calloc(1,sizeof(uv_timer_t));
-    uv_timer_init(loop,decoder->timer_stat);
-    uv_timer_start(decoder->timer_stat,on_timer_stat_cb,0,10000);
+    cors_set_thread_rt_priority();
 
-    decoder->decode=calloc(1,sizeof(uv_async_t));
-    decoder->decode->data=decoder;
-    uv_async_init(loop,decoder->decode,rtcm_decode_cb);
+    shard->timer_stat=calloc(1,sizeof(uv_timer_t));
+    shard->timer_stat->data=shard;
+    uv_timer_init(loop,shard->timer_stat);
+    uv_timer_start(shard->timer_stat,on_timer_stat_cb,0,10000);
 
-    uv_mutex_init(&decoder->qlock);
-    uv_mutex_init(&decoder->tbl_lock);
+    shard->decode=calloc(1,sizeof(uv_async_t));
+    shard->decode->data=shard;
+    uv_async_init(loop,shard->decode,rtcm_decode_cb);
 
-    decoder->close=calloc(1,sizeof(uv_async_t));
-    uv_async_init(loop,decoder->close,close_cb);
-
-    QUEUE_INIT(&decoder->decode_queue);
-    decoder->state=1;
+    shard->close=calloc(1,sizeof(uv_async_t));
+    uv_async_init(loop,shard->close,close_cb);
+    shard->state=1;
 
     uv_run(loop,UV_RUN_DEFAULT);
     close_uv_loop(loop);
@@ -171,73 +198,110 @@ static void rtcm_decoder_thread(void *arg)
 
 extern int cors_rtcm_decoder_start(cors_rtcm_decoder_t *decoder, cors_t* cors)
 {
+    cors_rtcm_decoder_shard_t *shard;
+    int i,n=cors->opt.decoder_threads;
+
+    if (n<=0) n=1;
+    if (n>MAX_RTCM_DECODER) n=MAX_RTCM_DECODER;
+
     decoder->cors=cors;
-    if (uv_thread_create(&decoder->thread,rtcm_decoder_thread,decoder)) {
-        log_trace(1,"rtcm decoder thread create error\n");
+    if (!(decoder->shards=calloc(n,sizeof(cors_rtcm_decoder_shard_t)))) {
         return 0;
     }
-    log_trace(1,"rtcm decoder thread create ok\n");
+    uv_mutex_init(&decoder->nav_lock);
+    uv_mutex_init(&decoder->sta_lock);
+    uv_mutex_init(&decoder->moni_lock);
+
+    for (i=0;i<n;i++) {
+        shard=decoder->shards+i;
+        shard->ID=i;
+        shard->decoder=decoder;
+        QUEUE_INIT(&shard->decode_queue);
+        uv_mutex_init(&shard->qlock);
+        uv_mutex_init(&shard->tbl_lock);
+
+        if (uv_thread_create(&shard->thread,rtcm_decoder_thread,shard)) {
+            log_trace(1,"rtcm decoder thread create error: shard=%d\n",i);
+            break;
+        }
+    }
+    if ((decoder->nshard=i)<=0) {
+        free(decoder->shards);
+        decoder->shards=NULL;
+        return 0;
+    }
+    decoder->state=1;
+    log_trace(1,"rtcm decoder thread create ok: shards=%d\n",decoder->nshard);
     return 1;
 }
 
-static cors_rtcm_t* new_cors_rtcm(cors_rtcm_decoder_t *decoder, int srcid)
+static cors_rtcm_decoder_shard_t* rtcm_decoder_shard(cors_rtcm_decoder_t *decoder, int srcid)
+{
+    return decoder->shards+srcid%decoder->nshard;
+}
+
+static cors_rtcm_t* new_cors_rtcm(cors_rtcm_decoder_shard_t *shard, int srcid)
 {
     cors_rtcm_t *rtcm=(cors_rtcm_t*)calloc(1,sizeof(cors_rtcm_t));
     if (!rtcm) return NULL;
+    if (!cors_ring_init(&rtcm->ring,RTCM_RING_SIZE)) {
+        free(rtcm);
+        return NULL;
+    }
     init_rtcm(&rtcm->rtcm);
 
     rtcm->rtcm.srcid=srcid;
 
-    uv_mutex_lock(&decoder->tbl_lock);
-    HASH_ADD_INT(decoder->data_tbl,rtcm.srcid,rtcm);
-    uv_mutex_unlock(&decoder->tbl_lock);
+    uv_mutex_lock(&shard->tbl_lock);
+    HASH_ADD_INT(shard->data_tbl,rtcm.srcid,rtcm);
+    uv_mutex_unlock(&shard->tbl_lock);
     return rtcm;
 }
 
-static decode_rtcm_task_t* new_rtcm_decode_task(cors_rtcm_t *rtcm, cors_rtcm_decoder_t *decoder,
-                                                const uint8_t *data, int n)
-{
-    decode_rtcm_task_t *task=calloc(1,sizeof(*task));
-    task->data.rtcm=rtcm;
-    task->data.decoder=decoder;
-    task->data.buff=malloc(n*sizeof(char));
-    task->data.nb=n;
-    memcpy(task->data.buff,data,n);
-    return task;
-}
-
-static void add_rtcm_decode_task(cors_rtcm_t *rtcm, cors_rtcm_decoder_t *decoder,
+static void add_rtcm_decode_data(cors_rtcm_t *rtcm, cors_rtcm_decoder_shard_t *shard,
                                  const uint8_t *data, int n)
 {
-    uv_mutex_lock(&decoder->qlock);
-    decode_rtcm_task_t *task=new_rtcm_decode_task(rtcm,decoder,data,n);
-    QUEUE_INSERT_TAIL(&decoder->decode_queue,&task->q);
-    uv_mutex_unlock(&decoder->qlock);
+    uint64_t ndrop=rtcm->ring.ndrop;
+
+    cors_ring_write(&rtcm->ring,data,n);
+    if (rtcm->ring.ndrop>ndrop) {
+        log_trace(2,"rtcm decoder ring overflow: srcid=%d drop=%d bytes\n",rtcm->rtcm.srcid,
+                  (int)(rtcm->ring.ndrop-ndrop));
+        shard->ndrop+=rtcm->ring.ndrop-ndrop;
+    }
+    if (__atomic_exchange_n(&rtcm->queued,1,__ATOMIC_SEQ_CST)) return;
 
-    uv_async_send(decoder->decode);
+    uv_mutex_lock(&shard->qlock);
+    QUEUE_INSERT_TAIL(&shard->decode_queue,&rtcm->q);
+    if (++shard->nq>shard->nq_max) shard->nq_max=shard->nq;
+    uv_mutex_unlock(&shard->qlock);
+
+    uv_async_send(shard->decode);
 }
 
 extern int cors_rtcm_decode(cors_rtcm_decoder_t *decoder, const uint8_t *data, int n, int srcid)
 {
+    cors_rtcm_decoder_shard_t *shard;
     cors_rtcm_t *rtcm;
 
     if (!decoder->state) return 0;
-    if (uv_is_closing((uv_handle_t*)decoder->decode)) {
-        return 0;
-    }
     if (n<=0||srcid<0) return 0;
 
-    uv_mutex_lock(&decoder->tbl_lock);
-    HASH_FIND_INT(decoder->data_tbl,&srcid,rtcm);
-    uv_mutex_unlock(&decoder->tbl_lock);
+    shard=rtcm_decoder_shard(decoder,srcid);
+    if (!shard->state) return 0;
+    if (uv_is_closing((uv_handle_t*)shard->decode)) {
+        return 0;
+    }
+    uv_mutex_lock(&shard->tbl_lock);
+    HASH_FIND_INT(shard->data_tbl,&srcid,rtcm);
+    uv_mutex_unlock(&shard->tbl_lock);
 
     if (!rtcm) {
-        if (!(rtcm=new_cors_rtcm(decoder,srcid))) {
+        if (!(rtcm=new_cors_rtcm(shard,srcid))) {
             return 0;
         }
     }
-    add_rtcm_decode_task(rtcm,decoder,
+    add_rtcm_decode_data(rtcm,shard,
             data,n);
     return 1;
 }
-
@@ -258,16 +258,21 @@ extern int input_rtcm3(rtcm_t *rtcm, uint8_t data)
 
 static uint8_t* sync_frame(rtcm_t *rtcm, uint8_t *buf, int len, int *rlen)
 {
+    uint8_t *p;
     int i;
     if (rtcm->nbyte>=3) return buf;
 
     for (i=0;i<len;i++) {
-        (*rlen)--;
         if (rtcm->nbyte==0) {
-            if (buf[i]!=RTCM3PREAMB) continue;
-            rtcm->buff[rtcm->nbyte++]=buf[i];
-            continue;
+            /* fast scan for preamble */
+            if (!(p=memchr(buf+i,RTCM3PREAMB,len-i))) {
+                (*rlen)-=len-i;
+                return NULL;
+            }
+            (*rlen)-=(int)(p-buf)-i;
+            i=(int)(p-buf);
         }
+        (*rlen)--;
         rtcm->buff[rtcm->nbyte++]=buf[i];
         if (rtcm->nbyte==3) {
             rtcm->len=getbitu(rtcm->buff,14,10)+6;
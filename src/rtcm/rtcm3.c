@@ -2068,7 +2068,8 @@ static int decode_msm_head(rtcm_t *rtcm, int sys, int *sync, int *iod,
     msm_h_t h0={0};
     double tow,tod;
     char *msg,tstr[64];
-    int i=24,j,dow,mask,staid,type,ncell=0;
+    uint32_t mask;
+    int i=24,j,k,n,dow,staid,type,ncell=0;
 
     type=getbitu(rtcm->buff,i,12); i+=12;
 
@@ -2097,13 +2098,15 @@ static int decode_msm_head(rtcm_t *rtcm, int sys, int *sync, int *iod,
         h->clk_ext=getbitu(rtcm->buff,i, 2);       i+= 2;
         h->smooth =getbitu(rtcm->buff,i, 1);       i+= 1;
         h->tint_s =getbitu(rtcm->buff,i, 3);       i+= 3;
-        for (j=1;j<=64;j++) {
-            mask=getbitu(rtcm->buff,i,1); i+=1;
-            if (mask) h->sats[h->nsat++]=j;
+        for (j=0;j<2;j++) {
+            mask=getbitu(rtcm->buff,i,32); i+=32;
+            for (k=0;k<32;k++) {
+                if (mask&(0x80000000u>>k)) h->sats[h->nsat++]=j*32+k+1;
+            }
         }
-        for (j=1;j<=32;j++) {
-            mask=getbitu(rtcm->buff,i,1); i+=1;
-            if (mask) h->sigs[h->nsig++]=j;
+        mask=getbitu(rtcm->buff,i,32); i+=32;
+        for (k=0;k<32;k++) {
+            if (mask&(0x80000000u>>k)) h->sigs[h->nsig++]=k+1;
         }
     }
     else {
@@ -2123,9 +2126,13 @@ static int decode_msm_head(rtcm_t *rtcm, int sys, int *sync, int *iod,
               rtcm->len,h->nsat,h->nsig);
         return -1;
     }
-    for (j=0;j<h->nsat*h->nsig;j++) {
-        h->cellmask[j]=getbitu(rtcm->buff,i,1); i+=1;
-        if (h->cellmask[j]) ncell++;
+    for (j=0;j<h->nsat*h->nsig;j+=n) {
+        n=h->nsat*h->nsig-j<32?h->nsat*h->nsig-j:32;
+        mask=getbitu(rtcm->buff,i,n); i+=n;
+        for (k=0;k<n;k++) {
+            h->cellmask[j+k]=(mask>>(n-1-k))&1;
+            if (h->cellmask[j+k]) ncell++;
+        }
     }
     *hsize=i;
 
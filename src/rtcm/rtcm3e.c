@@ -1987,6 +1987,15 @@ static void gen_msm_sig(rtcm_t *rtcm, int sys, int nsat, int nsig, int ncell,
         }
     }
 }
+/* pack msm mask indices into word (first index to msb) ---------------------*/
+static uint32_t pack_msm_mask(const uint8_t *ind, int n)
+{
+    uint32_t mask=0;
+    int j;
+    
+    for (j=0;j<n;j++) mask=(mask<<1)|(ind[j]?1u:0u);
+    return mask;
+}
 /* encode MSM header ---------------------------------------------------------*/
 static int encode_msm_head(int type, rtcm_t *rtcm, int sys, int sync, int *nsat,
                            int *ncell, double *rrng, double *rrate,
@@ -1997,7 +2006,7 @@ static int encode_msm_head(int type, rtcm_t *rtcm, int sys, int sync, int *nsat,
     double tow;
     uint8_t sat_ind[64]={0},sig_ind[32]={0},cell_ind[32*64]={0};
     uint32_t dow,epoch;
-    int i=24,j,nsig=0;
+    int i=24,j,n,nsig=0;
     
     switch (sys) {
         case SYS_GPS: type+=1070; break;
@@ -2039,16 +2048,16 @@ static int encode_msm_head(int type, rtcm_t *rtcm, int sys, int sync, int *nsat,
     setbitu(rtcm->buff,i, 3,0          ); i+= 3; /* smoothing interval */
     
     /* satellite mask */
-    for (j=0;j<64;j++) {
-        setbitu(rtcm->buff,i,1,sat_ind[j]?1:0); i+=1;
+    for (j=0;j<64;j+=32) {
+        setbitu(rtcm->buff,i,32,pack_msm_mask(sat_ind+j,32)); i+=32;
     }
     /* signal mask */
-    for (j=0;j<32;j++) {
-        setbitu(rtcm->buff,i,1,sig_ind[j]?1:0); i+=1;
-    }
+    setbitu(rtcm->buff,i,32,pack_msm_mask(sig_ind,32)); i+=32;
+    
     /* cell mask */
-    for (j=0;j<*nsat*nsig&&j<64;j++) {
-        setbitu(rtcm->buff,i,1,cell_ind[j]?1:0); i+=1;
+    for (j=0;j<*nsat*nsig&&j<64;j+=n) {
+        n=MIN(*nsat*nsig,64)-j; if (n>32) n=32;
+        setbitu(rtcm->buff,i,n,pack_msm_mask(cell_ind+j,n)); i+=n;
     }
     /* generate msm satellite data fields */
     gen_msm_sat(rtcm,sys,*nsat,sat_ind,rrng,rrate,info);
@@ -15,34 +15,12 @@
 #define VRS_HIGH_RESOLUTION      1
 #define VRS_NEAREST_BL           0
 
-typedef struct upd_vrs_task {
-    obs_t mobs;
-    rtk_t *rtk;
-    int n,*dire;
-    cors_vrs_sta_t *vsta;
-    cors_vrs_t *vrs;
-    cors_master_sta_t msta;
-    QUEUE q;
-} upd_vrs_task_t;
-
 static int generate_vsta_id()
 {
     static int mID=0;
     return -(++mID);
 }
 
-static void set_thread_rt_priority()
-{
-#if WIN32
-    SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_TIME_CRITICAL);
-#else
-    struct sched_param param;
-    param.sched_priority=sched_get_priority_max(SCHED_FIFO);
-    sched_setscheduler(getpid(),SCHED_RR,&param);
-    pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
-#endif
-}
-
 static void read_vstas_file(cors_vrs_t *vrs, const char *file)
 {
     char buff[256],*p,*q,*val[16];
@@ -74,57 +52,15 @@ static void read_vstas_file(cors_vrs_t *vrs, const char *file)
         sta->pos[2]=atof(val[3]);
         sta->srcid=generate_vsta_id();
         sta->obs.data=calloc(MAXOBS,sizeof(obsd_t));
+        uv_mutex_init(&sta->lock);
         HASH_ADD_STR(stas->data,name,sta);
     }
     fclose(fp);
 }
 
-static int is_in_dtrig(const cors_dtrig_t *dtrig, const double *pos)
-{
-    double coord_p2x[3],coord_p2y[3],pc[3]={0};
-    double pos0[3],dr[3],e[3];
-    int i,j;
-
-    for (i=0;i<3;i++) {
-        for (j=0;j<3;j++) pc[i]+=dtrig->vt[j]->pos[i];
-        pc[i]/=3.0;
-    }
-    ecef2pos(pc,pos0);
-
-    for (i=0;i<3;i++) {
-        for (j=0;j<3;j++) dr[j]=dtrig->vt[i]->pos[j]-pc[j];
-        ecef2enu(pos0,dr,e);
-        coord_p2x[i]=e[0];
-        coord_p2y[i]=e[1];
-    }
-    for (i=0;i<3;i++) dr[i]=pos[i]-pc[i];
-    ecef2enu(pos0,dr,e);
-    return pnpoly(3,coord_p2x,coord_p2y,e[0],e[1]);
-}
-
 static cors_bsta_trig_t* find_bsta_trig(const cors_vrs_t *vrs, cors_vrs_sta_t *sta)
 {
-    cors_dtrig_net_t *dtrig_net=&vrs->nrtk->dtrig_net;
-    cors_dtrig_t *d,*t,*m=NULL;
-    double md=-1E9,pc[3],dr[3];
-    int i,j;
-
-    HASH_ITER(hh,dtrig_net->dtrigs,d,t) {
-        if (!is_in_dtrig(d,sta->pos)) continue;
-        sta->in_dtrig=1;
-        return d;
-    }
-    HASH_ITER(hh,dtrig_net->dtrigs,d,t) {
-        for (i=0;i<3;i++) {
-            for (pc[i]=0.0,j=0;j<3;j++) pc[i]+=d->vt[j]->pos[i];
-            pc[i]/=3.0;
-        }
-        for (i=0;i<3;i++) dr[i]=sta->pos[i]-pc[i];
-        if (md<0||norm(dr,3)<md) {
-            sta->in_dtrig=0; m=d;
-        }
-    }
-    return m;
+    return cors_dtrignet_locate(&vrs->nrtk->dtrig_net,sta->pos,&sta->in_dtrig);
 }
 
 static cors_master_sta_t* find_master_bsta(const cors_dtrig_t *dtrig, cors_vrs_sta_t *sta)
@@ -163,174 +99,220 @@ static void upd_vrs_stas(cors_vrs_t *vrs)
     }
 }
 
-static int upd_vrs_coef(const cors_vrs_sta_t *vsta, const cors_master_sta_t *msta, rtk_t *rtk, int n, const int *dire,
-                        int sat, int frq, double *c, double *Q)
+static gtime_t blsnap_time(const cors_blsnap_t *snap)
+{
+    gtime_t t0={0};
+    return snap?snap->sol.time:t0;
+}
+
+/* new correction model of master station epoch (baselines sorted by time) ---*/
+extern cors_vrs_model_t* cors_vrs_model_new(gtime_t time, const double *pos, const cors_blsnap_t **snap,
+                                            const int *dire, int n)
+{
+    cors_vrs_model_t *mod;
+    int i,j;
+
+    if (!(mod=calloc(1,sizeof(*mod)))) return NULL;
+    mod->snap=calloc(n>0?n:1,sizeof(cors_blsnap_t*));
+    mod->dire=imat(1,n>0?n:1);
+    mod->ref=1;
+    mod->time=time;
+    matcpy(mod->pos,pos,1,3);
+    uv_mutex_init(&mod->lock);
+
+    for (i=0;i<n;i++) {
+        for (j=mod->n;j>0&&timediff(blsnap_time(mod->snap[j-1]),blsnap_time(snap[i]))>0.0;j--) {
+            mod->snap[j]=mod->snap[j-1];
+            mod->dire[j]=mod->dire[j-1];
+        }
+        mod->snap[j]=cors_blsnap_ref(snap[i]);
+        mod->dire[j]=dire[i];
+        mod->n++;
+    }
+    return mod;
+}
+
+extern cors_vrs_model_t* cors_vrs_model_ref(cors_vrs_model_t *mod)
+{
+    if (mod) __atomic_add_fetch(&mod->ref,1,__ATOMIC_SEQ_CST);
+    return mod;
+}
+
+extern void cors_vrs_model_unref(cors_vrs_model_t *mod)
+{
+    int i;
+
+    if (!mod||__atomic_sub_fetch(&mod->ref,1,__ATOMIC_SEQ_CST)) return;
+    for (i=0;i<mod->n;i++) cors_blsnap_unref(mod->snap[i]);
+    uv_mutex_destroy(&mod->lock);
+    free(mod->snap); free(mod->dire);
+    free(mod);
+}
+
+/* fit correction plane of one satellite/frequency to baseline residuals -----*/
+static int fit_vrs_coef(const cors_vrs_model_t *mod, int sat, int frq, double *c)
 {
-    double *H,*v,*var,e[3],dr[3],pos[3],age=30.0;
-    int i,j,k,m,info;
+    const cors_blsnap_t **snap=mod->snap;
+    const cors_blsat_t *s,*s0;
+    double *H,*v,*var,Q[9],e[3],dr[3],pos[3],age=30.0;
+    int i,j,k,m,n=mod->n,info=-1;
 
-    memset(Q,0,sizeof(double)*9);
     memset(c,0,sizeof(double)*3);
 
-#if VRS_CHK_IN_DTRIG
-    if (!vsta->in_dtrig) return 0;
-#endif
     if (n<2) return 0;
-    ecef2pos(vsta->msta->pos,pos);
+    ecef2pos(mod->pos,pos);
+    s0=cors_blsnap_sat(snap[0],sat);
 
     H=mat(n+1,3); v=mat(n+1,1);
     var=mat(n+1,1);
 
     for (m=i=0;i<n;i++) {
-        if (fabs(timediff(msta->time,rtk[i].time))>age) continue;
-        if (!rtk[i].ssat[sat-1].vsat[frq]) continue;
-        if ( rtk[i].ssat[sat-1].slip[frq]) continue;
-        if ( rtk[i].ssat[sat-1].lflg[frq]) continue;
-        if ( rtk[i].ssat[sat-1].fix[frq]<2) continue;
-        if (rtk[i].ssat[sat-1].refsat[frq]!=rtk[0].ssat[sat-1].refsat[frq]) continue;
-        if (norm(rtk[i].bl,3)<=0.0) continue;
-        for (k=0;k<3;k++) dr[k]=dire[i]*rtk[i].bl[k];
+        if (!(s=cors_blsnap_sat(snap[i],sat))) continue;
+        if (fabs(timediff(mod->time,snap[i]->time))>age) continue;
+        if (!s->vsat[frq]) continue;
+        if ( s->slip[frq]) continue;
+        if ( s->lflg[frq]) continue;
+        if ( s->fix[frq]<2) continue;
+        if (s->refsat[frq]!=(s0?s0->refsat[frq]:0)) continue;
+        if (norm(snap[i]->bl,3)<=0.0) continue;
+        for (k=0;k<3;k++) dr[k]=mod->dire[i]*snap[i]->bl[k];
         ecef2enu(pos,dr,e);
         H[3*m+0]=e[0];
         H[3*m+1]=e[1];
         H[3*m+2]=e[2];
-        v[m]=dire[i]*rtk[i].ssat[sat-1].resc[frq];
+        v[m]=mod->dire[i]*s->resc[frq];
         var[m++]=1.0;
     }
-    if (m<=1) return 0;
-    if (m<3) {
-        H[3*m+0]=H[3*m+1]=0.0;
-        H[3*m+2]=1.0; v[m]=0.0; var[m++]=1E-6;
-    }
-    for (j=0;j<m;j++) {
-        v[j]/=sqrt(var[j]);
-        for (k=0;k<3;k++) H[k+j*3]/=sqrt(var[j]);
+    if (m>1) {
+        if (m<3) {
+            H[3*m+0]=H[3*m+1]=0.0;
+            H[3*m+2]=1.0; v[m]=0.0; var[m++]=1E-6;
+        }
+        for (j=0;j<m;j++) {
+            v[j]/=sqrt(var[j]);
+            for (k=0;k<3;k++) H[k+j*3]/=sqrt(var[j]);
+        }
+        info=lsq(H,v,3,m,c,Q);
     }
-    info=lsq(H,v,3,m,c,Q);
-    free(H); free(v); return !info;
+    free(H); free(v); free(var);
+    return !info;
 }
 
-static int generate_vrs_obs_sat(cors_vrs_t *vrs, const cors_vrs_sta_t *vsta, const cors_master_sta_t *msta, const double *coef,
-                                const double *Q, int f, const obsd_t *mobs, obsd_t *vobs)
+static double vrs_trop(gtime_t time, const double *pos, const double *azel)
 {
-    double corr,dr[3],e[3],frq;
-    double pm[3],pv[3],rm,rv,dtm,dtv,tropm,tropv,em[3],ev[3];
-    double zazel[2]={0.0,90.0*D2R},azelm[2],azelv[2];
-    const nav_t *nav=&vrs->cors->nav.data;
-    int i;
-
-    vobs->P[f]=vobs->L[f]=0.0;
-
-    if (!mobs->L[f]||!mobs->P[f]) return 0;
-    if (!(frq=sat2freq(vobs->sat,vobs->code[f],nav))) return 0;
-
-    ecef2pos(msta->pos,pm);
-    ecef2pos(vsta->pos,pv);
-    for (i=0;i<3;i++) dr[i]=vsta->pos[i]-msta->pos[i];
-    ecef2enu(pm,dr,e);
-
-    corr=dot(coef,e,3);
-    rm=satdis(msta->pos,vobs,nav,EPHOPT_BRDC,&dtm,em);
-    rv=satdis(vsta->pos,vobs,nav,EPHOPT_BRDC,&dtv,ev);
-    if (rm<=0.0||rv<=0.0) return 0;
-
-    satazel(pm,em,azelm);
-    satazel(pv,ev,azelv);
-
 #if VRS_TROP_MAPFUNC
-    tropm=tropmapf(vobs->time,pm,azelm,NULL)*tropmodel(vobs->time,pm,zazel,0.0);
-    tropv=tropmapf(vobs->time,pv,azelv,NULL)*tropmodel(vobs->time,pv,zazel,0.0);
+    double zazel[2]={0.0,90.0*D2R};
+    return tropmapf(time,pos,azel,NULL)*tropmodel(time,pos,zazel,0.0);
 #else
-    tropm=tropmodel(obs->time,posm,azelm,0.7);
-    tropv=tropmodel(obs->time,posv,azelv,0.7);
+    return tropmodel(time,pos,azel,0.7);
 #endif
-    if (tropm<=0.0||tropv<=0.0) return 0;
-
-    vobs->L[f]=mobs->L[f]+(rv-rm+tropv-tropm+(dtv-dtm)*CLIGHT+corr)/(CLIGHT/frq);
-    vobs->P[f]=mobs->P[f]+(rv-rm+tropv-tropm+(dtv-dtm)*CLIGHT+corr);
-
-    char tbuf[32];
-    time2str(vobs->time,tbuf,3);
-    log_trace(1,"vobs: time=%s sat=%4d f=%d el=%6.1lf corr=%6.3lf\n",tbuf,vobs->sat,
-            f,azelv[1]*R2D,corr);
-    return 1;
 }
 
-static int generate_vrs_obs_satf(cors_vrs_t *vrs, const cors_vrs_sta_t *vsta, const cors_master_sta_t *msta, rtk_t *rtk,
-                                 int n, const obsd_t *mobs, const int *dire, obsd_t *vobs)
+/* fit model once for all satellites of master epoch (shared by vrs) ---------*/
+extern int cors_vrs_model_fit(cors_vrs_model_t *mod, const nav_t *nav, const obs_t *mobs)
 {
-    double coef[3],Q[9];
-    int f,flag;
-
-    *vobs=*mobs;
-
-    for (flag=f=0;f<NFREQ;f++) {
-        if (upd_vrs_coef(vsta,msta,rtk,n,dire,vobs->sat,f,coef,Q)<0) continue;
-        flag|=generate_vrs_obs_sat(vrs,vsta,msta,coef,Q,f,mobs,vobs);
+    cors_vrs_coef_t *coef;
+    double pos[3],e[3],azel[2];
+    int i,f;
+
+    uv_mutex_lock(&mod->lock);
+    if (!mod->stat) {
+        ecef2pos(mod->pos,pos);
+
+        for (i=0;i<mobs->n&&i<MAXOBS;i++) {
+            coef=mod->coef+i;
+            coef->sat=mobs->data[i].sat;
+            coef->trop=0.0;
+            if ((coef->r=satdis(mod->pos,mobs->data+i,nav,EPHOPT_BRDC,&coef->dts,e))>0.0) {
+                satazel(pos,e,azel);
+                coef->trop=vrs_trop(mobs->data[i].time,pos,azel);
+            }
+            for (f=0;f<NFREQ;f++) coef->stat[f]=fit_vrs_coef(mod,coef->sat,f,coef->c[f]);
+        }
+        mod->nc=i;
+        mod->stat=1;
     }
-    return flag;
+    uv_mutex_unlock(&mod->lock);
+    return mod->nc;
 }
 
-static int generate_vrs_obs(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const cors_master_sta_t *msta,
-                            const obs_t *mobs, const int *dire, rtk_t *rtk, int n)
+/* evaluate fitted model at vrs position (corr=0: geometry only) -------------*/
+extern int cors_vrs_model_obs(const cors_vrs_model_t *mod, const nav_t *nav, const double *vpos, int corr,
+                              const obs_t *mobs, obsd_t *vobs)
 {
-    double coef[3],Q[9];
-    int i,f,flag;
-
-    vsta->obs.n=0;
-
-    for (i=0;i<mobs->n;i++) {
-        if (generate_vrs_obs_satf(vrs,vsta,msta,rtk,n,&mobs->data[i],dire,
-                &vsta->obs.data[vsta->obs.n])<=0) continue;
-        vsta->obs.n++;
+    const cors_vrs_coef_t *coef;
+    const obsd_t *m;
+    double pm[3],pv[3],dr[3],enu[3],e[3],azel[2],rv,dtv,tropv,dd,c,frq;
+    char tbuf[32];
+    int i,f,n,flag;
+
+    ecef2pos(mod->pos,pm);
+    ecef2pos(vpos,pv);
+    for (i=0;i<3;i++) dr[i]=vpos[i]-mod->pos[i];
+    ecef2enu(pm,dr,enu);
+
+    for (i=n=0;i<mobs->n&&i<mod->nc;i++) {
+        m=mobs->data+i;
+        coef=mod->coef+i;
+        if (coef->sat!=m->sat||coef->r<=0.0||coef->trop<=0.0) continue;
+        if ((rv=satdis(vpos,m,nav,EPHOPT_BRDC,&dtv,e))<=0.0) continue;
+        satazel(pv,e,azel);
+        if ((tropv=vrs_trop(m->time,pv,azel))<=0.0) continue;
+
+        dd=rv-coef->r+tropv-coef->trop+(dtv-coef->dts)*CLIGHT;
+        vobs[n]=*m;
+        time2str(m->time,tbuf,3);
+
+        for (flag=f=0;f<NFREQ;f++) {
+            vobs[n].P[f]=vobs[n].L[f]=0.0;
+            if (!m->L[f]||!m->P[f]) continue;
+            if (!(frq=sat2freq(m->sat,m->code[f],nav))) continue;
+
+            c=corr?dot(coef->c[f],enu,3):0.0;
+            vobs[n].L[f]=m->L[f]+(dd+c)/(CLIGHT/frq);
+            vobs[n].P[f]=m->P[f]+dd+c;
+            flag=1;
+
+            log_trace(1,"vobs: time=%s sat=%4d f=%d el=%6.1lf corr=%6.3lf\n",tbuf,m->sat,
+                    f,azel[1]*R2D,c);
+        }
+        if (flag) n++;
     }
-    return vsta->obs.n;
+    return n;
 }
 
-static int cmprtk(const void *p1, const void *p2)
+static void upd_vrs_obs(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const obs_t *mobs, cors_vrs_model_t *mod)
 {
-    rtk_t *q1=(rtk_t*)p1;
-    rtk_t *q2=(rtk_t*)p2;
-    return (timediff(q1->sol.time,q2->sol.time)<0.0)?-1:1;
-}
+    const nav_t *nav=&vrs->cors->nav.data;
+    int corr=1;
 
-static void upd_vrs_obs(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const cors_master_sta_t *msta, const obs_t *mobs,
-                        const int *dire, rtk_t *rtk, int n)
-{
-    qsort(rtk,n,sizeof(rtk_t),cmprtk);
-    generate_vrs_obs(vrs,vsta,msta,mobs,dire,rtk,n);
+    cors_vrs_model_fit(mod,nav,mobs);
+#if VRS_CHK_IN_DTRIG
+    corr=vsta->in_dtrig;
+#endif
+    vsta->obs.n=cors_vrs_model_obs(mod,nav,vsta->pos,corr,mobs,vsta->obs.data);
 
     cors_updobs(&vrs->cors->obs,
             vsta->obs.data,vsta->obs.n,vsta->srcid);
 }
 
-static upd_vrs_task_t* new_upd_vrs_task(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const cors_master_sta_t *msta,
-                                        const obs_t *mobs, const int *dire, const rtk_t **rtk, int n)
+static void add_upd_vrs_task(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const obs_t *mobs, cors_vrs_model_t *mod)
 {
-    upd_vrs_task_t *task;
-    int i;
+    cors_vrs_task_t *task;
 
     task=calloc(1,sizeof(*task));
-    task->rtk=calloc(n,sizeof(rtk_t));
-    task->msta=*msta;
     task->mobs.data=calloc(mobs->n,sizeof(obsd_t));
     task->mobs.n=mobs->n;
     task->vrs=vrs;
-    task->dire=imat(1,n);
-    task->n=n;
     task->vsta=vsta;
-
-    memcpy(task->dire,dire,sizeof(int)*n);
+    task->mod=mod;
     memcpy(task->mobs.data,mobs->data,sizeof(obsd_t)*mobs->n);
-    for (i=0;i<n;i++) {
-        if (!rtk[i]) continue;
-        task->rtk[i]=*rtk[i];
-    }
-    return task;
+
+    cors_vrspool_push(&vrs->pool,task);
 }
 
-static const rtk_t* vrs_near_bl(const cors_master_sta_t *msta, const cors_vrs_sta_t *vsta,
-                                   const rtk_t **rtk, int n, int dire)
+static const cors_blsnap_t* vrs_near_bl(const cors_master_sta_t *msta, const cors_vrs_sta_t *vsta,
+                                        const cors_blsnap_t **snap, int n, int dire)
 {
     int i,j=-1;
     double dr[3],pos[3],e[3],hv,hm,dh,dp=1E6;
@@ -341,94 +323,102 @@ static const rtk_t* vrs_near_bl(const cors_master_sta_t *msta, const cors_vrs_st
     hv=atan2(e[0],e[1]);
 
     for (i=0;i<n;i++) {
-        if (!rtk[i]) continue;
-        if (norm(rtk[i]->bl,3)<=0.0) continue;
-        ecef2enu(pos,rtk[i]->bl,e);
+        if (!snap[i]) continue;
+        if (norm(snap[i]->bl,3)<=0.0) continue;
+        ecef2enu(pos,snap[i]->bl,e);
         hm=atan2(e[0],e[1]);
 
         if ((dh=dire*(hm-hv))<0.0) dh+=2.0*PI;
         if (j<0||dh<dp) j=i,dp=dh;
     }
-    return j<0?NULL:rtk[j];
+    return j<0?NULL:snap[j];
 }
 
 static int vrs_upd_dtrig(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const cors_master_sta_t *msta, const obs_t *mobs,
-                         const rtk_t **rtk, int n)
+                         const cors_blsnap_t **snap, int n)
 {
     cors_dtrig_edge_q_t *q,*t;
     cors_dtrig_edge_t *e;
-    const rtk_t *rtks[64],*rtkp;
+    cors_vrs_model_t *mod;
+    const cors_blsnap_t *snaps[64],*snapp;
     int i,j,k,m=0,dire[64]={0};
 
 #if VRS_NEAREST_BL
-    if (!(rtkp=vrs_near_bl(msta,vsta,rtk,n, 1))) rtks[m++]=rtkp;
-    if (!(rtkp=vrs_near_bl(msta,vsta,rtk,n,-1))) rtks[m++]=rtkp;
+    if (!(snapp=vrs_near_bl(msta,vsta,snap,n, 1))) snaps[m++]=snapp;
+    if (!(snapp=vrs_near_bl(msta,vsta,snap,n,-1))) snaps[m++]=snapp;
 #else
     for (j=-1,i=0;i<3;i++) {
         if (msta==vsta->trig->vt[i]) {j=i; break;}
     }
     if (j<0) return -1;
 
+    /* model of the master epoch is shared by all vrs of the triangle */
+    if ((mod=vsta->trig->vmod[j])&&fabs(timediff(mod->time,mobs->data[0].time))<1E-3) {
+        add_upd_vrs_task(vrs,vsta,mobs,cors_vrs_model_ref(mod));
+        return 1;
+    }
     for (i=m=0;i<2;i++) {
         e=vsta->trig->edge_f[j][i];
         k=0;
         HASH_ITER(hh,msta->edge_list,q,t) {
             if (q->edge!=e) {k++; continue;}
+            if (!q->edge->bl) break; /* baseline not linked yet */
             if (strcmp(q->edge->id,q->edge->bl->id)) dire[m]=-1;
             else dire[m]=1;
-            rtks[m++]=rtk[k++]; break;
+            snaps[m++]=snap[k++]; break;
         }
     }
-    if (m<2) {
-        m=0;
-        if (!(rtkp=vrs_near_bl(msta,vsta,rtk,n, 1))) rtks[m++]=rtkp;
-        if (!(rtkp=vrs_near_bl(msta,vsta,rtk,n,-1))) rtks[m++]=rtkp;
+    if (m>=2) {
+        if (!(mod=cors_vrs_model_new(mobs->data[0].time,msta->pos,snaps,dire,m))) return -1;
+        cors_vrs_model_unref(vsta->trig->vmod[j]);
+        vsta->trig->vmod[j]=mod;
+        add_upd_vrs_task(vrs,vsta,mobs,cors_vrs_model_ref(mod));
+        return 1;
     }
+    m=0;
+    if (!(snapp=vrs_near_bl(msta,vsta,snap,n, 1))) snaps[m++]=snapp;
+    if (!(snapp=vrs_near_bl(msta,vsta,snap,n,-1))) snaps[m++]=snapp;
 #endif
     if (m<=0) return -1;
 
-    uv_mutex_lock(&vrs->upd_vrs_lock);
-    upd_vrs_task_t *task=new_upd_vrs_task(vrs,vsta,msta,mobs,dire,rtks,m);
-    QUEUE_INSERT_TAIL(&vrs->upd_vrs_queue,&task->q);
-    uv_mutex_unlock(&vrs->upd_vrs_lock);
-
-    uv_async_send(vrs->upd_vrs);
+    /* baselines selected by vrs position, model is not shared */
+    if (!(mod=cors_vrs_model_new(mobs->data[0].time,msta->pos,snaps,dire,m))) return -1;
+    add_upd_vrs_task(vrs,vsta,mobs,mod);
+    return 1;
 }
 
 static int vrs_upd_subnet(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const cors_master_sta_t *msta, const obs_t *mobs,
-                          const rtk_t **rtk, int n)
+                          const cors_blsnap_t **snap, int n)
 {
     cors_dtrig_edge_q_t *q,*t;
-    const rtk_t *rtks[64];
+    cors_vrs_model_t *mod;
+    const cors_blsnap_t *snaps[64];
     int i,j,m,dire[64]={0};
 
     HASH_ITER(hh,msta->edge_list,q,t) {
-        if (!rtk[i]) {i++; continue;}
+        if (!snap[i]) {i++; continue;}
         if (strcmp(q->edge->id,q->edge->bl->id)) dire[m]=-1;
         else dire[m]=1;
-        rtks[m++]=rtk[i++];
+        snaps[m++]=snap[i++];
     }
     for (i=m=0;i<n;i++) {
-        if (rtk[i]) rtks[m++]=rtk[i];
+        if (snap[i]) snaps[m++]=snap[i];
     }
     if (m<=0) {
         return -1;
     }
-    uv_mutex_lock(&vrs->upd_vrs_lock);
-    upd_vrs_task_t *task=new_upd_vrs_task(vrs,vsta,msta,mobs,dire,rtks,m);
-    QUEUE_INSERT_TAIL(&vrs->upd_vrs_queue,&task->q);
-    uv_mutex_unlock(&vrs->upd_vrs_lock);
-
-    uv_async_send(vrs->upd_vrs);
+    if (!(mod=cors_vrs_model_new(mobs->data[0].time,msta->pos,snaps,dire,m))) return -1;
+    add_upd_vrs_task(vrs,vsta,mobs,mod);
+    return 1;
 }
 
 extern int cors_vrs_upd(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, const cors_master_sta_t *msta, const obs_t *mobs,
-                        const rtk_t **rtk, int n)
+                        const cors_blsnap_t **snap, int n)
 {
 #if VRS_UPD_DTRIG
-    return vrs_upd_dtrig(vrs,vsta,msta,mobs,rtk,n);
+    return vrs_upd_dtrig(vrs,vsta,msta,mobs,snap,n);
 #else
-    return vrs_upd_subnet(vrs,vsta,msta,mobs,rtk,n);
+    return vrs_upd_subnet(vrs,vsta,msta,mobs,snap,n);
 #endif
 }
 
@@ -466,36 +456,24 @@ static void out_vrs_obsrtcm(cors_vrs_t *vrs, cors_vrs_sta_t *vsta)
     nav_t *nav=&vrs->cors->nav.data;
 
     if ((nb=rtcm_encode_obs(&vsta->rtcm,type,5,nav,vsta->obs.data,vsta->obs.n,buff))) {
-        cors_ntrip_agent_send(agent,vsta->name,buff,nb,nav);
+        cors_ntrip_agent_send(agent,vsta->name,buff,nb);
     }
 }
 
-static void do_upd_vrs_work(upd_vrs_task_t *task)
+/* generate and send vrs observations of station epoch (vrs worker) --------*/
+extern void cors_vrs_work(cors_vrs_task_t *task)
 {
-    upd_vrs_obs(task->vrs,task->vsta,&task->msta,&task->mobs,task->dire,task->rtk,task->n);
+    upd_vrs_obs(task->vrs,task->vsta,&task->mobs,task->mod);
 
-#if VRS_OUT_OBSRNX
-    out_vrs_obsrnx(task->vrs,task->vsta);
-#endif
+    if (task->vrs->outrnx&&!task->vsta->ondemand) out_vrs_obsrnx(task->vrs,task->vsta);
     out_vrs_obsrtcm(task->vrs,task->vsta);
-
-    freeobs(&task->mobs);
-    free(task->rtk); free(task);
 }
 
-static void upd_vrs_process(uv_async_t* handle)
+extern void cors_vrs_free_task(cors_vrs_task_t *task)
 {
-    cors_vrs_t *vrs=handle->data;
-
-    while (!QUEUE_EMPTY(&vrs->upd_vrs_queue)) {
-        uv_mutex_lock(&vrs->upd_vrs_lock);
-
-        QUEUE *q=QUEUE_HEAD(&vrs->upd_vrs_queue);
-        upd_vrs_task_t *task=QUEUE_DATA(q,upd_vrs_task_t,q);
-        QUEUE_REMOVE(q);
-        uv_mutex_unlock(&vrs->upd_vrs_lock);
-        do_upd_vrs_work(task);
-    }
+    freeobs(&task->mobs);
+    cors_vrs_model_unref(task->mod);
+    free(task);
 }
 
 static void vrs_blsol_vsta(cors_vrs_t *vrs, const cors_vrs_sta_t *vsta)
@@ -504,26 +482,21 @@ static void vrs_blsol_vsta(cors_vrs_t *vrs, const cors_vrs_sta_t *vsta)
     cors_srtk_t *srtk=&vrs->cors->srtk;
     int i;
 
+    if (!vsta->trig) return;
+
     for (i=0;i<3;i++) {
         if (!(vt=vsta->trig->vt[i])) continue;
         cors_srtk_add_baseline(srtk,vt->srcid,vsta->srcid);
     }
 }
 
-static void close_cb(uv_async_t* handle)
-{
-    if (uv_loop_alive(handle->loop)) {
-        uv_stop(handle->loop);
-    }
-}
-
 static void init_vrs(cors_vrs_t *vrs, cors_t *cors, cors_nrtk_t *nrtk, const char *vfile)
 {
-    QUEUE_INIT(&vrs->upd_vrs_queue);
-    uv_mutex_init(&vrs->upd_vrs_lock);
-
+    vrs->outrnx=VRS_OUT_OBSRNX;
     vrs->cors=cors;
     vrs->nrtk=nrtk;
+    vrs->dsta_kdtree=kd_create(3);
+    uv_mutex_init(&vrs->dlock);
     read_vstas_file(vrs,vfile);
     upd_vrs_stas(vrs);
 
@@ -544,42 +517,41 @@ static void init_vrs(cors_vrs_t *vrs, cors_t *cors, cors_nrtk_t *nrtk, const cha
 #endif
 }
 
-static void vrs_thread(void *vrs_arg)
-{
-    cors_vrs_t *vrs=vrs_arg;
-    uv_loop_t *loop=uv_loop_new();
-
-    vrs->upd_vrs=calloc(1,sizeof(uv_async_t));
-    vrs->upd_vrs->data=vrs;
-    uv_async_init(loop,vrs->upd_vrs,upd_vrs_process);
-
-    vrs->close=calloc(1,sizeof(uv_async_t));
-    uv_async_init(loop,vrs->close,close_cb);
-
-    vrs->state=1;
-    uv_run(loop,UV_RUN_DEFAULT);
-
-    close_uv_loop(loop);
-    free(loop);
-}
-
 extern int cors_vrs_start(cors_vrs_t *vrs, cors_t *cors, cors_nrtk_t *nrtk, const char *vfile)
 {
     init_vrs(vrs,cors,nrtk,vfile);
 
-    if (uv_thread_create(&vrs->thread,vrs_thread,vrs)) {
-        log_trace(1,"vrs thread create fail\n");
+    if (!cors_vrspool_start(&vrs->pool,cors->opt.vrs_workers,cors->opt.vrs_deadline)) {
+        log_trace(1,"vrs worker pool create fail\n");
         return 0;
     }
-    log_trace(1,"vrs thread create ok\n");
+    vrs->state=1;
     return 1;
 }
 
 extern void cors_vrs_close(cors_vrs_t *vrs)
 {
+    cors_vrs_dsta_t *d,*dt;
+
+    /* lock is kept, agent may still attach rovers until it is closed */
+    uv_mutex_lock(&vrs->dlock);
     vrs->state=0;
-    uv_async_send(vrs->close);
-    uv_thread_join(&vrs->thread);
+    for (d=vrs->dadd;d;d=dt) {
+        dt=d->next; if (d->stat==2) free(d);
+    }
+    for (d=vrs->ddel;d;d=dt) {
+        dt=d->next; free(d);
+    }
+    HASH_ITER(hh,vrs->dstas,d,dt) {
+        HASH_DEL(vrs->dstas,d); free(d);
+    }
+    vrs->dadd=vrs->ddel=NULL;
+    __atomic_store_n(&vrs->ndsta,0,__ATOMIC_SEQ_CST);
+    if (vrs->dsta_kdtree) kd_free(vrs->dsta_kdtree);
+    vrs->dsta_kdtree=NULL;
+    uv_mutex_unlock(&vrs->dlock);
+
+    cors_vrspool_close(&vrs->pool);
     vrs->cors=NULL;
     vrs->nrtk=NULL;
 
@@ -587,12 +559,13 @@ extern void cors_vrs_close(cors_vrs_t *vrs)
     HASH_ITER(hh,vrs->stas.data,s,t) {
         freeobs(&s->obs);
         if (s->fp_rnx) fclose(s->fp_rnx);
+        uv_mutex_destroy(&s->lock);
         HASH_DEL(vrs->stas.data,s);
         free(s);
     }
 }
 
-extern int vrs_add_vsta(cors_vrs_t *vrs, const char *name, const double *pos)
+static int add_vsta(cors_vrs_t *vrs, const char *name, const double *pos, int ondemand)
 {
     cors_ntrip_source_info_t *info;
     cors_vrs_sta_t *sta;
@@ -606,7 +579,9 @@ extern int vrs_add_vsta(cors_vrs_t *vrs, const char *name, const double *pos)
     strcpy(sta->name,name);
     matcpy(sta->pos,pos,1,3);
     sta->srcid=generate_vsta_id();
+    sta->ondemand=ondemand;
     sta->obs.data=calloc(MAXOBS,sizeof(obsd_t));
+    uv_mutex_init(&sta->lock);
 
     sta->trig=find_bsta_trig(vrs,sta);
     sta->msta=find_master_bsta(sta->trig,sta);
@@ -623,9 +598,15 @@ extern int vrs_add_vsta(cors_vrs_t *vrs, const char *name, const double *pos)
     return 1;
 }
 
+extern int vrs_add_vsta(cors_vrs_t *vrs, const char *name, const double *pos)
+{
+    return add_vsta(vrs,name,pos,0);
+}
+
 extern int vrs_del_vsta(cors_vrs_t *vrs, const char *name)
 {
     cors_t *cors=vrs->cors;
+    cors_dtrig_vertex_t *v,*vt;
     cors_vrs_sta_q_t *vq;
     cors_vrs_sta_t *vsta;
 
@@ -633,20 +614,24 @@ extern int vrs_del_vsta(cors_vrs_t *vrs, const char *name)
     if (!vsta) return 0;
 
 #if VRS_BLSOL_VSTA
-    cors_dtrig_vertex_t *vt;
     cors_srtk_t *srtk=&vrs->cors->srtk;
     int i;
 
-    for (i=0;i<3;i++) {
-        if (!(vt=vsta->trig->vt[i])) continue;
-        cors_srtk_del_baseline(srtk,vt->srcid,vsta->srcid);
+    for (i=0;i<3&&vsta->trig;i++) {
+        if (!(v=vsta->trig->vt[i])) continue;
+        cors_srtk_del_baseline(srtk,v->srcid,vsta->srcid);
     }
 #endif
-    HASH_FIND_PTR(vsta->msta->vsta_list,&vsta,vq);
-    if (vq) {HASH_DEL(vsta->msta->vsta_list,vq); free(vq);}
+    /* station may be left in lists of former master stations */
+    HASH_ITER(hh,vrs->nrtk->dtrig_net.vertexs,v,vt) {
+        HASH_FIND_PTR(v->vsta_list,&vsta,vq);
+        if (vq) {HASH_DEL(v->vsta_list,vq); free(vq);}
+    }
     HASH_DEL(vrs->stas.data,vsta);
+    cors_vrspool_cancel(&vrs->pool,vsta);
     freeobs(&vsta->obs);
     if (vsta->fp_rnx) fclose(vsta->fp_rnx);
+    uv_mutex_destroy(&vsta->lock);
 
     cors_ntrip_del_source(&cors->ntrip,name);
     free(vsta); return 1;
@@ -656,3 +641,201 @@ extern void vrs_upd_vsta(cors_vrs_t *vrs)
 {
     return upd_vrs_stas(vrs);
 }
+
+/* rebuild kd-tree of on-demand stations ------------------------------------*/
+static void upd_dsta_kdtree(cors_vrs_t *vrs)
+{
+    cors_vrs_dsta_t *d,*t;
+
+    kd_clear(vrs->dsta_kdtree);
+    HASH_ITER(hh,vrs->dstas,d,t) kd_insert(vrs->dsta_kdtree,d->pos,d);
+}
+
+static double dsta_dist(const cors_vrs_dsta_t *d, const double *pos)
+{
+    double dr[3];
+    int i;
+
+    for (i=0;i<3;i++) dr[i]=pos[i]-d->pos[i];
+    return norm(dr,3);
+}
+
+static cors_vrs_dsta_t* near_dsta(const cors_vrs_t *vrs, const double *pos, double radius)
+{
+    cors_vrs_dsta_t *d=NULL;
+    struct kdres *res;
+
+    if (!(res=kd_nearest(vrs->dsta_kdtree,pos))) return NULL;
+    if (!kd_res_end(res)) d=kd_res_item_data(res);
+    kd_res_free(res);
+    return d&&dsta_dist(d,pos)<=radius?d:NULL;
+}
+
+/* least recently used station, stations without rovers first ----------------*/
+static cors_vrs_dsta_t* lru_dsta(const cors_vrs_t *vrs)
+{
+    cors_vrs_dsta_t *d,*t,*p=NULL;
+
+    HASH_ITER(hh,vrs->dstas,d,t) {
+        if (!p||(!d->nuser&&p->nuser)||
+            (!d->nuser==!p->nuser&&timediff(d->tu,p->tu)<0.0)) p=d;
+    }
+    return p;
+}
+
+/* evict station, it is deleted by nrtk thread if it has been created --------*/
+static void del_dsta(cors_vrs_t *vrs, cors_vrs_dsta_t *d)
+{
+    log_trace(2,"evict on-demand vrs: name=%s users=%d\n",d->name,d->nuser);
+
+    HASH_DEL(vrs->dstas,d);
+    if (d->stat==1) {
+        d->next=vrs->ddel;
+        vrs->ddel=d;
+    }
+    d->stat=2;
+}
+
+static cors_vrs_dsta_t* new_dsta(cors_vrs_t *vrs, const double *pos)
+{
+    cors_vrs_dsta_t *d;
+    int maxsta=vrs->cors->opt.vrs_maxsta;
+
+    if (maxsta>0&&HASH_COUNT(vrs->dstas)>=(unsigned int)maxsta) {
+        del_dsta(vrs,lru_dsta(vrs));
+        upd_dsta_kdtree(vrs);
+    }
+    if (!(d=calloc(1,sizeof(*d)))) return NULL;
+    __atomic_add_fetch(&vrs->ndsta,1,__ATOMIC_SEQ_CST);
+    sprintf(d->name,"DVRS%06d",++vrs->dseq);
+    matcpy(d->pos,pos,1,3);
+    HASH_ADD_STR(vrs->dstas,name,d);
+    kd_insert(vrs->dsta_kdtree,d->pos,d);
+    d->next=vrs->dadd;
+    vrs->dadd=d;
+
+    log_trace(2,"new on-demand vrs: name=%s pos=%.3f %.3f %.3f\n",d->name,pos[0],pos[1],pos[2]);
+    return d;
+}
+
+/* attach rover to on-demand vrs -----------------------------------------------
+* share the nearest on-demand station within radius or create a new one
+* args   : cors_vrs_t *vrs      IO  vrs
+*          double     *pos      I   rover position {x,y,z} (ecef) (m)
+*          char       *cur      I   current station of rover ("":none)
+*          char       *name     O   station of rover
+* return : status (1:station changed,0:unchanged,-1:error)
+* notes  : stations are created and deleted by cors_vrs_ondemand(), at the
+*          capacity limit the least recently used station is evicted first
+*-----------------------------------------------------------------------------*/
+extern int cors_vrs_attach(cors_vrs_t *vrs, const double *pos, const char *cur, char *name)
+{
+    cors_vrs_dsta_t *d,*c;
+    double radius;
+
+    if (norm(pos,3)<=0.0) return -1;
+
+    uv_mutex_lock(&vrs->dlock);
+    if (!vrs->state||(radius=vrs->cors->opt.vrs_radius)<=0.0) {
+        uv_mutex_unlock(&vrs->dlock);
+        return -1;
+    }
+    HASH_FIND_STR(vrs->dstas,cur,c);
+    if (c&&dsta_dist(c,pos)<=radius) {
+        c->tu=timeget();
+        uv_mutex_unlock(&vrs->dlock);
+        return 0;
+    }
+    if (c) {
+        c->nuser--;
+        c->tu=timeget();
+    }
+    if (!(d=near_dsta(vrs,pos,radius))&&!(d=new_dsta(vrs,pos))) {
+        uv_mutex_unlock(&vrs->dlock);
+        return -1;
+    }
+    d->nuser++;
+    d->tu=timeget();
+    strcpy(name,d->name);
+    uv_mutex_unlock(&vrs->dlock);
+    return 1;
+}
+
+/* detach rover from on-demand vrs -------------------------------------------*/
+extern void cors_vrs_detach(cors_vrs_t *vrs, const char *name)
+{
+    cors_vrs_dsta_t *d;
+
+    uv_mutex_lock(&vrs->dlock);
+    HASH_FIND_STR(vrs->dstas,name,d);
+    if (d&&d->nuser>0) {
+        d->nuser--;
+        d->tu=timeget();
+    }
+    uv_mutex_unlock(&vrs->dlock);
+}
+
+/* evict on-demand stations without rovers longer than idle timeout ----------*/
+extern int cors_vrs_evict(cors_vrs_t *vrs)
+{
+    cors_vrs_dsta_t *d,*t;
+    gtime_t now=timeget();
+    int n=0,idle;
+
+    uv_mutex_lock(&vrs->dlock);
+    if (vrs->state&&(idle=vrs->cors->opt.vrs_idle)>0) {
+        HASH_ITER(hh,vrs->dstas,d,t) {
+            if (d->nuser>0||timediff(now,d->tu)<=idle) continue;
+            del_dsta(vrs,d); n++;
+        }
+        if (n) upd_dsta_kdtree(vrs);
+    }
+    uv_mutex_unlock(&vrs->dlock);
+    return n;
+}
+
+/* create and delete pending on-demand stations (nrtk thread) ----------------*/
+extern void cors_vrs_ondemand(cors_vrs_t *vrs)
+{
+    cors_vrs_dsta_t *d,*t,*add,*del;
+    gtime_t now;
+    char (*name)[32]=NULL;
+    double *pos=NULL;
+    int i,n=0,nfree=0;
+
+    if (!vrs->state||vrs->cors->opt.vrs_radius<=0.0) return;
+
+    now=timeget();
+    if (timediff(now,vrs->tevict)>=1.0) {
+        cors_vrs_evict(vrs);
+        vrs->tevict=now;
+    }
+    if (!__atomic_load_n(&vrs->dadd,__ATOMIC_SEQ_CST)&&
+        !__atomic_load_n(&vrs->ddel,__ATOMIC_SEQ_CST)) return;
+
+    uv_mutex_lock(&vrs->dlock);
+    add=vrs->dadd; vrs->dadd=NULL;
+    del=vrs->ddel; vrs->ddel=NULL;
+    for (d=add;d;d=d->next) n++;
+    if (n) {
+        name=calloc(n,sizeof(*name));
+        pos=mat(3,n);
+    }
+    for (d=add,n=0;d;d=t) {
+        t=d->next;
+        if (d->stat==2) {free(d); nfree++; continue;} /* evicted before created */
+        d->stat=1;
+        strcpy(name[n],d->name);
+        matcpy(pos+3*n++,d->pos,1,3);
+    }
+    uv_mutex_unlock(&vrs->dlock);
+
+    for (i=0;i<n;i++) add_vsta(vrs,name[i],pos+3*i,1);
+    for (d=del;d;d=t) {
+        t=d->next;
+        vrs_del_vsta(vrs,d->name);
+        free(d); nfree++;
+    }
+    if (nfree) __atomic_sub_fetch(&vrs->ndsta,nfree,__ATOMIC_SEQ_CST);
+    free(name); free(pos);
+}
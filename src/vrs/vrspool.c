@@ -0,0 +1,227 @@
+/*------------------------------------------------------------------------------
+ * vrspool.c : virtual reference station worker pool for CORS
+ *
+ * author  : sujinglan
+ * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
+ * history : 2022/11/17 1.0  new
+ *-----------------------------------------------------------------------------*/
+#include "cors.h"
+
+#define MAX_VRS_WORKERS   64
+#define LATENCY_RES       100000  /* latency histogram resolution (ns) */
+
+static void push_vsta(cors_vrspool_t *pool, cors_vrs_sta_t *vsta)
+{
+    uv_mutex_lock(&pool->lock);
+    QUEUE_INSERT_TAIL(&pool->queue,&vsta->q);
+    uv_cond_signal(&pool->cond);
+    uv_mutex_unlock(&pool->lock);
+}
+
+/* run latest epoch of station, drop it if deadline is passed ----------------*/
+static void run_vsta(cors_vrspool_t *pool, cors_vrs_sta_t *vsta)
+{
+    cors_vrs_task_t *task;
+    uint64_t dt;
+    int late=0,more;
+
+    uv_mutex_lock(&vsta->lock);
+    task=vsta->task;
+    vsta->task=NULL;
+    uv_mutex_unlock(&vsta->lock);
+
+    if (task) {
+        if (!(late=pool->deadline&&uv_hrtime()-task->tq>pool->deadline)) {
+            cors_vrs_work(task);
+        }
+        dt=(uv_hrtime()-task->tq)/LATENCY_RES;
+
+        uv_mutex_lock(&pool->lock);
+        if (late) pool->nlate++;
+        else {
+            pool->ngen++;
+            pool->latency[dt<VRS_NLATENCY?dt:VRS_NLATENCY]++;
+        }
+        uv_mutex_unlock(&pool->lock);
+        cors_vrs_free_task(task);
+    }
+    uv_mutex_lock(&vsta->lock);
+    if (!(more=vsta->task!=NULL)) vsta->scheduled=0;
+    uv_mutex_unlock(&vsta->lock);
+
+    if (more) push_vsta(pool,vsta);
+    else if (__atomic_load_n(&pool->nwait,__ATOMIC_SEQ_CST)) {
+        uv_mutex_lock(&pool->lock);
+        uv_cond_broadcast(&pool->done);
+        uv_mutex_unlock(&pool->lock);
+    }
+}
+
+static void vrspool_worker_thread(void *arg)
+{
+    cors_vrspool_t *pool=(cors_vrspool_t*)arg;
+    QUEUE *q;
+
+    cors_set_thread_rt_priority();
+
+    for (;;) {
+        uv_mutex_lock(&pool->lock);
+        while (pool->state&&QUEUE_EMPTY(&pool->queue)) {
+            uv_cond_wait(&pool->cond,&pool->lock);
+        }
+        if (QUEUE_EMPTY(&pool->queue)) {
+            uv_mutex_unlock(&pool->lock);
+            break;
+        }
+        q=QUEUE_HEAD(&pool->queue);
+        QUEUE_REMOVE(q);
+        uv_mutex_unlock(&pool->lock);
+
+        run_vsta(pool,QUEUE_DATA(q,cors_vrs_sta_t,q));
+    }
+}
+
+/* start vrs worker pool -------------------------------------------------------
+ * args   : cors_vrspool_t *pool     IO  worker pool
+ *          int            nworker   I   number of workers (0:number of cpus)
+ *          int            deadline  I   epoch deadline (ms) (0:no deadline)
+ * return : status (1:ok,0:error)
+ *-----------------------------------------------------------------------------*/
+extern int cors_vrspool_start(cors_vrspool_t *pool, int nworker, int deadline)
+{
+    uv_cpu_info_t *cpus;
+    int i,ncpu;
+
+    if (nworker<=0) {
+        nworker=1;
+        if (!uv_cpu_info(&cpus,&ncpu)) {
+            nworker=ncpu;
+            uv_free_cpu_info(cpus,ncpu);
+        }
+    }
+    if (nworker>MAX_VRS_WORKERS) nworker=MAX_VRS_WORKERS;
+
+    memset(pool,0,sizeof(*pool));
+    if (!(pool->threads=calloc(nworker,sizeof(uv_thread_t)))) {
+        return 0;
+    }
+    QUEUE_INIT(&pool->queue);
+    uv_mutex_init(&pool->lock);
+    uv_cond_init(&pool->cond);
+    uv_cond_init(&pool->done);
+    pool->deadline=deadline>0?(uint64_t)deadline*1000000:0;
+    pool->state=1;
+
+    for (i=0;i<nworker;i++) {
+        if (uv_thread_create(pool->threads+i,vrspool_worker_thread,pool)) {
+            log_trace(1,"vrs worker thread create error: worker=%d\n",i);
+            break;
+        }
+        pool->nworker++;
+    }
+    if (i<nworker) {
+        cors_vrspool_close(pool);
+        return 0;
+    }
+    log_trace(1,"vrs worker pool create ok: workers=%d deadline=%d ms\n",nworker,deadline);
+    return 1;
+}
+
+/* close vrs worker pool (pending stations are processed before exit) --------*/
+extern void cors_vrspool_close(cors_vrspool_t *pool)
+{
+    int i;
+
+    if (!pool->threads) return;
+
+    uv_mutex_lock(&pool->lock);
+    pool->state=0;
+    uv_cond_broadcast(&pool->cond);
+    uv_mutex_unlock(&pool->lock);
+
+    for (i=0;i<pool->nworker;i++) uv_thread_join(pool->threads+i);
+
+    log_trace(3,"vrs worker pool: gen=%llu late=%llu skip=%llu p99=%.1lf ms\n",
+              (unsigned long long)pool->ngen,(unsigned long long)pool->nlate,
+              (unsigned long long)pool->nskip,cors_vrspool_latency(pool,0.99));
+
+    uv_cond_destroy(&pool->cond);
+    uv_cond_destroy(&pool->done);
+    uv_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    pool->threads=NULL;
+    pool->nworker=0;
+}
+
+/* push vrs epoch task to pool -------------------------------------------------
+ * a station keeps only its latest pending epoch (a replaced one is counted as
+ * skipped) and is queued at most once, so epochs of one station never run
+ * concurrently and never out of order.
+ *-----------------------------------------------------------------------------*/
+extern void cors_vrspool_push(cors_vrspool_t *pool, cors_vrs_task_t *task)
+{
+    cors_vrs_sta_t *vsta=task->vsta;
+    cors_vrs_task_t *old;
+    int sched;
+
+    task->tq=uv_hrtime();
+
+    uv_mutex_lock(&vsta->lock);
+    old=vsta->task;
+    vsta->task=task;
+    if (!(sched=vsta->scheduled)) vsta->scheduled=1;
+    uv_mutex_unlock(&vsta->lock);
+
+    if (old) {
+        uv_mutex_lock(&pool->lock);
+        pool->nskip++;
+        uv_mutex_unlock(&pool->lock);
+        cors_vrs_free_task(old);
+    }
+    if (!sched) push_vsta(pool,vsta);
+}
+
+/* drop pending epoch of station and wait for running one ----------------------
+ * the waiter is registered in pool->nwait before checking the station, so a
+ * worker clearing scheduled after that check sees it and wakes the waiter.
+ *-----------------------------------------------------------------------------*/
+extern void cors_vrspool_cancel(cors_vrspool_t *pool, cors_vrs_sta_t *vsta)
+{
+    cors_vrs_task_t *task;
+    int sched;
+
+    uv_mutex_lock(&vsta->lock);
+    task=vsta->task;
+    vsta->task=NULL;
+    uv_mutex_unlock(&vsta->lock);
+
+    if (task) cors_vrs_free_task(task);
+    if (!pool->threads) return;
+
+    uv_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->nwait,1,__ATOMIC_SEQ_CST);
+    for (;;) {
+        uv_mutex_lock(&vsta->lock);
+        sched=vsta->scheduled;
+        uv_mutex_unlock(&vsta->lock);
+        if (!sched) break;
+        uv_cond_wait(&pool->done,&pool->lock);
+    }
+    __atomic_sub_fetch(&pool->nwait,1,__ATOMIC_SEQ_CST);
+    uv_mutex_unlock(&pool->lock);
+}
+
+/* generation latency percentile (ms) of epochs since pool start -------------*/
+extern double cors_vrspool_latency(cors_vrspool_t *pool, double p)
+{
+    uint64_t n=0,m=0;
+    int i;
+
+    uv_mutex_lock(&pool->lock);
+    for (i=0;i<=VRS_NLATENCY;i++) n+=pool->latency[i];
+    for (i=0;i<=VRS_NLATENCY;i++) {
+        if ((m+=pool->latency[i])>=p*n) break;
+    }
+    uv_mutex_unlock(&pool->lock);
+    return n?(i+1)*LATENCY_RES*1E-6:0.0;
+}
@@ -0,0 +1,309 @@
+#include "cors.h"
+
+#define PORT        18022   /* agent port for bench */
+#define NGRID       20      /* stations on grid (NGRID x NGRID) */
+#define SPACING     10000.0 /* station spacing (m) */
+#define NROVER      1000    /* rovers */
+#define NMOVE       200     /* moving rovers (20%) */
+#define STEP        300.0   /* moving rover step per gga (m) */
+#define NOISE       1.0     /* static rover position noise (m) */
+#define NROUND      40      /* gga messages per rover */
+#define PERIOD      50      /* gga period (ms) */
+#define TICK        200     /* reassignment tick (ms) */
+#define HYST        1000.0  /* reassignment hysteresis (m) */
+#define TIMEOUT     30.0    /* phase timeout (s) */
+#define USERS_FILE  "bench_agent_gga_users"
+
+static const double lat0=30.5*D2R,lon0=114.3*D2R;
+
+typedef struct rover {
+    uv_tcp_t tcp;
+    uv_connect_t req;
+    uv_write_t wreq;
+    double e,n,dir;
+    int ok,move,near;
+    struct bench *b;
+} rover_t;
+
+typedef struct bench {
+    uv_loop_t loop;
+    uv_timer_t timer;
+    rover_t *rov;
+    double sta[NGRID*NGRID][3];
+    char req[256];
+    int nok,round,stop,done;
+    uint64_t nsent,ncross;
+} bench_t;
+
+static void local2ecef(double e, double n, double *rr)
+{
+    double pos[3];
+
+    pos[0]=lat0+n/RE_WGS84;
+    pos[1]=lon0+e/(RE_WGS84*cos(lat0));
+    pos[2]=50.0;
+    pos2ecef(pos,rr);
+}
+
+static int nearest_sta(const bench_t *b, const double *rr, double *dist)
+{
+    double dr[3],d,dmin=1E30;
+    int i,j,k=-1;
+
+    for (i=0;i<NGRID*NGRID;i++) {
+        for (j=0;j<3;j++) dr[j]=rr[j]-b->sta[i][j];
+        if ((d=norm(dr,3))<dmin) {dmin=d; k=i;}
+    }
+    if (dist) *dist=dmin;
+    return k;
+}
+
+static void on_alloc(uv_handle_t *handle, size_t size, uv_buf_t *buf)
+{
+    static char buff[65536];
+    *buf=uv_buf_init(buff,sizeof(buff));
+}
+
+static void on_read(uv_stream_t *str, ssize_t nr, const uv_buf_t *buf)
+{
+    rover_t *r=str->data;
+
+    if (nr<0) {
+        uv_read_stop(str);
+        return;
+    }
+    if (!r->ok&&nr>=12&&!strncmp(buf->base,"ICY 200 OK\r\n",12)) {
+        r->ok=1;
+        __atomic_add_fetch(&r->b->nok,1,__ATOMIC_SEQ_CST);
+    }
+}
+
+static void on_connect(uv_connect_t *req, int status)
+{
+    rover_t *r=req->data;
+    uv_buf_t buf=uv_buf_init(r->b->req,strlen(r->b->req));
+
+    if (status<0) return;
+    uv_read_start((uv_stream_t*)&r->tcp,on_alloc,on_read);
+    uv_write(&r->wreq,(uv_stream_t*)&r->tcp,&buf,1,NULL);
+}
+
+static void on_write(uv_write_t *req, int status)
+{
+    free(req);
+}
+
+/* move rover and send gga ---------------------------------------------------*/
+static void send_gga(bench_t *b, rover_t *r)
+{
+    uv_write_t *wreq;
+    uv_buf_t buf;
+    sol_t sol;
+    double ext=NGRID*SPACING*0.5;
+    int k;
+
+    if (r->move) {
+        r->e+=STEP*cos(r->dir);
+        r->n+=STEP*sin(r->dir);
+        if (fabs(r->e)>ext) r->dir=PI-r->dir;
+        if (fabs(r->n)>ext) r->dir=-r->dir;
+    }
+    else {
+        r->e+=NOISE*(rand()/(double)RAND_MAX-0.5);
+        r->n+=NOISE*(rand()/(double)RAND_MAX-0.5);
+    }
+    memset(&sol,0,sizeof(sol));
+    sol.time=timeget();
+    sol.stat=SOLQ_FIX;
+    sol.ns=10;
+    local2ecef(r->e,r->n,sol.rr);
+
+    /* boundary crossings of nearest station */
+    if ((k=nearest_sta(b,sol.rr,NULL))!=r->near) {
+        if (r->near>=0) b->ncross++;
+        r->near=k;
+    }
+    if (!(wreq=malloc(sizeof(uv_write_t)+256))) return;
+    buf=uv_buf_init((char*)(wreq+1),outnmea_gga((uint8_t*)(wreq+1),&sol));
+    if (uv_write(wreq,(uv_stream_t*)&r->tcp,&buf,1,on_write)) free(wreq);
+    else b->nsent++;
+}
+
+static void on_timer(uv_timer_t *timer)
+{
+    bench_t *b=timer->data;
+    int i;
+
+    if (__atomic_load_n(&b->stop,__ATOMIC_SEQ_CST)) {
+        uv_stop(timer->loop);
+        return;
+    }
+    if (b->round>=NROUND||__atomic_load_n(&b->nok,__ATOMIC_SEQ_CST)<NROVER) return;
+
+    for (i=0;i<NROVER;i++) send_gga(b,b->rov+i);
+    if (++b->round>=NROUND) __atomic_store_n(&b->done,1,__ATOMIC_SEQ_CST);
+}
+
+static void rover_thread(void *arg)
+{
+    bench_t *b=arg;
+    struct sockaddr_in addr;
+    int i;
+
+    uv_ip4_addr("127.0.0.1",PORT,&addr);
+
+    for (i=0;i<NROVER;i++) {
+        b->rov[i].b=b;
+        b->rov[i].tcp.data=b->rov+i;
+        b->rov[i].req.data=b->rov+i;
+        uv_tcp_init(&b->loop,&b->rov[i].tcp);
+        uv_tcp_connect(&b->rov[i].req,&b->rov[i].tcp,(const struct sockaddr*)&addr,on_connect);
+    }
+    uv_timer_start(&b->timer,on_timer,PERIOD,PERIOD);
+    uv_run(&b->loop,UV_RUN_DEFAULT);
+}
+
+static void close_rover(uv_handle_t *handle, void *arg)
+{
+    if (!uv_is_closing(handle)) uv_close(handle,NULL);
+}
+
+static uint64_t agent_count(const cors_ntrip_agent_t *agent, int type)
+{
+    uint64_t n=0;
+    int i;
+
+    for (i=0;i<agent->nloop;i++) {
+        n+=type==0?agent->loops[i].ngga:type==1?agent->loops[i].nquery:agent->loops[i].nswitch;
+    }
+    return n;
+}
+
+/* distance of assigned station over nearest one of agent rovers (m) ---------*/
+static double assign_excess(const cors_ntrip_agent_t *agent, const bench_t *b, int *nrov)
+{
+    cors_ntrip_conn_t *c,*t;
+    double dr[3],d,dmin,dmax=0.0;
+    int i,j,k;
+
+    *nrov=0;
+    for (i=0;i<agent->nloop;i++) {
+        HASH_ITER(hh,agent->loops[i].conn_tbl,c,t) {
+            if (c->type!=2||norm(c->pos,3)<=0.0) continue;
+            nearest_sta(b,c->pos,&dmin);
+            if (sscanf(c->mntpnt,"S%d",&k)<1||k<0||k>=NGRID*NGRID) return 1E30;
+            for (j=0;j<3;j++) dr[j]=c->pos[j]-b->sta[k][j];
+            if ((d=norm(dr,3)-dmin)>dmax) dmax=d;
+            (*nrov)++;
+        }
+    }
+    return dmax;
+}
+
+static int run_bench(cors_t *cors, bench_t *b, int tick, double hyst, uint64_t *nquery)
+{
+    cors_ntrip_agent_t *agent=&cors->agent;
+    uv_thread_t thread;
+    uint64_t tp,ngga=0,last;
+    double e;
+    int i,nrov,nbad=0;
+
+    agent->port=PORT;
+    agent->gga_tick=tick;
+    agent->gga_hyst=hyst;
+    if (!cors_ntrip_agent_start(agent,&cors->ntrip,USERS_FILE,1)) {
+        fprintf(stderr,"agent start error\n");
+        return 1;
+    }
+    memset(&b->loop,0,sizeof(b->loop));
+    b->nok=b->round=b->stop=b->done=0;
+    b->nsent=b->ncross=0;
+    srand(2023);
+    for (i=0;i<NROVER;i++) {
+        memset(b->rov+i,0,sizeof(rover_t));
+        b->rov[i].e=(rand()/(double)RAND_MAX-0.5)*NGRID*SPACING;
+        b->rov[i].n=(rand()/(double)RAND_MAX-0.5)*NGRID*SPACING;
+        b->rov[i].dir=rand()/(double)RAND_MAX*2.0*PI;
+        b->rov[i].move=i<NMOVE;
+        b->rov[i].near=-1;
+    }
+    uv_loop_init(&b->loop);
+    uv_timer_init(&b->loop,&b->timer);
+    b->timer.data=b;
+    uv_thread_create(&thread,rover_thread,b);
+
+    /* wait for all gga sent and received, then for last tick */
+    tp=uv_hrtime();
+    while (!__atomic_load_n(&b->done,__ATOMIC_SEQ_CST)&&(uv_hrtime()-tp)*1E-9<TIMEOUT) uv_sleep(10);
+    do {
+        last=ngga;
+        uv_sleep(100);
+        ngga=agent_count(agent,0);
+    } while (ngga!=last&&(uv_hrtime()-tp)*1E-9<TIMEOUT);
+    uv_sleep(2*TICK);
+
+    e=assign_excess(agent,b,&nrov);
+    *nquery=agent_count(agent,1);
+    fprintf(stdout,"%5d %7.0lf %7llu %7llu %7llu %7llu %7llu %6d %9.1lf\n",tick,hyst,
+            (unsigned long long)b->nsent,(unsigned long long)ngga,(unsigned long long)*nquery,
+            (unsigned long long)agent_count(agent,2),(unsigned long long)b->ncross,nrov,e);
+
+    /* each rover on nearest station within hysteresis */
+    if (b->nok<NROVER||nrov<NROVER||e>hyst+1E-3) nbad++;
+
+    __atomic_store_n(&b->stop,1,__ATOMIC_SEQ_CST);
+    uv_thread_join(&thread);
+    uv_walk(&b->loop,close_rover,NULL);
+    uv_run(&b->loop,UV_RUN_DEFAULT);
+    uv_loop_close(&b->loop);
+
+    cors_ntrip_agent_close(agent);
+    return nbad;
+}
+
+int main(int argc, const char *argv[])
+{
+    cors_t *cors=calloc(1,sizeof(cors_t));
+    bench_t *b=calloc(1,sizeof(bench_t));
+    cors_ntrip_source_info_t *info;
+    char auth[64];
+    uint64_t nq[2];
+    FILE *fp;
+    int i,j,nbad=0;
+
+    if (!(fp=fopen(USERS_FILE,"w"))) return -1;
+    fprintf(fp,"user,pass,\n");
+    fclose(fp);
+    cors->ntrip.cors=cors;
+    uv_mutex_init(&cors->ntrip.info_lock);
+    uv_mutex_init(&cors->ntrip.stas_lock);
+
+    /* station grid as ntrip sources */
+    for (i=0;i<NGRID;i++) for (j=0;j<NGRID;j++) {
+        info=calloc(1,sizeof(*info));
+        sprintf(info->name,"S%03d",i*NGRID+j);
+        info->ID=i*NGRID+j+1;
+        local2ecef((j-(NGRID-1)*0.5)*SPACING,(i-(NGRID-1)*0.5)*SPACING,info->pos);
+        matcpy(b->sta[i*NGRID+j],info->pos,1,3);
+        HASH_ADD(hh,cors->ntrip.info_tbl[0],name,strlen(info->name),info);
+    }
+    cors_ntrip_stas_publish(&cors->ntrip);
+
+    encbase64(auth,(const uint8_t*)"user:pass",9);
+    sprintf(b->req,"GET /RTCM32 HTTP/1.0\r\nUser-Agent: NTRIP bench\r\nAuthorization: Basic %s\r\n\r\n",auth);
+    b->rov=calloc(NROVER,sizeof(rover_t));
+
+    fprintf(stdout,"gga     : stations=%d rovers=%d moving=%d messages=%d x %d ms\n",NGRID*NGRID,NROVER,
+            NMOVE,NROUND,PERIOD);
+    fprintf(stdout,"%5s %7s %7s %7s %7s %7s %7s %6s %9s\n","tick","hyst","sent","gga","query","switch",
+            "cross","rover","excess(m)");
+
+    nbad+=run_bench(cors,b,0,0.0,nq);      /* per message, nearest station */
+    nbad+=run_bench(cors,b,TICK,HYST,nq+1); /* batched with hysteresis */
+    if (nq[1]*2>nq[0]) nbad++;
+    fprintf(stdout,"check   : failed=%d\n",nbad);
+
+    remove(USERS_FILE);
+    free(b->rov); free(b);
+    return nbad?-1:0;
+}
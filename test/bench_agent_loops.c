@@ -0,0 +1,192 @@
+#include "cors.h"
+
+#define PORT        18002   /* agent port for bench */
+#define NCONN       2000    /* number of agent connections */
+#define NMSG        200     /* broadcast messages to RTCM32 */
+#define MSGLEN      512     /* message length (bytes) */
+#define TIMEOUT     60.0    /* phase timeout (s) */
+#define USERS_FILE  "bench_agent_users"
+
+static const int nloops[]={1,4,8};
+
+typedef struct client {
+    uv_tcp_t tcp;
+    uv_connect_t req;
+    uv_write_t wreq;
+    uint64_t nbyte;
+    int ok;
+    struct bench *b;
+} client_t;
+
+typedef struct bench {
+    uv_loop_t loop;
+    uv_timer_t timer;
+    client_t *cli;
+    char req[256];
+    uint64_t nbyte,nbyte_exp;
+    int nok,nfail,stop;
+} bench_t;
+
+static void on_alloc(uv_handle_t *handle, size_t size, uv_buf_t *buf)
+{
+    static char buff[65536];
+    *buf=uv_buf_init(buff,sizeof(buff));
+}
+
+static void on_read(uv_stream_t *str, ssize_t nr, const uv_buf_t *buf)
+{
+    client_t *c=str->data;
+    bench_t *b=c->b;
+
+    if (nr<0) {
+        if (!c->ok) b->nfail++;
+        uv_read_stop(str);
+        return;
+    }
+    if (!c->ok) {
+        if (nr<12||strncmp(buf->base,"ICY 200 OK\r\n",12)) {
+            b->nfail++;
+            uv_read_stop(str);
+            return;
+        }
+        c->ok=1;
+        __atomic_add_fetch(&b->nok,1,__ATOMIC_SEQ_CST);
+        nr-=12;
+    }
+    c->nbyte+=nr;
+    __atomic_add_fetch(&b->nbyte,nr,__ATOMIC_SEQ_CST);
+}
+
+static void on_connect(uv_connect_t *req, int status)
+{
+    client_t *c=req->data;
+    uv_buf_t buf=uv_buf_init(c->b->req,strlen(c->b->req));
+
+    if (status<0) {
+        c->b->nfail++;
+        return;
+    }
+    uv_read_start((uv_stream_t*)&c->tcp,on_alloc,on_read);
+    uv_write(&c->wreq,(uv_stream_t*)&c->tcp,&buf,1,NULL);
+}
+
+static void on_timer(uv_timer_t *timer)
+{
+    if (__atomic_load_n(&((bench_t*)timer->data)->stop,__ATOMIC_SEQ_CST)) uv_stop(timer->loop);
+}
+
+static void client_thread(void *arg)
+{
+    bench_t *b=arg;
+    struct sockaddr_in addr;
+    int i;
+
+    uv_ip4_addr("127.0.0.1",PORT,&addr);
+
+    for (i=0;i<NCONN;i++) {
+        b->cli[i].b=b;
+        b->cli[i].tcp.data=b->cli+i;
+        b->cli[i].req.data=b->cli+i;
+        uv_tcp_init(&b->loop,&b->cli[i].tcp);
+        uv_tcp_connect(&b->cli[i].req,&b->cli[i].tcp,(const struct sockaddr*)&addr,on_connect);
+    }
+    uv_timer_start(&b->timer,on_timer,1,1);
+    uv_run(&b->loop,UV_RUN_DEFAULT);
+}
+
+static void close_client(uv_handle_t *handle, void *arg)
+{
+    if (!uv_is_closing(handle)) uv_close(handle,NULL);
+}
+
+/* wait until counter reached or timeout, return elapsed time (ns) -----------*/
+static uint64_t wait_count(const void *p, int size, uint64_t n, uint64_t tp)
+{
+    uint64_t m;
+
+    for (;;) {
+        m=size==4?(uint64_t)__atomic_load_n((const int*)p,__ATOMIC_SEQ_CST):
+                  __atomic_load_n((const uint64_t*)p,__ATOMIC_SEQ_CST);
+        if (m>=n||(uv_hrtime()-tp)*1E-9>TIMEOUT) break;
+        uv_sleep(1);
+    }
+    return uv_hrtime()-tp;
+}
+
+static int run_bench(cors_t *cors, int nloop)
+{
+    cors_ntrip_agent_t *agent=&cors->agent;
+    bench_t *b=calloc(1,sizeof(bench_t));
+    uv_thread_t thread;
+    char msg[MSGLEN],auth[64];
+    uint64_t tp,tc[2],cmin=NCONN,cmax=0;
+    int i,nbad=0;
+
+    agent->port=PORT;
+    if (!cors_ntrip_agent_start(agent,&cors->ntrip,USERS_FILE,nloop)) {
+        fprintf(stderr,"agent start error: loops=%d\n",nloop);
+        free(b);
+        return 1;
+    }
+    encbase64(auth,(const uint8_t*)"user:pass",9);
+    sprintf(b->req,"GET /RTCM32 HTTP/1.0\r\nUser-Agent: NTRIP bench\r\nAuthorization: Basic %s\r\n\r\n",auth);
+    b->cli=calloc(NCONN,sizeof(client_t));
+    uv_loop_init(&b->loop);
+    uv_timer_init(&b->loop,&b->timer);
+    b->timer.data=b;
+
+    /* connections until ICY 200 OK */
+    tp=uv_hrtime();
+    uv_thread_create(&thread,client_thread,b);
+    tc[0]=wait_count(&b->nok,4,NCONN,tp);
+
+    /* broadcasts to all connections */
+    for (i=0;i<MSGLEN;i++) msg[i]=(char)i;
+    b->nbyte_exp=(uint64_t)b->nok*NMSG*MSGLEN;
+    tp=uv_hrtime();
+    for (i=0;i<NMSG;i++) cors_ntrip_agent_send(agent,"RTCM32",msg,MSGLEN);
+    tc[1]=wait_count(&b->nbyte,8,b->nbyte_exp,tp);
+
+    for (i=0;i<agent->nloop;i++) {
+        if (agent->loops[i].nconn<cmin) cmin=agent->loops[i].nconn;
+        if (agent->loops[i].nconn>cmax) cmax=agent->loops[i].nconn;
+    }
+    fprintf(stdout,"%5d %9d %10.0lf %9.1lf %9.1lf %6llu-%llu\n",agent->nloop,b->nok,
+            b->nok/(tc[0]*1E-9),b->nbyte/(tc[1]*1E-9)/1E6,tc[1]*1E-6,(unsigned long long)cmin,
+            (unsigned long long)cmax);
+    if (b->nok<NCONN||b->nbyte<b->nbyte_exp) nbad++;
+
+    __atomic_store_n(&b->stop,1,__ATOMIC_SEQ_CST);
+    uv_thread_join(&thread);
+    uv_walk(&b->loop,close_client,NULL);
+    uv_run(&b->loop,UV_RUN_DEFAULT);
+    uv_loop_close(&b->loop);
+
+    cors_ntrip_agent_close(agent);
+    free(b->cli); free(b);
+    return nbad;
+}
+
+int main(int argc, const char *argv[])
+{
+    cors_t *cors=calloc(1,sizeof(cors_t));
+    FILE *fp;
+    int i,nbad=0;
+
+    if (!(fp=fopen(USERS_FILE,"w"))) return -1;
+    fprintf(fp,"user,pass,\n");
+    fclose(fp);
+    cors->ntrip.cors=cors;
+
+    fprintf(stdout,"agent   : connections=%d messages=%d x %d bytes (broadcast to all)\n",NCONN,NMSG,MSGLEN);
+    fprintf(stdout,"%5s %9s %10s %9s %9s %9s\n","loops","conn","conn/s","MB/s","ms","perloop");
+
+    for (i=0;i<(int)(sizeof(nloops)/sizeof(nloops[0]));i++) {
+        nbad+=run_bench(cors,nloops[i]);
+    }
+    fprintf(stdout,"check   : failed runs=%d\n",nbad);
+
+    remove(USERS_FILE);
+    free(cors);
+    return nbad?-1:0;
+}
@@ -0,0 +1,175 @@
+#include "cors.h"
+#include <sys/socket.h>
+
+#define NMNTPNT     100     /* number of mountpoints */
+#define NROVER      10000   /* number of rovers (spread over mountpoints) */
+#define NEPOCH      10      /* number of epochs */
+#define NPIPE       64      /* number of socket pairs for uv_write check */
+
+typedef struct bench {
+    uint64_t nalloc,nbyte_alloc,nmemcpy,nwrite;
+} bench_t;
+
+static int gen_frame(char *buff, gtime_t time, int mnt)
+{
+    static const int type[3]={1077,1097,1127};
+    obsd_t obs[MAXOBS];
+    rtcm_t enc={0};
+    nav_t nav={0};
+    double r,freq;
+    int i,j,f,n=0;
+
+    for (i=0;i<3;i++) for (j=1;j<=10;j++) {
+        memset(obs+n,0,sizeof(obsd_t));
+        obs[n].time=time;
+        obs[n].sat=satno(i==0?SYS_GPS:(i==1?SYS_GAL:SYS_CMP),j);
+        r=2.1E7+1E5*j+10.0*mnt;
+        for (f=0;f<2;f++) {
+            obs[n].code[f]=i==0?(f?CODE_L2W:CODE_L1C):(i==1?(f?CODE_L5Q:CODE_L1C):(f?CODE_L7I:CODE_L2I));
+            freq=code2freq(satsys(obs[n].sat,NULL),obs[n].code[f],0);
+            obs[n].P[f]=r;
+            obs[n].L[f]=r/(CLIGHT/freq);
+            obs[n].SNR[f]=(uint16_t)(45.0/SNR_UNIT);
+        }
+        n++;
+    }
+    return rtcm_encode_obs(&enc,type,3,&nav,obs,n,buff);
+}
+
+/* former path: copy per message, then calloc+memcpy per subscriber ----------*/
+static void send_copy(bench_t *b, const char *buff, int nb, int nsub, void **pend, int *npend)
+{
+    char *data,*p;
+    int i;
+
+    data=calloc(nb,sizeof(char)*nb); /* former new_agent_data() */
+    memcpy(data,buff,nb);
+    b->nalloc++; b->nbyte_alloc+=(uint64_t)nb*nb; b->nmemcpy+=nb;
+
+    for (i=0;i<nsub;i++) {
+        pend[(*npend)++]=malloc(sizeof(uv_write_t));
+        p=calloc(nb,sizeof(char));
+        memcpy(p,data,nb);
+        pend[(*npend)++]=p;
+        b->nalloc+=2; b->nbyte_alloc+=sizeof(uv_write_t)+nb; b->nmemcpy+=nb;
+        b->nwrite++;
+    }
+    free(data);
+}
+
+/* shared path: one refcounted buffer, one write request per subscriber ------*/
+static void send_shared(bench_t *b, const char *buff, int nb, int nsub, void **pend, int *npend)
+{
+    cors_ntrip_sbuf_t *sbuf=cors_ntrip_sbuf_new(buff,nb);
+    uv_write_t *wreq;
+    int i;
+
+    b->nalloc++; b->nbyte_alloc+=sizeof(cors_ntrip_sbuf_t)+nb; b->nmemcpy+=nb;
+
+    for (i=0;i<nsub;i++) {
+        wreq=malloc(sizeof(uv_write_t));
+        wreq->data=sbuf;
+        cors_ntrip_sbuf_ref(sbuf);
+        pend[(*npend)++]=wreq;
+        b->nalloc++; b->nbyte_alloc+=sizeof(uv_write_t);
+        b->nwrite++;
+    }
+    cors_ntrip_sbuf_unref(sbuf);
+}
+
+static void run_bench(int mode, char (*frames)[4096], const int *nbs)
+{
+    bench_t b={0};
+    void **pend=malloc(sizeof(void*)*NROVER*2);
+    uint64_t tp,tc;
+    int i,j,k,npend,nsub=NROVER/NMNTPNT;
+
+    tp=uv_hrtime();
+    for (i=0;i<NEPOCH;i++) {
+        for (j=0,npend=0;j<NMNTPNT;j++) {
+            if (mode) send_shared(&b,frames[j],nbs[j],nsub,pend,&npend);
+            else      send_copy  (&b,frames[j],nbs[j],nsub,pend,&npend);
+        }
+        /* write completion */
+        for (k=0;k<npend;k++) {
+            if (mode) cors_ntrip_sbuf_unref(((uv_write_t*)pend[k])->data);
+            free(pend[k]);
+        }
+    }
+    tc=uv_hrtime()-tp;
+
+    fprintf(stdout,"%-6s: rovers=%d mntpnts=%d writes=%8llu allocs=%8llu (%5.2lf /write) alloc=%10llu bytes memcpy=%10llu bytes time=%8.3lf ms\n",
+            mode?"shared":"copy",NROVER,NMNTPNT,(unsigned long long)b.nwrite,(unsigned long long)b.nalloc,
+            (double)b.nalloc/b.nwrite,(unsigned long long)b.nbyte_alloc,(unsigned long long)b.nmemcpy,tc*1E-6);
+    free(pend);
+}
+
+static void on_write(uv_write_t *req, int status)
+{
+    int *nerr=req->handle->data;
+    if (status) (*nerr)++;
+    cors_ntrip_sbuf_unref(req->data);
+    free(req);
+}
+
+/* one shared buffer written to many streams is freed after the last write --*/
+static int check_uv_write(const char *buff, int nb)
+{
+    uv_loop_t *loop=uv_loop_new();
+    uv_pipe_t pipes[NPIPE];
+    cors_ntrip_sbuf_t *sbuf=cors_ntrip_sbuf_new(buff,nb);
+    uv_write_t *wreq;
+    uv_buf_t buf;
+    char rbuff[4096];
+    int i,fds[NPIPE][2],nerr=0,nread=0,ref;
+
+    for (i=0;i<NPIPE;i++) {
+        if (socketpair(AF_UNIX,SOCK_STREAM,0,fds[i])) return -1;
+        uv_pipe_init(loop,pipes+i,0);
+        uv_pipe_open(pipes+i,fds[i][0]);
+        pipes[i].data=&nerr;
+
+        wreq=malloc(sizeof(uv_write_t));
+        wreq->data=sbuf;
+        cors_ntrip_sbuf_ref(sbuf);
+        buf=uv_buf_init(sbuf->buff,sbuf->nb);
+        if (uv_write(wreq,(uv_stream_t*)(pipes+i),&buf,1,on_write)) {
+            cors_ntrip_sbuf_unref(sbuf);
+            free(wreq);
+            nerr++;
+        }
+    }
+    uv_run(loop,UV_RUN_DEFAULT);
+    ref=sbuf->ref;
+
+    for (i=0;i<NPIPE;i++) {
+        if (recv(fds[i][1],rbuff,sizeof(rbuff),0)==nb&&!memcmp(rbuff,buff,nb)) nread++;
+        uv_close((uv_handle_t*)(pipes+i),NULL);
+        close(fds[i][1]);
+    }
+    uv_run(loop,UV_RUN_DEFAULT);
+    uv_loop_close(loop);
+    free(loop);
+    cors_ntrip_sbuf_unref(sbuf);
+
+    fprintf(stdout,"uv_write: streams=%d received=%d errors=%d ref after writes=%d\n",NPIPE,nread,nerr,ref);
+    return nerr||nread!=NPIPE||ref!=1;
+}
+
+int main(int argc, const char *argv[])
+{
+    static char frames[NMNTPNT][4096];
+    int i,nbs[NMNTPNT];
+    gtime_t time=gpst2time(2200,0.0);
+
+    for (i=0;i<NMNTPNT;i++) nbs[i]=gen_frame(frames[i],time,i);
+    fprintf(stdout,"frame   : %d bytes\n",nbs[0]);
+
+    if (check_uv_write(frames[0],nbs[0])) return -1;
+
+    for (i=0;i<2;i++) {
+        run_bench(0,frames,nbs);
+        run_bench(1,frames,nbs);
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "cors.h"
+
+#define NCONN       50000   /* agent connections */
+#define NMNT        20000   /* mountpoints (on-demand vrs, ~2.5 rovers each) */
+#define NREADER     2       /* broadcast producer threads */
+#define TRUN        2.0     /* run time per mode (s) */
+#define LATRES      100     /* latency histogram resolution (ns) */
+#define NLAT        100000  /* latency histogram size (10 ms) */
+
+typedef struct bench {
+    cors_ntrip_subs_t subs;
+    uv_mutex_t lock;        /* former single subscriber lock (mode 0) */
+    cors_ntrip_conn_t **conn;
+    uv_tcp_t *tcp;
+    int mode,stop;
+    uint64_t nchurn,nbcast,nsub;
+    uint64_t nread[NREADER],nhit[NREADER],lat[NREADER][NLAT+1],lmax[NREADER];
+} bench_t;
+
+static void mntpnt_name(int i, char *name)
+{
+    sprintf(name,"DVRS%06d",i);
+}
+
+/* connect, disconnect, mountpoint switch and broadcast of agent loop --------*/
+static void writer_thread(void *arg)
+{
+    bench_t *b=arg;
+    cors_ntrip_conn_q_t *q;
+    cors_ntrip_conn_t *c,*t;
+    char name[32];
+    int i,op;
+
+    while (!__atomic_load_n(&b->stop,__ATOMIC_SEQ_CST)) {
+        op=rand()%10;
+        i=rand()%NCONN;
+        mntpnt_name(rand()%NMNT,name);
+
+        if (b->mode==0) uv_mutex_lock(&b->lock);
+        if (op<3) { /* broadcast to subscribers of mountpoint */
+            if ((q=cors_ntrip_subs_get(&b->subs,name))) HASH_ITER(hh,q->cs,c,t) {
+                c->sta_chg=0;
+                b->nsub++;
+            }
+            b->nbcast++;
+        }
+        else if (op<7) { /* gga driven switch */
+            c=cors_ntrip_subs_del(&b->subs,b->conn[i]->mntpnt,b->tcp+i);
+            strcpy(c->mntpnt,name);
+            cors_ntrip_subs_add(&b->subs,name,c);
+            b->nchurn++;
+        }
+        else { /* disconnect and new connection */
+            free(cors_ntrip_subs_del(&b->subs,b->conn[i]->mntpnt,b->tcp+i));
+            c=b->conn[i]=calloc(1,sizeof(cors_ntrip_conn_t));
+            c->conn=b->tcp+i;
+            strcpy(c->mntpnt,name);
+            cors_ntrip_subs_add(&b->subs,name,c);
+            b->nchurn++;
+        }
+        if (b->mode==0) uv_mutex_unlock(&b->lock);
+    }
+}
+
+/* subscriber lookup of broadcast producers ----------------------------------*/
+static void reader_thread(void *arg)
+{
+    bench_t *b=((void**)arg)[0];
+    int k=(int)(intptr_t)((void**)arg)[1];
+    char name[32];
+    uint64_t tp,dt;
+    int has;
+    unsigned int seed=k+1;
+
+    while (!__atomic_load_n(&b->stop,__ATOMIC_SEQ_CST)) {
+        mntpnt_name(rand_r(&seed)%NMNT,name);
+
+        tp=uv_hrtime();
+        if (b->mode==0) {
+            uv_mutex_lock(&b->lock);
+            has=cors_ntrip_subs_get(&b->subs,name)!=NULL;
+            uv_mutex_unlock(&b->lock);
+        }
+        else {
+            has=cors_ntrip_subs_has(&b->subs,name);
+        }
+        dt=uv_hrtime()-tp;
+        b->lat[k][dt/LATRES<NLAT?dt/LATRES:NLAT]++;
+        if (dt>b->lmax[k]) b->lmax[k]=dt;
+        b->nread[k]++;
+        b->nhit[k]+=has;
+    }
+}
+
+static double percentile(bench_t *b, uint64_t n, double p)
+{
+    uint64_t m=0;
+    int i,k;
+
+    for (i=0;i<=NLAT;i++) {
+        for (k=0;k<NREADER;k++) m+=b->lat[k][i];
+        if (m>=p*n) break;
+    }
+    return (i+1)*LATRES*1E-3;
+}
+
+static int run_bench(bench_t *b, int mode)
+{
+    static const char *label[]={"locked","rcu"};
+    uv_thread_t writer,reader[NREADER];
+    void *arg[NREADER][2];
+    char name[32];
+    uint64_t n=0,lmax=0,npub0=b->subs.npub,nfree0=b->subs.nfree;
+    int i,k,ndiff=0;
+
+    b->mode=mode;
+    b->stop=0;
+    b->nchurn=b->nbcast=0;
+    memset(b->nread,0,sizeof(b->nread));
+    memset(b->nhit,0,sizeof(b->nhit));
+    memset(b->lat,0,sizeof(b->lat));
+    memset(b->lmax,0,sizeof(b->lmax));
+
+    uv_thread_create(&writer,writer_thread,b);
+    for (k=0;k<NREADER;k++) {
+        arg[k][0]=b; arg[k][1]=(void*)(intptr_t)k;
+        uv_thread_create(reader+k,reader_thread,arg[k]);
+    }
+    uv_sleep((int)(TRUN*1000));
+    __atomic_store_n(&b->stop,1,__ATOMIC_SEQ_CST);
+    uv_thread_join(&writer);
+    for (k=0;k<NREADER;k++) uv_thread_join(reader+k);
+
+    for (k=0;k<NREADER;k++) {
+        n+=b->nread[k];
+        if (b->lmax[k]>lmax) lmax=b->lmax[k];
+    }
+    /* published snapshots agree with subscriber table */
+    for (i=0;i<NMNT;i++) {
+        mntpnt_name(i,name);
+        if (cors_ntrip_subs_has(&b->subs,name)!=(cors_ntrip_subs_get(&b->subs,name)!=NULL)) ndiff++;
+    }
+    fprintf(stdout,"%-7s %9.0lf %8.2lf %8.2lf %8.2lf %9.1lf %9.0lf %9.0lf %7llu %7llu %5d\n",label[mode],
+            n/TRUN,percentile(b,n,0.5),percentile(b,n,0.99),percentile(b,n,0.999),lmax*1E-3,
+            b->nchurn/TRUN,b->nbcast/TRUN,(unsigned long long)(b->subs.npub-npub0),
+            (unsigned long long)(b->subs.nfree-nfree0),ndiff);
+    return ndiff;
+}
+
+int main(int argc, const char *argv[])
+{
+    bench_t *b=calloc(1,sizeof(bench_t));
+    cors_ntrip_conn_t *c;
+    int i,nbad=0;
+
+    srand(2023);
+    cors_ntrip_subs_init(&b->subs);
+    uv_mutex_init(&b->lock);
+    b->conn=calloc(NCONN,sizeof(cors_ntrip_conn_t*));
+    b->tcp=calloc(NCONN,sizeof(uv_tcp_t));
+
+    for (i=0;i<NCONN;i++) {
+        c=b->conn[i]=calloc(1,sizeof(cors_ntrip_conn_t));
+        c->conn=b->tcp+i;
+        mntpnt_name(rand()%NMNT,c->mntpnt);
+        cors_ntrip_subs_add(&b->subs,c->mntpnt,c);
+    }
+    fprintf(stdout,"subs    : connections=%d mountpoints=%d readers=%d shards=%d\n",NCONN,NMNT,NREADER,
+            NTRIP_SUBS_SHARD);
+    fprintf(stdout,"%-7s %9s %8s %8s %8s %9s %9s %9s %7s %7s %5s\n","mode","lookup/s","p50(us)","p99(us)",
+            "p999(us)","max(us)","churn/s","bcast/s","publish","freed","diff");
+
+    nbad+=run_bench(b,0);
+    nbad+=run_bench(b,1);
+    fprintf(stdout,"check   : mismatches=%d\n",nbad);
+
+    cors_ntrip_subs_free(&b->subs);
+    uv_mutex_destroy(&b->lock);
+    free(b->conn); free(b->tcp); free(b);
+    return nbad?-1:0;
+}
@@ -0,0 +1,274 @@
+#include "cors.h"
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#endif
+
+#define PORT        18012   /* agent port for bench */
+#define NCONN       100     /* number of agent connections */
+#define NSTALL      20      /* stalled connections (20%) */
+#define NMSG        8000    /* broadcast messages to RTCM32 */
+#define MSGLEN      1024    /* message length (bytes) */
+#define LIMIT       65536   /* write queue limit (bytes) */
+#define RCVBUF      4096    /* receive buffer of stalled clients (bytes) */
+#define SNDBUF      16384   /* agent send buffer to stalled clients (bytes) */
+#define TIMEOUT     30.0    /* delivery timeout (s) */
+#define USERS_FILE  "bench_agent_wq_users"
+
+typedef struct client {
+    uv_tcp_t tcp;
+    uv_connect_t req;
+    uv_write_t wreq;
+    int ok,stall,port;
+    struct bench *b;
+} client_t;
+
+typedef struct bench {
+    uv_loop_t loop;
+    uv_timer_t timer;
+    client_t *cli;
+    char req[256];
+    uint64_t nbyte;
+    int nok,nclose,stop;
+} bench_t;
+
+static void on_alloc(uv_handle_t *handle, size_t size, uv_buf_t *buf)
+{
+    static char buff[65536];
+    *buf=uv_buf_init(buff,sizeof(buff));
+}
+
+static void on_read(uv_stream_t *str, ssize_t nr, const uv_buf_t *buf)
+{
+    client_t *c=str->data;
+    bench_t *b=c->b;
+
+    if (nr<0) {
+        __atomic_add_fetch(&b->nclose,1,__ATOMIC_SEQ_CST);
+        uv_read_stop(str);
+        return;
+    }
+    if (!c->ok) {
+        if (nr<12||strncmp(buf->base,"ICY 200 OK\r\n",12)) {
+            uv_read_stop(str);
+            return;
+        }
+        c->ok=1;
+        __atomic_add_fetch(&b->nok,1,__ATOMIC_SEQ_CST);
+        nr-=12;
+
+        /* stalled rover: stop reading, socket buffers fill up */
+        if (c->stall) {
+            uv_read_stop(str);
+            return;
+        }
+    }
+    __atomic_add_fetch(&b->nbyte,nr,__ATOMIC_SEQ_CST);
+}
+
+static void on_connect(uv_connect_t *req, int status)
+{
+    client_t *c=req->data;
+    uv_buf_t buf=uv_buf_init(c->b->req,strlen(c->b->req));
+    struct sockaddr_in addr;
+    int len=sizeof(addr);
+
+    if (status<0) return;
+    if (!uv_tcp_getsockname(&c->tcp,(struct sockaddr*)&addr,&len)) c->port=ntohs(addr.sin_port);
+    uv_read_start((uv_stream_t*)&c->tcp,on_alloc,on_read);
+    uv_write(&c->wreq,(uv_stream_t*)&c->tcp,&buf,1,NULL);
+}
+
+static void on_timer(uv_timer_t *timer)
+{
+    if (__atomic_load_n(&((bench_t*)timer->data)->stop,__ATOMIC_SEQ_CST)) uv_stop(timer->loop);
+}
+
+static void client_thread(void *arg)
+{
+    bench_t *b=arg;
+    struct sockaddr_in addr;
+    int i,size=RCVBUF;
+
+    uv_ip4_addr("127.0.0.1",PORT,&addr);
+
+    for (i=0;i<NCONN;i++) {
+        b->cli[i].b=b;
+        b->cli[i].stall=i%(NCONN/NSTALL)==0;
+        b->cli[i].tcp.data=b->cli+i;
+        b->cli[i].req.data=b->cli+i;
+        uv_tcp_init_ex(&b->loop,&b->cli[i].tcp,AF_INET);
+        if (b->cli[i].stall) uv_recv_buffer_size((uv_handle_t*)&b->cli[i].tcp,&size);
+        uv_tcp_connect(&b->cli[i].req,&b->cli[i].tcp,(const struct sockaddr*)&addr,on_connect);
+    }
+    uv_timer_start(&b->timer,on_timer,1,1);
+    uv_run(&b->loop,UV_RUN_DEFAULT);
+}
+
+static void close_client(uv_handle_t *handle, void *arg)
+{
+    if (!uv_is_closing(handle)) uv_close(handle,NULL);
+}
+
+static int wait_ok(bench_t *b)
+{
+    uint64_t tp=uv_hrtime();
+
+    while (__atomic_load_n(&b->nok,__ATOMIC_SEQ_CST)<NCONN&&(uv_hrtime()-tp)*1E-9<TIMEOUT) {
+        uv_sleep(1);
+    }
+    return b->nok;
+}
+
+/* kernel send queue of connection (unsent and unacked bytes) ----------------*/
+static uint64_t sock_outq(cors_ntrip_conn_t *c)
+{
+#ifdef __linux__
+    uv_os_fd_t fd;
+    int n=0;
+
+    if (!uv_fileno((uv_handle_t*)c->conn,&fd)&&!ioctl(fd,SIOCOUTQ,&n)&&n>0) return n;
+#endif
+    return 0;
+}
+
+/* limit kernel send buffer of agent connections to stalled rovers ----------*/
+static void set_sndbuf(cors_ntrip_agent_t *agent, const bench_t *b)
+{
+    cors_ntrip_conn_t *c,*t;
+    struct sockaddr_in addr;
+    int i,j,len,size;
+
+    for (i=0;i<agent->nloop;i++) {
+        HASH_ITER(hh,agent->loops[i].conn_tbl,c,t) {
+            len=sizeof(addr);
+            if (uv_tcp_getpeername((uv_tcp_t*)c->conn,(struct sockaddr*)&addr,&len)) continue;
+            for (j=0;j<NCONN;j++) {
+                if (!b->cli[j].stall||b->cli[j].port!=ntohs(addr.sin_port)) continue;
+                size=SNDBUF;
+                uv_send_buffer_size((uv_handle_t*)c->conn,&size);
+                break;
+            }
+        }
+    }
+}
+
+/* bytes held for connections by agent (write queue of streams and pending)
+ * and by kernel (socket send queue) ----------------------------------------*/
+static uint64_t agent_held(cors_ntrip_agent_t *agent, uint64_t *kern, int *nconn)
+{
+    cors_ntrip_agent_loop_t *lp;
+    cors_ntrip_conn_t *c,*t;
+    uint64_t n=0;
+    int i;
+
+    *kern=0;
+    *nconn=0;
+    for (i=0;i<agent->nloop;i++) {
+        lp=agent->loops+i;
+        HASH_ITER(hh,lp->conn_tbl,c,t) {
+            n+=uv_stream_get_write_queue_size((uv_stream_t*)c->conn)+c->wq_nb;
+            *kern+=sock_outq(c);
+            (*nconn)++;
+        }
+    }
+    return n;
+}
+
+static int run_bench(cors_t *cors, int limit, int policy, const char *label)
+{
+    static const char *pstr[]={"drop","coalesce","disconnect"};
+    cors_ntrip_agent_t *agent=&cors->agent;
+    bench_t *b=calloc(1,sizeof(bench_t));
+    uv_thread_t thread;
+    char msg[MSGLEN],auth[64];
+    uint64_t tp,held,kern,exp,ndrop=0,nevict=0,last=0;
+    int i,nconn,nbad=0;
+
+    agent->port=PORT;
+    agent->wq_limit=limit;
+    agent->wq_policy=policy;
+    if (!cors_ntrip_agent_start(agent,&cors->ntrip,USERS_FILE,1)) {
+        fprintf(stderr,"agent start error\n");
+        free(b);
+        return 1;
+    }
+    encbase64(auth,(const uint8_t*)"user:pass",9);
+    sprintf(b->req,"GET /RTCM32 HTTP/1.0\r\nUser-Agent: NTRIP bench\r\nAuthorization: Basic %s\r\n\r\n",auth);
+    b->cli=calloc(NCONN,sizeof(client_t));
+    uv_loop_init(&b->loop);
+    uv_timer_init(&b->loop,&b->timer);
+    b->timer.data=b;
+
+    uv_thread_create(&thread,client_thread,b);
+    if (wait_ok(b)<NCONN) nbad++;
+    set_sndbuf(agent,b);
+
+    /* bursts of 10 messages, as from many stations */
+    for (i=0;i<MSGLEN;i++) msg[i]=(char)i;
+    tp=uv_hrtime();
+    for (i=0;i<NMSG;i++) {
+        cors_ntrip_agent_send(agent,"RTCM32",msg,MSGLEN);
+        if (i%10==9) uv_sleep(1);
+    }
+    exp=(uint64_t)(NCONN-NSTALL)*NMSG*MSGLEN;
+
+    /* wait until active rovers got all or delivery stopped */
+    while ((uv_hrtime()-tp)*1E-9<TIMEOUT) {
+        uv_sleep(200);
+        if (b->nbyte>=exp||b->nbyte==last) break;
+        last=b->nbyte;
+    }
+    uv_sleep(200);
+    held=agent_held(agent,&kern,&nconn);
+    for (i=0;i<agent->nloop;i++) {
+        ndrop+=agent->loops[i].nbdrop;
+        nevict+=agent->loops[i].nevict;
+    }
+    fprintf(stdout,"%-10s %6d %9.1lf %9.1lf %9.1lf %9.1lf %6llu %5d %7.1lf\n",limit>0?pstr[policy]:label,
+            limit,held/1048576.0,kern/1048576.0,(held+kern)/1024.0/NSTALL,ndrop/1048576.0,
+            (unsigned long long)nevict,nconn,100.0*b->nbyte/exp);
+
+    /* memory per stalled connection bounded by pending plus one flush over the
+       stall threshold in agent and send buffer in kernel (doubled by kernel) */
+    if (limit>0&&held>(uint64_t)NSTALL*(2*limit+MSGLEN+AGENT_WQ_STALL)) nbad++;
+    if (limit>0&&kern>(uint64_t)NSTALL*2*SNDBUF) nbad++;
+    if (policy==AGENT_WQ_DISC&&limit>0&&(nevict<NSTALL||nconn>NCONN-NSTALL)) nbad++;
+
+    __atomic_store_n(&b->stop,1,__ATOMIC_SEQ_CST);
+    uv_thread_join(&thread);
+    uv_walk(&b->loop,close_client,NULL);
+    uv_run(&b->loop,UV_RUN_DEFAULT);
+    uv_loop_close(&b->loop);
+
+    cors_ntrip_agent_close(agent);
+    free(b->cli); free(b);
+    return nbad;
+}
+
+int main(int argc, const char *argv[])
+{
+    cors_t *cors=calloc(1,sizeof(cors_t));
+    FILE *fp;
+    int nbad=0;
+
+    if (!(fp=fopen(USERS_FILE,"w"))) return -1;
+    fprintf(fp,"user,pass,\n");
+    fclose(fp);
+    cors->ntrip.cors=cors;
+
+    fprintf(stdout,"agent   : connections=%d stalled=%d messages=%d x %d bytes sndbuf=%d\n",NCONN,NSTALL,
+            NMSG,MSGLEN,SNDBUF);
+    fprintf(stdout,"%-10s %6s %9s %9s %9s %9s %6s %5s %7s\n","policy","limit","held(MB)","kern(MB)",
+            "KB/stall","drop(MB)","evict","conn","active%");
+
+    nbad+=run_bench(cors,0,0,"unlimited");
+    nbad+=run_bench(cors,LIMIT,AGENT_WQ_DROP,NULL);
+    nbad+=run_bench(cors,LIMIT,AGENT_WQ_COAL,NULL);
+    nbad+=run_bench(cors,LIMIT,AGENT_WQ_DISC,NULL);
+    fprintf(stdout,"check   : failed=%d\n",nbad);
+
+    remove(USERS_FILE);
+    free(cors);
+    return nbad?-1:0;
+}
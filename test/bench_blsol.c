@@ -0,0 +1,115 @@
+#include "simobs.h"
+
+#define NBL         1000    /* number of baselines */
+#define NVRS        500     /* number of vrs stations (2 baselines each) */
+#define NEPOCH      50      /* number of published epochs */
+#define NWARM       10      /* epochs to converge the source solution */
+
+/* rtk solution of a short baseline used as publish source -------------------*/
+static void gen_rtk(rtk_t *rtk, const nav_t *nav, gtime_t time)
+{
+    prcopt_t opt=prcopt_default_rtk;
+    obsd_t obsd[MAXOBS*2];
+    obs_t robs={0,0,obsd},bobs={0,0,obsd+MAXOBS};
+    double pos[3]={30.5*D2R,114.3*D2R,50.0},enu[3]={3000.0,4000.0,10.0},rb[3],rr[3],dr[3];
+    int i,N[2][NSIM][2];
+
+    srand(2023);
+    for (i=0;i<NSIM;i++) {
+        N[0][i][0]=rand()%2000-1000; N[0][i][1]=rand()%2000-1000;
+        N[1][i][0]=rand()%2000-1000; N[1][i][1]=rand()%2000-1000;
+    }
+    pos2ecef(pos,rb);
+    enu2ecef(pos,enu,dr);
+    for (i=0;i<3;i++) rr[i]=rb[i]+dr[i];
+    opt.navsys=SYS_GPS|SYS_GAL;
+    rtkinit(rtk,&opt);
+    matcpy(rtk->rb,rb,1,3);
+
+    for (i=0;i<NWARM;i++,time=timeadd(time,1.0)) {
+        robs.n=gen_obs(nav,time,rr,1,N[0],robs.data);
+        bobs.n=gen_obs(nav,time,rb,2,N[1],bobs.data);
+        rtkpos(rtk,&robs,&bobs,nav);
+    }
+}
+
+/* snapshot has to carry what nrtk and vrs read from rtk_t -------------------*/
+static int chk_snap(const cors_blsnap_t *snap, const rtk_t *rtk)
+{
+    const cors_blsat_t *s;
+    int i,f,ndiff=0;
+
+    if (timediff(snap->time,rtk->time)||snap->sol.stat!=rtk->sol.stat) ndiff++;
+    for (i=0;i<3;i++) if (snap->bl[i]!=rtk->bl[i]||snap->rb[i]!=rtk->rb[i]) ndiff++;
+
+    for (i=0;i<MAXSAT;i++) for (f=0;f<NFREQ;f++) {
+        if (!(s=cors_blsnap_sat(snap,i+1))) {
+            if (rtk->ssat[i].vsat[f]||rtk->ssat[i].fix[f]) ndiff++;
+            continue;
+        }
+        if (s->vsat[f]!=rtk->ssat[i].vsat[f]||s->fix[f]!=rtk->ssat[i].fix[f]||
+            s->slip[f]!=rtk->ssat[i].slip[f]||s->lflg[f]!=rtk->ssat[i].lflg[f]||
+            s->refsat[f]!=rtk->ssat[i].refsat[f]||s->resc[f]!=rtk->ssat[i].resc[f]||
+            s->dd[f]!=rtk->ssat[i].dd[f]) ndiff++;
+    }
+    return ndiff;
+}
+
+int main(int argc, const char *argv[])
+{
+    static rtk_t rtk;
+    nav_t nav={0};
+    gtime_t time=gpst2time(2200,3600.0);
+    cors_blsols_t blsols;
+    cors_baseline_t *bls=calloc(NBL,sizeof(cors_baseline_t));
+    rtk_t *copy=calloc(NBL,sizeof(rtk_t)),*task;
+    const cors_blsnap_t *snap[2];
+    uint64_t tp,tc[2]={0};
+    int i,j,k,ns=0,ndiff=0;
+
+    cors_initblsol(&blsols);
+    gen_nav(&nav,timeadd(time,-60.0));
+    gen_rtk(&rtk,&nav,time);
+    for (i=0;i<NBL;i++) {
+        bls[i].base_srcid=i;
+        bls[i].rover_srcid=i+1;
+    }
+    for (j=0;j<NEPOCH;j++) {
+        /* full rtk_t copies: solution table and per-vrs task */
+        tp=uv_hrtime();
+        for (i=0;i<NBL;i++) copy[i]=rtk;
+        for (i=0;i<NVRS;i++) {
+            task=calloc(2,sizeof(rtk_t));
+            for (k=0;k<2;k++) task[k]=copy[(i*2+k)%NBL];
+            free(task);
+        }
+        tc[0]+=uv_hrtime()-tp;
+
+        /* snapshots published by pointer swap, vrs tasks only take refs */
+        tp=uv_hrtime();
+        for (i=0;i<NBL;i++) {
+            cors_updblsol(&blsols,bls+i,&rtk,bls[i].base_srcid,bls[i].rover_srcid);
+        }
+        for (i=0;i<NVRS;i++) {
+            for (k=0;k<2;k++) snap[k]=cors_blsol_snap(bls[(i*2+k)%NBL].sol);
+            for (k=0;k<2;k++) cors_blsnap_unref(snap[k]);
+        }
+        tc[1]+=uv_hrtime()-tp;
+    }
+    for (i=0;i<NBL;i++) {
+        snap[0]=cors_blsol_snap(bls[i].sol);
+        ndiff+=chk_snap(snap[0],&rtk);
+        ns=snap[0]->ns;
+        cors_blsnap_unref(snap[0]);
+    }
+    fprintf(stdout,"publish : baselines=%d vrs=%d epochs=%d active sats=%d\n",NBL,NVRS,NEPOCH,ns);
+    fprintf(stdout,"rtk_t   : %8.1lf KB/baseline %8.3lf ms/epoch\n",sizeof(rtk_t)/1024.0,tc[0]*1E-6/NEPOCH);
+    fprintf(stdout,"snapshot: %8.1lf KB/baseline %8.3lf ms/epoch\n",sizeof(cors_blsnap_t)/1024.0,tc[1]*1E-6/NEPOCH);
+    fprintf(stdout,"check   : mismatches=%d\n",ndiff);
+
+    cors_freeblsol(&blsols);
+    rtkfree(&rtk);
+    free(copy); free(bls);
+    free(nav.eph);
+    return ndiff?-1:0;
+}
@@ -0,0 +1,95 @@
+#include "simobs.h"
+
+#define NSTA        1000    /* number of stations */
+#define NBL         3000    /* number of baselines */
+#define NEPOCH      5       /* number of epochs */
+
+typedef struct station {
+    double rr[3];
+    int N[NSIM][2];
+    obsd_t obs[MAXOBS];
+    int n;
+} station_t;
+
+static double rs_ref[NSTA][MAXOBS*6],dts_ref[NSTA][MAXOBS*2];
+
+/* satposs of one epoch: pntpos per station and relpos per baseline ----------*/
+static uint64_t run_epoch(const station_t *sta, const nav_t *nav, gtime_t time,
+                          int check, double *err)
+{
+    obsd_t obs[MAXOBS*2];
+    double rs[MAXOBS*2*6],dts[MAXOBS*2*2],var[MAXOBS*2];
+    uint64_t tp=uv_hrtime();
+    int i,j,k,n,svh[MAXOBS*2];
+
+    for (i=0;i<NSTA;i++) {
+        satposs(time,sta[i].obs,sta[i].n,nav,EPHOPT_BRDC,rs,dts,var,svh);
+        if (check<0) {
+            memcpy(rs_ref[i],rs,sizeof(double)*6*sta[i].n);
+            memcpy(dts_ref[i],dts,sizeof(double)*2*sta[i].n);
+        }
+        else if (check>0) {
+            for (j=0;j<sta[i].n;j++) {
+                for (k=0;k<3;k++) {
+                    if (fabs(rs[k+j*6]-rs_ref[i][k+j*6])>err[0]) err[0]=fabs(rs[k+j*6]-rs_ref[i][k+j*6]);
+                    if (fabs(rs[k+3+j*6]-rs_ref[i][k+3+j*6])>err[1]) err[1]=fabs(rs[k+3+j*6]-rs_ref[i][k+3+j*6]);
+                }
+                if (fabs(dts[j*2]-dts_ref[i][j*2])*CLIGHT>err[2]) err[2]=fabs(dts[j*2]-dts_ref[i][j*2])*CLIGHT;
+            }
+        }
+    }
+    for (i=0;i<NBL;i++) {
+        const station_t *r=sta+i%NSTA,*b=sta+(i%NSTA+1+i/NSTA)%NSTA;
+        memcpy(obs,r->obs,sizeof(obsd_t)*r->n);
+        memcpy(obs+r->n,b->obs,sizeof(obsd_t)*b->n);
+        n=r->n+b->n;
+        satposs(time,obs,n,nav,EPHOPT_BRDC,rs,dts,var,svh);
+    }
+    return uv_hrtime()-tp;
+}
+
+int main(int argc, const char *argv[])
+{
+    nav_t nav={0};
+    station_t *sta=calloc(NSTA,sizeof(station_t));
+    gtime_t time=gpst2time(2200,3600.0);
+    double pos[3],err[3]={0},sec[2]={0};
+    uint64_t tc,nhit[2],nmiss[2],nsat=0;
+    int i,j,k;
+
+    srand(2023);
+    gen_nav(&nav,timeadd(time,-60.0));
+    for (i=0;i<NSTA;i++) {
+        pos[0]=(20.0+20.0*rand()/RAND_MAX)*D2R;
+        pos[1]=(100.0+20.0*rand()/RAND_MAX)*D2R;
+        pos[2]=100.0*rand()/RAND_MAX;
+        pos2ecef(pos,sta[i].rr);
+    }
+    getephcache(nhit,nmiss);
+
+    for (j=0;j<NEPOCH;j++,time=timeadd(time,1.0)) {
+        setephcache(0);
+        for (i=0;i<NSTA;i++) {
+            sta[i].n=gen_obs(&nav,time,sta[i].rr,1,sta[i].N,sta[i].obs);
+            nsat+=sta[i].n;
+        }
+        for (k=0;k<2;k++) {
+            setephcache(k?2:0);
+            tc=run_epoch(sta,&nav,time,k?1:-1,err);
+            sec[k]+=tc*1E-9;
+        }
+    }
+    getephcache(nhit+1,nmiss+1);
+    nhit[1]-=nhit[0]; nmiss[1]-=nmiss[0];
+
+    fprintf(stdout,"epoch   : stations=%d baselines=%d epochs=%d sats/station=%.1lf\n",NSTA,NBL,NEPOCH,
+            (double)nsat/NSTA/NEPOCH);
+    fprintf(stdout,"nocache : %8.1lf ms/epoch\n",sec[0]*1E3/NEPOCH);
+    fprintf(stdout,"cache   : %8.1lf ms/epoch hit=%llu miss=%llu (hit rate %.4lf)\n",sec[1]*1E3/NEPOCH,
+            (unsigned long long)nhit[1],(unsigned long long)nmiss[1],(double)nhit[1]/(nhit[1]+nmiss[1]));
+    fprintf(stdout,"error   : pos=%.2e m vel=%.2e m/s clk=%.2e m\n",err[0],err[1],err[2]);
+
+    free(nav.eph);
+    free(sta);
+    return err[0]>1E-4||err[2]>1E-4?-1:0;
+}
@@ -0,0 +1,83 @@
+#include "simobs.h"
+
+#define NLOOP       4000    /* satposs calls per round */
+#define NROUND      5       /* timing rounds (fastest one is reported) */
+
+/* cors navigation store fed like the rtcm decoder (previous + current) ------*/
+static int gen_cors_nav(cors_nav_t *cnav, gtime_t toe)
+{
+    nav_t src={0},nav={0};
+    int i,k;
+
+    if (!cors_initnav(cnav)) return 0;
+    src.eph=calloc(MAXSAT*2,sizeof(eph_t));
+
+    for (k=0;k<2;k++) {
+        gen_nav(&nav,timeadd(toe,k?0.0:-3600.0));
+        for (i=0;i<nav.n;i++) {
+            if (!k) nav.eph[i].iode=nav.eph[i].iodc=nav.eph[i].iode+100;
+            src.eph[nav.eph[i].sat-1]=nav.eph[i];
+            cors_updnav(cnav,&src,nav.eph[i].sat,0);
+        }
+        free(nav.eph);
+    }
+    free(src.eph);
+    return 1;
+}
+
+static double run_bench(const nav_t *nav, gtime_t time, const obsd_t *obs, int n,
+                        double *rs, double *dts)
+{
+    double var[MAXOBS];
+    uint64_t tp,tmin=0;
+    int i,j,svh[MAXOBS];
+
+    for (j=0;j<NROUND;j++) {
+        tp=uv_hrtime();
+        for (i=0;i<NLOOP;i++) {
+            satposs(time,obs,n,nav,EPHOPT_BRDC,rs,dts,var,svh);
+        }
+        tp=uv_hrtime()-tp;
+        if (!j||tp<tmin) tmin=tp;
+    }
+    return tmin*1E-3/NLOOP;
+}
+
+int main(int argc, const char *argv[])
+{
+    static const char *name[]={"flat","scan","index"};
+    cors_nav_t cnav;
+    nav_t nav={0};
+    const nav_t *navs[3];
+    obsd_t obs[MAXOBS];
+    gtime_t time=gpst2time(2200,3600.0);
+    double rr[3],pos[3]={30.5*D2R,114.3*D2R,50.0},rs[3][MAXOBS*6],dts[3][MAXOBS*2],tc;
+    int i,j,n,N[NSIM][2]={{0}},neph[3],ndiff=0;
+
+    gen_nav(&nav,timeadd(time,-60.0));
+    if (!gen_cors_nav(&cnav,timeadd(time,-60.0))) return -1;
+    pos2ecef(pos,rr);
+    n=gen_obs(&nav,time,rr,1,N,obs);
+
+    navs[0]=&nav; neph[0]=nav.n;
+    navs[1]=navs[2]=&cnav.data; neph[1]=neph[2]=cnav.data.n;
+
+    for (i=0;i<3;i++) {
+        cnav.data.ephidx=i==2;
+        tc=run_bench(navs[i],time,obs,n,rs[i],dts[i]);
+        fprintf(stdout,"%-6s: sats=%d ephs=%4d %8.2lf us/satposs %6.3lf us/sat\n",name[i],n,
+                i==2?MAXEPHIDX:neph[i],tc,tc/n);
+    }
+    /* indexed selection has to match the scan */
+    for (j=0;j<n;j++) {
+        for (i=1;i<3;i++) {
+            if (memcmp(rs[0]+j*6,rs[i]+j*6,sizeof(double)*6)||
+                memcmp(dts[0]+j*2,dts[i]+j*2,sizeof(double)*2)) ndiff++;
+        }
+    }
+    fprintf(stdout,"check : sats=%d mismatches=%d\n",n,ndiff);
+
+    free(nav.eph);
+    cors_freenav(&cnav);
+    return ndiff?-1:0;
+}
@@ -0,0 +1,72 @@
+#include "cors.h"
+
+#define NSAT        24      /* number of glonass satellites (3 planes) */
+#define NDAY        86400   /* seconds of a day */
+#define TEPH        1800    /* ephemeris update interval (s) */
+#define MU          3.9860044E14
+
+/* glonass ephemeris of circular orbit at toe --------------------------------*/
+static void gen_geph(geph_t *geph, int prn, gtime_t t0, gtime_t toe)
+{
+    double a=25510000.0,inc=64.8*D2R,OMG=(prn-1)/8*120.0*D2R,u,th,r[3],v[3];
+    double P[3],Q[3],vs=sqrt(MU/a),dt=timediff(toe,t0);
+    int i;
+
+    u=((prn-1)%8*45.0+(prn-1)/8*15.0)*D2R+vs/a*dt;
+    th=OMGE*dt;
+    P[0]=cos(OMG); P[1]=sin(OMG); P[2]=0.0;
+    Q[0]=-cos(inc)*sin(OMG); Q[1]=cos(inc)*cos(OMG); Q[2]=sin(inc);
+    for (i=0;i<3;i++) {
+        r[i]=a*(cos(u)*P[i]+sin(u)*Q[i]);
+        v[i]=vs*(-sin(u)*P[i]+cos(u)*Q[i]);
+    }
+    memset(geph,0,sizeof(geph_t));
+    geph->sat=satno(SYS_GLO,prn);
+    geph->iode=(int)(fmod(dt,86400.0)/900.0);
+    geph->toe=geph->tof=toe;
+    geph->pos[0]= cos(th)*r[0]+sin(th)*r[1];
+    geph->pos[1]=-sin(th)*r[0]+cos(th)*r[1];
+    geph->pos[2]=r[2];
+    geph->vel[0]= cos(th)*v[0]+sin(th)*v[1]+OMGE*geph->pos[1];
+    geph->vel[1]=-sin(th)*v[0]+cos(th)*v[1]-OMGE*geph->pos[0];
+    geph->vel[2]=v[2];
+    geph->acc[2]=1E-6*(prn%5-2);
+    geph->taun=1E-5*(prn%7-3);
+}
+
+int main(int argc, const char *argv[])
+{
+    static geph_t geph[NDAY/TEPH+1][NSAT];
+    gtime_t t0=gpst2time(2200,0.0),time;
+    double rs[2][NSAT][3],dts,var,err=0.0;
+    uint64_t tp,tc[2]={0};
+    int i,j,k,m,s,ndays=NDAY,ncall=0;
+
+    if (argc>1) ndays=atoi(argv[1]);
+    if (ndays>NDAY) ndays=NDAY;
+
+    for (j=0;j<=NDAY/TEPH;j++) for (i=0;i<NSAT;i++) {
+        gen_geph(geph[j]+i,i+1,t0,timeadd(t0,TEPH*j+TEPH/2.0));
+    }
+    for (s=0;s<ndays;s++) {
+        time=timeadd(t0,s+0.925);
+        j=(int)floor((s+0.925)/TEPH);
+        for (k=0;k<2;k++) {
+            setephcache(k);
+            tp=uv_hrtime();
+            for (i=0;i<NSAT;i++) {
+                geph2pos(time,geph[j]+i,rs[k][i],&dts,&var);
+            }
+            tc[k]+=uv_hrtime()-tp;
+        }
+        ncall+=NSAT;
+        for (i=0;i<NSAT;i++) for (m=0;m<3;m++) {
+            if (fabs(rs[1][i][m]-rs[0][i][m])>err) err=fabs(rs[1][i][m]-rs[0][i][m]);
+        }
+    }
+    fprintf(stdout,"geph2pos: sats=%d seconds=%d calls=%d\n",NSAT,ndays,ncall);
+    fprintf(stdout,"nocache : %8.3lf us/call %8.1lf ms/day\n",tc[0]*1E-3/ncall,tc[0]*1E-6*NDAY/ndays);
+    fprintf(stdout,"cache   : %8.3lf us/call %8.1lf ms/day\n",tc[1]*1E-3/ncall,tc[1]*1E-6*NDAY/ndays);
+    fprintf(stdout,"error   : max position difference=%.3e m\n",err);
+    return err>1E-4?-1:0;
+}
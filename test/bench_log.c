@@ -0,0 +1,98 @@
+#include "cors.h"
+
+#define NTHREAD     16      /* number of logging threads */
+#define NCALL       20000   /* calls per thread */
+#define NPACE       20      /* calls per 1 ms in paced run */
+
+typedef struct bench_arg {
+    int mode,n;
+    uint64_t t;
+} bench_arg_t;
+
+/* former logger: global lock, format, write and flush per call --------------*/
+static FILE *fp_ref=NULL;
+static lock_t lock_ref;
+
+static void log_trace_ref(int level, const char *format, ...)
+{
+    char buff[4096]={0},tbuf[64];
+    va_list ap;
+
+    lock(&lock_ref);
+    va_start(ap,format); vsprintf(buff,format,ap); va_end(ap);
+    time2str(timeget(),tbuf,3);
+    fprintf(fp_ref,"%s %s: ",tbuf,"[INFO]");
+    fprintf(fp_ref,"%s",buff);
+    fflush(fp_ref);
+    unlock(&lock_ref);
+}
+
+static void bench_thread(void *arg)
+{
+    bench_arg_t *a=arg;
+    uint64_t tp=uv_hrtime();
+    int i;
+
+    for (i=0;i<a->n;i++) {
+        if (a->mode==0) log_trace_ref(3,"[%2d] receive RTCM data: %d bytes\n",i%100,256+i%512);
+        else if (a->mode==1) log_trace(3,"[%2d] receive RTCM data: %d bytes\n",i%100,256+i%512);
+        else if (a->mode==2) log_trace(4,"[%2d] receive RTCM data: %d bytes\n",i%100,256+i%512);
+        else {
+            log_trace(3,"[%2d] receive RTCM data: %d bytes\n",i%100,256+i%512);
+            if (i%NPACE==NPACE-1) uv_sleep(1);
+        }
+    }
+    a->t=uv_hrtime()-tp;
+}
+
+static void run_bench(int mode, int nthread, int ncall)
+{
+    static const char *name[]={"former","async","filtered","paced"};
+    uv_thread_t threads[NTHREAD];
+    bench_arg_t args[NTHREAD];
+    uint64_t tp,tmax=0,ndrop=log_trace_ndrop();
+    int i;
+
+    tp=uv_hrtime();
+    for (i=0;i<nthread;i++) {
+        args[i].mode=mode;
+        args[i].n=ncall;
+        uv_thread_create(threads+i,bench_thread,args+i);
+    }
+    for (i=0;i<nthread;i++) {
+        uv_thread_join(threads+i);
+        if (args[i].t>tmax) tmax=args[i].t;
+    }
+    tp=uv_hrtime()-tp;
+
+    fprintf(stdout,"%-8s: threads=%2d calls=%8d %12.0lf calls/s %8.1lf ns/call (per thread) drop=%llu\n",
+            name[mode],nthread,nthread*ncall,nthread*ncall/(tp*1E-9),(double)tmax/ncall,
+            (unsigned long long)(log_trace_ndrop()-ndrop));
+}
+
+int main(int argc, const char *argv[])
+{
+    const char *file=argc>1?argv[1]:"bench_log.trace";
+    char file_ref[1024];
+    int nthread=NTHREAD,ncall=NCALL;
+
+    if (argc>2) nthread=atoi(argv[2]);
+    if (nthread>NTHREAD) nthread=NTHREAD;
+    if (argc>3) ncall=atoi(argv[3]);
+
+    sprintf(file_ref,"%s.ref",file);
+    if (!(fp_ref=fopen(file_ref,"w"))) return -1;
+    initlock(&lock_ref);
+
+    log_trace_open(file);
+    log_set_level(3);
+
+    run_bench(0,nthread,ncall);
+    run_bench(1,nthread,ncall);
+    run_bench(2,nthread,ncall);
+    run_bench(3,nthread,ncall/10);
+
+    log_trace_close();
+    fclose(fp_ref);
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "simobs.h"
+
+#define NCONN       10000   /* agent connections */
+#define NCONN_ENC   200     /* connections timed for per-connection encoding */
+#define NSTA        200     /* stations forwarding the same ephemeris */
+#define NUPD        120     /* ephemeris broadcasts per station (30 s for 1 h) */
+
+/* ephemeris as stored by rtcm decoder (indexed by satellite) ----------------*/
+static void set_decnav(nav_t *dec, const nav_t *nav, int iode)
+{
+    int i;
+
+    for (i=0;i<nav->n;i++) {
+        dec->eph[nav->eph[i].sat-1]=nav->eph[i];
+        dec->eph[nav->eph[i].sat-1].iode=iode;
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    static const int type[5]={1019,1020,1046,1042,1044};
+    static char buff[MAXSAT*256];
+    cors_nav_t cnav={0};
+    cors_ntrip_sbuf_t *sbuf;
+    nav_t nav={0},dec={0};
+    gtime_t time=gpst2time(2200,3600.0);
+    uint64_t tp,tc[2],nupd=0;
+    int i,j,k,m,nb=0,ndiff=0;
+
+    gen_nav(&nav,timeadd(time,-60.0));
+    dec.eph=calloc(MAXSAT*2,sizeof(eph_t));
+    cors_initnav(&cnav);
+    cors_initnavrtcm(&cnav);
+
+    /* every station forwards every ephemeris, new iode after 2 h */
+    for (k=0;k<2;k++) {
+        set_decnav(&dec,&nav,k+1);
+        for (j=0;j<NUPD;j++) for (m=0;m<NSTA;m++) {
+            for (i=0;i<nav.n;i++,nupd++) cors_updnav(&cnav,&dec,nav.eph[i].sat,0);
+        }
+    }
+    /* former path: encode all ephemeris per connection */
+    for (i=0;i<nav.n;i++) nav.eph[i].iode=2;
+    tp=uv_hrtime();
+    for (i=0;i<NCONN_ENC;i++) nb=rtcm_encode_nav(type,&nav,buff);
+    tc[0]=(uv_hrtime()-tp)*NCONN/NCONN_ENC;
+
+    /* shared path: take a reference of encoded messages per connection */
+    tp=uv_hrtime();
+    for (i=0;i<NCONN;i++) {
+        if (!(sbuf=cors_navrtcm(&cnav))) break;
+        cors_ntrip_sbuf_unref(sbuf);
+    }
+    tc[1]=uv_hrtime()-tp;
+
+    if (!(sbuf=cors_navrtcm(&cnav))||sbuf->nb!=nb||memcmp(sbuf->buff,buff,nb)) ndiff++;
+
+    fprintf(stdout,"nav     : satellites=%d updates=%llu encoded=%llu rebuilt=%llu bytes=%d\n",nav.n,
+            (unsigned long long)nupd,(unsigned long long)cnav.nenc,(unsigned long long)cnav.nupd,nb);
+    fprintf(stdout,"encode  : %10.1lf ms per %d connections (%.1lf us/conn)\n",tc[0]*1E-6,NCONN,
+            tc[0]*1E-3/NCONN);
+    fprintf(stdout,"shared  : %10.3lf ms per %d connections (%.3lf us/conn)\n",tc[1]*1E-6,NCONN,
+            tc[1]*1E-3/NCONN);
+    fprintf(stdout,"check   : mismatches=%d\n",ndiff);
+
+    if (sbuf) cors_ntrip_sbuf_unref(sbuf);
+    cors_freenav(&cnav);
+    free(nav.eph); free(dec.eph);
+    return ndiff?-1:0;
+}
@@ -0,0 +1,218 @@
+#include "cors.h"
+
+/* usage: bench_rtcm_decode [capture|-] [loops]. the capture is a stored raw
+ * rtcm3 caster stream (e.g. recorded by str2str -out file://...), "-" or an
+ * unreadable capture falls back to the synthetic corpus */
+#ifndef RTCM_CAPTURE
+#define RTCM_CAPTURE "rtcm3.bin" /* default stored capture */
+#endif
+#define NEPOCH      60      /* number of synthesized epochs */
+#define NLOOP       20      /* number of corpus replays */
+#define NCHECK      2000000 /* number of random bit-exact checks */
+#define MAXCORPUS   (32*1024*1024)
+#define PREAMB      0xD3    /* rtcm ver.3 frame preamble */
+
+/* reference bit-by-bit extraction (former getbitu/getbits) ------------------*/
+static uint32_t getbitu_ref(const uint8_t *buff, int pos, int len)
+{
+    uint32_t bits=0;
+    int i;
+    for (i=pos;i<pos+len;i++) bits=(bits<<1)+((buff[i/8]>>(7-i%8))&1u);
+    return bits;
+}
+static int32_t getbits_ref(const uint8_t *buff, int pos, int len)
+{
+    uint32_t bits=getbitu_ref(buff,pos,len);
+    if (len<=0||32<=len||!(bits&(1u<<(len-1)))) return (int32_t)bits;
+    return (int32_t)(bits|(~0u<<len));
+}
+
+static int gen_obs(obsd_t *obs, gtime_t time)
+{
+    static const int sys[3]={SYS_GPS,SYS_GAL,SYS_CMP};
+    static const uint8_t code[3][2]={{CODE_L1C,CODE_L2W},{CODE_L1C,CODE_L5Q},{CODE_L2I,CODE_L7I}};
+    double r,freq;
+    int i,j,f,n=0;
+
+    for (i=0;i<3;i++) for (j=1;j<=12;j++) {
+        memset(obs+n,0,sizeof(obsd_t));
+        obs[n].time=time;
+        obs[n].sat=satno(sys[i],j);
+        obs[n].rcv=1;
+        r=2.1E7+1E5*j+100.0*fmod(time.time,600.0);
+        for (f=0;f<2;f++) {
+            obs[n].code[f]=code[i][f];
+            freq=code2freq(sys[i],code[i][f],0);
+            obs[n].P[f]=r+f*1.5;
+            obs[n].L[f]=r/(CLIGHT/freq);
+            obs[n].D[f]=-500.0;
+            obs[n].SNR[f]=(uint16_t)(45.0/SNR_UNIT);
+        }
+        n++;
+    }
+    return n;
+}
+
+static int gen_nav(gtime_t time, char *buff, int *nframe)
+{
+    static const int sys[3]={SYS_GPS,SYS_GAL,SYS_CMP};
+    static const int type[3]={1019,1046,1042};
+    eph_t eph={0};
+    geph_t geph={0};
+    int i,j,n,nb=0;
+
+    for (i=0;i<3;i++) for (j=1;j<=12;j++) {
+        memset(&eph,0,sizeof(eph));
+        eph.sat=satno(sys[i],j);
+        eph.iode=eph.iodc=j;
+        eph.week=2200;
+        eph.toe=eph.toc=eph.ttr=time;
+        eph.toes=time2gpst(time,NULL);
+        eph.A=26560E3*26560E3; eph.e=0.01; eph.i0=0.96; eph.OMG0=0.1*j; eph.omg=0.2;
+        eph.M0=0.3*j; eph.deln=4E-9; eph.OMGd=-8E-9; eph.idot=1E-10;
+        eph.crc=200.0; eph.crs=-20.0; eph.cuc=1E-6; eph.cus=5E-6; eph.cic=1E-7; eph.cis=-1E-7;
+        eph.f0=1E-4; eph.f1=1E-12; eph.tgd[0]=5E-9; eph.sva=2;
+        if (sys[i]==SYS_GAL) eph.code=(1<<1)|(1<<8);
+        if ((n=rtcm_encode_eph(type[i],&eph,buff+nb))>0) {nb+=n; (*nframe)++;}
+    }
+    for (j=1;j<=12;j++) {
+        geph.sat=satno(SYS_GLO,j);
+        geph.iode=j; geph.frq=j-7;
+        geph.toe=geph.tof=time;
+        geph.pos[0]=1E7; geph.pos[1]=-1.5E7; geph.pos[2]=1.2E7;
+        geph.vel[0]=1E3; geph.vel[1]=2E3; geph.vel[2]=-1E3;
+        geph.taun=1E-5; geph.gamn=1E-12;
+        if ((n=rtcm_encode_geph(1020,&geph,buff+nb))>0) {nb+=n; (*nframe)++;}
+    }
+    return nb;
+}
+
+/* synthesize multi-constellation MSM4/MSM7 + ephemeris corpus ---------------*/
+static int gen_corpus(uint8_t *corpus, int *nframe)
+{
+    static const int type[6]={1074,1094,1124,1077,1097,1127};
+    static char buff[MAXSAT*1024];
+    obsd_t obs[MAXOBS];
+    rtcm_t *enc=calloc(1,sizeof(rtcm_t));
+    nav_t nav={0};
+    gtime_t time=gpst2time(2200,3600.0);
+    int i,k,n,m,nb=0;
+
+    for (i=0;i<NEPOCH;i++) {
+        n=gen_obs(obs,timeadd(time,i));
+        for (k=0;k<6;k++) {
+            if ((m=rtcm_encode_obs(enc,type+k,1,&nav,obs,n,buff))<=0) continue;
+            memcpy(corpus+nb,buff,m); nb+=m; (*nframe)++;
+        }
+        if (i%10==0) {
+            n=gen_nav(timeadd(time,i),buff,nframe);
+            memcpy(corpus+nb,buff,n); nb+=n;
+        }
+    }
+    free(enc);
+    return nb;
+}
+
+/* count rtcm3 frames with valid parity in corpus ----------------------------*/
+static int count_frames(const uint8_t *corpus, int nb)
+{
+    int i=0,len,n=0;
+
+    while (i+6<=nb) {
+        if (corpus[i]!=PREAMB) {i++; continue;}
+        len=getbitu(corpus+i,14,10)+3;
+        if (i+len+3>nb) break;
+        if (rtk_crc24q(corpus+i,len)==getbitu(corpus+i,len*8,24)) {n++; i+=len+3;}
+        else i++;
+    }
+    return n;
+}
+
+/* read stored capture -------------------------------------------------------*/
+static int read_capture(const char *file, uint8_t *corpus, int *nframe)
+{
+    FILE *fp;
+    int nb;
+
+    if (!(fp=fopen(file,"rb"))) {
+        fprintf(stderr,"capture open error: %s\n",file);
+        return 0;
+    }
+    nb=(int)fread(corpus,1,MAXCORPUS,fp);
+    fclose(fp);
+    if (!(*nframe=count_frames(corpus,nb))) {
+        fprintf(stderr,"no rtcm3 frame in capture: %s\n",file);
+        return 0;
+    }
+    return nb;
+}
+
+static int check_exact(const uint8_t *corpus, int nb)
+{
+    int i,pos,len,nerr=0,nbit=(nb-8)*8;
+
+    for (i=0;i<NCHECK&&nbit>0;i++) {
+        pos=rand()%nbit;
+        len=1+rand()%32;
+        if (getbitu(corpus,pos,len)!=getbitu_ref(corpus,pos,len)) nerr++;
+        if (getbits(corpus,pos,len)!=getbits_ref(corpus,pos,len)) nerr++;
+    }
+    fprintf(stdout,"bit-exact: %d random fields checked, %d mismatch\n",i,nerr);
+    return nerr;
+}
+
+static void bench_getbit(const uint8_t *corpus, int nb)
+{
+    volatile uint32_t sink=0;
+    uint64_t t0,t1,t2;
+    int i,n=(nb-8)*8-32,m=0;
+
+    t0=uv_hrtime();
+    for (i=0;i<n;i+=7) {sink+=getbitu_ref(corpus,i,1+i%32); m++;}
+    t1=uv_hrtime();
+    for (i=0;i<n;i+=7) sink+=getbitu(corpus,i,1+i%32);
+    t2=uv_hrtime();
+    fprintf(stdout,"getbitu  : ref=%6.2lf ns/call word=%6.2lf ns/call (%d calls)\n",
+            (double)(t1-t0)/m,(double)(t2-t1)/m,m);
+}
+
+int main(int argc, const char *argv[])
+{
+    uint8_t *corpus=malloc(MAXCORPUS);
+    rtcm_t *rtcm=calloc(1,sizeof(rtcm_t));
+    const char *file=argc>1?argv[1]:RTCM_CAPTURE;
+    uint64_t t0,t1;
+    int i,j,nb=0,nframe=0,nloop=NLOOP,rlen,nmsg=0;
+
+    /* stored capture, synthetic corpus as fallback */
+    if (strcmp(file,"-")) nb=read_capture(file,corpus,&nframe);
+    if (nb<=0) {
+        file="synthetic";
+        nframe=0;
+        nb=gen_corpus(corpus,&nframe);
+    }
+    if (argc>2) nloop=atoi(argv[2]);
+    fprintf(stdout,"corpus   : %d bytes %d frames (%s)\n",nb,nframe,file);
+
+    if (check_exact(corpus,nb)) return -1;
+    bench_getbit(corpus,nb);
+
+    init_rtcm(rtcm);
+    strcpy(rtcm->opt,"-EPHALL");
+
+    t0=uv_hrtime();
+    for (i=0;i<nloop;i++) {
+        for (j=0,rlen=nb;j<nb&&rlen>0;j++) {
+            if (input_rtcm3x(rtcm,corpus+(nb-rlen),rlen,&rlen)) nmsg++;
+        }
+    }
+    t1=uv_hrtime();
+
+    fprintf(stdout,"decode   : loops=%d frames=%d msgs=%d %10.0lf frames/s %8.1lf ns/frame\n",
+            nloop,nframe*nloop,nmsg,nframe*nloop/((t1-t0)*1E-9),(double)(t1-t0)/(nframe*nloop));
+
+    free_rtcm(rtcm);
+    free(rtcm);
+    free(corpus);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "cors.h"
+
+#define NEPOCH      2000    /* number of encoded epochs */
+#define NCHECK      2000000 /* number of random byte-identical checks */
+#define NSET        2       /* number of message sets */
+
+/* reference bit-by-bit setting (former setbitu) -----------------------------*/
+static void setbitu_ref(uint8_t *buff, int pos, int len, uint32_t data)
+{
+    uint32_t mask=1u<<(len-1);
+    int i;
+    if (len<=0||32<len) return;
+    for (i=pos;i<pos+len;i++,mask>>=1) {
+        if (data&mask) buff[i/8]|=1u<<(7-i%8); else buff[i/8]&=~(1u<<(7-i%8));
+    }
+}
+
+static int gen_obs(obsd_t *obs, gtime_t time)
+{
+    static const int sys[2]={SYS_GPS,SYS_CMP};
+    static const uint8_t code[2][2]={{CODE_L1C,CODE_L2W},{CODE_L2I,CODE_L7I}};
+    double r,freq;
+    int i,j,f,n=0;
+
+    for (i=0;i<2;i++) for (j=1;j<=14;j++) {
+        memset(obs+n,0,sizeof(obsd_t));
+        obs[n].time=time;
+        obs[n].sat=satno(sys[i],j);
+        obs[n].rcv=1;
+        r=2.1E7+1E5*j+100.0*fmod(time.time,600.0)+0.123*j;
+        for (f=0;f<2;f++) {
+            obs[n].code[f]=code[i][f];
+            freq=code2freq(sys[i],code[i][f],0);
+            obs[n].P[f]=r+f*1.5;
+            obs[n].L[f]=r/(CLIGHT/freq)+0.25*f;
+            obs[n].D[f]=-500.0+j;
+            obs[n].SNR[f]=(uint16_t)((40.0+j*0.5)/SNR_UNIT);
+        }
+        n++;
+    }
+    return n;
+}
+
+static int check_identical(void)
+{
+    uint8_t a[64],b[64];
+    uint32_t data;
+    int i,k,pos,len,nerr=0;
+
+    for (i=0;i<NCHECK;i++) {
+        for (k=0;k<64;k++) a[k]=b[k]=(uint8_t)rand();
+        pos=rand()%(64*8-32);
+        len=1+rand()%32;
+        data=((uint32_t)rand()<<16)^(uint32_t)rand();
+        setbitu_ref(a,pos,len,data);
+        setbitu    (b,pos,len,data);
+        if (memcmp(a,b,64)) nerr++;
+    }
+    fprintf(stdout,"identical: %d random fields checked, %d mismatch\n",i,nerr);
+    return nerr;
+}
+
+/* compare decoded observation with source within msm resolution -------------*/
+static int check_obs(const obsd_t *src, int n, const obs_t *dec)
+{
+    int i,j,f,nerr=0;
+
+    for (i=0;i<n;i++) {
+        for (j=0;j<dec->n;j++) if (dec->data[j].sat==src[i].sat) break;
+        if (j>=dec->n) {nerr++; continue;}
+        for (f=0;f<2;f++) {
+            if (fabs(dec->data[j].P[f]-src[i].P[f])>0.1) nerr++;
+            if (fabs(dec->data[j].L[f]-src[i].L[f])>0.01) nerr++;
+        }
+    }
+    return nerr;
+}
+
+static void run_bench(const char *name, const int *type, int nt)
+{
+    static char buff[MAXSAT*1024];
+    obsd_t obs[MAXOBS];
+    rtcm_t *enc=calloc(1,sizeof(rtcm_t)),*dec=calloc(1,sizeof(rtcm_t));
+    nav_t nav={0};
+    gtime_t time=gpst2time(2200,3600.0);
+    uint64_t tp,tenc=0,tdec=0,nbyte=0,sum=0;
+    int i,j,n,nb,rlen,nframe=0,nerr=0;
+
+    init_rtcm(dec);
+    for (i=0;i<NEPOCH;i++) {
+        n=gen_obs(obs,timeadd(time,i));
+
+        tp=uv_hrtime();
+        nb=rtcm_encode_obs(enc,type,nt,&nav,obs,n,buff);
+        tenc+=uv_hrtime()-tp;
+        nbyte+=nb;
+        sum+=rtk_crc32((uint8_t*)buff,nb);
+        nframe+=nt;
+
+        tp=uv_hrtime();
+        for (j=0,rlen=nb;j<nb&&rlen>0;j++) {
+            if (input_rtcm3x(dec,(uint8_t*)buff+(nb-rlen),rlen,&rlen)==1) break;
+        }
+        tdec+=uv_hrtime()-tp;
+        nerr+=check_obs(obs,n,&dec->obs);
+    }
+    fprintf(stdout,"%-9s: frames=%6d bytes=%8llu sum=%016llx encode=%7.1lf ns/frame decode=%7.1lf ns/frame round-trip err=%d\n",
+            name,nframe,(unsigned long long)nbyte,(unsigned long long)sum,(double)tenc/nframe,(double)tdec/nframe,nerr);
+    free_rtcm(dec);
+    free(dec); free(enc);
+}
+
+int main(int argc, const char *argv[])
+{
+    static const int type[NSET][2]={{1074,1124},{1077,1127}};
+    static const char *name[NSET]={"1074+1124","1077+1127"};
+    int i;
+
+    if (check_identical()) return -1;
+
+    for (i=0;i<NSET;i++) run_bench(name[i],type[i],2);
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "cors.h"
+
+#define NSRC        1000    /* number of simulated sources */
+#define NEPOCH      30      /* number of simulated epochs */
+#define NREAD       256     /* bytes per simulated tcp read */
+#define RING_SIZE   32768
+
+typedef struct bench_src {
+    rtcm_t *rtcm;
+    cors_ring_t ring;
+    int queued;
+    QUEUE q;
+} bench_src_t;
+
+typedef struct bench_task {
+    uint8_t *buff;
+    int nb;
+    bench_src_t *src;
+    QUEUE q;
+} bench_task_t;
+
+typedef struct bench {
+    int mode,done,busy;
+    uv_mutex_t lock;
+    uv_cond_t cond;
+    QUEUE queue;
+    uint64_t nalloc,nmemcpy,nchunk,nmsg,tbusy;
+} bench_t;
+
+static int gen_obs(obsd_t *obs, gtime_t time, int srcid)
+{
+    static const int sys[3]={SYS_GPS,SYS_GAL,SYS_CMP};
+    static const uint8_t code[3][2]={{CODE_L1C,CODE_L2W},{CODE_L1C,CODE_L5Q},{CODE_L2I,CODE_L7I}};
+    double r,freq;
+    int i,j,f,n=0;
+
+    for (i=0;i<3;i++) for (j=1;j<=10;j++) {
+        memset(obs+n,0,sizeof(obsd_t));
+        obs[n].time=time;
+        obs[n].sat=satno(sys[i],j);
+        obs[n].rcv=1;
+        r=2.1E7+1E5*j+10.0*srcid+100.0*fmod(time.time,600.0);
+        for (f=0;f<2;f++) {
+            obs[n].code[f]=code[i][f];
+            freq=code2freq(sys[i],code[i][f],0);
+            obs[n].P[f]=r+f*1.5;
+            obs[n].L[f]=r/(CLIGHT/freq);
+            obs[n].D[f]=-500.0;
+            obs[n].SNR[f]=(uint16_t)(45.0/SNR_UNIT);
+        }
+        n++;
+    }
+    return n;
+}
+
+static uint64_t thread_cputime(void)
+{
+#if WIN32
+    return uv_hrtime();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID,&ts);
+    return (uint64_t)ts.tv_sec*1000000000ull+ts.tv_nsec;
+#endif
+}
+
+static void decode_buff(bench_t *b, bench_src_t *s, uint8_t *buff, int nb)
+{
+    int i,rlen=nb;
+
+    for (i=0;i<nb;i++) {
+        if (input_rtcm3x(s->rtcm,buff+(nb-rlen),rlen,&rlen)) b->nmsg++;
+        if (rlen<=0) break;
+    }
+}
+
+static void consumer_thread(void *arg)
+{
+    bench_t *b=arg;
+    bench_task_t *task;
+    bench_src_t *s;
+    uint8_t *p;
+    uint64_t tp;
+    QUEUE *q;
+    int n;
+
+    uv_mutex_lock(&b->lock);
+    for (;;) {
+        while (QUEUE_EMPTY(&b->queue)&&!b->done) {
+            b->busy=0;
+            uv_cond_broadcast(&b->cond);
+            uv_cond_wait(&b->cond,&b->lock);
+        }
+        if (QUEUE_EMPTY(&b->queue)) break;
+        b->busy=1;
+        q=QUEUE_HEAD(&b->queue);
+        QUEUE_REMOVE(q);
+        uv_mutex_unlock(&b->lock);
+
+        tp=thread_cputime();
+        if (b->mode==0) {
+            task=QUEUE_DATA(q,bench_task_t,q);
+            decode_buff(b,task->src,task->buff,task->nb);
+            free(task->buff);
+            free(task);
+        }
+        else {
+            s=QUEUE_DATA(q,bench_src_t,q);
+            __atomic_store_n(&s->queued,0,__ATOMIC_SEQ_CST);
+            while ((n=cors_ring_peek(&s->ring,&p))>0) {
+                decode_buff(b,s,p,n);
+                cors_ring_commit(&s->ring,n);
+            }
+        }
+        b->tbusy+=thread_cputime()-tp;
+        uv_mutex_lock(&b->lock);
+    }
+    b->busy=0;
+    uv_cond_broadcast(&b->cond);
+    uv_mutex_unlock(&b->lock);
+}
+
+/* former path: one task and one buffer copy per tcp read */
+static void push_queue(bench_t *b, bench_src_t *s, const uint8_t *data, int n)
+{
+    bench_task_t *task=calloc(1,sizeof(*task));
+    task->src=s;
+    task->buff=malloc(n);
+    task->nb=n;
+    memcpy(task->buff,data,n);
+    b->nalloc+=2;
+    b->nmemcpy+=n;
+
+    uv_mutex_lock(&b->lock);
+    QUEUE_INSERT_TAIL(&b->queue,&task->q);
+    uv_cond_signal(&b->cond);
+    uv_mutex_unlock(&b->lock);
+}
+
+/* ring path: bytes go to the source ring, source queued once until drained */
+static void push_ring(bench_t *b, bench_src_t *s, const uint8_t *data, int n)
+{
+    cors_ring_write(&s->ring,data,n);
+    b->nmemcpy+=n;
+    if (__atomic_exchange_n(&s->queued,1,__ATOMIC_SEQ_CST)) return;
+
+    uv_mutex_lock(&b->lock);
+    QUEUE_INSERT_TAIL(&b->queue,&s->q);
+    uv_cond_signal(&b->cond);
+    uv_mutex_unlock(&b->lock);
+}
+
+static void run_bench(int mode, bench_src_t *srcs, int nsrc, int nepoch)
+{
+    static char buff[MAXSAT*256];
+    static const int type[3]={1077,1097,1127};
+    obsd_t obs[MAXOBS];
+    rtcm_t enc={0};
+    nav_t nav={0};
+    bench_t b={0};
+    uv_thread_t thread;
+    gtime_t time=gpst2time(2200,0.0);
+    uint64_t tp,tc,ndrop=0;
+    int i,j,k,n,nb;
+
+    b.mode=mode;
+    QUEUE_INIT(&b.queue);
+    uv_mutex_init(&b.lock);
+    uv_cond_init(&b.cond);
+    uv_thread_create(&thread,consumer_thread,&b);
+
+    tp=uv_hrtime();
+    for (i=0;i<nepoch;i++) {
+        for (j=0;j<nsrc;j++) {
+            n=gen_obs(obs,timeadd(time,i),j);
+            nb=rtcm_encode_obs(&enc,type,3,&nav,obs,n,buff);
+
+            for (k=0;k<nb;k+=NREAD) {
+                b.nchunk++;
+                if (mode==0) push_queue(&b,srcs+j,(uint8_t*)buff+k,nb-k<NREAD?nb-k:NREAD);
+                else         push_ring (&b,srcs+j,(uint8_t*)buff+k,nb-k<NREAD?nb-k:NREAD);
+            }
+        }
+        /* wait decoder idle (1 epoch per cycle) */
+        uv_mutex_lock(&b.lock);
+        while (!QUEUE_EMPTY(&b.queue)||b.busy) uv_cond_wait(&b.cond,&b.lock);
+        uv_mutex_unlock(&b.lock);
+    }
+    uv_mutex_lock(&b.lock);
+    b.done=1;
+    uv_cond_broadcast(&b.cond);
+    uv_mutex_unlock(&b.lock);
+    uv_thread_join(&thread);
+    tc=uv_hrtime();
+
+    for (j=0;j<nsrc;j++) ndrop+=srcs[j].ring.ndrop;
+
+    fprintf(stdout,"%-6s: srcs=%5d chunks=%8llu msgs=%8llu allocs=%8llu (%10.0lf /s) memcpy=%10llu bytes drop=%llu\n",
+            mode?"ring":"queue",nsrc,(unsigned long long)b.nchunk,(unsigned long long)b.nmsg,
+            (unsigned long long)b.nalloc,b.nalloc/((tc-tp)*1E-9),(unsigned long long)b.nmemcpy,
+            (unsigned long long)ndrop);
+    fprintf(stdout,"%-6s: wall=%9.3lf ms decoder cpu=%9.3lf ms (%7.3lf ms/epoch %6.1lf ns/chunk)\n",
+            mode?"ring":"queue",(tc-tp)*1E-6,b.tbusy*1E-6,b.tbusy*1E-6/nepoch,(double)b.tbusy/b.nchunk);
+}
+
+int main(int argc, const char *argv[])
+{
+    bench_src_t *srcs;
+    int i,nsrc=NSRC,nepoch=NEPOCH;
+
+    if (argc>1) nsrc=atoi(argv[1]);
+    if (argc>2) nepoch=atoi(argv[2]);
+
+    srcs=calloc(nsrc,sizeof(bench_src_t));
+    for (i=0;i<nsrc;i++) {
+        srcs[i].rtcm=calloc(1,sizeof(rtcm_t));
+        init_rtcm(srcs[i].rtcm);
+        cors_ring_init(&srcs[i].ring,RING_SIZE);
+    }
+    for (i=0;i<2;i++) {
+        run_bench(0,srcs,nsrc,nepoch);
+        run_bench(1,srcs,nsrc,nepoch);
+    }
+
+    for (i=0;i<nsrc;i++) {
+        free_rtcm(srcs[i].rtcm);
+        free(srcs[i].rtcm);
+        cors_ring_free(&srcs[i].ring);
+    }
+    free(srcs);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "simobs.h"
+
+#define NEPOCH      300     /* number of simulated epochs */
+#define NWARM       30      /* warm-up epochs excluded from counting */
+#define NLOOP       2000    /* filter calls per timing run */
+#define BASELEN     5000.0  /* baseline length (m) */
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+static uint64_t nalloc=0;   /* number of heap allocations */
+
+/* count heap allocations of this process ------------------------------------*/
+void *malloc(size_t size)
+{
+    __atomic_add_fetch(&nalloc,1,__ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+void *calloc(size_t n, size_t size)
+{
+    __atomic_add_fetch(&nalloc,1,__ATOMIC_RELAXED);
+    return __libc_calloc(n,size);
+}
+void *realloc(void *p, size_t size)
+{
+    __atomic_add_fetch(&nalloc,1,__ATOMIC_RELAXED);
+    return __libc_realloc(p,size);
+}
+
+/* filter problem shaped like one relpos update from current rtk states ------*/
+static int gen_filter(const rtk_t *rtk, int *ix, double **H, double **v, double **R)
+{
+    int i,j,k,nx=0,m;
+
+    for (i=0;i<rtk->nx;i++) if (rtk->x[i]!=0.0&&rtk->P[i+i*rtk->nx]>0.0) ix[nx++]=i;
+    if (nx<5) return 0;
+    m=(nx-3)*2;
+    *H=zeros(rtk->nx,m); *v=mat(m,1); *R=zeros(m,m);
+    for (j=0;j<m;j++) {
+        for (k=0;k<3;k++) (*H)[k+j*rtk->nx]=randn();
+        if (j%2) (*H)[ix[3]+j*rtk->nx]=1.0,(*H)[ix[3+j/2]+j*rtk->nx]=-1.0;
+        (*v)[j]=0.01*randn();
+        for (i=0;i<m;i++) (*R)[i+j*m]=i==j?2E-4:1E-4;
+    }
+    return nx;
+}
+
+int main(int argc, const char *argv[])
+{
+    prcopt_t opt=prcopt_default_rtk;
+    nav_t nav={0};
+    rtk_t rtk={0};
+    obsd_t obsd[MAXOBS*2];
+    obs_t robs={0,0,obsd},bobs={0,0,obsd+MAXOBS};
+    gtime_t time=gpst2time(2200,3600.0);
+    double pos[3]={30.5*D2R,114.3*D2R,50.0},rb[3],rr[3],enu[3]={BASELEN*0.6,BASELEN*0.8,10.0},dr[3];
+    double *x,*P,*H,*v,*R;
+    int i,j,nepoch=NEPOCH,N[2][NSIM][2],ix[1024],nx,m,nfix=0,nnull=0,info=0;
+    uint64_t tp,tc=0,n0,na=0,nmax=0,nf[2];
+
+    if (argc>1) nepoch=atoi(argv[1]);
+    if (nepoch<=NWARM) nepoch=NWARM+1;
+
+    srand(2023);
+    gen_nav(&nav,timeadd(time,-60.0));
+    for (i=0;i<2;i++) for (j=0;j<NSIM;j++) {
+        N[i][j][0]=rand()%2000-1000; N[i][j][1]=rand()%2000-1000;
+    }
+    pos2ecef(pos,rb);
+    enu2ecef(pos,enu,dr);
+    for (i=0;i<3;i++) rr[i]=rb[i]+dr[i];
+
+    opt.navsys=SYS_GPS|SYS_GAL;
+    opt.nf=2;
+    rtkinit(&rtk,&opt);
+    matcpy(rtk.rb,rb,1,3);
+
+    /* steady-state rtkpos epochs */
+    for (i=0;i<nepoch;i++,time=timeadd(time,1.0)) {
+        robs.n=gen_obs(&nav,time,rr,1,N[0],robs.data);
+        bobs.n=gen_obs(&nav,time,rb,2,N[1],bobs.data);
+
+        n0=nalloc; tp=uv_hrtime();
+        rtkpos(&rtk,&robs,&bobs,&nav);
+        tp=uv_hrtime()-tp; n0=nalloc-n0;
+        if (rtk.sol.stat==SOLQ_NONE) nnull++;
+        if (i<NWARM) continue;
+        if (rtk.sol.stat==SOLQ_FIX) nfix++;
+        tc+=tp; na+=n0; if (n0>nmax) nmax=n0;
+    }
+    for (i=0;i<3;i++) dr[i]=rtk.sol.rr[i]-rr[i];
+    fprintf(stdout,"rtkpos  : epochs=%d sats=%d fix=%d none=%d err=%6.3lf m %8.1lf us/epoch allocs=%6.1lf /epoch (max %llu)\n",
+            nepoch-NWARM,robs.n,nfix,nnull,norm(dr,3),tc*1E-3/(nepoch-NWARM),(double)na/(nepoch-NWARM),
+            (unsigned long long)nmax);
+    fprintf(stdout,"filtws  : nmax=%d mmax=%d\n",rtk.ws.nmax,rtk.ws.mmax);
+
+    /* filter with temporary workspace (former) vs rtk workspace */
+    if (!(nx=gen_filter(&rtk,ix,&H,&v,&R))) return -1;
+    m=(nx-3)*2;
+    x=mat(rtk.nx,1); P=mat(rtk.nx,rtk.nx);
+    for (j=0;j<4;j++) {
+        for (i=0,tc=0,nf[j%2]=0;i<NLOOP;i++) {
+            matcpy(x,rtk.x,rtk.nx,1);
+            matcpy(P,rtk.P,rtk.nx,rtk.nx);
+            n0=nalloc; tp=uv_hrtime();
+            info|=j%2?filter_ws(x,P,H,v,R,rtk.nx,m,ix,nx,&rtk.ws):filter(x,P,H,v,R,rtk.nx,m,ix,nx);
+            tc+=uv_hrtime()-tp; nf[j%2]+=nalloc-n0;
+        }
+        fprintf(stdout,"%-8s: states=%d meas=%d %8.2lf us/call allocs=%5.2lf /call\n",j%2?"filterws":"filter",
+                nx,m,tc*1E-3/NLOOP,(double)nf[j%2]/NLOOP);
+    }
+    free(x); free(P); free(H); free(v); free(R);
+    rtkfree(&rtk);
+    free(nav.eph);
+    return info||nf[1]||na?-1:0;
+}
@@ -0,0 +1,110 @@
+#include <malloc.h>
+#include "simobs.h"
+
+#define NBASELINE   500     /* number of baselines */
+#define NBASELINE_FULL 100  /* number of baselines of full layout */
+#define NEPOCH      40      /* number of simulated epochs */
+#define NWARM       10      /* warm-up epochs excluded from timing */
+#define BASELEN     5000.0  /* baseline length (m) */
+
+typedef struct baseline {
+    rtk_t rtk;
+    double rb[3],rr[3];
+    int N[2][NSIM][2];
+} baseline_t;
+
+/* heap in use (bytes) -------------------------------------------------------*/
+static size_t heap_used(void)
+{
+    struct mallinfo2 mi=mallinfo2();
+    return mi.uordblks+mi.hblkhd;
+}
+
+/* run baselines with state slots reserved up front (0: grow on demand) ------*/
+static int run_layout(const char *name, int nslot, int nbl, int nepoch, const nav_t *nav)
+{
+    prcopt_t opt=prcopt_default_rtk;
+    baseline_t *bls;
+    obsd_t obsd[MAXOBS*2];
+    obs_t robs={0,0,obsd},bobs={0,0,obsd+MAXOBS};
+    gtime_t time=gpst2time(2200,3600.0);
+    double pos[3],enu[3]={BASELEN*0.6,BASELEN*0.8,10.0},dr[3],err=0.0;
+    size_t heap0,heap1,heap2;
+    uint64_t tp,tc=0;
+    int i,j,k,nfix=0,nx=0;
+
+    srand(2023);
+    opt.navsys=SYS_GPS|SYS_GAL;
+
+    bls=calloc(nbl,sizeof(baseline_t));
+    for (i=0;i<nbl;i++) {
+        pos[0]=(30.0+5.0*rand()/RAND_MAX)*D2R;
+        pos[1]=(110.0+5.0*rand()/RAND_MAX)*D2R;
+        pos[2]=50.0;
+        pos2ecef(pos,bls[i].rb);
+        enu2ecef(pos,enu,dr);
+        for (k=0;k<3;k++) bls[i].rr[k]=bls[i].rb[k]+dr[k];
+        for (j=0;j<NSIM;j++) for (k=0;k<2;k++) {
+            bls[i].N[0][j][k]=rand()%2000-1000;
+            bls[i].N[1][j][k]=rand()%2000-1000;
+        }
+    }
+    heap0=heap_used();
+    for (i=0;i<nbl;i++) {
+        rtkinit(&bls[i].rtk,&opt);
+        if (nslot>0) rtkslots(&bls[i].rtk,nslot);
+        matcpy(bls[i].rtk.rb,bls[i].rb,1,3);
+    }
+    heap1=heap_used();
+
+    for (j=0;j<nepoch;j++,time=timeadd(time,1.0)) {
+        for (i=0;i<nbl;i++) {
+            robs.n=gen_obs(nav,time,bls[i].rr,1,bls[i].N[0],robs.data);
+            bobs.n=gen_obs(nav,time,bls[i].rb,2,bls[i].N[1],bobs.data);
+
+            tp=uv_hrtime();
+            rtkpos(&bls[i].rtk,&robs,&bobs,nav);
+            if (j>=NWARM) tc+=uv_hrtime()-tp;
+        }
+    }
+    heap2=heap_used();
+
+    for (i=0;i<nbl;i++) {
+        for (k=0;k<3;k++) dr[k]=bls[i].rtk.sol.rr[k]-bls[i].rr[k];
+        if (bls[i].rtk.sol.stat==SOLQ_FIX) nfix++;
+        if (norm(dr,3)>err) err=norm(dr,3);
+        if (bls[i].rtk.nx>nx) nx=bls[i].rtk.nx;
+    }
+    fprintf(stdout,"%-6s: nx=%3d baselines=%3d heap=%8.1lf KB/baseline (init) %8.1lf KB/baseline (steady) "
+            "%7.1lf us/baseline fix=%d/%d maxerr=%6.3lf m\n",name,nx,nbl,(heap1-heap0)/1024.0/nbl,
+            (heap2-heap0)/1024.0/nbl,tc*1E-3/(nepoch-NWARM)/nbl,nfix,nbl,err);
+
+    for (i=0;i<nbl;i++) rtkfree(&bls[i].rtk);
+    free(bls);
+    return nfix>=nbl*9/10;
+}
+
+int main(int argc, const char *argv[])
+{
+    nav_t nav={0};
+    gtime_t time=gpst2time(2200,3600.0);
+    int nbl=NBASELINE,nbl_full=NBASELINE_FULL,nepoch=NEPOCH,stat;
+
+    if (argc>1) nbl=atoi(argv[1]);
+    if (argc>2) nepoch=atoi(argv[2]);
+    if (argc>3) nbl_full=atoi(argv[3]);
+    if (nepoch<=NWARM) nepoch=NWARM+1;
+
+    srand(2023);
+    gen_nav(&nav,timeadd(time,-60.0));
+
+    fprintf(stdout,"layout: MAXSAT=%d MAXOBS=%d nf=%d sizeof(rtk_t)=%.1lf KB epochs=%d\n",MAXSAT,MAXOBS,
+            prcopt_default_rtk.nf,sizeof(rtk_t)/1024.0,nepoch-NWARM);
+
+    /* slots of tracked satellites vs one slot per satellite (former layout) */
+    stat =run_layout("slots",0,nbl,nepoch,&nav);
+    stat&=run_layout("full",MAXSAT,nbl_full,nepoch,&nav);
+
+    free(nav.eph);
+    return stat?0:-1;
+}
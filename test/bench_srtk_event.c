@@ -0,0 +1,136 @@
+#include "cors.h"
+#include <sys/resource.h>
+
+#define NSRTK       16      /* number of srtk instances (2 threads each) */
+#define NEPOCH      200     /* number of epochs for wakeup latency */
+#define IDLE_SEC    2.0     /* idle measurement period (s) */
+#define NWORKER     4       /* number of rtk pool workers */
+#define NBURST      50      /* number of burst epochs */
+
+static double proc_cputime(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF,&ru);
+    return ru.ru_utime.tv_sec+ru.ru_stime.tv_sec+(ru.ru_utime.tv_usec+ru.ru_stime.tv_usec)*1E-6;
+}
+
+static int gen_obs(obsd_t *obs, gtime_t time, int rcv)
+{
+    int j,n=0;
+
+    for (j=1;j<=8;j++) {
+        memset(obs+n,0,sizeof(obsd_t));
+        obs[n].time=time;
+        obs[n].sat=satno(SYS_GPS,j);
+        obs[n].rcv=rcv;
+        obs[n].code[0]=CODE_L1C;
+        obs[n].P[0]=2.1E7+1E5*j;
+        obs[n].L[0]=obs[n].P[0]/CLIGHT*FREQ1;
+        n++;
+    }
+    return n;
+}
+
+int main(int argc, const char *argv[])
+{
+    cors_t *cors=calloc(1,sizeof(cors_t));
+    cors_srtk_t *srtk=calloc(NSRTK,sizeof(cors_srtk_t));
+    cors_baseline_t *bl;
+    obsd_t obs[MAXOBS];
+    gtime_t time=gpst2time(2200,0.0);
+    uint64_t tp,tsum=0,tmax=0,dt;
+    double tc;
+    int i,j,n,nworker=NWORKER,busy;
+
+    if (argc>1) nworker=atoi(argv[1]);
+
+    /* feeding thread at the priority of the workers, as with cors_start() */
+    cors_set_thread_rt_priority();
+
+    cors_initobs(&cors->obs);
+    cors_initnav(&cors->nav);
+    cors_initssat(&cors->ssats);
+    cors_initsta(&cors->stas);
+    if (!cors_rtkpool_start(&cors->rtkpool,cors,nworker)) return -1;
+
+    for (i=0;i<NSRTK;i++) {
+        srtk[i].ID=i;
+        if (!cors_srtk_start(srtk+i,cors,NULL,"")) return -1;
+        cors_srtk_add_baseline(srtk+i,2*i+1,2*i+2);
+    }
+    uv_sleep(200);
+
+    /* idle: no observation arrives */
+    tc=proc_cputime();
+    uv_sleep((int)(IDLE_SEC*1000));
+    tc=proc_cputime()-tc;
+    fprintf(stdout,"idle     : srtk=%d threads=%d cpu=%6.3lf s in %.1lf s (%5.2lf%% of one core)\n",
+            NSRTK,NSRTK+cors->rtkpool.nworker,tc,IDLE_SEC,tc/IDLE_SEC*100.0);
+
+    /* wakeup latency: rover/base epoch arrival to baseline scheduled */
+    HASH_FIND_STR(srtk[0].bls.data,"1->2",bl);
+    if (!bl) return -1;
+
+    for (i=0;i<NEPOCH;i++) {
+        time=timeadd(time,1.0);
+        n=gen_obs(obs,time,2);
+        cors_updobs(&cors->obs,obs,n,1);
+        n=gen_obs(obs,time,1);
+        tp=uv_hrtime();
+        cors_updobs(&cors->obs,obs,n,2);
+        while (fabs(timediff(bl->time,time))>1E-3) sched_yield();
+        dt=uv_hrtime()-tp;
+        tsum+=dt;
+        if (dt>tmax) tmax=dt;
+        uv_sleep(5);
+    }
+    fprintf(stdout,"wakeup   : epochs=%d avg=%8.1lf us max=%8.1lf us\n",NEPOCH,tsum*1E-3/NEPOCH,tmax*1E-3);
+
+    /* burst: all sources get epochs back to back, pool drains every baseline */
+    tp=uv_hrtime();
+    for (i=0;i<NBURST;i++) {
+        time=timeadd(time,1.0);
+        for (j=1;j<=2*NSRTK;j++) {
+            n=gen_obs(obs,time,j);
+            cors_updobs(&cors->obs,obs,n,j);
+        }
+    }
+    do {
+        uv_sleep(1);
+        for (i=busy=0;i<NSRTK;i++) {
+            for (bl=srtk[i].bls.data;bl;bl=bl->hh.next) {
+                if (fabs(timediff(bl->time,time))>1E-3||__atomic_load_n(&bl->on,__ATOMIC_SEQ_CST)) busy++;
+            }
+        }
+    } while (busy);
+    dt=uv_hrtime()-tp;
+    fprintf(stdout,"burst    : epochs=%d baselines=%d workers=%d time=%8.1lf ms\n",NBURST,NSRTK,
+            cors->rtkpool.nworker,dt*1E-6);
+    for (i=0;i<cors->rtkpool.nworker;i++) {
+        fprintf(stdout,"worker %2d: run=%6llu steal=%6llu\n",i,
+                (unsigned long long)cors->rtkpool.workers[i].nrun,
+                (unsigned long long)cors->rtkpool.workers[i].nsteal);
+    }
+
+    /* delete: baselines are deleted while their burst epochs are running */
+    for (i=0;i<NBURST;i++) {
+        time=timeadd(time,1.0);
+        for (j=1;j<=2*NSRTK;j++) {
+            n=gen_obs(obs,time,j);
+            cors_updobs(&cors->obs,obs,n,j);
+        }
+    }
+    tp=uv_hrtime();
+    for (i=0;i<NSRTK;i++) cors_srtk_del_baseline(srtk+i,2*i+1,2*i+2);
+    do {
+        uv_sleep(1);
+        for (i=busy=0;i<NSRTK;i++) if (srtk[i].bls.data) busy++;
+    } while (busy);
+    dt=uv_hrtime()-tp;
+    fprintf(stdout,"delete   : baselines=%d time=%8.1lf ms\n",NSRTK,dt*1E-6);
+
+    for (i=0;i<NSRTK;i++) cors_srtk_close(srtk+i);
+    cors_rtkpool_close(&cors->rtkpool);
+    free(srtk);
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "cors.h"
+
+#define NSTA        5100    /* number of stations (about 10k triangles) */
+#define NQUERY      100000  /* number of query points */
+#define NREF        2000    /* number of queries checked by linear search */
+
+/* former linear search by pnpoly on each triangle ---------------------------*/
+static int is_in_dtrig_ref(const cors_dtrig_t *dtrig, const double *pos)
+{
+    double coord_p2x[3],coord_p2y[3],pc[3]={0};
+    double pos0[3],dr[3],e[3];
+    int i,j;
+
+    for (i=0;i<3;i++) {
+        for (j=0;j<3;j++) pc[i]+=dtrig->vt[j]->pos[i];
+        pc[i]/=3.0;
+    }
+    ecef2pos(pc,pos0);
+
+    for (i=0;i<3;i++) {
+        for (j=0;j<3;j++) dr[j]=dtrig->vt[i]->pos[j]-pc[j];
+        ecef2enu(pos0,dr,e);
+        coord_p2x[i]=e[0];
+        coord_p2y[i]=e[1];
+    }
+    for (i=0;i<3;i++) dr[i]=pos[i]-pc[i];
+    ecef2enu(pos0,dr,e);
+    return pnpoly(3,coord_p2x,coord_p2y,e[0],e[1]);
+}
+
+static cors_dtrig_t* find_dtrig_ref(cors_dtrig_net_t *net, const double *pos, int *in)
+{
+    cors_dtrig_t *d,*t;
+
+    HASH_ITER(hh,net->dtrigs,d,t) {
+        if (!is_in_dtrig_ref(d,pos)) continue;
+        *in=1;
+        return d;
+    }
+    *in=0;
+    return NULL;
+}
+
+static void gen_pos(double *rr, double margin)
+{
+    double pos[3];
+    pos[0]=(30.0-margin+(9.0+2.0*margin)*rand()/RAND_MAX)*D2R;
+    pos[1]=(110.0-margin+(10.0+2.0*margin)*rand()/RAND_MAX)*D2R;
+    pos[2]=100.0*rand()/RAND_MAX;
+    pos2ecef(pos,rr);
+}
+
+int main(int argc, const char *argv[])
+{
+    cors_dtrig_net_t net;
+    cors_dtrig_t *d,*dr;
+    double (*qs)[3],rr[3];
+    uint64_t t0,t1,t2;
+    int i,in,inr,nsta=NSTA,nquery=NQUERY,nin=0,nout=0,nnull=0,nmis=0,nref=NREF;
+
+    if (argc>1) nsta=atoi(argv[1]);
+    if (argc>2) nquery=atoi(argv[2]);
+    if (nref>nquery) nref=nquery;
+
+    srand(4321);
+    cors_dtrignet_init(&net);
+    for (i=0;i<nsta;i++) {
+        gen_pos(rr,0.0);
+        cors_dtrignet_add_vertex(&net,rr,i+1,NULL,NULL,NULL,NULL);
+    }
+    qs=malloc(sizeof(double)*3*nquery);
+    for (i=0;i<nquery;i++) gen_pos(qs[i],0.5);
+
+    fprintf(stdout,"network  : vertexs=%d trigs=%d queries=%d\n",HASH_COUNT(net.vertexs),HASH_COUNT(net.dtrigs),nquery);
+
+    /* linear search (former) vs walk index on the same queries */
+    t0=uv_hrtime();
+    for (i=0;i<nref;i++) find_dtrig_ref(&net,qs[i],&inr);
+    t1=uv_hrtime();
+    for (i=0;i<nref;i++) {
+        d=cors_dtrignet_locate(&net,qs[i],&in);
+        dr=find_dtrig_ref(&net,qs[i],&inr);
+        if (in!=inr||(in&&d!=dr)) nmis++;
+    }
+    fprintf(stdout,"linear   : queries=%d %10.1lf us/query mismatch=%d\n",nref,(t1-t0)*1E-3/nref,nmis);
+
+    t1=uv_hrtime();
+    for (i=0;i<nquery;i++) {
+        if (!(d=cors_dtrignet_locate(&net,qs[i],&in))) nnull++;
+        else if (in) nin++; else nout++;
+    }
+    t2=uv_hrtime();
+    fprintf(stdout,"walk     : queries=%d %10.3lf us/query in=%d nearest=%d none=%d\n",nquery,(t2-t1)*1E-3/nquery,
+            nin,nout,nnull);
+
+    free(qs);
+    cors_dtrignet_free(&net);
+    return nnull?-1:0;
+}
@@ -0,0 +1,135 @@
+#include "simobs.h"
+
+#define NROVER      4000    /* rovers connected over the day */
+#define TDAY        36000.0 /* simulated service time (s) */
+#define TGGA        10.0    /* gga interval (s) */
+#define REGION      60000.0 /* service area size (m) */
+#define NTOWN       25      /* rover clusters (work sites) */
+#define RADIUS      5000.0  /* on-demand vrs sharing radius (m) */
+#define IDLE        300     /* idle timeout (s) */
+
+typedef struct rover {
+    double t0,t1;           /* session start/end time (s) */
+    double pos[3],vel[3];
+    char mntpnt[32];
+    int on;
+} rover_t;
+
+/* gga of rovers arriving at work sites, sessions of 10-60 min ---------------*/
+static void init_rovers(rover_t *rov, const double *pos0)
+{
+    double town[NTOWN][2],enu[3]={0},r0[3],dr[3],az;
+    int i,j,k;
+
+    pos2ecef(pos0,r0);
+    for (k=0;k<NTOWN;k++) {
+        town[k][0]=REGION*((double)rand()/RAND_MAX-0.5);
+        town[k][1]=REGION*((double)rand()/RAND_MAX-0.5);
+    }
+    for (i=0;i<NROVER;i++) {
+        k=rand()%NTOWN;
+        rov[i].t0=(TDAY-3600.0)*rand()/RAND_MAX;
+        rov[i].t1=rov[i].t0+600.0+3000.0*rand()/RAND_MAX;
+        enu[0]=town[k][0]+2000.0*randn();
+        enu[1]=town[k][1]+2000.0*randn();
+        enu2ecef(pos0,enu,dr);
+        for (j=0;j<3;j++) rov[i].pos[j]=r0[j]+dr[j];
+        az=2.0*PI*rand()/RAND_MAX;
+        enu[0]=sin(az)*rand()/RAND_MAX; enu[1]=cos(az)*rand()/RAND_MAX;
+        enu2ecef(pos0,enu,rov[i].vel);
+    }
+}
+
+/* run service day with station cap, return steps over cap ------------------*/
+static int run_day(cors_t *cors, rover_t *rov, int maxsta, int verbose)
+{
+    cors_vrs_t *vrs=&cors->vrs;
+    gtime_t time0=timeget();
+    double t,avg=0.0,kb;
+    char name[32];
+    uint64_t tp,tc=0,ngga=0;
+    int i,j,n,nuser,nsta,nmax=0,nstep=0,nnew=0,nchg=0,nbad=0;
+
+    cors->opt.vrs_maxsta=maxsta;
+    vrs->cors=cors;
+    vrs->dsta_kdtree=kd_create(3);
+    vrs->dseq=0;
+    vrs->state=1;
+
+    for (t=0.0;t<TDAY;t+=TGGA,nstep++) {
+        timeset(timeadd(time0,t));
+
+        for (i=nuser=0;i<NROVER;i++) {
+            if (rov[i].on&&t>=rov[i].t1) {
+                cors_vrs_detach(vrs,rov[i].mntpnt);
+                rov[i].on=0;
+                continue;
+            }
+            if (t<rov[i].t0||t>=rov[i].t1) continue;
+            for (j=0;j<3;j++) rov[i].pos[j]+=rov[i].vel[j]*TGGA;
+
+            tp=uv_hrtime();
+            n=cors_vrs_attach(vrs,rov[i].pos,rov[i].mntpnt,name);
+            tc+=uv_hrtime()-tp;
+            ngga++;
+            if (n>0) {
+                if (rov[i].on) nchg++;
+                strcpy(rov[i].mntpnt,name);
+            }
+            if (!rov[i].on) nnew++;
+            rov[i].on=1;
+            nuser++;
+        }
+        cors_vrs_evict(vrs);
+
+        nsta=HASH_COUNT(vrs->dstas);
+        if (maxsta>0&&nsta>maxsta) nbad++;
+        if (nsta>nmax) nmax=nsta;
+        avg+=nsta;
+        if (verbose&&fmod(t,3600.0)==0.0) {
+            fprintf(stdout,"t=%5.1lf h rovers=%4d stations=%4d\n",t/3600.0,nuser,nsta);
+        }
+    }
+    kb=(sizeof(cors_vrs_sta_t)+MAXOBS*sizeof(obsd_t))/1024.0;
+
+    if (verbose) {
+        fprintf(stdout,"rovers  : %d sessions over %.0lf h, radius=%.0lf m idle=%d s\n",nnew,TDAY/3600.0,
+                RADIUS,IDLE);
+        fprintf(stdout,"static  : %6d stations %10.1lf MB (one per first gga, never freed)\n",nnew,
+                nnew*kb/1024.0);
+    }
+    fprintf(stdout,"cap=%4d: %6d created, max=%d avg=%.1lf end=%d stations, max %.1lf MB, "
+            "moved=%d, %.2lf us/gga\n",maxsta,vrs->dseq,nmax,avg/nstep,HASH_COUNT(vrs->dstas),nmax*kb/1024.0,
+            nchg,tc*1E-3/ngga);
+
+    timereset();
+    cors_vrs_close(vrs);
+    for (i=0;i<NROVER;i++) rov[i].on=0,rov[i].mntpnt[0]='\0';
+    return nbad;
+}
+
+int main(int argc, const char *argv[])
+{
+    cors_t *cors=calloc(1,sizeof(cors_t));
+    cors_vrs_t *vrs=&cors->vrs;
+    rover_t *rov=calloc(NROVER,sizeof(rover_t)),*rov0=calloc(NROVER,sizeof(rover_t));
+    double pos0[3]={30.5*D2R,114.3*D2R,50.0};
+    int nbad=0;
+
+    srand(2023);
+    init_rovers(rov0,pos0);
+
+    cors->opt.vrs_radius=RADIUS;
+    cors->opt.vrs_idle=IDLE;
+    uv_mutex_init(&vrs->dlock);
+
+    memcpy(rov,rov0,sizeof(rover_t)*NROVER);
+    nbad+=run_day(cors,rov,0,1);
+    memcpy(rov,rov0,sizeof(rover_t)*NROVER);
+    nbad+=run_day(cors,rov,40,0);
+    fprintf(stdout,"check   : steps over cap=%d\n",nbad);
+
+    uv_mutex_destroy(&vrs->dlock);
+    free(rov); free(rov0); free(cors);
+    return nbad?-1:0;
+}
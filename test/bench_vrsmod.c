@@ -0,0 +1,139 @@
+#include "simobs.h"
+
+#define NTRIG       100     /* number of triangles */
+#define NVSTA       100     /* vrs stations per triangle */
+#define NEPOCH      15      /* number of simulated epochs */
+#define NWARM       10      /* epochs to fix the baselines before vrs */
+#define BASELEN     15000.0 /* master to auxiliary station distance (m) */
+
+typedef struct triangle {
+    double rr[3][3];        /* master and auxiliary stations */
+    double vpos[NVSTA][3];  /* vrs positions */
+    int N[3][NSIM][2];
+    obsd_t data[3][MAXOBS];
+    obs_t obs[3];
+    rtk_t rtk[2];           /* master->auxiliary baselines */
+    cors_baseline_t bl[2];
+} triangle_t;
+
+static obsd_t vobs[2][NVSTA][MAXOBS];
+
+static void init_trig(triangle_t *trig, const prcopt_t *opt, int k)
+{
+    double pos0[3],enu[3],dr[3],a,b;
+    int i,j;
+
+    pos0[0]=(25.0+(k/10)*0.5)*D2R;
+    pos0[1]=(105.0+(k%10)*0.5)*D2R;
+    pos0[2]=50.0;
+    pos2ecef(pos0,trig->rr[0]);
+    for (i=0;i<2;i++) {
+        enu[0]=BASELEN*cos(i*60.0*D2R); enu[1]=BASELEN*sin(i*60.0*D2R); enu[2]=5.0*i;
+        enu2ecef(pos0,enu,dr);
+        for (j=0;j<3;j++) trig->rr[i+1][j]=trig->rr[0][j]+dr[j];
+    }
+    for (i=0;i<NVSTA;i++) {
+        a=(double)rand()/RAND_MAX; b=(double)rand()/RAND_MAX*(1.0-a);
+        enu[0]=BASELEN*(a+b*cos(60.0*D2R)); enu[1]=BASELEN*b*sin(60.0*D2R); enu[2]=0.0;
+        enu2ecef(pos0,enu,dr);
+        for (j=0;j<3;j++) trig->vpos[i][j]=trig->rr[0][j]+dr[j];
+    }
+    for (i=0;i<3;i++) for (j=0;j<NSIM;j++) {
+        trig->N[i][j][0]=rand()%2000-1000;
+        trig->N[i][j][1]=rand()%2000-1000;
+    }
+    for (i=0;i<2;i++) {
+        rtkinit(trig->rtk+i,opt);
+        matcpy(trig->rtk[i].rb,trig->rr[0],1,3);
+        trig->bl[i].base_srcid=k*3;
+        trig->bl[i].rover_srcid=k*3+i+1;
+    }
+}
+
+/* vrs observations of one triangle, model per vrs or shared -----------------*/
+static uint64_t run_vrs(triangle_t *trig, const nav_t *nav, const cors_blsnap_t **snap, int shared,
+                        uint64_t *tfit, int *nobs)
+{
+    static const int dire[2]={1,1};
+    cors_vrs_model_t *mod=NULL;
+    uint64_t tp=uv_hrtime(),tf;
+    int i;
+
+    for (i=0;i<NVSTA;i++) {
+        if (!mod) {
+            tf=uv_hrtime();
+            mod=cors_vrs_model_new(trig->obs[0].data[0].time,trig->rr[0],snap,dire,2);
+            cors_vrs_model_fit(mod,nav,trig->obs);
+            *tfit+=uv_hrtime()-tf;
+        }
+        nobs[i]=cors_vrs_model_obs(mod,nav,trig->vpos[i],1,trig->obs,vobs[shared][i]);
+
+        if (!shared) {
+            cors_vrs_model_unref(mod); mod=NULL;
+        }
+    }
+    cors_vrs_model_unref(mod);
+    return uv_hrtime()-tp;
+}
+
+int main(int argc, const char *argv[])
+{
+    prcopt_t opt=prcopt_default_rtk;
+    nav_t nav={0};
+    cors_blsols_t blsols;
+    triangle_t *trig=calloc(NTRIG,sizeof(triangle_t));
+    const cors_blsnap_t *snap[2];
+    gtime_t time=gpst2time(2200,3600.0);
+    uint64_t tc[2]={0},tfit[2]={0};
+    int i,j,k,nobs[2][NVSTA],nfix=0,nbl=0,ndiff=0,nv=0;
+
+    srand(2023);
+    cors_initblsol(&blsols);
+    gen_nav(&nav,timeadd(time,-60.0));
+    opt.navsys=SYS_GPS|SYS_GAL;
+    for (k=0;k<NTRIG;k++) init_trig(trig+k,&opt,k);
+
+    for (j=0;j<NEPOCH;j++,time=timeadd(time,1.0)) {
+        for (k=0;k<NTRIG;k++) {
+            for (i=0;i<3;i++) {
+                trig[k].obs[i].data=trig[k].data[i];
+                trig[k].obs[i].n=gen_obs(&nav,time,trig[k].rr[i],i?1:2,trig[k].N[i],trig[k].data[i]);
+            }
+            for (i=0;i<2;i++) {
+                rtkpos(trig[k].rtk+i,trig[k].obs+i+1,trig[k].obs,&nav);
+                cors_updblsol(&blsols,trig[k].bl+i,trig[k].rtk+i,trig[k].bl[i].base_srcid,
+                              trig[k].bl[i].rover_srcid);
+                if (j==NEPOCH-1) {
+                    nfix+=trig[k].rtk[i].sol.stat==SOLQ_FIX;
+                    nbl++;
+                }
+            }
+        }
+        if (j<NWARM) continue;
+
+        for (k=0;k<NTRIG;k++) {
+            for (i=0;i<2;i++) snap[i]=cors_blsol_snap(trig[k].bl[i].sol);
+
+            for (i=0;i<2;i++) tc[i]+=run_vrs(trig+k,&nav,snap,i,tfit+i,nobs[i]);
+
+            for (i=0;i<NVSTA;i++,nv++) {
+                if (nobs[0][i]!=nobs[1][i]||
+                    memcmp(vobs[0][i],vobs[1][i],sizeof(obsd_t)*nobs[0][i])) ndiff++;
+            }
+            for (i=0;i<2;i++) cors_blsnap_unref(snap[i]);
+        }
+    }
+    fprintf(stdout,"network : triangles=%d vrs=%d epochs=%d fixed baselines=%d/%d\n",NTRIG,NTRIG*NVSTA,
+            NEPOCH-NWARM,nfix,nbl);
+    fprintf(stdout,"per-vrs : %8.1lf ms/epoch (fit %7.2lf ms/epoch)\n",tc[0]*1E-6/(NEPOCH-NWARM),
+            tfit[0]*1E-6/(NEPOCH-NWARM));
+    fprintf(stdout,"shared  : %8.1lf ms/epoch (fit %7.2lf ms/epoch)\n",tc[1]*1E-6/(NEPOCH-NWARM),
+            tfit[1]*1E-6/(NEPOCH-NWARM));
+    fprintf(stdout,"check   : vrs epochs=%d mismatches=%d\n",nv,ndiff);
+
+    cors_freeblsol(&blsols);
+    for (k=0;k<NTRIG;k++) for (i=0;i<2;i++) rtkfree(trig[k].rtk+i);
+    free(trig);
+    free(nav.eph);
+    return ndiff?-1:0;
+}
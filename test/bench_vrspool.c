@@ -0,0 +1,128 @@
+#include "simobs.h"
+
+#define NVMAX       4000    /* max number of virtual stations */
+#define NEPOCH      3       /* epochs per run */
+#define RADIUS      20000.0 /* vrs distance from master station (m) */
+
+static const int nvsta[]={250,500,1000,2000,4000};
+
+static void push_epoch(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, int n, const obs_t *mobs,
+                       cors_vrs_model_t *mod)
+{
+    cors_vrs_task_t *task;
+    int i;
+
+    for (i=0;i<n;i++) {
+        task=calloc(1,sizeof(*task));
+        task->mobs.data=calloc(mobs->n,sizeof(obsd_t));
+        task->mobs.n=mobs->n;
+        memcpy(task->mobs.data,mobs->data,sizeof(obsd_t)*mobs->n);
+        task->vrs=vrs;
+        task->vsta=vsta+i;
+        task->mod=cors_vrs_model_ref(mod);
+        cors_vrspool_push(&vrs->pool,task);
+    }
+}
+
+/* one epoch of all stations pushed at once, wait until pool drained ---------*/
+static void run_epoch(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, int n, const obs_t *mobs,
+                      cors_vrs_model_t *mod)
+{
+    cors_vrspool_t *pool=&vrs->pool;
+    uint64_t n0,n1;
+
+    n0=pool->ngen+pool->nlate+pool->nskip;
+    push_epoch(vrs,vsta,n,mobs,mod);
+    do {
+        uv_sleep(1);
+        uv_mutex_lock(&pool->lock);
+        n1=pool->ngen+pool->nlate+pool->nskip;
+        uv_mutex_unlock(&pool->lock);
+    } while (n1-n0<(uint64_t)n);
+}
+
+/* cancel all stations while an epoch is in flight (ms) -----------------------*/
+static double cancel_epoch(cors_vrs_t *vrs, cors_vrs_sta_t *vsta, int n, const obs_t *mobs,
+                           cors_vrs_model_t *mod)
+{
+    uint64_t tc;
+    int i;
+
+    push_epoch(vrs,vsta,n,mobs,mod);
+    tc=uv_hrtime();
+    for (i=0;i<n;i++) cors_vrspool_cancel(&vrs->pool,vsta+i);
+    return (uv_hrtime()-tc)*1E-6;
+}
+
+int main(int argc, const char *argv[])
+{
+    cors_t *cors=calloc(1,sizeof(cors_t));
+    cors_vrs_t *vrs=&cors->vrs;
+    cors_vrs_sta_t *vsta=calloc(NVMAX,sizeof(cors_vrs_sta_t));
+    cors_vrs_model_t *mod;
+    obsd_t data[MAXOBS];
+    obs_t mobs={0,0,data};
+    gtime_t time=gpst2time(2200,3600.0);
+    uv_cpu_info_t *cpus;
+    double pos[3]={30.5*D2R,114.3*D2R,50.0},rr[3],enu[3]={0},dr[3],az,tc;
+    int i,j,k,m,ncpu=1,deadline=1000,nworker[2],N[NSIM][2]={{0}};
+
+    if (!uv_cpu_info(&cpus,&ncpu)) uv_free_cpu_info(cpus,ncpu);
+    nworker[0]=1; nworker[1]=ncpu;
+    if (argc>1) deadline=atoi(argv[1]);
+    if (argc>2) nworker[1]=atoi(argv[2]); /* multi-worker run with given workers */
+
+    /* feeding thread at the priority of the workers, as with cors_start() */
+    cors_set_thread_rt_priority();
+
+    srand(2023);
+    gen_nav(&cors->nav.data,timeadd(time,-60.0));
+    uv_mutex_init(&cors->obs.lock);
+    vrs->cors=cors;
+    vrs->outrnx=0;
+    pos2ecef(pos,rr);
+
+    for (i=0;i<NVMAX;i++) {
+        az=2.0*PI*rand()/RAND_MAX;
+        enu[0]=RADIUS*sin(az)*rand()/RAND_MAX;
+        enu[1]=RADIUS*cos(az)*rand()/RAND_MAX;
+        enu2ecef(pos,enu,dr);
+        for (k=0;k<3;k++) vsta[i].pos[k]=rr[k]+dr[k];
+        sprintf(vsta[i].name,"VRS%04d",i);
+        vsta[i].srcid=-(i+1);
+        vsta[i].obs.data=calloc(MAXOBS,sizeof(obsd_t));
+        uv_mutex_init(&vsta[i].lock);
+    }
+    fprintf(stdout,"vrs pool: cpus=%d deadline=%d ms epochs=%d\n",ncpu,deadline,NEPOCH);
+    fprintf(stdout,"%6s %7s %9s %9s %9s %6s %10s\n","vsta","workers","ms/epoch","p50(ms)",
+            "p99(ms)","late","cancel(ms)");
+
+    for (j=0;j<(int)(sizeof(nvsta)/sizeof(nvsta[0]));j++) {
+        for (m=0;m<(nworker[1]>1?2:1);m++) {
+            if (!cors_vrspool_start(&vrs->pool,nworker[m],deadline)) return -1;
+            uint64_t tp=uv_hrtime();
+
+            for (k=0;k<NEPOCH;k++) {
+                mobs.n=gen_obs(&cors->nav.data,timeadd(time,k),rr,1,N,data);
+                mod=cors_vrs_model_new(data[0].time,rr,NULL,NULL,0);
+                run_epoch(vrs,vsta,nvsta[j],&mobs,mod);
+                if (k<NEPOCH-1) cors_vrs_model_unref(mod);
+            }
+            tp=uv_hrtime()-tp;
+            tc=cancel_epoch(vrs,vsta,nvsta[j],&mobs,mod);
+            cors_vrs_model_unref(mod);
+            fprintf(stdout,"%6d %7d %9.1lf %9.1lf %9.1lf %6llu %10.2lf\n",nvsta[j],vrs->pool.nworker,
+                    tp*1E-6/NEPOCH,cors_vrspool_latency(&vrs->pool,0.5),
+                    cors_vrspool_latency(&vrs->pool,0.99),(unsigned long long)vrs->pool.nlate,tc);
+            cors_vrspool_close(&vrs->pool);
+        }
+    }
+    for (i=0;i<NVMAX;i++) {
+        freeobs(&vsta[i].obs);
+        uv_mutex_destroy(&vsta[i].lock);
+    }
+    cors_freeobs(&cors->obs);
+    free(cors->nav.data.eph);
+    free(vsta); free(cors);
+    return 0;
+}
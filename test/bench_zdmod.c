@@ -0,0 +1,119 @@
+#include "simobs.h"
+
+#define NROW        10      /* station rows */
+#define NCOL        20      /* station columns */
+#define NSTA        (NROW*NCOL)
+#define SPACING     10000.0 /* station spacing (m) */
+#define NEPOCH      20      /* number of simulated epochs */
+#define NWARM       5       /* warm-up epochs excluded from timing */
+
+typedef struct station {
+    double rr[3];
+    int N[NSIM][2];
+    obsd_t data[MAXOBS];
+    obs_t obs;
+    zdmod_t mod;
+} station_t;
+
+typedef struct baseline {
+    int base,rover;
+    rtk_t rtk;
+} baseline_t;
+
+/* baselines of triangulated grid, both directions ---------------------------*/
+static int gen_baselines(baseline_t *bls)
+{
+    static const int off[3][2]={{0,1},{1,0},{1,1}};
+    int i,j,k,n=0;
+
+    for (i=0;i<NROW;i++) for (j=0;j<NCOL;j++) for (k=0;k<3;k++) {
+        if (i+off[k][0]>=NROW||j+off[k][1]>=NCOL) continue;
+        bls[n].base=i*NCOL+j;
+        bls[n++].rover=(i+off[k][0])*NCOL+j+off[k][1];
+        bls[n].rover=i*NCOL+j;
+        bls[n++].base=(i+off[k][0])*NCOL+j+off[k][1];
+    }
+    return n;
+}
+
+/* run all epochs with per-baseline base residuals or per-station model ------*/
+static double run_bench(station_t *sta, baseline_t *bls, int nbl, const nav_t *nav,
+                        const prcopt_t *opt, int mode, double *sol, double *tmod)
+{
+    gtime_t time=gpst2time(2200,3600.0);
+    uint64_t tp,tc=0,tm=0;
+    int i,j,k;
+
+    srand(2023);
+    for (i=0;i<NSTA;i++) for (j=0;j<NSIM;j++) {
+        sta[i].N[j][0]=rand()%2000-1000;
+        sta[i].N[j][1]=rand()%2000-1000;
+    }
+    for (i=0;i<nbl;i++) {
+        rtkinit(&bls[i].rtk,opt);
+        matcpy(bls[i].rtk.rb,sta[bls[i].base].rr,1,3);
+    }
+    for (j=0;j<NEPOCH;j++,time=timeadd(time,1.0)) {
+        for (i=0;i<NSTA;i++) {
+            sta[i].obs.data=sta[i].data;
+            sta[i].obs.n=gen_obs(nav,time,sta[i].rr,1,sta[i].N,sta[i].data);
+        }
+        tp=uv_hrtime();
+        if (mode) {
+            for (i=0;i<NSTA;i++) {
+                zdmodel(time,sta[i].data,sta[i].obs.n,nav,sta[i].rr,opt,&sta[i].mod);
+            }
+        }
+        if (j>=NWARM) tm+=uv_hrtime()-tp;
+
+        for (i=0;i<nbl;i++) {
+            if (mode) rtkpos_zd(&bls[i].rtk,&sta[bls[i].rover].obs,&sta[bls[i].base].obs,
+                                &sta[bls[i].base].mod,nav);
+            else      rtkpos(&bls[i].rtk,&sta[bls[i].rover].obs,&sta[bls[i].base].obs,nav);
+            for (k=0;k<3;k++) sol[k+(i+j*nbl)*3]=bls[i].rtk.sol.rr[k];
+        }
+        if (j>=NWARM) tc+=uv_hrtime()-tp;
+    }
+    for (i=0;i<nbl;i++) rtkfree(&bls[i].rtk);
+    *tmod=tm*1E-6/(NEPOCH-NWARM);
+    return tc*1E-6/(NEPOCH-NWARM);
+}
+
+int main(int argc, const char *argv[])
+{
+    prcopt_t opt=prcopt_default_rtk;
+    nav_t nav={0};
+    station_t *sta=calloc(NSTA,sizeof(station_t));
+    baseline_t *bls=calloc(NSTA*6,sizeof(baseline_t));
+    double pos0[3]={30.0*D2R,114.0*D2R,50.0},enu[3]={0},r0[3],dr[3],*sol[2],t[2],tmod[2],err=0.0;
+    int i,j,k,nbl;
+
+    gen_nav(&nav,timeadd(gpst2time(2200,3600.0),-60.0));
+    opt.navsys=SYS_GPS|SYS_GAL;
+    opt.nf=2;
+
+    pos2ecef(pos0,r0);
+    for (i=0;i<NROW;i++) for (j=0;j<NCOL;j++) {
+        enu[0]=j*SPACING; enu[1]=i*SPACING; enu[2]=10.0*((i+j)%5);
+        enu2ecef(pos0,enu,dr);
+        for (k=0;k<3;k++) sta[i*NCOL+j].rr[k]=r0[k]+dr[k];
+    }
+    nbl=gen_baselines(bls);
+
+    for (i=0;i<2;i++) {
+        sol[i]=calloc(nbl*NEPOCH*3,sizeof(double));
+        t[i]=run_bench(sta,bls,nbl,&nav,&opt,i,sol[i],tmod+i);
+    }
+    for (i=0;i<nbl*NEPOCH*3;i++) {
+        if (fabs(sol[0][i]-sol[1][i])>err) err=fabs(sol[0][i]-sol[1][i]);
+    }
+    fprintf(stdout,"network : stations=%d baselines=%d epochs=%d\n",NSTA,nbl,NEPOCH-NWARM);
+    fprintf(stdout,"baseline: %8.1lf ms/epoch (base residuals per baseline)\n",t[0]);
+    fprintf(stdout,"station : %8.1lf ms/epoch (station models %6.1lf ms/epoch)\n",t[1],tmod[1]);
+    fprintf(stdout,"check   : max solution difference=%.3e m\n",err);
+
+    free(sol[0]); free(sol[1]);
+    free(bls); free(sta);
+    free(nav.eph);
+    return err>0.0?-1:0;
+}
@@ -0,0 +1,87 @@
+/*------------------------------------------------------------------------------
+ * simobs.h : synthetic navigation/observation data for rtk benchmarks
+ *
+ * author  : sujinglan
+ * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
+ * history : 2022/11/17 1.0  new
+ *-----------------------------------------------------------------------------*/
+#ifndef SIMOBS_H
+#define SIMOBS_H
+#include "cors.h"
+
+#define NSIMGPS     32      /* number of simulated gps satellites */
+#define NSIMGAL     24      /* number of simulated galileo satellites */
+#define NSIM        (NSIMGPS+NSIMGAL)
+
+#define SQR(x)      ((x)*(x))
+
+static inline double randn(void)
+{
+    double u1=(rand()+1.0)/(RAND_MAX+2.0),u2=(rand()+1.0)/(RAND_MAX+2.0);
+    return sqrt(-2.0*log(u1))*cos(2.0*PI*u2);
+}
+
+/* synthetic gps/galileo constellations (6 planes) ---------------------------*/
+static inline void gen_nav(nav_t *nav, gtime_t toe)
+{
+    eph_t *eph;
+    int i,k,week,prn;
+
+    nav->eph=calloc(NSIM,sizeof(eph_t));
+    nav->n=nav->nmax=NSIM;
+    for (i=0;i<NSIM;i++) {
+        eph=nav->eph+i;
+        k=i<NSIMGPS?i:i-NSIMGPS;
+        prn=k+1;
+        eph->sat=satno(i<NSIMGPS?SYS_GPS:SYS_GAL,prn);
+        eph->iode=eph->iodc=prn;
+        eph->code=i<NSIMGPS?0:(1<<9)|(1<<0); /* GAL: I/NAV E1-B */
+        eph->toe=eph->toc=eph->ttr=toe;
+        eph->toes=time2gpst(toe,&week);
+        eph->week=week;
+        eph->A=i<NSIMGPS?26559710.0:29600000.0;
+        eph->e=0.005;
+        eph->i0=(i<NSIMGPS?55.0:56.0)*D2R;
+        eph->OMG0=((k%6)*60.0+(i<NSIMGPS?0.0:30.0))*D2R;
+        eph->M0=((k/6)*65.0+(k%6)*13.0)*D2R;
+        eph->OMGd=-8E-9;
+        eph->fit=4.0;
+        eph->f0=1E-5*(k%7-3);
+    }
+}
+
+/* synthetic dual-frequency observations of receiver -------------------------*/
+static inline int gen_obs(const nav_t *nav, gtime_t time, const double *rr, int rcv,
+                          const int (*N)[2], obsd_t *obs)
+{
+    double pos[3],rs[6],dts[2],var,e[3],azel[2],r,ion,trp,freq;
+    int i,f,sat,sys,svh,n=0;
+
+    ecef2pos(rr,pos);
+    for (i=0;i<NSIM;i++) {
+        sat=nav->eph[i].sat;
+        sys=satsys(sat,NULL);
+        if (!satpos(timeadd(time,-0.075),time,sat,EPHOPT_BRDC,nav,rs,dts,&var,&svh)) continue;
+        r=geodist(rs,rr,e);
+        satpos(timeadd(time,-r/CLIGHT),time,sat,EPHOPT_BRDC,nav,rs,dts,&var,&svh);
+        if ((r=geodist(rs,rr,e))<=0.0||satazel(pos,e,azel)<15.0*D2R) continue;
+
+        ion=ionmodel(time,nav->ion_gps,pos,azel);
+        trp=tropmodel(time,pos,azel,0.7);
+        memset(obs+n,0,sizeof(obsd_t));
+        obs[n].time=time;
+        obs[n].sat=sat;
+        obs[n].rcv=rcv;
+        for (f=0;f<2;f++) {
+            obs[n].code[f]=sys==SYS_GPS?(f?CODE_L2W:CODE_L1C):(f?CODE_L5Q:CODE_L1C);
+            freq=code2freq(sys,obs[n].code[f],0);
+            obs[n].SNR[f]=(uint16_t)(45.0/SNR_UNIT);
+            obs[n].P[f]=r-CLIGHT*dts[0]+trp+ion*SQR(FREQ1/freq)+0.1*randn();
+            obs[n].L[f]=(r-CLIGHT*dts[0]+trp-ion*SQR(FREQ1/freq)+0.002*randn())*freq/CLIGHT+N[i][f];
+        }
+        n++;
+    }
+    return n;
+}
+
+#endif
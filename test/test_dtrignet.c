@@ -31,7 +31,7 @@ int main(int argc, const char *argv[])
         cors_dtrig_edge_t *e,*et;
         double rr[3];
         pos2ecef(s->pos,rr);
-        cors_dtrignet_add_vertex(&dtrig_net,rr,++srcid,&edge_add,&edge_del);
+        cors_dtrignet_add_vertex(&dtrig_net,rr,++srcid,&edge_add,&edge_del,NULL,NULL);
 
         fprintf(stdout,"%s %d %d\n",s->id,srcid,HASH_COUNT(dtrig_net.edges));
 
@@ -0,0 +1,190 @@
+#include "cors.h"
+
+#define NSTA        5000    /* number of random stations */
+#define NDEL        1000    /* number of deleted stations */
+#define NMOV        1000    /* number of moved stations */
+#define NBUCKET     1000    /* operations per timing bucket */
+
+typedef struct shadow {
+    char id[32];
+    UT_hash_handle hh;
+} shadow_t;
+
+static cors_baseline_t bl_link;     /* baseline linked to edges */
+
+/* link baselines to added edges as nrtk does, count edges without one -------*/
+static int link_bls(cors_dtrig_net_t *net, cors_dtrig_edge_t *edge_add)
+{
+    cors_dtrig_edge_t *e,*et;
+    int nerr=0;
+
+    HASH_ITER(hh,edge_add,e,et) {
+        cors_dtrignet_upd_edge(net,&bl_link,e->vt[0]->srcid,e->vt[1]->srcid);
+    }
+    HASH_ITER(hh,net->edges,e,et) if (!e->bl) nerr++;
+    return nerr;
+}
+
+/* apply reported diff to shadow id set --------------------------------------*/
+static int upd_shadow(shadow_t **tbl, const char *id, int add)
+{
+    shadow_t *s;
+    HASH_FIND_STR(*tbl,id,s);
+    if (add) {
+        if (s) return 1;
+        s=calloc(1,sizeof(*s));
+        strcpy(s->id,id);
+        HASH_ADD_STR(*tbl,id,s);
+    }
+    else {
+        if (!s) return 1;
+        HASH_DEL(*tbl,s); free(s);
+    }
+    return 0;
+}
+
+static int apply_diff(shadow_t **edges, shadow_t **trigs, cors_dtrig_edge_t **edge_add, cors_dtrig_edge_t **edge_del,
+                      cors_dtrig_t **dtrig_add, cors_dtrig_t **dtrig_del)
+{
+    cors_dtrig_edge_t *e,*et;
+    cors_dtrig_t *d,*dt;
+    int nerr=0;
+
+    HASH_ITER(hh,*edge_del,e,et) {nerr+=upd_shadow(edges,e->id,0); HASH_DEL(*edge_del,e); free(e);}
+    HASH_ITER(hh,*edge_add,e,et) {nerr+=upd_shadow(edges,e->id,1); HASH_DEL(*edge_add,e); free(e);}
+    HASH_ITER(hh,*dtrig_del,d,dt) {nerr+=upd_shadow(trigs,d->id,0); HASH_DEL(*dtrig_del,d); free(d);}
+    HASH_ITER(hh,*dtrig_add,d,dt) {nerr+=upd_shadow(trigs,d->id,1); HASH_DEL(*dtrig_add,d); free(d);}
+    return nerr;
+}
+
+/* shadow built from reported diffs equals network tables -------------------*/
+static int check_shadow(cors_dtrig_net_t *net, shadow_t *edges, shadow_t *trigs)
+{
+    cors_dtrig_edge_t *e,*et;
+    cors_dtrig_t *d,*dt;
+    shadow_t *s;
+    int nerr=0;
+
+    if (HASH_COUNT(edges)!=HASH_COUNT(net->edges)) nerr++;
+    if (HASH_COUNT(trigs)!=HASH_COUNT(net->dtrigs)) nerr++;
+    HASH_ITER(hh,net->edges,e,et) {HASH_FIND_STR(edges,e->id,s); if (!s) nerr++;}
+    HASH_ITER(hh,net->dtrigs,d,dt) {HASH_FIND_STR(trigs,d->id,s); if (!s) nerr++;}
+    return nerr;
+}
+
+/* full rebuild by triangle must not change the network -----------------------*/
+static int check_rebuild(cors_dtrig_net_t *net)
+{
+    cors_dtrig_edge_t *edge_add,*edge_del;
+    cors_dtrig_t *dtrig_add=NULL,*dtrig_del=NULL;
+    shadow_t *es=NULL,*ts=NULL,*s,*t;
+    uint64_t tp;
+    int n[4];
+
+    edge_add=edge_del=NULL;
+    tp=uv_hrtime();
+    cors_dtrignet_build(net,&edge_add,&edge_del,&dtrig_add,&dtrig_del);
+    tp=uv_hrtime()-tp;
+    n[0]=HASH_COUNT(edge_add); n[1]=HASH_COUNT(edge_del);
+    n[2]=HASH_COUNT(dtrig_add); n[3]=HASH_COUNT(dtrig_del);
+    apply_diff(&es,&ts,&edge_add,&edge_del,&dtrig_add,&dtrig_del);
+    HASH_ITER(hh,es,s,t) {HASH_DEL(es,s); free(s);}
+    HASH_ITER(hh,ts,s,t) {HASH_DEL(ts,s); free(s);}
+
+    fprintf(stdout,"rebuild  : vertexs=%d edges=%d trigs=%d full=%8.3lf ms diff edge +%d -%d trig +%d -%d\n",
+            HASH_COUNT(net->vertexs),HASH_COUNT(net->edges),HASH_COUNT(net->dtrigs),tp*1E-6,n[0],n[1],n[2],n[3]);
+    return n[0]+n[1]+n[2]+n[3];
+}
+
+static void print_bucket(const char *op, int i, uint64_t tsum, uint64_t tmax)
+{
+    fprintf(stdout,"%-9s: %5d-%5d avg=%8.1lf us max=%8.1lf us\n",op,i-NBUCKET+1,i,tsum*1E-3/NBUCKET,tmax*1E-3);
+}
+
+int main(int argc, const char *argv[])
+{
+    cors_dtrig_net_t net;
+    cors_dtrig_edge_t *edge_add,*edge_del;
+    cors_dtrig_t *dtrig_add,*dtrig_del;
+    shadow_t *edges=NULL,*trigs=NULL,*s,*t;
+    double pos[3],rr[3];
+    uint64_t tp,tsum=0,tmax=0;
+    int i,j,k,*ids,nerr=0,nsta=NSTA,ndel=NDEL,nmov=NMOV;
+
+    if (argc>1) nsta=atoi(argv[1]);
+    if (argc>2) ndel=atoi(argv[2]);
+    if (argc>3) nmov=atoi(argv[3]);
+    if (ndel>nsta) ndel=nsta;
+    if (nmov>nsta-ndel) nmov=nsta-ndel;
+
+    srand(12345);
+    cors_dtrignet_init(&net);
+
+    for (i=0;i<nsta;i++) {
+        pos[0]=(30.0+9.0*rand()/RAND_MAX)*D2R;
+        pos[1]=(110.0+10.0*rand()/RAND_MAX)*D2R;
+        pos[2]=100.0*rand()/RAND_MAX;
+        pos2ecef(pos,rr);
+
+        tp=uv_hrtime();
+        cors_dtrignet_add_vertex(&net,rr,i+1,&edge_add,&edge_del,&dtrig_add,&dtrig_del);
+        tp=uv_hrtime()-tp;
+        tsum+=tp; if (tp>tmax) tmax=tp;
+        if ((i+1)%NBUCKET==0) {print_bucket("insert",i+1,tsum,tmax); tsum=tmax=0;}
+
+        nerr+=apply_diff(&edges,&trigs,&edge_add,&edge_del,&dtrig_add,&dtrig_del);
+    }
+    nerr+=check_shadow(&net,edges,trigs);
+    nerr+=check_rebuild(&net);
+
+    /* delete random stations */
+    ids=malloc(sizeof(int)*nsta);
+    for (i=0;i<nsta;i++) ids[i]=i+1;
+    for (i=nsta-1;i>0;i--) {j=rand()%(i+1); k=ids[i]; ids[i]=ids[j]; ids[j]=k;}
+
+    for (i=0;i<ndel;i++) {
+        tp=uv_hrtime();
+        cors_dtrignet_del_vertex(&net,ids[i],&edge_add,&edge_del,&dtrig_add,&dtrig_del);
+        tp=uv_hrtime()-tp;
+        tsum+=tp; if (tp>tmax) tmax=tp;
+        if ((i+1)%NBUCKET==0) {print_bucket("delete",i+1,tsum,tmax); tsum=tmax=0;}
+
+        nerr+=apply_diff(&edges,&trigs,&edge_add,&edge_del,&dtrig_add,&dtrig_del);
+    }
+    nerr+=check_shadow(&net,edges,trigs);
+    nerr+=check_rebuild(&net);
+
+    /* move remaining stations (re-surveyed or wrong 1005 position) */
+    nerr+=link_bls(&net,net.edges);
+
+    for (i=0;i<nmov;i++) {
+        pos[0]=(30.0+9.0*rand()/RAND_MAX)*D2R;
+        pos[1]=(110.0+10.0*rand()/RAND_MAX)*D2R;
+        pos[2]=100.0*rand()/RAND_MAX;
+        pos2ecef(pos,rr);
+
+        tp=uv_hrtime();
+        if (!cors_dtrignet_upd_vertex(&net,rr,ids[ndel+i],&edge_add,&edge_del,&dtrig_add,&dtrig_del)) nerr++;
+        tp=uv_hrtime()-tp;
+        tsum+=tp; if (tp>tmax) tmax=tp;
+        if ((i+1)%NBUCKET==0) {print_bucket("move",i+1,tsum,tmax); tsum=tmax=0;}
+
+        /* every edge kept or added by move has its baseline */
+        nerr+=link_bls(&net,edge_add);
+        nerr+=apply_diff(&edges,&trigs,&edge_add,&edge_del,&dtrig_add,&dtrig_del);
+
+        /* repeated position is no change */
+        if (cors_dtrignet_upd_vertex(&net,rr,ids[ndel+i],&edge_add,&edge_del,&dtrig_add,&dtrig_del)) nerr++;
+        nerr+=apply_diff(&edges,&trigs,&edge_add,&edge_del,&dtrig_add,&dtrig_del);
+    }
+    nerr+=check_shadow(&net,edges,trigs);
+    nerr+=check_rebuild(&net);
+
+    fprintf(stdout,"result   : %s (err=%d)\n",nerr?"NG":"OK",nerr);
+
+    HASH_ITER(hh,edges,s,t) {HASH_DEL(edges,s); free(s);}
+    HASH_ITER(hh,trigs,s,t) {HASH_DEL(trigs,s); free(s);}
+    free(ids);
+    cors_dtrignet_free(&net);
+    return nerr?-1:0;
+}